@@ -11,6 +11,8 @@ import { startBookingCleanupJob } from '@/modules/ApartmentListing/models/bookin
 import { startAir4ThaiAggregationJob } from '@/modules/clean-air/services/clean-air-air4thai.scheduler';
 import { startConsecutiveRainAlertJob } from '@/modules/weather/services/weather-rain-alert.scheduler';
 import { enableWeatherAutoImport } from '@/modules/weather/services/weather-auto-import.scheduler';
+import { startDeviceViewMirror } from '@/modules/traffic/services/device-view.service';
+import { startPedestrianCallListener } from '@/modules/traffic/services/pedestrian-call.service';
 import 'dotenv/config';
 
 const app = new OpenAPIHono();
@@ -83,6 +85,8 @@ setupRoutes(app);
 startAir4ThaiAggregationJob();
 startConsecutiveRainAlertJob();
 enableWeatherAutoImport();
+startDeviceViewMirror();
+startPedestrianCallListener();
 
 let serverInstance: ReturnType<typeof serve> | null = null;
 
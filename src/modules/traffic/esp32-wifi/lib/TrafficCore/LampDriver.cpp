@@ -0,0 +1,20 @@
+#include "LampDriver.h"
+
+void MockLampDriver::begin()
+{
+  m_count = 0;
+  m_lamps = 0;
+}
+
+void MockLampDriver::write(uint8_t lamps)
+{
+  lamps &= LAMP_ALL;
+  if (lamps == m_lamps)
+    return;
+
+  // Keeps the first CAPACITY transitions, later ones are only counted
+  if (m_count < CAPACITY)
+    m_log[m_count] = {m_clockUs ? m_clockUs() : 0, m_lamps, lamps};
+  m_count++;
+  m_lamps = lamps;
+}
@@ -0,0 +1,75 @@
+#ifndef TRAFFIC_CORE_LAMP_DRIVER_H
+#define TRAFFIC_CORE_LAMP_DRIVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Lamp driver interface. A driver owns the outputs of one signal head and
+// switches all of its lamps in a single step, so no intermediate lamp
+// combination is ever driven. Hardware backends live in the firmware
+// (src/lamp_driver.h); the mock below records transitions for host tests
+// (tools/lamp_driver_check.cpp).
+
+// Lamp bits of a signal head
+const uint8_t LAMP_RED = 0x01;
+const uint8_t LAMP_YELLOW = 0x02;
+const uint8_t LAMP_GREEN = 0x04;
+const uint8_t LAMP_ALL = LAMP_RED | LAMP_YELLOW | LAMP_GREEN;
+const uint8_t LAMP_BITS = 3;
+
+// color: 1=red, 2=yellow, 3=green, anything else = dark
+constexpr uint8_t lampsForColor(int color)
+{
+  return color == 1 ? LAMP_RED : color == 2 ? LAMP_YELLOW
+                             : color == 3   ? LAMP_GREEN
+                                            : 0;
+}
+
+class LampDriver
+{
+public:
+  virtual ~LampDriver() {}
+
+  // Configure the outputs and switch every lamp off
+  virtual void begin() = 0;
+
+  // Set the head to exactly `lamps` (LAMP_* bits)
+  virtual void write(uint8_t lamps) = 0;
+
+  uint8_t lamps() const { return m_lamps; }
+
+protected:
+  uint8_t m_lamps = 0;
+};
+
+// Records every transition with a timestamp from the supplied clock
+struct LampTransition
+{
+  uint64_t atUs;
+  uint8_t from;
+  uint8_t to;
+};
+
+class MockLampDriver : public LampDriver
+{
+public:
+  static const size_t CAPACITY = 128;
+
+  explicit MockLampDriver(uint64_t (*clockUs)()) : m_clockUs(clockUs) {}
+
+  void begin() override;
+  void write(uint8_t lamps) override;
+
+  // Writes that did not change the lamps are not transitions
+  size_t count() const { return m_count < CAPACITY ? m_count : CAPACITY; }
+  uint32_t dropped() const { return m_count > CAPACITY ? (uint32_t)(m_count - CAPACITY) : 0; }
+  const LampTransition &at(size_t i) const { return m_log[i]; }
+  void clear() { m_count = 0; }
+
+private:
+  uint64_t (*m_clockUs)();
+  LampTransition m_log[CAPACITY];
+  size_t m_count = 0;
+};
+
+#endif
@@ -0,0 +1,144 @@
+#include "LightState.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *const FIELD_NAMES[] = {"color", "remaintime", "yellow_duration", "status", "preempt", "density_level"};
+
+const char *lightFieldName(LightField field)
+{
+  return field < FIELD_UNKNOWN ? FIELD_NAMES[field] : "";
+}
+
+LightField lightFieldFromName(const char *name, size_t len)
+{
+  for (int i = 0; i < FIELD_UNKNOWN; i++)
+  {
+    if (strlen(FIELD_NAMES[i]) == len && memcmp(FIELD_NAMES[i], name, len) == 0)
+      return (LightField)i;
+  }
+  return FIELD_UNKNOWN;
+}
+
+bool setLightField(LightState &state, LightField field, int value)
+{
+  switch (field)
+  {
+  case FIELD_COLOR:
+    if (value < 1 || value > 3 || value == state.color)
+      return false;
+    state.color = value;
+    return true;
+  case FIELD_REMAINTIME:
+    if (value < 0 || value > 9999 || value == state.remaining)
+      return false;
+    state.remaining = value;
+    return true;
+  case FIELD_YELLOW:
+    if (value < 0 || value == state.yellow)
+      return false;
+    state.yellow = value;
+    return true;
+  case FIELD_STATUS:
+    if (value < 0 || value > 2 || value == state.status)
+      return false;
+    state.status = value;
+    return true;
+  case FIELD_DENSITY:
+    if (value < 0 || value > 4 || value == state.density)
+      return false;
+    state.density = value;
+    return true;
+  default:
+    return false;
+  }
+}
+
+// ================= DECODING =================
+
+static const char *findIn(const char *data, const char *end, const char *needle, size_t needleLen)
+{
+  for (const char *p = data; p + needleLen <= end; p++)
+  {
+    if (memcmp(p, needle, needleLen) == 0)
+      return p;
+  }
+  return nullptr;
+}
+
+// atoi-style parse of [begin, end): leading blanks, optional sign, digits
+static int parseInt(const char *begin, const char *end)
+{
+  while (begin < end && (*begin == ' ' || *begin == '\t' || *begin == '\r' || *begin == '\n'))
+    begin++;
+
+  bool negative = false;
+  if (begin < end && (*begin == '-' || *begin == '+'))
+    negative = *begin++ == '-';
+
+  long value = 0;
+  while (begin < end && *begin >= '0' && *begin <= '9' && value < 100000000L)
+    value = value * 10 + (*begin++ - '0');
+  return (int)(negative ? -value : value);
+}
+
+bool readJsonInt(const char *data, size_t len, const char *key, int &value)
+{
+  const char *end = data + len;
+
+  // Quoted key, so "color" does not match inside another key's name
+  char quoted[24];
+  size_t keyLen = strlen(key);
+  if (keyLen + 2 > sizeof(quoted))
+    return false;
+  quoted[0] = '"';
+  memcpy(quoted + 1, key, keyLen);
+  quoted[keyLen + 1] = '"';
+
+  const char *keyAt = findIn(data, end, quoted, keyLen + 2);
+  if (!keyAt)
+    return false;
+
+  const char *colon = findIn(keyAt, end, ":", 1);
+  if (!colon)
+    return false;
+
+  const char *comma = findIn(colon, end, ",", 1);
+  const char *brace = findIn(colon, end, "}", 1);
+  const char *valueEnd = (comma && (!brace || comma < brace)) ? comma : brace;
+  if (!valueEnd)
+    return false;
+
+  value = parseInt(colon + 1, valueEnd);
+  return true;
+}
+
+size_t decodeStreamUpdate(const char *path, size_t pathLen, const char *data, size_t dataLen,
+                          FieldUpdate *out)
+{
+  // Single field ("/color", "/remaintime", ...)
+  if (pathLen > 1 || (pathLen == 1 && path[0] != '/'))
+  {
+    const char *name = path + pathLen;
+    while (name > path && name[-1] != '/')
+      name--;
+
+    LightField field = lightFieldFromName(name, path + pathLen - name);
+    if (field == FIELD_UNKNOWN)
+      return 0;
+
+    out[0] = {field, parseInt(data, data + dataLen)};
+    return 1;
+  }
+
+  // Full or partial object
+  static const LightField order[] = {FIELD_PREEMPT, FIELD_DENSITY, FIELD_COLOR, FIELD_YELLOW,
+                                      FIELD_REMAINTIME, FIELD_STATUS};
+  size_t count = 0;
+  for (LightField field : order)
+  {
+    int value;
+    if (readJsonInt(data, dataLen, lightFieldName(field), value))
+      out[count++] = {field, value};
+  }
+  return count;
+}
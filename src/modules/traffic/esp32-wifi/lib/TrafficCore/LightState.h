@@ -0,0 +1,61 @@
+#ifndef TRAFFIC_CORE_LIGHT_STATE_H
+#define TRAFFIC_CORE_LIGHT_STATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Render state of one light and the decoding of the stream events that
+// change it. Plain C++ (no Arduino dependencies) so the host fleet simulator
+// (tools/fleet_sim.cpp) runs exactly the same decode and validation as the
+// firmware.
+
+enum LightField
+{
+  FIELD_COLOR = 0,
+  FIELD_REMAINTIME,
+  FIELD_YELLOW,
+  FIELD_STATUS,
+  FIELD_PREEMPT,
+  FIELD_DENSITY,
+  FIELD_UNKNOWN
+};
+
+// Database key of a field ("color", "remaintime", ...) and back
+const char *lightFieldName(LightField field);
+LightField lightFieldFromName(const char *name, size_t len);
+
+struct LightState
+{
+  int color = 1;     // 1=red, 2=yellow, 3=green
+  int remaining = 0; // seconds
+  int status = 0;    // 0=active, 1=broken, 2=fixing
+  int yellow = 0;    // yellow duration in seconds
+  int density = 0;   // density level 1-4 for the local plan, 0=unknown
+};
+
+// Store `value` in `state` if it is valid for `field`. Returns false for an
+// invalid value, an unchanged value and for preempt, which is not part of
+// the render state.
+bool setLightField(LightState &state, LightField field, int value);
+
+// Extract an integer field from a flat JSON object (missing/null -> false or 0)
+bool readJsonInt(const char *data, size_t len, const char *key, int &value);
+
+struct FieldUpdate
+{
+  LightField field;
+  int value;
+};
+
+const size_t MAX_FIELD_UPDATES = 6;
+
+// Decode one stream event into the field updates it carries, in the order
+// they must be applied. A full or partial object at "" or "/" yields preempt
+// first, then density_level, color, yellow_duration, remaintime and status
+// (yellow before remaintime so a green countdown is shown with the new
+// yellow). A single field at "/<field>" yields that field only. Returns the
+// number of updates.
+size_t decodeStreamUpdate(const char *path, size_t pathLen, const char *data, size_t dataLen,
+                          FieldUpdate *out);
+
+#endif
@@ -0,0 +1,207 @@
+#include "PhaseSync.h"
+
+static const uint8_t MAGIC_0 = 'T';
+static const uint8_t MAGIC_1 = 'L';
+
+static void putU16(uint8_t *p, uint16_t v)
+{
+  p[0] = v & 0xFF;
+  p[1] = v >> 8;
+}
+
+static void putU32(uint8_t *p, uint32_t v)
+{
+  for (int i = 0; i < 4; i++)
+    p[i] = (v >> (8 * i)) & 0xFF;
+}
+
+static uint16_t getU16(const uint8_t *p)
+{
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t getU32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// ================= ENCODING =================
+
+static bool tagMatches(const uint8_t *a, const uint8_t *b)
+{
+  uint8_t diff = 0;
+  for (size_t i = 0; i < PHASE_TICK_TAG_SIZE; i++)
+    diff |= a[i] ^ b[i];
+  return diff == 0;
+}
+
+size_t encodePhaseTick(const PhaseTick &tick, const PhaseTickKey &key, uint8_t *buf, size_t len)
+{
+  if (len < PHASE_TICK_SIZE || !key.hmac || key.len == 0)
+    return 0;
+
+  buf[0] = MAGIC_0;
+  buf[1] = MAGIC_1;
+  buf[2] = tick.version;
+  buf[3] = tick.flags;
+  putU16(buf + 4, tick.group);
+  buf[6] = tick.phase;
+  buf[7] = tick.color;
+  buf[8] = tick.status;
+  buf[9] = tick.yellow;
+  putU16(buf + 10, tick.remaining);
+  putU16(buf + 12, tick.elapsed);
+  putU32(buf + 14, tick.boardId);
+  putU32(buf + 18, tick.epoch);
+  putU32(buf + 22, tick.seq);
+
+  uint8_t mac[32];
+  key.hmac(key.key, key.len, buf, PHASE_TICK_BODY_SIZE, mac);
+  for (size_t i = 0; i < PHASE_TICK_TAG_SIZE; i++)
+    buf[PHASE_TICK_BODY_SIZE + i] = mac[i];
+  return PHASE_TICK_SIZE;
+}
+
+bool decodePhaseTick(const uint8_t *buf, size_t len, const PhaseTickKey &key, PhaseTick &tick)
+{
+  if (len != PHASE_TICK_SIZE || buf[0] != MAGIC_0 || buf[1] != MAGIC_1 || buf[2] != PHASE_TICK_VERSION)
+    return false;
+  if (!key.hmac || key.len == 0)
+    return false;
+
+  uint8_t mac[32];
+  key.hmac(key.key, key.len, buf, PHASE_TICK_BODY_SIZE, mac);
+  if (!tagMatches(mac, buf + PHASE_TICK_BODY_SIZE))
+    return false;
+
+  tick.version = buf[2];
+  tick.flags = buf[3];
+  tick.group = getU16(buf + 4);
+  tick.phase = buf[6];
+  tick.color = buf[7];
+  tick.status = buf[8];
+  tick.yellow = buf[9];
+  tick.remaining = getU16(buf + 10);
+  tick.elapsed = getU16(buf + 12);
+  tick.boardId = getU32(buf + 14);
+  tick.epoch = getU32(buf + 18);
+  tick.seq = getU32(buf + 22);
+
+  return tick.color >= 1 && tick.color <= 3 && tick.phase <= 1;
+}
+
+// ================= REPLAY GUARD =================
+
+bool TickReplayGuard::accept(const PhaseTick &tick)
+{
+  m_heard++;
+
+  Peer *peer = nullptr;
+  for (size_t i = 0; i < m_count; i++)
+  {
+    if (m_peers[i].boardId == tick.boardId)
+      peer = &m_peers[i];
+  }
+
+  if (peer)
+  {
+    bool newer = tick.epoch > peer->epoch || (tick.epoch == peer->epoch && tick.seq > peer->seq);
+    if (!newer)
+    {
+      m_refused++;
+      return false;
+    }
+  }
+  else if (m_count < MAX_PEERS)
+  {
+    peer = &m_peers[m_count++];
+  }
+  else
+  {
+    peer = &m_peers[0];
+    for (size_t i = 1; i < m_count; i++)
+    {
+      if (m_peers[i].heard < peer->heard)
+        peer = &m_peers[i];
+    }
+  }
+
+  peer->boardId = tick.boardId;
+  peer->epoch = tick.epoch;
+  peer->seq = tick.seq;
+  peer->heard = m_heard;
+  return true;
+}
+
+// ================= PHASE MAPPING =================
+
+void mapPeerPhase(const PhaseTick &tick, uint8_t ownPhase, int &color, int &remaining)
+{
+  remaining = tick.remaining;
+
+  if (ownPhase == tick.phase)
+  {
+    color = tick.color;
+    return;
+  }
+
+  if ((tick.flags & PHASE_FLAG_PREEMPT) || tick.color != 1)
+  {
+    // Leader green/yellow (or preempting): cross phase waits until the leader turns red
+    color = 1;
+    return;
+  }
+
+  // Leader red: all red first, so the leader's lamps are out before the cross
+  // phase starts, and again before the leader's red ends, so the cross phase
+  // is red before the leader turns green. A few ms of network jitter stay
+  // well inside either interval.
+  if (tick.elapsed < PHASE_CLEARANCE_S || tick.remaining <= PHASE_CLEARANCE_S)
+  {
+    color = 1;
+    return;
+  }
+
+  // In between the cross phase runs green, ending with its own yellow
+  remaining = tick.remaining - PHASE_CLEARANCE_S;
+  color = (remaining > tick.yellow) ? 3 : 2;
+}
+
+// ================= ELECTION =================
+
+void PeerElection::start(uint32_t nowMs)
+{
+  m_startMs = nowMs;
+  m_started = true;
+  m_heardAny = false;
+  m_leaderId = m_ownId;
+}
+
+bool PeerElection::heard(uint32_t boardId, uint32_t nowMs)
+{
+  if (boardId == m_ownId)
+    return false;
+
+  // A lower id always takes over; the current leader refreshes its lease
+  if (boardId < m_ownId && (!hasLeader(nowMs) || boardId <= m_leaderId))
+  {
+    m_leaderId = boardId;
+    m_lastHeardMs = nowMs;
+    m_heardAny = true;
+    return true;
+  }
+
+  return false;
+}
+
+bool PeerElection::hasLeader(uint32_t nowMs) const
+{
+  return m_heardAny && m_leaderId != m_ownId && nowMs - m_lastHeardMs < m_timeoutMs;
+}
+
+bool PeerElection::isLeader(uint32_t nowMs) const
+{
+  if (!m_started || hasLeader(nowMs))
+    return false;
+  return nowMs - m_startMs >= m_timeoutMs;
+}
@@ -0,0 +1,126 @@
+#ifndef TRAFFIC_CORE_PHASE_SYNC_H
+#define TRAFFIC_CORE_PHASE_SYNC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Peer phase synchronization between boards at the same intersection.
+// Plain C++ (no Arduino dependencies) so the encoding, election and phase
+// mapping can also be built on a host.
+
+const uint8_t PHASE_TICK_VERSION = 2;
+const size_t PHASE_TICK_BODY_SIZE = 26;
+const size_t PHASE_TICK_TAG_SIZE = 16; // HMAC-SHA256 of the body, truncated
+const size_t PHASE_TICK_SIZE = PHASE_TICK_BODY_SIZE + PHASE_TICK_TAG_SIZE;
+
+// Tick flags
+const uint8_t PHASE_FLAG_PREEMPT = 0x01; // leader is running an emergency preemption
+
+// All red between the two phases, in seconds
+const uint8_t PHASE_CLEARANCE_S = 2;
+
+// Compact phase tick broadcast by the leader (42 bytes on the wire)
+struct PhaseTick
+{
+  uint8_t version = PHASE_TICK_VERSION;
+  uint8_t flags = 0;
+  uint16_t group = 0;     // intersection id shared by all peers
+  uint8_t phase = 0;      // intersection phase the leader's lamp belongs to (0 or 1)
+  uint8_t color = 0;      // 1=red, 2=yellow, 3=green
+  uint8_t status = 0;     // 0=active, 1=broken, 2=fixing
+  uint8_t yellow = 0;     // yellow duration in seconds
+  uint16_t remaining = 0; // seconds left in the current color
+  uint16_t elapsed = 0;   // seconds since the leader's color last changed
+  uint32_t boardId = 0;   // election key, the lowest id wins
+  uint32_t epoch = 0;     // sender's boot count, kept in NVS
+  uint32_t seq = 0;       // increments with every tick sent, from 1 at boot
+};
+
+// HMAC-SHA256 of data under key into mac (32 bytes). The library has no
+// crypto of its own: the firmware passes mbedtls, host tools OpenSSL.
+typedef void (*TickHmacFn)(const uint8_t *key, size_t keyLen, const uint8_t *data, size_t len, uint8_t *mac);
+
+// Key shared by every board in a group
+struct PhaseTickKey
+{
+  const uint8_t *key = nullptr;
+  size_t len = 0;
+  TickHmacFn hmac = nullptr;
+};
+
+// Encodes and signs a tick; returns 0 if the buffer is too small or there is no key
+size_t encodePhaseTick(const PhaseTick &tick, const PhaseTickKey &key, uint8_t *buf, size_t len);
+
+// False unless the tag matches under the group key (compared in constant
+// time) and the fields are in range
+bool decodePhaseTick(const uint8_t *buf, size_t len, const PhaseTickKey &key, PhaseTick &tick);
+
+// Refuses a tick unless (epoch, seq) is above the last one accepted from the
+// same board, so a recorded tick cannot be played again. A rebooted leader
+// starts a new epoch and is not refused. Boards are tracked in a fixed
+// table; when it is full the least recently heard one makes room. A board
+// that reboots itself forgets the table and takes the first valid tick it
+// hears from each peer.
+class TickReplayGuard
+{
+public:
+  bool accept(const PhaseTick &tick);
+  uint32_t refused() const { return m_refused; }
+
+  static const size_t MAX_PEERS = 8;
+
+private:
+  struct Peer
+  {
+    uint32_t boardId;
+    uint32_t epoch;
+    uint32_t seq;
+    uint32_t heard; // m_heard when last accepted
+  };
+
+  Peer m_peers[MAX_PEERS];
+  size_t m_count = 0;
+  uint32_t m_heard = 0;
+  uint32_t m_refused = 0;
+};
+
+// Lamp state for a board in phase `ownPhase`, derived from the leader's tick.
+// Boards in the same phase mirror the leader. Boards in the other phase get
+// green while the leader is red, and red otherwise, with PHASE_CLEARANCE_S
+// of all red at both ends: for the first seconds of the leader's red, and
+// from that many seconds before it ends (their own yellow comes before that).
+// Opposite boards also hold red while the leader is preempting.
+void mapPeerPhase(const PhaseTick &tick, uint8_t ownPhase, int &color, int &remaining);
+
+// Lowest-id-wins leader election. A board leads unless it heard a tick from
+// a lower id within the timeout; it waits one timeout after start before
+// claiming leadership so it does not fight an existing leader. Only pass
+// heard() ticks that decodePhaseTick() and TickReplayGuard accepted, or any
+// host on the LAN can claim id 0.
+class PeerElection
+{
+public:
+  explicit PeerElection(uint32_t ownId, uint32_t timeoutMs = 1500)
+      : m_ownId(ownId), m_timeoutMs(timeoutMs) {}
+
+  void start(uint32_t nowMs);
+
+  // Record a tick heard from `boardId`; returns true if it came from the
+  // board this one should follow
+  bool heard(uint32_t boardId, uint32_t nowMs);
+
+  bool isLeader(uint32_t nowMs) const;
+  bool hasLeader(uint32_t nowMs) const;
+  uint32_t leaderId() const { return m_leaderId; }
+
+private:
+  uint32_t m_ownId;
+  uint32_t m_timeoutMs;
+  uint32_t m_startMs = 0;
+  uint32_t m_leaderId = 0;
+  uint32_t m_lastHeardMs = 0;
+  bool m_started = false;
+  bool m_heardAny = false;
+};
+
+#endif
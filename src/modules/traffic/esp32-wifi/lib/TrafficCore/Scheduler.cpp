@@ -0,0 +1,141 @@
+#include "Scheduler.h"
+
+int Scheduler::refuse(const char *name)
+{
+  if (m_rejected++ == 0)
+    m_firstRejected = name;
+  return NO_JOB;
+}
+
+int Scheduler::add(const char *name, JobFn fn)
+{
+  if (m_count >= SCHEDULER_MAX_JOBS || fn == nullptr)
+    return refuse(name);
+
+  Job &job = m_jobs[m_count];
+  job.name = name;
+  job.fn = fn;
+  return m_count++;
+}
+
+int Scheduler::every(const char *name, uint32_t periodMs, JobFn fn, uint64_t nowUs)
+{
+  // periodUs would wrap
+  if (periodMs > SCHEDULER_MAX_PERIOD_MS)
+    return refuse(name);
+
+  int id = add(name, fn);
+  if (id == NO_JOB)
+    return NO_JOB;
+
+  m_jobs[id].periodUs = periodMs * 1000UL;
+  after(id, periodMs, nowUs);
+  return id;
+}
+
+int Scheduler::oneShot(const char *name, JobFn fn)
+{
+  return add(name, fn);
+}
+
+void Scheduler::after(int id, uint32_t delayMs, uint64_t nowUs)
+{
+  if (id < 0 || id >= m_count)
+    return;
+
+  m_jobs[id].deadlineUs = nowUs + (uint64_t)delayMs * 1000ULL;
+  m_jobs[id].armed = true;
+}
+
+void Scheduler::setPeriod(int id, uint32_t periodMs)
+{
+  if (id >= 0 && id < m_count && periodMs <= SCHEDULER_MAX_PERIOD_MS)
+    m_jobs[id].periodUs = periodMs * 1000UL;
+}
+
+void Scheduler::cancel(int id)
+{
+  if (id >= 0 && id < m_count)
+    m_jobs[id].armed = false;
+}
+
+bool Scheduler::armed(int id) const
+{
+  return id >= 0 && id < m_count && m_jobs[id].armed;
+}
+
+int Scheduler::nextDue(uint64_t nowUs, const bool *ran) const
+{
+  int best = NO_JOB;
+  for (int i = 0; i < m_count; i++)
+  {
+    const Job &job = m_jobs[i];
+    if (ran[i] || !job.armed || job.deadlineUs > nowUs)
+      continue;
+    if (best == NO_JOB || job.deadlineUs < m_jobs[best].deadlineUs)
+      best = i;
+  }
+  return best;
+}
+
+void Scheduler::run(ClockFn clockUs)
+{
+  // Each due job runs at most once per call, so a job that re-arms itself
+  // with a zero delay can't starve the others
+  bool ran[SCHEDULER_MAX_JOBS] = {};
+
+  uint64_t nowUs;
+  int id;
+  while ((id = nextDue(nowUs = clockUs(), ran)) != NO_JOB)
+  {
+    Job &job = m_jobs[id];
+    ran[id] = true;
+
+    uint32_t lateUs = (uint32_t)(nowUs - job.deadlineUs);
+    JobStats &stats = job.stats;
+    if (stats.runs == 0 || lateUs < stats.minLateUs)
+      stats.minLateUs = lateUs;
+    if (lateUs > stats.maxLateUs)
+      stats.maxLateUs = lateUs;
+    stats.totalLateUs += lateUs;
+    stats.runs++;
+
+    if (job.periodUs > 0)
+    {
+      // Fixed rate; after a long stall, skip the missed runs instead of bursting
+      job.deadlineUs += job.periodUs;
+      if (job.deadlineUs <= nowUs)
+        job.deadlineUs = nowUs + job.periodUs;
+    }
+    else
+    {
+      job.armed = false;
+    }
+
+    job.fn();
+  }
+}
+
+uint32_t Scheduler::untilNextUs(uint64_t nowUs) const
+{
+  uint64_t best = UINT64_MAX;
+  for (int i = 0; i < m_count; i++)
+  {
+    const Job &job = m_jobs[i];
+    if (job.armed && job.deadlineUs < best)
+      best = job.deadlineUs;
+  }
+
+  if (best == UINT64_MAX)
+    return UINT32_MAX;
+  if (best <= nowUs)
+    return 0;
+  uint64_t waitUs = best - nowUs;
+  return waitUs > UINT32_MAX ? UINT32_MAX : (uint32_t)waitUs;
+}
+
+void Scheduler::resetStats()
+{
+  for (int i = 0; i < m_count; i++)
+    m_jobs[i].stats = JobStats();
+}
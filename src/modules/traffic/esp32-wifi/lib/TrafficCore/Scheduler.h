@@ -0,0 +1,94 @@
+#ifndef TRAFFIC_CORE_SCHEDULER_H
+#define TRAFFIC_CORE_SCHEDULER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Cooperative deadline scheduler for the main loop. Jobs are periodic or
+// one-shot and run from run() once their deadline has passed; the loop then
+// sleeps for untilNextUs(). Time is a 64-bit microsecond clock passed in by
+// the caller (esp_timer_get_time() on the board), so there is no wraparound
+// and the class can be built and driven on a host.
+//
+// The job table is fixed. A job that does not fit is refused and counted in
+// rejected(); the caller checks that once all jobs are registered, since a
+// refused job would otherwise just never run.
+//
+// Periods are kept in 32-bit microseconds, so a periodic job runs at least
+// every SCHEDULER_MAX_PERIOD_MS (about 71 minutes). every() refuses a longer
+// period like a full table; one-shot delays are not limited.
+//
+// A job's lateness is how long after its deadline it actually ran; the
+// spread between its smallest and largest lateness is its jitter.
+
+typedef void (*JobFn)();
+typedef uint64_t (*ClockFn)(); // microseconds
+
+const int SCHEDULER_MAX_JOBS = 16;
+const int NO_JOB = -1;
+const uint32_t SCHEDULER_MAX_PERIOD_MS = UINT32_MAX / 1000; // 4294967 ms
+
+struct JobStats
+{
+  uint32_t runs = 0;
+  uint32_t minLateUs = 0;
+  uint32_t maxLateUs = 0;
+  uint64_t totalLateUs = 0;
+
+  uint32_t avgLateUs() const { return runs > 0 ? (uint32_t)(totalLateUs / runs) : 0; }
+  uint32_t jitterUs() const { return maxLateUs - minLateUs; }
+};
+
+struct Job
+{
+  const char *name = nullptr;
+  JobFn fn = nullptr;
+  uint64_t deadlineUs = 0;
+  uint32_t periodUs = 0; // 0 = one-shot
+  bool armed = false;
+  JobStats stats;
+};
+
+class Scheduler
+{
+public:
+  // Register a job; returns its id, or NO_JOB (counted in rejected()) when
+  // the table is full or the period is over SCHEDULER_MAX_PERIOD_MS.
+  // A periodic job first runs one period from now.
+  int every(const char *name, uint32_t periodMs, JobFn fn, uint64_t nowUs);
+
+  // Register a one-shot job that stays disarmed until after() is called
+  int oneShot(const char *name, JobFn fn);
+
+  // (Re)arm a job to run delayMs from now; periodic jobs keep their period
+  void after(int id, uint32_t delayMs, uint64_t nowUs);
+  void setPeriod(int id, uint32_t periodMs); // ignored over SCHEDULER_MAX_PERIOD_MS
+  void cancel(int id);
+  bool armed(int id) const;
+
+  // Run every job whose deadline has passed, earliest first. The clock is
+  // read again before each job, so lateness includes the time the jobs ahead
+  // of it took, and a job that came due meanwhile runs in the same pass.
+  void run(ClockFn clockUs);
+
+  // Time until the earliest armed deadline (0 if one is due, UINT32_MAX if none)
+  uint32_t untilNextUs(uint64_t nowUs) const;
+
+  int size() const { return m_count; }
+  int rejected() const { return m_rejected; }
+  const char *firstRejected() const { return m_firstRejected; }
+  const Job &job(int id) const { return m_jobs[id]; }
+  void resetStats();
+
+private:
+  int refuse(const char *name);
+  int add(const char *name, JobFn fn);
+  int nextDue(uint64_t nowUs, const bool *ran) const;
+
+  Job m_jobs[SCHEDULER_MAX_JOBS];
+  int m_count = 0;
+  int m_rejected = 0;
+  const char *m_firstRejected = nullptr;
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef TRAFFIC_CORE_SPSC_RING_H
+#define TRAFFIC_CORE_SPSC_RING_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Lock-free single-producer, single-consumer ring. Made for handing events
+// from an ISR (producer) to the main loop (consumer): neither side waits or
+// masks interrupts, and a full ring drops the new item and counts it instead
+// of overwriting one the consumer may be reading.
+//
+// Each index is written by one side only. The producer publishes an item by
+// storing the new head after the item itself (release), the consumer frees
+// the slot by storing the new tail after copying it out. The indices run
+// freely and wrap at 2^32, so Size has to be a power of two.
+//
+// push() is forced inline so it ends up inside an IRAM_ATTR ISR on the board.
+
+template <typename T, size_t Size>
+class SpscRing
+{
+  static_assert(Size >= 2 && (Size & (Size - 1)) == 0, "ring size must be a power of two");
+
+public:
+  // Producer side
+  inline __attribute__((always_inline)) bool push(const T &item)
+  {
+    uint32_t head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail.load(std::memory_order_acquire) >= Size)
+    {
+      m_dropped.store(m_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return false;
+    }
+    m_items[head & (Size - 1)] = item;
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side
+  bool pop(T &item)
+  {
+    uint32_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail == m_head.load(std::memory_order_acquire))
+      return false;
+    item = m_items[tail & (Size - 1)];
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Either side; a snapshot that may be stale by the time it is used
+  size_t size() const { return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire); }
+
+  static constexpr size_t capacity() { return Size; }
+
+  // Items the producer could not push because the ring was full
+  uint32_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+  T m_items[Size];
+  std::atomic<uint32_t> m_head{0};
+  std::atomic<uint32_t> m_tail{0};
+  std::atomic<uint32_t> m_dropped{0};
+};
+
+#endif
@@ -0,0 +1,140 @@
+#include "StreamTrace.h"
+#include <string.h>
+
+static void putU16(uint8_t *p, uint16_t v)
+{
+  p[0] = v & 0xFF;
+  p[1] = v >> 8;
+}
+
+static void putU32(uint8_t *p, uint32_t v)
+{
+  for (int i = 0; i < 4; i++)
+    p[i] = (v >> (8 * i)) & 0xFF;
+}
+
+static uint16_t getU16(const uint8_t *p)
+{
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t getU32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// ================= WRITING =================
+
+void TraceBlockWriter::begin(uint32_t seq, uint16_t flags)
+{
+  memset(m_buf, 0, sizeof(m_buf));
+  m_used = TRACE_BLOCK_HEADER;
+  m_seq = seq;
+  m_flags = flags;
+  m_records = 0;
+  writeHeader();
+}
+
+void TraceBlockWriter::writeHeader()
+{
+  putU32(m_buf, TRACE_MAGIC);
+  putU32(m_buf + 4, m_seq);
+  putU16(m_buf + 8, (uint16_t)m_used);
+  putU16(m_buf + 10, m_flags);
+}
+
+bool TraceBlockWriter::append(uint32_t atMs, const char *event, size_t eventLen, const char *path,
+                              size_t pathLen, const char *data, size_t dataLen)
+{
+  if (eventLen > 255)
+    eventLen = 255;
+  if (pathLen > 255)
+    pathLen = 255;
+
+  size_t fixed = TRACE_RECORD_HEADER + eventLen + pathLen;
+  size_t room = TRACE_BLOCK_SIZE - TRACE_BLOCK_HEADER;
+  bool truncated = false;
+
+  // Too big for any block: keep what fits in an empty one
+  if (fixed + dataLen > room)
+  {
+    if (m_records > 0)
+      return false;
+    if (fixed > room)
+      return false;
+    dataLen = room - fixed;
+    truncated = true;
+  }
+
+  if (m_used + fixed + dataLen > TRACE_BLOCK_SIZE)
+    return false;
+
+  uint8_t *p = m_buf + m_used;
+  putU32(p, atMs);
+  putU16(p + 4, (uint16_t)dataLen | (truncated ? TRACE_DATA_TRUNCATED : 0));
+  p[6] = (uint8_t)eventLen;
+  p[7] = (uint8_t)pathLen;
+  p += TRACE_RECORD_HEADER;
+  memcpy(p, event, eventLen);
+  memcpy(p + eventLen, path, pathLen);
+  memcpy(p + eventLen + pathLen, data, dataLen);
+
+  m_used += fixed + dataLen;
+  m_records++;
+  writeHeader();
+  return true;
+}
+
+// ================= READING =================
+
+bool readTraceBlockHeader(const uint8_t *block, uint32_t &seq, uint16_t &flags)
+{
+  if (getU32(block) != TRACE_MAGIC)
+    return false;
+
+  uint16_t used = getU16(block + 8);
+  if (used < TRACE_BLOCK_HEADER || used > TRACE_BLOCK_SIZE)
+    return false;
+
+  seq = getU32(block + 4);
+  flags = getU16(block + 10);
+  return true;
+}
+
+size_t forEachTraceRecord(const uint8_t *block, void (*fn)(const TraceRecord &record, void *ctx), void *ctx)
+{
+  uint32_t seq;
+  uint16_t flags;
+  if (!readTraceBlockHeader(block, seq, flags))
+    return 0;
+
+  size_t used = getU16(block + 8);
+  size_t pos = TRACE_BLOCK_HEADER;
+  size_t count = 0;
+
+  while (pos + TRACE_RECORD_HEADER <= used)
+  {
+    const uint8_t *p = block + pos;
+    uint16_t dataField = getU16(p + 4);
+
+    TraceRecord record;
+    record.atMs = getU32(p);
+    record.dataLen = dataField & ~TRACE_DATA_TRUNCATED;
+    record.truncated = (dataField & TRACE_DATA_TRUNCATED) != 0;
+    record.eventLen = p[6];
+    record.pathLen = p[7];
+
+    size_t size = TRACE_RECORD_HEADER + record.eventLen + record.pathLen + record.dataLen;
+    if (pos + size > used)
+      break;
+
+    record.event = (const char *)p + TRACE_RECORD_HEADER;
+    record.path = record.event + record.eventLen;
+    record.data = record.path + record.pathLen;
+
+    fn(record, ctx);
+    count++;
+    pos += size;
+  }
+  return count;
+}
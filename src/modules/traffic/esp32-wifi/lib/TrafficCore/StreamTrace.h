@@ -0,0 +1,75 @@
+#ifndef TRAFFIC_CORE_STREAM_TRACE_H
+#define TRAFFIC_CORE_STREAM_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Stream trace format, written by the firmware (src/stream_trace.cpp) and
+// read back on a host (tools/trace_replay.cpp).
+//
+// A trace file is a ring of fixed-size blocks. Every block starts with a
+// header carrying a sequence number, and records never cross a block, so a
+// reader orders the blocks by sequence and parses each one on its own
+// without looking for record boundaries in an overwritten region.
+//
+//   block:  magic u32 | seq u32 | used u16 | flags u16 | records...
+//   record: atMs u32 | dataLen u16 | eventLen u8 | pathLen u8 | event | path | data
+//
+// All integers little endian.
+
+const uint32_t TRACE_MAGIC = 0x52544C54; // "TLTR"
+const size_t TRACE_BLOCK_SIZE = 2048;
+const size_t TRACE_BLOCK_HEADER = 12;
+const size_t TRACE_RECORD_HEADER = 8;
+
+// Block flags
+const uint16_t TRACE_BLOCK_BOOT = 0x0001; // first block written after a boot
+
+// dataLen flag: the data did not fit in a block and was cut
+const uint16_t TRACE_DATA_TRUNCATED = 0x8000;
+
+struct TraceRecord
+{
+  uint32_t atMs; // millis() when the event reached the stream callback
+  const char *event;
+  size_t eventLen;
+  const char *path;
+  size_t pathLen;
+  const char *data;
+  size_t dataLen;
+  bool truncated;
+};
+
+class TraceBlockWriter
+{
+public:
+  // Start an empty block; the unused tail is always zero
+  void begin(uint32_t seq, uint16_t flags = 0);
+
+  // Append one record. Returns false if it does not fit in what is left of
+  // this block; a record too big for any block is cut to fit an empty one.
+  bool append(uint32_t atMs, const char *event, size_t eventLen, const char *path, size_t pathLen,
+              const char *data, size_t dataLen);
+
+  uint32_t seq() const { return m_seq; }
+  uint16_t records() const { return m_records; }
+  bool empty() const { return m_records == 0; }
+  const uint8_t *bytes() const { return m_buf; }
+
+private:
+  void writeHeader();
+
+  uint8_t m_buf[TRACE_BLOCK_SIZE] = {};
+  size_t m_used = TRACE_BLOCK_HEADER;
+  uint32_t m_seq = 0;
+  uint16_t m_flags = 0;
+  uint16_t m_records = 0;
+};
+
+// Header of a block read back; false for an unused or foreign block
+bool readTraceBlockHeader(const uint8_t *block, uint32_t &seq, uint16_t &flags);
+
+// Call `fn` for each record of a block in order; returns the record count
+size_t forEachTraceRecord(const uint8_t *block, void (*fn)(const TraceRecord &record, void *ctx), void *ctx);
+
+#endif
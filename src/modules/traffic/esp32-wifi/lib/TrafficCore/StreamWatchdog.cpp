@@ -0,0 +1,54 @@
+#include "StreamWatchdog.h"
+
+void StreamWatchdog::opened(uint32_t nowMs)
+{
+  m_openedMs = nowMs;
+  m_lastEventMs = nowMs;
+}
+
+bool StreamWatchdog::event(uint32_t nowMs)
+{
+  m_lastEventMs = nowMs;
+  if (m_up)
+    return false;
+
+  m_up = true;
+  lastOutageMs = nowMs - m_downMs;
+  if (lastOutageMs > maxOutageMs)
+    maxOutageMs = lastOutageMs;
+  return true;
+}
+
+bool StreamWatchdog::failed(uint32_t nowMs)
+{
+  if (!m_up)
+    return false;
+  goDown(nowMs);
+  // The client reconnects by itself after an error; give it a reopen
+  // interval before check() steps in
+  m_openedMs = nowMs;
+  return true;
+}
+
+bool StreamWatchdog::check(uint32_t nowMs)
+{
+  if (m_up)
+  {
+    if (nowMs - m_lastEventMs < m_staleMs)
+      return false;
+    silences++;
+    goDown(nowMs);
+  }
+  else if (nowMs - m_openedMs < m_reopenMs)
+    return false;
+
+  reopens++;
+  return true;
+}
+
+void StreamWatchdog::goDown(uint32_t nowMs)
+{
+  m_up = false;
+  m_downMs = nowMs;
+  outages++;
+}
@@ -0,0 +1,63 @@
+#ifndef TRAFFIC_CORE_STREAM_WATCHDOG_H
+#define TRAFFIC_CORE_STREAM_WATCHDOG_H
+
+#include <stdint.h>
+
+// Liveness of the database stream as the board sees it. The server sends an
+// event at least every STREAM_KEEPALIVE_MS (a keep-alive when nothing
+// changed), so a stream that stays silent much longer than that is dead even
+// if its socket still looks open: a half-open connection after an AP drop, a
+// NAT entry that timed out, a TLS session the other end has reset. Errors
+// reported by the client end the link at once. Plain C++ so
+// tools/impair_bench.cpp runs the same rules against an impaired network.
+//
+// Times are ms from a 32-bit clock (millis() on the board); differences are
+// taken unsigned, so the wrap after 49 days does no harm.
+
+const uint32_t STREAM_KEEPALIVE_MS = 30000; // Realtime Database keep-alive interval
+const uint32_t STREAM_STALE_MS = 40000;     // one keep-alive plus slack for a slow path
+const uint32_t STREAM_REOPEN_MS = 10000;    // retry while a reopened stream stays silent
+
+class StreamWatchdog
+{
+public:
+  explicit StreamWatchdog(uint32_t staleMs = STREAM_STALE_MS, uint32_t reopenMs = STREAM_REOPEN_MS)
+      : m_staleMs(staleMs), m_reopenMs(reopenMs) {}
+
+  // The stream was opened or reopened; silence is counted from here
+  void opened(uint32_t nowMs);
+
+  // Any event arrived, keep-alives included. True when it ends an outage.
+  bool event(uint32_t nowMs);
+
+  // The client reported an error or the connection closed. True when it
+  // starts an outage.
+  bool failed(uint32_t nowMs);
+
+  // Call about once a second. True when the stream should be closed and
+  // opened again: it has just gone silent, or it is still down STREAM_REOPEN_MS
+  // after the last attempt.
+  bool check(uint32_t nowMs);
+
+  bool up() const { return m_up; }
+  uint32_t silentMs(uint32_t nowMs) const { return nowMs - m_lastEventMs; }
+  uint32_t downMs(uint32_t nowMs) const { return m_up ? 0 : nowMs - m_downMs; }
+
+  uint32_t outages = 0;     // up -> down
+  uint32_t silences = 0;    // of those, found by silence rather than an error
+  uint32_t reopens = 0;     // check() asked for a new stream
+  uint32_t lastOutageMs = 0; // down until the next event
+  uint32_t maxOutageMs = 0;
+
+private:
+  void goDown(uint32_t nowMs);
+
+  uint32_t m_staleMs;
+  uint32_t m_reopenMs;
+  bool m_up = true;
+  uint32_t m_lastEventMs = 0;
+  uint32_t m_openedMs = 0;
+  uint32_t m_downMs = 0;
+};
+
+#endif
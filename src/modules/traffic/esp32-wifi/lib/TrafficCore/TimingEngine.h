@@ -0,0 +1,174 @@
+#ifndef TRAFFIC_CORE_TIMING_ENGINE_H
+#define TRAFFIC_CORE_TIMING_ENGINE_H
+
+// Signal timing from traffic density or vehicle counts, a port of the
+// backend's src/modules/traffic/services/timing.service.ts. Everything is
+// constexpr on plain tables, so the board plans its own cycle
+// (src/local_plan.cpp) from the same numbers the backend would use, and a
+// change to the tables shows up in the static_asserts below or in
+// tools/timing_check.cpp, which compares against vectors generated from the
+// TypeScript version.
+//
+// Written for C++11 constexpr (one return statement per function), the
+// language level the ESP32 Arduino framework builds with.
+
+struct CycleTiming
+{
+  int green;  // seconds
+  int yellow; // seconds
+  int red;    // seconds
+  int total;  // green + yellow + red
+};
+
+// BASE_TIMING
+constexpr int TIMING_YELLOW = 3;
+constexpr int TIMING_MIN_GREEN = 15;
+constexpr int TIMING_MAX_GREEN = 90;
+constexpr int TIMING_MIN_RED = 20;
+constexpr int TIMING_MAX_RED = 120;
+
+constexpr int timingMin(int a, int b) { return a < b ? a : b; }
+constexpr int timingMax(int a, int b) { return a > b ? a : b; }
+
+// Math.max(lo, Math.min(v, hi))
+constexpr int timingClamp(int v, int lo, int hi) { return timingMax(lo, timingMin(v, hi)); }
+
+constexpr CycleTiming makeTiming(int green, int red)
+{
+  return CycleTiming{green, TIMING_YELLOW, red, green + TIMING_YELLOW + red};
+}
+
+constexpr CycleTiming withGreen(CycleTiming t, int green)
+{
+  return CycleTiming{green, t.yellow, t.red, green + t.yellow + t.red};
+}
+
+// ================= BY DENSITY =================
+
+// Indexed by density level; index 0 is the default for any unknown level
+constexpr CycleTiming DENSITY_TIMING[5] = {
+    makeTiming(30, 45), // default
+    makeTiming(20, 40), // 1 LOW
+    makeTiming(35, 50), // 2 MODERATE
+    makeTiming(60, 60), // 3 HIGH
+    makeTiming(75, 45), // 4 SEVERE: shorter red to move traffic faster
+};
+
+constexpr CycleTiming timingByDensity(int level)
+{
+  return level >= 1 && level <= 4 ? DENSITY_TIMING[level] : DENSITY_TIMING[0];
+}
+
+// ================= BY VEHICLE COUNT =================
+
+// Each vehicle needs about 2 seconds of green; red shrinks as green grows
+constexpr CycleTiming timingForGreen(int green)
+{
+  return makeTiming(green, timingClamp(90 - (green - 30), TIMING_MIN_RED, TIMING_MAX_RED));
+}
+
+constexpr CycleTiming timingByVehicleCount(int vehicles)
+{
+  return timingForGreen(timingClamp(vehicles * 2, TIMING_MIN_GREEN, TIMING_MAX_GREEN));
+}
+
+// ================= BY SPEED =================
+
+constexpr int densityForSpeed(int speedKmh)
+{
+  return speedKmh >= 40 ? 1 : speedKmh >= 25 ? 2 : speedKmh >= 15 ? 3 : 4;
+}
+
+constexpr CycleTiming timingBySpeed(int speedKmh)
+{
+  return timingByDensity(densityForSpeed(speedKmh));
+}
+
+// ================= ADAPTIVE =================
+
+constexpr bool isRushHour(int hour)
+{
+  return (hour >= 7 && hour <= 9) || (hour >= 17 && hour <= 19);
+}
+
+// green * 1.2 in the TypeScript version; exact in integers because every
+// table green is a multiple of 5 (checked below)
+constexpr CycleTiming rushHourAdjust(CycleTiming t, int hour)
+{
+  return hour >= 0 && isRushHour(hour) ? withGreen(t, timingMin(t.green * 6 / 5, TIMING_MAX_GREEN)) : t;
+}
+
+// Very slow traffic gets 10 more seconds of green
+constexpr CycleTiming slowTrafficAdjust(CycleTiming t, int speedKmh)
+{
+  return speedKmh >= 0 && speedKmh < 20 ? withGreen(t, timingMin(t.green + 10, TIMING_MAX_GREEN)) : t;
+}
+
+// Density timing with rush hour and speed adjustments. A negative speed or
+// hour stands for "not given" (undefined in the TypeScript version).
+constexpr CycleTiming adaptiveTiming(int level, int speedKmh = -1, int localHour = -1)
+{
+  return slowTrafficAdjust(rushHourAdjust(timingByDensity(level), localHour), speedKmh);
+}
+
+// ================= COORDINATED =================
+
+// Math.floor(v / 2) and Math.ceil(v / 2), negative values included
+constexpr int floorHalf(int v) { return v >= 0 ? v / 2 : -((1 - v) / 2); }
+constexpr int ceilHalf(int v) { return v - floorHalf(v); }
+
+// Stretch or shrink a light's own timing to the intersection's cycle length
+constexpr CycleTiming coordinate(CycleTiming t, int total)
+{
+  return CycleTiming{t.green + floorHalf(total - t.total), t.yellow, t.red + ceilHalf(total - t.total), total};
+}
+
+// One light of an intersection whose highest density level is maxLevel
+constexpr CycleTiming coordinatedTiming(int level, int maxLevel)
+{
+  return coordinate(timingByDensity(level), timingByDensity(maxLevel).total);
+}
+
+// ================= CYCLE POSITION =================
+
+// Color at `elapsedS` into a repeating green-yellow-red cycle (3=green, 2=yellow, 1=red)
+constexpr int recommendedColor(unsigned long elapsedS, CycleTiming t)
+{
+  return elapsedS % t.total < (unsigned long)t.green                ? 3
+         : elapsedS % t.total < (unsigned long)(t.green + t.yellow) ? 2
+                                                                     : 1;
+}
+
+// Seconds left as the board shows them: until the end of yellow while green
+// or yellow (the display takes the yellow off during green), until the end
+// of the cycle while red
+constexpr int phaseRemaining(unsigned long elapsedS, CycleTiming t)
+{
+  return elapsedS % t.total < (unsigned long)(t.green + t.yellow) ? t.green + t.yellow - (int)(elapsedS % t.total)
+                                                                    : t.total - (int)(elapsedS % t.total);
+}
+
+// ================= TABLE CHECKS =================
+
+constexpr bool greensExactForRushHour(int i)
+{
+  return i == 5 || (DENSITY_TIMING[i].green % 5 == 0 && greensExactForRushHour(i + 1));
+}
+
+static_assert(greensExactForRushHour(0), "rush hour scaling needs table greens that are multiples of 5");
+static_assert(timingByDensity(2).total == 88, "MODERATE cycle");
+static_assert(timingByDensity(9).green == 30 && timingByDensity(0).red == 45, "unknown level falls back to the default");
+static_assert(timingByVehicleCount(0).green == TIMING_MIN_GREEN && timingByVehicleCount(200).green == TIMING_MAX_GREEN,
+              "green clamps");
+static_assert(timingByVehicleCount(20).red == 80 && timingByVehicleCount(45).red == 30, "red follows green");
+static_assert(adaptiveTiming(4, 10, 8).green == TIMING_MAX_GREEN, "rush hour and slow traffic stay under max green");
+static_assert(adaptiveTiming(2, -1, 8).green == 42 && adaptiveTiming(2, -1, 12).green == 35, "rush hour scaling");
+static_assert(coordinatedTiming(2, 3).total == 123 && coordinatedTiming(2, 3).green == 52 &&
+                  coordinatedTiming(2, 3).red == 68,
+              "an odd stretch gives red the extra second");
+static_assert(floorHalf(-45) == -23 && ceilHalf(-45) == -22, "Math.floor/Math.ceil of negative halves");
+static_assert(recommendedColor(0, DENSITY_TIMING[1]) == 3 && recommendedColor(21, DENSITY_TIMING[1]) == 2 &&
+                  recommendedColor(23, DENSITY_TIMING[1]) == 1 && recommendedColor(63, DENSITY_TIMING[1]) == 3,
+              "cycle position");
+
+#endif
@@ -0,0 +1,168 @@
+#include "UpdateStamp.h"
+#include <string.h>
+
+// Digits of the value after "key": in a flat JSON object
+static bool readJsonUint64(const char *data, size_t len, const char *key, uint64_t &value)
+{
+  const char *end = data + len;
+  size_t keyLen = strlen(key);
+
+  for (const char *p = data; p + keyLen + 2 <= end; p++)
+  {
+    if (p[0] != '"' || memcmp(p + 1, key, keyLen) != 0 || p[keyLen + 1] != '"')
+      continue;
+
+    const char *q = p + keyLen + 2;
+    while (q < end && (*q == ' ' || *q == ':'))
+      q++;
+    if (q == end || *q < '0' || *q > '9')
+      return false;
+
+    value = 0;
+    while (q < end && *q >= '0' && *q <= '9')
+      value = value * 10 + (uint64_t)(*q++ - '0');
+    return true;
+  }
+  return false;
+}
+
+bool readUpdateStamp(const char *data, size_t len, UpdateStamp &stamp)
+{
+  uint64_t seq, ts;
+  if (!readJsonUint64(data, len, "seq", seq) || !readJsonUint64(data, len, "ts", ts))
+    return false;
+
+  stamp.seq = (uint32_t)seq;
+  stamp.serverMs = ts;
+  return true;
+}
+
+const char *stampVerdictName(StampVerdict verdict)
+{
+  switch (verdict)
+  {
+  case STAMP_SNAPSHOT:
+    return "snapshot";
+  case STAMP_OUT_OF_ORDER:
+    return "out of order";
+  case STAMP_STALE:
+    return "stale";
+  default:
+    return "fresh";
+  }
+}
+
+// ================= GATE =================
+
+// a is after b, across a wrap of the counter too
+static bool seqAfter(uint32_t a, uint32_t b)
+{
+  return (int32_t)(a - b) > 0;
+}
+
+size_t UpdateGate::filter(const UpdateStamp &stamp, bool snapshot, uint64_t nowMs, FieldUpdate *updates,
+                          size_t count, StampResult &result)
+{
+  result = StampResult();
+
+  if (snapshot || !m_synced)
+  {
+    // Everything in a snapshot is current; fields it lacks are not set
+    result.verdict = STAMP_SNAPSHOT;
+    m_synced = true;
+    m_lastSeq = stamp.seq;
+    for (uint32_t &seq : m_fieldSeq)
+      seq = stamp.seq;
+    snapshots++;
+    return count;
+  }
+
+  if (!seqAfter(stamp.seq, m_lastSeq))
+  {
+    // Also the second copy of each update while two streams overlap
+    result.verdict = STAMP_OUT_OF_ORDER;
+    outOfOrder++;
+  }
+  else
+  {
+    if (stamp.seq - m_lastSeq > 1)
+      gaps += stamp.seq - m_lastSeq - 1;
+    m_lastSeq = stamp.seq;
+
+    if (nowMs > 0)
+    {
+      result.measured = true;
+      result.latencyMs = (int32_t)(int64_t)(nowMs - stamp.serverMs);
+    }
+
+    if (result.measured && result.latencyMs > UPDATE_MAX_AGE_MS)
+    {
+      result.verdict = STAMP_STALE;
+      stale++;
+    }
+    else
+    {
+      fresh++;
+    }
+  }
+
+  size_t kept = 0;
+  for (size_t i = 0; i < count; i++)
+  {
+    const FieldUpdate &update = updates[i];
+    if (update.field >= FIELD_UNKNOWN || !seqAfter(stamp.seq, m_fieldSeq[update.field]))
+    {
+      dropped++;
+      continue;
+    }
+    m_fieldSeq[update.field] = stamp.seq;
+
+    // A stale countdown is off by the delay; it still outdates older ones
+    if (result.verdict == STAMP_STALE && update.field == FIELD_REMAINTIME)
+    {
+      dropped++;
+      continue;
+    }
+    updates[kept++] = update;
+  }
+  return kept;
+}
+
+// ================= HISTOGRAM =================
+
+void LatencyHistogram::add(int32_t ms)
+{
+  size_t bucket = 0;
+  while (bucket < LATENCY_BUCKETS - 1 && ms > LATENCY_BUCKET_MS[bucket])
+    bucket++;
+  buckets[bucket]++;
+
+  if (count == 0 || ms < minMs)
+    minMs = ms;
+  if (count == 0 || ms > maxMs)
+    maxMs = ms;
+  if (ms < 0)
+    negative++;
+  totalMs += ms;
+  count++;
+}
+
+int32_t LatencyHistogram::percentileMs(uint32_t percent) const
+{
+  if (count == 0)
+    return -1;
+
+  // Rank of the sample at the percentile, 1-based
+  uint64_t rank = ((uint64_t)count * percent + 99) / 100;
+  if (rank == 0)
+    rank = 1;
+
+  uint64_t seen = 0;
+  for (size_t bucket = 0; bucket < LATENCY_BUCKETS - 1; bucket++)
+  {
+    seen += buckets[bucket];
+    if (seen >= rank)
+      return LATENCY_BUCKET_MS[bucket];
+  }
+  return LATENCY_OVER_MS;
+}
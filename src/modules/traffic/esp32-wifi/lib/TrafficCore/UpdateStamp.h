@@ -0,0 +1,102 @@
+#ifndef TRAFFIC_CORE_UPDATE_STAMP_H
+#define TRAFFIC_CORE_UPDATE_STAMP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "LightState.h"
+
+// Sequence number and server time that the backend's device-view mirror
+// stamps on every write ("seq", "ts"), and what a board does with them:
+// drop what arrives out of order, drop the countdown of an update that took
+// too long to arrive, and measure how long each update took. Plain C++ so
+// tools/trace_replay.cpp applies the same rules as the firmware.
+
+struct UpdateStamp
+{
+  uint32_t seq = 0;
+  uint64_t serverMs = 0; // ms since the epoch
+};
+
+// Read "seq" and "ts" from a state object; false unless both are there
+bool readUpdateStamp(const char *data, size_t len, UpdateStamp &stamp);
+
+// An update older than this on arrival is stale: its remaintime has run on
+// since it was written
+const int32_t UPDATE_MAX_AGE_MS = 3000;
+
+enum StampVerdict
+{
+  STAMP_FRESH,        // in order, and on time (or no clock to tell)
+  STAMP_SNAPSHOT,     // full state (initial put, first message after a reconnect)
+  STAMP_OUT_OF_ORDER, // a newer update was already applied
+  STAMP_STALE         // in order, but older than UPDATE_MAX_AGE_MS
+};
+
+const char *stampVerdictName(StampVerdict verdict);
+
+struct StampResult
+{
+  StampVerdict verdict = STAMP_FRESH;
+  bool measured = false; // latencyMs is set (in-order updates with a clock)
+  int32_t latencyMs = 0; // arrival minus server time, negative with clock skew
+};
+
+// Tracks the newest sequence number applied to each field. The device view
+// is written as diffs, so a field is dropped only when a newer update has
+// already set that same field; the rest of a late update still applies.
+class UpdateGate
+{
+public:
+  // Filter `updates` in place and return how many are left. `snapshot`
+  // marks a full-state event: it re-bases the sequence (the node may have
+  // been recreated) and its server time is the last write, not a delivery,
+  // so it is not measured. `nowMs` is wall-clock ms since the epoch, 0
+  // while the clock is not set (order is still checked).
+  size_t filter(const UpdateStamp &stamp, bool snapshot, uint64_t nowMs, FieldUpdate *updates, size_t count,
+                StampResult &result);
+
+  // The next stamped update is a snapshot (after a reconnect)
+  void resync() { m_synced = false; }
+  bool synced() const { return m_synced; }
+  uint32_t lastSeq() const { return m_lastSeq; }
+
+  uint32_t fresh = 0;
+  uint32_t snapshots = 0;
+  uint32_t outOfOrder = 0;
+  uint32_t stale = 0;
+  uint32_t gaps = 0;    // sequence numbers skipped between two updates
+  uint32_t dropped = 0; // fields dropped
+
+private:
+  bool m_synced = false;
+  uint32_t m_lastSeq = 0;
+  uint32_t m_fieldSeq[FIELD_UNKNOWN] = {};
+};
+
+// Delivery latency in fixed buckets, so percentiles come cheap and the
+// whole distribution fits one small JSON array
+const size_t LATENCY_BUCKETS = 8;
+const int32_t LATENCY_BUCKET_MS[LATENCY_BUCKETS - 1] = {50, 100, 200, 500, 1000, 2000, 5000}; // upper bounds
+
+// percentileMs() for a percentile in the open last bucket (over 5000 ms)
+const int32_t LATENCY_OVER_MS = INT32_MAX;
+
+struct LatencyHistogram
+{
+  uint32_t buckets[LATENCY_BUCKETS] = {};
+  uint32_t count = 0;
+  uint32_t negative = 0; // arrived "before" it was written: clocks disagree
+  int64_t totalMs = 0;
+  int32_t minMs = 0;
+  int32_t maxMs = 0;
+
+  void add(int32_t ms);
+  void reset() { *this = LatencyHistogram(); }
+  int32_t averageMs() const { return count ? (int32_t)(totalMs / count) : 0; }
+
+  // Upper bound of the bucket holding the given percentile, -1 when empty,
+  // LATENCY_OVER_MS in the open last bucket
+  int32_t percentileMs(uint32_t percent) const;
+};
+
+#endif
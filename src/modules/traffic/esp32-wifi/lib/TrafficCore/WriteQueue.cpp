@@ -0,0 +1,193 @@
+#include "WriteQueue.h"
+#include <stdio.h>
+#include <string.h>
+
+bool WriteQueue::put(const char *path, const char *json, uint32_t nowMs)
+{
+  if (strlen(path) >= WRITE_PATH_MAX || strlen(json) >= WRITE_VALUE_MAX)
+  {
+    stats.overflows++;
+    return false;
+  }
+
+  Slot *slot = nullptr;
+  Slot *free = nullptr;
+  for (Slot &s : m_slots)
+  {
+    if (s.used && strcmp(s.path, path) == 0)
+    {
+      slot = &s;
+      break;
+    }
+    if (!s.used && free == nullptr)
+      free = &s;
+  }
+
+  if (slot != nullptr)
+  {
+    // Sent before only if the in-flight copy is this version
+    if (slot->sent != slot->version)
+      stats.merged++;
+  }
+  else if (free != nullptr)
+  {
+    slot = free;
+    slot->used = true;
+    slot->sent = 0;
+    strcpy(slot->path, path);
+  }
+  else
+  {
+    stats.overflows++;
+    return false;
+  }
+
+  strcpy(slot->value, json);
+  slot->version++;
+  if (slot->version == 0)
+    slot->version = 1; // 0 means "not in flight"
+  stats.writes++;
+
+  if (!m_waiting)
+  {
+    m_waiting = true;
+    m_waitingSinceMs = nowMs;
+  }
+  return true;
+}
+
+bool WriteQueue::putInt(const char *path, long value, uint32_t nowMs)
+{
+  char json[WRITE_VALUE_MAX];
+  snprintf(json, sizeof(json), "%ld", value);
+  return put(path, json, nowMs);
+}
+
+bool WriteQueue::putBool(const char *path, bool value, uint32_t nowMs)
+{
+  return put(path, value ? "true" : "false", nowMs);
+}
+
+bool WriteQueue::due(uint32_t nowMs)
+{
+  if (m_inFlight)
+  {
+    if (nowMs - m_sentMs < WRITE_TIMEOUT_MS)
+      return false;
+    stats.timeouts++;
+    finish(false, true, nowMs);
+  }
+
+  if (!m_waiting || nowMs - m_waitingSinceMs < WRITE_COALESCE_MS)
+    return false;
+  return m_backoffMs == 0 || (int32_t)(nowMs - m_retryAtMs) >= 0;
+}
+
+size_t WriteQueue::takeBatch(char *out, size_t len, uint32_t nowMs)
+{
+  size_t n = 0;
+  for (const Slot &s : m_slots)
+  {
+    if (s.used)
+      n += strlen(s.path) + strlen(s.value) + 4; // "path":value,
+  }
+  if (n == 0 || n + 2 > len)
+    return 0;
+
+  n = 0;
+  out[n++] = '{';
+  for (Slot &s : m_slots)
+  {
+    if (!s.used)
+      continue;
+    n += sprintf(out + n, "%s\"%s\":%s", n > 1 ? "," : "", s.path, s.value);
+    s.sent = s.version;
+    stats.values++;
+  }
+  out[n++] = '}';
+  out[n] = '\0';
+
+  stats.batches++;
+  m_batchId++;
+  if (m_batchId == 0)
+    m_batchId = 1; // 0 means "none yet"
+  m_inFlight = true;
+  m_waiting = false;
+  m_sentMs = nowMs;
+  return n;
+}
+
+void WriteQueue::done(uint32_t id, bool ok, uint32_t nowMs)
+{
+  if (!m_inFlight || id != m_batchId)
+  {
+    stats.lateAnswers++;
+    return;
+  }
+  finish(ok, true, nowMs);
+}
+
+void WriteQueue::doneUnconfirmed(uint32_t id, uint32_t nowMs)
+{
+  if (!m_inFlight || id != m_batchId)
+  {
+    stats.lateAnswers++;
+    return;
+  }
+  finish(true, false, nowMs);
+}
+
+void WriteQueue::finish(bool ok, bool confirmed, uint32_t nowMs)
+{
+  m_inFlight = false;
+
+  bool left = false;
+  for (Slot &s : m_slots)
+  {
+    if (!s.used)
+      continue;
+    if (ok && s.sent == s.version)
+      s.used = false;
+    else
+      left = true;
+    s.sent = 0;
+  }
+
+  if (ok && !confirmed)
+  {
+    stats.unconfirmed++;
+    m_backoffMs = 0;
+  }
+  else if (ok)
+  {
+    stats.landed++;
+    uint32_t rttMs = nowMs - m_sentMs;
+    stats.lastRttMs = rttMs;
+    if (rttMs > stats.maxRttMs)
+      stats.maxRttMs = rttMs;
+    m_backoffMs = 0;
+  }
+  else
+  {
+    stats.failures++;
+    m_backoffMs = m_backoffMs == 0 ? WRITE_RETRY_MIN_MS : m_backoffMs * 2;
+    if (m_backoffMs > WRITE_RETRY_MAX_MS)
+      m_backoffMs = WRITE_RETRY_MAX_MS;
+    m_retryAtMs = nowMs + m_backoffMs;
+  }
+
+  // Whatever is left goes out with the next batch
+  if (left && !m_waiting)
+  {
+    m_waiting = true;
+    m_waitingSinceMs = nowMs;
+  }
+}
+
+size_t WriteQueue::pending() const
+{
+  size_t n = 0;
+  for (const Slot &s : m_slots)
+    n += s.used;
+  return n;
+}
@@ -0,0 +1,108 @@
+#ifndef TRAFFIC_CORE_WRITE_QUEUE_H
+#define TRAFFIC_CORE_WRITE_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Outbound writes to the board's own light node, merged into one multi-path
+// update ({"online":true,"applied/color":3,...}). Each path keeps only its
+// latest value, so a path written twice before it goes out is sent once. A
+// batch that failed, or got no answer, goes out again after a backoff that
+// doubles up to WRITE_RETRY_MAX_MS; a value that changed while its batch was
+// in flight stays queued. Fixed slots, so memory is bounded no matter how
+// long the link is down. Plain C++ so it can be built and driven on a host.
+//
+// Every batch gets an id, and an answer only counts for the batch it names:
+// an answer that turns up after its batch timed out is dropped instead of
+// being taken for the batch sent since.
+//
+// Times are ms from a 32-bit clock (millis() on the board).
+
+const size_t WRITE_QUEUE_SLOTS = 8;
+const size_t WRITE_PATH_MAX = 24;  // incl. the terminator: "applied/remaintime"
+const size_t WRITE_VALUE_MAX = 24; // raw JSON value: 3, true, "text"
+
+// Largest batch takeBatch() can build
+const size_t WRITE_BATCH_MAX = 2 + WRITE_QUEUE_SLOTS * (WRITE_PATH_MAX + WRITE_VALUE_MAX + 2);
+
+const uint32_t WRITE_COALESCE_MS = 200;    // wait this long for more writes to merge
+const uint32_t WRITE_RETRY_MIN_MS = 1000;  // first backoff after a failure
+const uint32_t WRITE_RETRY_MAX_MS = 60000;
+const uint32_t WRITE_TIMEOUT_MS = 15000;   // no answer to a batch: counted as failed
+
+struct WriteQueueStats
+{
+  uint32_t writes = 0;    // put() calls accepted
+  uint32_t merged = 0;    // of those, replaced a value not yet sent
+  uint32_t overflows = 0; // rejected: every slot holds another path, or too long
+  uint32_t batches = 0;   // batches sent
+  uint32_t values = 0;    // values sent, over all batches
+  uint32_t landed = 0;    // batches the transport confirmed
+  uint32_t unconfirmed = 0; // batches handed off with no answer to come
+  uint32_t failures = 0;  // batches that failed (timeouts included)
+  uint32_t timeouts = 0;
+  uint32_t lateAnswers = 0; // answers for a batch no longer in flight, ignored
+  uint32_t lastRttMs = 0; // send to answer of the last batch that landed
+  uint32_t maxRttMs = 0;
+};
+
+class WriteQueue
+{
+public:
+  // Queue the latest value for a path relative to the light node. `json` is
+  // a raw JSON value. False if the path or value is too long, or if all
+  // slots are taken by other paths.
+  bool put(const char *path, const char *json, uint32_t nowMs);
+  bool putInt(const char *path, long value, uint32_t nowMs);
+  bool putBool(const char *path, bool value, uint32_t nowMs);
+
+  // True when a batch should go out: something is waiting, the coalescing
+  // window and any backoff are over, and no batch is in flight. Also times
+  // out a batch that got no answer.
+  bool due(uint32_t nowMs);
+
+  // Write the pending values as one JSON object into `out` and mark them in
+  // flight under a new batch id (batchId()). Returns its length, 0 if nothing
+  // is pending or `len` is too small.
+  size_t takeBatch(char *out, size_t len, uint32_t nowMs);
+
+  // Answer for batch `id`. On success its values are done, unless they
+  // changed meanwhile; on failure all of them are sent again later. Ignored
+  // (and counted in lateAnswers) unless `id` is the batch in flight.
+  void done(uint32_t id, bool ok, uint32_t nowMs);
+
+  // Batch `id` went out on a link that never answers (an MQTT QoS 0
+  // publish). Its values are not sent again, but it counts as unconfirmed,
+  // not landed, and stays out of the round trip times.
+  void doneUnconfirmed(uint32_t id, uint32_t nowMs);
+
+  bool inFlight() const { return m_inFlight; }
+  uint32_t batchId() const { return m_batchId; } // last batch taken, 0 before the first
+  size_t pending() const; // paths waiting or in flight
+  uint32_t backoffMs() const { return m_backoffMs; }
+
+  WriteQueueStats stats;
+
+private:
+  void finish(bool ok, bool confirmed, uint32_t nowMs);
+
+  struct Slot
+  {
+    bool used = false;
+    char path[WRITE_PATH_MAX];
+    char value[WRITE_VALUE_MAX];
+    uint32_t version = 0; // bumped by every put
+    uint32_t sent = 0;    // version in flight, 0 = none
+  };
+
+  Slot m_slots[WRITE_QUEUE_SLOTS];
+  bool m_inFlight = false;
+  uint32_t m_batchId = 0;
+  bool m_waiting = false; // a value not yet sent
+  uint32_t m_waitingSinceMs = 0;
+  uint32_t m_sentMs = 0;
+  uint32_t m_retryAtMs = 0;
+  uint32_t m_backoffMs = 0;
+};
+
+#endif
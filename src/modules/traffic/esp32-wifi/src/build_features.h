@@ -0,0 +1,38 @@
+#ifndef BUILD_FEATURES_H
+#define BUILD_FEATURES_H
+
+#include <Arduino.h>
+
+// ================= BUILD FEATURES =================
+// Compile-time switches, set through build_flags in platformio.ini. The full
+// image has everything; the lean production environment sets all of the
+// NO_* switches below (and LEAN_BUILD, which only names the image). Each one
+// also works on its own.
+//
+//   NO_CONFIG_PORTAL  no Wi-Fi AP and config page; config mode takes
+//                     settings over serial only (serial_config.h)
+//   NO_LOCAL_API      no LAN control API (/api/...)
+//   NO_ENV_FILE       no /.env on LittleFS for the Firebase settings
+//   NO_VERBOSE_LOG    LOG_VERBOSE() lines compile to nothing
+//
+// With both the portal and the local API gone, WebServer is not linked.
+
+#if !defined(NO_CONFIG_PORTAL) || !defined(NO_LOCAL_API)
+#define HAS_WEB_SERVER
+#endif
+
+// Config dumps, per-cycle and per-heartbeat lines: useful on the bench,
+// noise on a cabinet nobody watches
+#ifdef NO_VERBOSE_LOG
+#define LOG_VERBOSE(...) ((void)0)
+#else
+#define LOG_VERBOSE(...) Serial.printf(__VA_ARGS__)
+#endif
+
+#ifdef LEAN_BUILD
+#define BUILD_VARIANT "lean"
+#else
+#define BUILD_VARIANT "full"
+#endif
+
+#endif
@@ -0,0 +1,461 @@
+// Generated by tools/gen_portal.py from portal/config.html - do not edit.
+#ifndef CONFIG_PAGE_H
+#define CONFIG_PAGE_H
+
+#include "gzip_template.h"
+
+enum PortalField
+{
+  PORTAL_TEAM_ID,
+  PORTAL_LIGHT_ID,
+  PORTAL_WIFI_SSID,
+  PORTAL_WIFI_PASS,
+  PORTAL_WIFI_SSID2,
+  PORTAL_WIFI_PASS2,
+  PORTAL_WIFI_SSID3,
+  PORTAL_WIFI_PASS3,
+  PORTAL_WIFI_ROAM,
+  PORTAL_FB_KEY,
+  PORTAL_FB_URL,
+  PORTAL_FB_EMAIL,
+  PORTAL_FB_PASS,
+  PORTAL_LOCAL_KEY,
+  PORTAL_PREEMPT_IN,
+  PORTAL_PEER_GROUP,
+  PORTAL_PEER_PHASE,
+  PORTAL_PEER_KEY,
+  PORTAL_OTA_URL,
+  PORTAL_POWER_LI,
+  PORTAL_MQTT_HOST,
+  PORTAL_MQTT_USER,
+  PORTAL_MQTT_PASS,
+  PORTAL_TRACE_KB,
+  PORTAL_DET_LANES,
+  PORTAL_PED_BUTTON,
+  PORTAL_PLAN_MODE,
+  PORTAL_PLAN_TZ,
+  PORTAL_FIELD_COUNT
+};
+
+static const uint8_t portalPiece0[] PROGMEM = {
+    0x8c, 0x54, 0x4d, 0x8f, 0xd3, 0x30, 0x10, 0xbd, 0xef, 0xaf, 0x18, 0xb2, 0x42, 0x02, 0xd4, 0x6c,
+    0x93, 0x6e, 0x5b, 0x56, 0x69, 0x5a, 0x09, 0x2d, 0x70, 0x42, 0x82, 0x43, 0x39, 0x70, 0x74, 0x6c,
+    0x27, 0x19, 0xad, 0x63, 0x47, 0xb6, 0xd3, 0x0f, 0x10, 0xff, 0x1d, 0x3b, 0x6d, 0xd3, 0x34, 0x2d,
+    0x88, 0x58, 0x51, 0x62, 0x7b, 0xc6, 0xf3, 0xde, 0xbc, 0x19, 0xa7, 0xaf, 0x3e, 0x7e, 0x7d, 0x5e,
+    0xff, 0xf8, 0xf6, 0x09, 0x4a, 0x5b, 0x89, 0xd5, 0x5d, 0xea, 0x3f, 0x20, 0x88, 0x2c, 0x96, 0x01,
+    0x97, 0x81, 0x5f, 0xe0, 0x84, 0xad, 0xee, 0xc0, 0x3d, 0x69, 0xc5, 0x2d, 0x01, 0x5a, 0x12, 0x6d,
+    0xb8, 0x5d, 0x06, 0xdf, 0xd7, 0x9f, 0xc3, 0xa7, 0xa0, 0xbf, 0x25, 0x49, 0xc5, 0x97, 0xc1, 0x06,
+    0xf9, 0xb6, 0x56, 0xda, 0x06, 0x40, 0x95, 0xb4, 0x5c, 0x3a, 0xd3, 0x2d, 0x32, 0x5b, 0x2e, 0x19,
+    0xdf, 0x20, 0xe5, 0x61, 0x3b, 0x19, 0x01, 0x4a, 0xb4, 0x48, 0x44, 0x68, 0x28, 0x11, 0x7c, 0x19,
+    0x9f, 0x0e, 0xb2, 0x68, 0x05, 0x5f, 0xad, 0x35, 0xc9, 0x73, 0xa4, 0xf0, 0x05, 0x8b, 0xd2, 0xc2,
+    0xb3, 0x92, 0x39, 0x16, 0x8d, 0x26, 0x16, 0x95, 0x4c, 0xc7, 0x07, 0x93, 0x83, 0xb9, 0xb1, 0xfb,
+    0xd3, 0xbf, 0x7f, 0xde, 0xc1, 0x2f, 0xa8, 0x88, 0x2e, 0x50, 0x26, 0x10, 0x2d, 0xa0, 0x26, 0x8c,
+    0xa1, 0x2c, 0xda, 0xff, 0x4c, 0xed, 0x42, 0x83, 0x3f, 0xdb, 0x69, 0xa6, 0x34, 0xe3, 0x3a, 0x74,
+    0x4b, 0x0b, 0xf8, 0xdd, 0x39, 0x67, 0x8a, 0xed, 0x9d, 0x7f, 0xee, 0x50, 0x87, 0x39, 0xa9, 0x50,
+    0xec, 0x13, 0xf8, 0xa0, 0x1d, 0xc6, 0x11, 0x18, 0x22, 0x4d, 0x68, 0xb8, 0xc6, 0xdc, 0x1d, 0x44,
+    0xe8, 0x4b, 0xa1, 0x55, 0x23, 0x59, 0x02, 0xf7, 0xf9, 0xcc, 0x8f, 0x5e, 0xa4, 0x49, 0x54, 0x5f,
+    0x1c, 0xfa, 0xe0, 0x93, 0x40, 0x50, 0x72, 0xdd, 0x42, 0xdb, 0x1d, 0xe8, 0x27, 0x30, 0x8f, 0x5a,
+    0xc3, 0x0e, 0x2c, 0x90, 0xc6, 0xaa, 0xcb, 0xc3, 0xb7, 0x25, 0x5a, 0xbe, 0x38, 0x81, 0xd5, 0x84,
+    0x61, 0x63, 0x12, 0x78, 0xf2, 0x6e, 0x2d, 0x99, 0x92, 0x30, 0xb5, 0xf5, 0xae, 0x93, 0x7a, 0x07,
+    0x53, 0xf7, 0xea, 0x22, 0x23, 0x6f, 0xa2, 0x51, 0x3b, 0x1e, 0xe2, 0xb7, 0x17, 0x30, 0xbc, 0x8c,
+    0x2d, 0x86, 0x0b, 0xf8, 0x13, 0xfa, 0xc8, 0x67, 0x2e, 0x39, 0x54, 0x09, 0xa5, 0xbb, 0x88, 0x67,
+    0x32, 0xd3, 0x43, 0xb0, 0x21, 0x80, 0xf6, 0x8d, 0x7c, 0x56, 0x07, 0x44, 0x9d, 0xda, 0x2e, 0xc4,
+    0xc0, 0xbf, 0x67, 0x93, 0x2b, 0x5d, 0x85, 0x3e, 0x7a, 0xdd, 0x09, 0xe5, 0x54, 0xb0, 0x56, 0x55,
+    0xd7, 0x99, 0x13, 0x24, 0xe3, 0xc2, 0x99, 0x31, 0x34, 0xb5, 0x20, 0x4e, 0x8b, 0x4c, 0x28, 0xfa,
+    0xb2, 0x18, 0xba, 0xcd, 0xbd, 0x57, 0xab, 0xd9, 0x96, 0xfb, 0x6a, 0x49, 0x60, 0x16, 0x45, 0xc7,
+    0x15, 0xa7, 0x37, 0x4f, 0x20, 0x1e, 0xa0, 0x40, 0x59, 0x37, 0xd6, 0x69, 0xca, 0x05, 0xa7, 0x1e,
+    0xee, 0x51, 0x91, 0x38, 0x8a, 0x5e, 0xf7, 0xb8, 0xc7, 0xd1, 0x99, 0xbb, 0x9b, 0x39, 0xc2, 0x46,
+    0x09, 0x64, 0x70, 0x4f, 0x29, 0xbd, 0xca, 0xc9, 0xb4, 0x03, 0x71, 0x3b, 0x64, 0xd6, 0x38, 0xb0,
+    0xf2, 0xef, 0xb1, 0x26, 0xfd, 0x58, 0x52, 0x49, 0xfe, 0x8f, 0x08, 0x27, 0x9a, 0x73, 0x4f, 0x93,
+    0x36, 0xda, 0x78, 0xe5, 0x6a, 0x85, 0x2e, 0xfb, 0xba, 0xcb, 0x8e, 0x55, 0xf5, 0x89, 0x42, 0x2f,
+    0xfd, 0x99, 0x95, 0x61, 0xad, 0xd1, 0xd9, 0xec, 0xff, 0xaf, 0x12, 0x06, 0xbe, 0xcc, 0xdd, 0x0b,
+    0xd7, 0x45, 0xc4, 0xdf, 0x4f, 0xe9, 0x23, 0xbd, 0xed, 0x9a, 0x8e, 0x8f, 0x1d, 0x9a, 0x8e, 0x0f,
+    0x17, 0x49, 0xea, 0xbb, 0xec, 0xd8, 0xbc, 0x0c, 0x37, 0x40, 0x05, 0x31, 0x66, 0x19, 0x74, 0x5d,
+    0x12, 0x9c, 0x9b, 0xb9, 0xbf, 0x7f, 0x28, 0xdf, 0xde, 0x66, 0x6b, 0x50, 0xc6, 0x37, 0x6f, 0x0a,
+    0x17, 0x2b, 0x1e, 0x58, 0xd6, 0xab, 0x35, 0x27, 0xae, 0x5a, 0xfe, 0x00, 0x00, 0x00, 0xff, 0xff,
+};
+
+static const uint8_t portalPiece1[] PROGMEM = {
+    0x52, 0xa8, 0x51, 0xf0, 0xc9, 0x4c, 0xcf, 0x28, 0x51, 0xf0, 0x74, 0xb1, 0x52, 0x00, 0x00, 0x00,
+    0x00, 0xff, 0xff,
+};
+
+static const uint8_t portalPiece2[] PROGMEM = {
+    0x6c, 0x8c, 0xcb, 0x0a, 0x02, 0x31, 0x0c, 0x45, 0xf7, 0x7e, 0x45, 0xc8, 0x5e, 0xfa, 0x03, 0xed,
+    0xac, 0x44, 0x70, 0xa5, 0x50, 0x61, 0xd6, 0xb5, 0xad, 0x5a, 0xe8, 0x8b, 0x69, 0x5a, 0xf4, 0xef,
+    0xad, 0xa3, 0xa0, 0x0c, 0x93, 0xd5, 0x3d, 0xc9, 0xb9, 0xe1, 0x2c, 0x0f, 0x1b, 0xf8, 0x0e, 0x67,
+    0xc6, 0xb5, 0x3f, 0xec, 0x04, 0xda, 0xab, 0x52, 0x04, 0xea, 0x14, 0xc9, 0x46, 0xc2, 0xdf, 0x75,
+    0x36, 0xae, 0x69, 0x0a, 0xa0, 0x34, 0xb9, 0x14, 0x05, 0xb2, 0xa2, 0x9a, 0x45, 0x08, 0x96, 0xee,
+    0xc9, 0x08, 0x3c, 0x1d, 0xe5, 0x79, 0xe1, 0x2f, 0xbf, 0xbe, 0xeb, 0xdb, 0xdb, 0x94, 0x6a, 0x5e,
+    0x11, 0x67, 0xd9, 0xab, 0x8b, 0xf5, 0xc3, 0xe8, 0xf6, 0x0e, 0xa4, 0x3c, 0xec, 0x38, 0xfb, 0x2c,
+    0xd6, 0x65, 0x17, 0x73, 0x25, 0xa0, 0x67, 0xb6, 0x02, 0xc9, 0x3e, 0x08, 0x21, 0xaa, 0xd0, 0x73,
+    0x29, 0xce, 0x20, 0x34, 0xe5, 0x6b, 0x87, 0x17, 0x00, 0x00, 0x00, 0xff, 0xff,
+};
+
+static const uint8_t portalPiece3[] PROGMEM = {
+    0x6c, 0x8b, 0x31, 0x0e, 0x80, 0x20, 0x10, 0x04, 0x7b, 0x5f, 0x71, 0xb9, 0xde, 0xf0, 0x01, 0xb4,
+    0xb4, 0xb6, 0xb3, 0x46, 0x41, 0x73, 0x09, 0x02, 0x1e, 0xa2, 0xf1, 0xf7, 0x12, 0xb5, 0x52, 0xb7,
+    0xdb, 0xc9, 0x0c, 0x02, 0x9b, 0x25, 0x11, 0x1b, 0x5d, 0x17, 0xf0, 0x9a, 0x14, 0x9a, 0xb6, 0x1f,
+    0x9c, 0x29, 0x0c, 0x56, 0xc5, 0x58, 0xe1, 0xe8, 0x79, 0x2e, 0x27, 0xf6, 0x29, 0xe0, 0x57, 0xbc,
+    0x64, 0xab, 0x7a, 0x63, 0xeb, 0x8e, 0x1a, 0x82, 0x36, 0x27, 0xbb, 0x67, 0x2d, 0xc5, 0x0d, 0xff,
+    0x03, 0x72, 0x21, 0xad, 0xb0, 0x1e, 0xc1, 0x54, 0x18, 0x9e, 0x02, 0xc1, 0xa9, 0xf9, 0xf9, 0x08,
+    0x9b, 0xb2, 0x29, 0x9f, 0x13, 0x00, 0x00, 0xff, 0xff,
+};
+
+static const uint8_t portalPiece4[] PROGMEM = {
+    0x52, 0xb2, 0xe3, 0x52, 0x40, 0x03, 0x36, 0xfa, 0x29, 0x99, 0x65, 0x58, 0x84, 0x81, 0xa2, 0x0a,
+    0xc9, 0x39, 0x89, 0xc5, 0xc5, 0xb6, 0x4a, 0x69, 0xf9, 0x45, 0xb9, 0xba, 0xe9, 0x45, 0xf9, 0xa5,
+    0x05, 0x4a, 0x98, 0x0a, 0xc1, 0x8a, 0x73, 0x12, 0x93, 0x52, 0x73, 0xec, 0x82, 0x53, 0x93, 0xf3,
+    0xf3, 0x52, 0x14, 0xc2, 0x33, 0xdd, 0x32, 0x15, 0x82, 0x83, 0x3d, 0x5d, 0x14, 0x34, 0xf2, 0x0b,
+    0x4a, 0x32, 0xf3, 0xf3, 0x12, 0x73, 0x34, 0x6d, 0xf4, 0x21, 0x4a, 0xb0, 0x6b, 0xcf, 0xcc, 0x2b,
+    0x28, 0x2d, 0x51, 0x28, 0xa9, 0x2c, 0x48, 0xb5, 0x55, 0x2a, 0x49, 0xad, 0x28, 0x51, 0x52, 0xc8,
+    0x4b, 0xcc, 0x05, 0xb2, 0x8b, 0x8b, 0x33, 0x53, 0x8c, 0x94, 0x14, 0xca, 0x12, 0x73, 0x4a, 0x81,
+    0x3c, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff,
+};
+
+static const uint8_t portalPiece5[] PROGMEM = {
+    0x52, 0xb2, 0xe3, 0x52, 0x40, 0x03, 0x36, 0xfa, 0x29, 0x99, 0x65, 0x58, 0x84, 0x81, 0xa2, 0x0a,
+    0xc9, 0x39, 0x89, 0xc5, 0xc5, 0xb6, 0x4a, 0x69, 0xf9, 0x45, 0xb9, 0xba, 0xe9, 0x45, 0xf9, 0xa5,
+    0x05, 0x4a, 0x98, 0x0a, 0xc1, 0x8a, 0x73, 0x12, 0x93, 0x52, 0x73, 0xec, 0x82, 0x53, 0x93, 0xf3,
+    0xf3, 0x52, 0x14, 0xc2, 0x33, 0xdd, 0x32, 0x15, 0x02, 0x80, 0x3a, 0xcb, 0xf3, 0x8b, 0x52, 0x6c,
+    0xf4, 0x21, 0x72, 0xd8, 0xf5, 0x65, 0xe6, 0x15, 0x94, 0x96, 0x28, 0x94, 0x54, 0x16, 0xa4, 0xda,
+    0x2a, 0x15, 0x40, 0x75, 0x28, 0x29, 0xe4, 0x25, 0xe6, 0x42, 0xf9, 0x46, 0x4a, 0x0a, 0x65, 0x89,
+    0x39, 0xa5, 0x40, 0x1e, 0x00, 0x00, 0x00, 0xff, 0xff,
+};
+
+static const uint8_t portalPiece6[] PROGMEM = {
+    0x52, 0xb2, 0xe3, 0x52, 0x40, 0x03, 0x36, 0xfa, 0x29, 0x99, 0x65, 0x58, 0x84, 0x81, 0xa2, 0x0a,
+    0xc9, 0x39, 0x89, 0xc5, 0xc5, 0xb6, 0x4a, 0x69, 0xf9, 0x45, 0xb9, 0xba, 0xe9, 0x45, 0xf9, 0xa5,
+    0x05, 0x4a, 0x98, 0x0a, 0xc1, 0x8a, 0x73, 0x12, 0x93, 0x52, 0x73, 0xec, 0x42, 0x32, 0x32, 0x8b,
+    0x52, 0x14, 0xc2, 0x33, 0xdd, 0x32, 0x15, 0x82, 0x83, 0x3d, 0x5d, 0x14, 0x34, 0xf2, 0x0b, 0x4a,
+    0x32, 0xf3, 0xf3, 0x12, 0x73, 0x34, 0x6d, 0xf4, 0x21, 0x2a, 0xb0, 0xeb, 0xce, 0xcc, 0x2b, 0x28,
+    0x2d, 0x51, 0x28, 0xa9, 0x2c, 0x48, 0xb5, 0x55, 0x2a, 0x49, 0xad, 0x28, 0x51, 0x52, 0xc8, 0x4b,
+    0xcc, 0x05, 0xb2, 0x8b, 0x8b, 0x33, 0x53, 0x8c, 0x95, 0x14, 0xca, 0x12, 0x73, 0x4a, 0x81, 0x3c,
+    0x00, 0x00, 0x00, 0x00, 0xff, 0xff,
+};
+
+static const uint8_t portalPiece7[] PROGMEM = {
+    0x52, 0xb2, 0xe3, 0x52, 0x40, 0x03, 0x36, 0xfa, 0x29, 0x99, 0x65, 0x58, 0x84, 0x81, 0xa2, 0x0a,
+    0xc9, 0x39, 0x89, 0xc5, 0xc5, 0xb6, 0x4a, 0x69, 0xf9, 0x45, 0xb9, 0xba, 0xe9, 0x45, 0xf9, 0xa5,
+    0x05, 0x4a, 0x98, 0x0a, 0xc1, 0x8a, 0x73, 0x12, 0x93, 0x52, 0x73, 0xec, 0x42, 0x32, 0x32, 0x8b,
+    0x52, 0x14, 0xc2, 0x33, 0xdd, 0x32, 0x15, 0x02, 0x80, 0x1a, 0xcb, 0xf3, 0x8b, 0x52, 0x6c, 0xf4,
+    0x21, 0x52, 0xd8, 0xb5, 0x65, 0xe6, 0x15, 0x94, 0x96, 0x28, 0x94, 0x54, 0x16, 0xa4, 0xda, 0x2a,
+    0x15, 0x40, 0x75, 0x28, 0x29, 0xe4, 0x25, 0xe6, 0x42, 0xf9, 0xc6, 0x4a, 0x0a, 0x65, 0x89, 0x39,
+    0xa5, 0x40, 0x1e, 0x00, 0x00, 0x00, 0xff, 0xff,
+};
+
+static const uint8_t portalPiece8[] PROGMEM = {
+    0x6c, 0x8d, 0x3d, 0x0b, 0xc2, 0x50, 0x0c, 0x45, 0x77, 0x7f, 0x45, 0xc8, 0xa4, 0xa0, 0xb4, 0xdd,
+    0xfb, 0x3a, 0x89, 0xe0, 0x6a, 0x07, 0x47, 0x49, 0xf5, 0xb5, 0x04, 0xde, 0x17, 0xef, 0xa3, 0xda,
+    0x7f, 0x6f, 0xd0, 0x4d, 0x9b, 0xe5, 0x92, 0xc3, 0x49, 0x2e, 0x76, 0x1b, 0xf8, 0x99, 0xb6, 0x7a,
+    0xf0, 0xbc, 0x82, 0x85, 0xc2, 0xdd, 0x50, 0x4a, 0x0a, 0x47, 0x1f, 0xed, 0x61, 0x8a, 0xbe, 0x04,
+    0xfc, 0x17, 0x3f, 0xb2, 0xa1, 0x41, 0x9b, 0xee, 0xca, 0x27, 0x86, 0x8b, 0x27, 0xcb, 0x6e, 0x82,
+    0x6d, 0x03, 0x0a, 0xbc, 0xdb, 0x43, 0x2d, 0x39, 0x72, 0x4c, 0x19, 0xfa, 0xfe, 0x7c, 0x14, 0x64,
+    0x96, 0x5d, 0x5b, 0x7d, 0x2f, 0xd6, 0xbf, 0xb1, 0x0b, 0x25, 0x43, 0x5e, 0x82, 0x56, 0xe8, 0x8a,
+    0x1d, 0x74, 0x44, 0x70, 0x64, 0x65, 0x7b, 0xf2, 0xc8, 0xb7, 0x28, 0x0d, 0x08, 0x52, 0xa2, 0xb0,
+    0x96, 0xa4, 0x97, 0xc2, 0x06, 0x61, 0x26, 0x53, 0xc4, 0x78, 0x03, 0x00, 0x00, 0xff, 0xff,
+};
+
+static const uint8_t portalPiece9[] PROGMEM = {
+    0x52, 0xb2, 0xe3, 0x52, 0x40, 0x03, 0x36, 0xfa, 0x29, 0x99, 0x65, 0x58, 0x84, 0x81, 0xa2, 0x0a,
+    0xc9, 0x39, 0x89, 0xc5, 0xc5, 0xb6, 0x4a, 0x69, 0xf9, 0x45, 0xb9, 0xba, 0xe9, 0x45, 0xf9, 0xa5,
+    0x05, 0x4a, 0x98, 0x0a, 0xc1, 0x8a, 0x73, 0x12, 0x93, 0x52, 0x73, 0xec, 0x42, 0x52, 0x13, 0x73,
+    0x15, 0x3c, 0x5d, 0x6c, 0xf4, 0x21, 0x5c, 0xec, 0x4a, 0x33, 0xf3, 0x0a, 0x4a, 0x4b, 0x14, 0x4a,
+    0x2a, 0x0b, 0x52, 0x6d, 0x95, 0x4a, 0x52, 0x2b, 0x4a, 0x94, 0x14, 0xf2, 0x12, 0x73, 0xc1, 0xec,
+    0xc4, 0x5c, 0x25, 0x85, 0xb2, 0xc4, 0x9c, 0x52, 0x20, 0x07, 0x00, 0x00, 0x00, 0xff, 0xff,
+};
+
+static const uint8_t portalPiece10[] PROGMEM = {
+    0x52, 0x52, 0x28, 0x4a, 0x2d, 0x2c, 0xcd, 0x2c, 0x4a, 0x4d, 0xb1, 0xe3, 0x52, 0x40, 0x03, 0x36,
+    0xfa, 0x29, 0x99, 0x65, 0x58, 0x84, 0x81, 0xa2, 0x0a, 0xc9, 0x39, 0x89, 0xc5, 0xc5, 0xb6, 0x4a,
+    0x69, 0xf9, 0x45, 0xb9, 0xba, 0xe9, 0x45, 0xf9, 0xa5, 0x05, 0x4a, 0x98, 0x0a, 0xc1, 0x8a, 0x73,
+    0x12, 0x93, 0x52, 0x73, 0xec, 0x42, 0x8a, 0x12, 0xd3, 0xd2, 0x32, 0x93, 0x15, 0x7c, 0x32, 0xd3,
+    0x33, 0x4a, 0x14, 0x3c, 0x5d, 0x6c, 0xf4, 0x21, 0xe2, 0xd8, 0xf5, 0x64, 0xe6, 0x15, 0x94, 0x96,
+    0x28, 0x94, 0x54, 0x16, 0xa4, 0xda, 0x2a, 0x95, 0xa4, 0x56, 0x94, 0x28, 0x29, 0xe4, 0x25, 0xe6,
+    0x02, 0xd9, 0x39, 0x20, 0xdd, 0x99, 0x29, 0x4a, 0x0a, 0x65, 0x89, 0x39, 0xa5, 0x40, 0x3e, 0x00,
+    0x00, 0x00, 0xff, 0xff,
+};
+
+static const uint8_t portalPiece11[] PROGMEM = {
+    0x6c, 0x8e, 0x41, 0x6b, 0xc3, 0x30, 0x0c, 0x85, 0xef, 0xfb, 0x15, 0xc2, 0x3d, 0x87, 0x74, 0xcd,
+    0x2d, 0x4d, 0x0b, 0x65, 0x50, 0x28, 0xbd, 0xec, 0x1f, 0x0c, 0x7b, 0x56, 0x52, 0x53, 0xc7, 0x72,
+    0x65, 0x39, 0x34, 0xff, 0x7e, 0x66, 0x63, 0x87, 0x0d, 0xeb, 0xa4, 0x27, 0x9e, 0xbe, 0xf7, 0x14,
+    0x30, 0x3e, 0xb2, 0x63, 0xb4, 0xc7, 0x17, 0xf8, 0x37, 0x43, 0x6b, 0xdd, 0x52, 0x39, 0xdf, 0x18,
+    0x92, 0xac, 0x1e, 0x0f, 0x6a, 0xd6, 0x3c, 0xb9, 0xd0, 0x43, 0xb7, 0x8d, 0x4f, 0xd8, 0xee, 0xc1,
+    0x10, 0x5b, 0xe4, 0x1e, 0x02, 0x05, 0xfc, 0x55, 0x8d, 0x50, 0xec, 0xe1, 0xb5, 0x18, 0x12, 0x79,
+    0x67, 0x61, 0x63, 0xad, 0xdd, 0xab, 0x1a, 0xb6, 0xfb, 0x8b, 0x6d, 0x0c, 0x89, 0xd0, 0xdc, 0xc3,
+    0xae, 0xd0, 0xcb, 0xc7, 0xb9, 0xb4, 0x34, 0x3a, 0x21, 0xbc, 0x51, 0x18, 0xdd, 0x94, 0x59, 0x8b,
+    0xa3, 0x30, 0xb4, 0xb7, 0xae, 0x02, 0x2b, 0xcd, 0xe1, 0xd3, 0xeb, 0x94, 0x0e, 0x6a, 0x24, 0x9e,
+    0x9b, 0x89, 0x29, 0xc7, 0x4a, 0xea, 0xb7, 0xd9, 0x6b, 0x83, 0xfe, 0x78, 0x7a, 0xbf, 0xc0, 0x15,
+    0xd7, 0xa1, 0xfd, 0x91, 0x75, 0xab, 0x0b, 0x31, 0x0b, 0xc8, 0x1a, 0x4b, 0x4d, 0xc1, 0xa7, 0x28,
+    0x08, 0x7a, 0x2e, 0xfb, 0x68, 0x3e, 0xee, 0xb8, 0x2a, 0x58, 0xb4, 0xcf, 0x45, 0x7e, 0x01, 0x00,
+    0x00, 0xff, 0xff,
+};
+
+static const uint8_t portalPiece12[] PROGMEM = {
+    0x52, 0x52, 0x28, 0x4a, 0x2d, 0x2c, 0xcd, 0x2c, 0x4a, 0x4d, 0xb1, 0xe3, 0x52, 0x40, 0x03, 0x36,
+    0xfa, 0x29, 0x99, 0x65, 0x58, 0x84, 0x81, 0xa2, 0x0a, 0xc9, 0x39, 0x89, 0xc5, 0xc5, 0xb6, 0x4a,
+    0x69, 0xf9, 0x45, 0xb9, 0xba, 0xe9, 0x45, 0xf9, 0xa5, 0x05, 0x4a, 0x98, 0x0a, 0xc1, 0x8a, 0x73,
+    0x12, 0x93, 0x52, 0x73, 0xec, 0x5c, 0x12, 0x4b, 0x12, 0x93, 0x12, 0x8b, 0x53, 0x15, 0x42, 0x83,
+    0x7c, 0x6c, 0xf4, 0x21, 0x62, 0xd8, 0xd5, 0x67, 0xe6, 0x15, 0x94, 0x96, 0x28, 0x94, 0x54, 0x16,
+    0xa4, 0xda, 0x2a, 0x95, 0xa4, 0x56, 0x94, 0x28, 0x29, 0xe4, 0x25, 0xe6, 0x02, 0xd9, 0x69, 0x49,
+    0xf1, 0xa5, 0x45, 0x39, 0x4a, 0x0a, 0x65, 0x89, 0x39, 0xa5, 0x40, 0x2e, 0x00, 0x00, 0x00, 0xff,
+    0xff,
+};
+
+static const uint8_t portalPiece13[] PROGMEM = {
+    0x52, 0x52, 0x28, 0x4a, 0x2d, 0x2c, 0xcd, 0x2c, 0x4a, 0x4d, 0xb1, 0xe3, 0x52, 0x40, 0x03, 0x36,
+    0xfa, 0x29, 0x99, 0x65, 0x58, 0x84, 0x81, 0xa2, 0x0a, 0xc9, 0x39, 0x89, 0xc5, 0xc5, 0xb6, 0x4a,
+    0x69, 0xf9, 0x45, 0xb9, 0xba, 0xe9, 0x45, 0xf9, 0xa5, 0x05, 0x4a, 0x98, 0x0a, 0xc1, 0x8a, 0x73,
+    0x12, 0x93, 0x52, 0x73, 0xec, 0x42, 0x8b, 0x53, 0x8b, 0x14, 0x5c, 0x73, 0x13, 0x33, 0x73, 0x6c,
+    0xf4, 0x21, 0x22, 0xd8, 0x55, 0x67, 0xe6, 0x15, 0x94, 0x96, 0x28, 0x94, 0x54, 0x16, 0xa4, 0xda,
+    0x2a, 0x95, 0xa4, 0x56, 0x94, 0x28, 0x29, 0xe4, 0x25, 0xe6, 0x02, 0xd9, 0x69, 0x49, 0xf1, 0xa9,
+    0x20, 0xdd, 0x4a, 0x0a, 0x65, 0x89, 0x39, 0xa5, 0x40, 0x01, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff,
+};
+
+static const uint8_t portalPiece14[] PROGMEM = {
+    0x6c, 0x8b, 0x3b, 0x0e, 0x80, 0x20, 0x10, 0x05, 0x7b, 0x4f, 0xb1, 0xd9, 0xde, 0x78, 0x01, 0xf5,
+    0x0c, 0x36, 0xd6, 0x06, 0x65, 0x35, 0x24, 0x20, 0xb8, 0x88, 0xc6, 0xdb, 0x8b, 0x9f, 0x4a, 0x79,
+    0xdd, 0x9b, 0xcc, 0x20, 0x30, 0x2d, 0x41, 0x31, 0xc9, 0x3a, 0x83, 0xcf, 0xca, 0x42, 0xaa, 0x2d,
+    0x81, 0x23, 0x85, 0x41, 0x0b, 0xef, 0x2b, 0x1c, 0x2d, 0x9b, 0x7c, 0x62, 0x1b, 0x1c, 0xfe, 0xc5,
+    0x5b, 0xd6, 0xa2, 0x27, 0x5d, 0xb7, 0x9e, 0x18, 0x9a, 0x98, 0xec, 0x96, 0x65, 0x59, 0x3c, 0x30,
+    0x1d, 0xa8, 0xd9, 0x85, 0x15, 0xd6, 0xc3, 0x51, 0x85, 0xee, 0x2d, 0x10, 0x66, 0x61, 0xe2, 0x1f,
+    0xfb, 0xee, 0x42, 0x08, 0x9b, 0xd0, 0x21, 0xfe, 0x13, 0x00, 0x00, 0xff, 0xff,
+};
+
+static const uint8_t portalPiece15[] PROGMEM = {
+    0x6c, 0x8f, 0xbd, 0x4e, 0xc4, 0x30, 0x10, 0x84, 0x7b, 0x9e, 0x62, 0x64, 0x1a, 0x28, 0xa2, 0x1c,
+    0xa4, 0xcb, 0xe5, 0x90, 0x10, 0x15, 0x82, 0x82, 0x37, 0x40, 0xce, 0x79, 0xb9, 0xb3, 0x6e, 0xed,
+    0x35, 0xb6, 0x13, 0xf0, 0xdb, 0x63, 0xfe, 0x0a, 0x90, 0xb7, 0x9b, 0xd5, 0xec, 0x37, 0xb3, 0x0a,
+    0x91, 0x5e, 0x17, 0x1b, 0xc9, 0xdc, 0x9c, 0xe1, 0xdf, 0x4c, 0xbd, 0xb1, 0x6b, 0x63, 0x7d, 0x8c,
+    0x48, 0xb9, 0x30, 0xed, 0x94, 0xd3, 0xf1, 0x60, 0xfd, 0x88, 0x61, 0x13, 0xde, 0xb1, 0xd9, 0x62,
+    0x96, 0x68, 0x28, 0x8e, 0xf0, 0xe2, 0xe9, 0x57, 0x75, 0x59, 0xc2, 0x88, 0xab, 0x6a, 0x48, 0xc2,
+    0xd6, 0xe0, 0xdc, 0x18, 0xb3, 0x55, 0x2d, 0xec, 0xf0, 0x17, 0xdb, 0xcd, 0x92, 0xb3, 0xb8, 0x11,
+    0xd7, 0x95, 0x5e, 0x2f, 0x1e, 0x65, 0xaf, 0x19, 0x77, 0xe2, 0x73, 0x14, 0x9e, 0xfa, 0xe3, 0xd0,
+    0x60, 0xd4, 0xc2, 0xd8, 0xb3, 0x4e, 0x69, 0xa7, 0x5e, 0x24, 0xba, 0xee, 0x10, 0x65, 0x09, 0x8d,
+    0xb0, 0x2f, 0x33, 0xeb, 0x99, 0xf8, 0x07, 0x7b, 0xfb, 0x74, 0x8f, 0x07, 0x2a, 0xb8, 0x60, 0xd2,
+    0x2b, 0x81, 0x5c, 0xc8, 0x05, 0x59, 0x60, 0x6c, 0xd2, 0x33, 0xd3, 0xe5, 0xd4, 0x7f, 0xbb, 0xdb,
+    0x24, 0xeb, 0xc3, 0x92, 0x91, 0x4b, 0xa8, 0xe5, 0x43, 0x4d, 0x7f, 0xab, 0x9f, 0x2b, 0x78, 0xed,
+    0xaa, 0xe6, 0x4f, 0xfe, 0xf3, 0x89, 0x8a, 0xc2, 0xaa, 0x79, 0xa9, 0x9b, 0x0f, 0x00, 0x00, 0x00,
+    0xff, 0xff,
+};
+
+static const uint8_t portalPiece16[] PROGMEM = {
+    0x6c, 0x8d, 0xbb, 0x0e, 0xc2, 0x30, 0x0c, 0x45, 0x77, 0xbe, 0xc2, 0xf2, 0x04, 0x52, 0x51, 0x4b,
+    0x17, 0x96, 0xba, 0x2b, 0xea, 0x44, 0xff, 0x00, 0xa5, 0x34, 0x2d, 0x91, 0x12, 0x27, 0xca, 0xa3,
+    0x82, 0xbf, 0x27, 0x6a, 0x37, 0xa8, 0x17, 0xfb, 0x5e, 0x1d, 0x1d, 0x63, 0x7b, 0x80, 0x9f, 0x69,
+    0xca, 0x51, 0x2d, 0x3b, 0x75, 0x6e, 0xe1, 0xa9, 0x45, 0x08, 0x84, 0x93, 0xf5, 0xe6, 0x3c, 0x7b,
+    0x9b, 0x1c, 0xfe, 0x83, 0x2b, 0xac, 0xc5, 0x20, 0x75, 0xdb, 0x7b, 0x29, 0x8d, 0x8b, 0xca, 0x32,
+    0x74, 0xec, 0x52, 0x84, 0x7c, 0xdc, 0xfa, 0xee, 0x0e, 0xf5, 0x15, 0x8e, 0x15, 0xd9, 0x69, 0x2a,
+    0xe0, 0x42, 0x21, 0x5a, 0x57, 0x40, 0x4d, 0x73, 0xa6, 0x19, 0x5e, 0x56, 0x8f, 0xa7, 0xa6, 0xdc,
+    0x04, 0xfb, 0x72, 0xb5, 0xba, 0xe2, 0xc7, 0x49, 0x42, 0x4e, 0x66, 0x90, 0x1e, 0x81, 0x85, 0xc9,
+    0xc9, 0x6d, 0x0f, 0x1f, 0x8a, 0x11, 0x8c, 0x62, 0xc2, 0x2a, 0x6f, 0xf1, 0x26, 0xac, 0x11, 0x16,
+    0xa1, 0x53, 0x46, 0xbe, 0x00, 0x00, 0x00, 0xff, 0xff,
+};
+
+static const uint8_t portalPiece17[] PROGMEM = {
+    0x6c, 0xce, 0xbb, 0x0a, 0xc2, 0x40, 0x10, 0x05, 0xd0, 0xde, 0xaf, 0xb8, 0x4c, 0xa5, 0x85, 0x24,
+    0x20, 0xb1, 0xca, 0xa6, 0x12, 0x42, 0x3a, 0xff, 0x40, 0x36, 0x71, 0x22, 0x0b, 0xfb, 0x62, 0x1f,
+    0x41, 0xff, 0xde, 0xd5, 0x74, 0x9a, 0x69, 0x86, 0xb9, 0x1c, 0x2e, 0x43, 0xdd, 0x0e, 0x3f, 0xd3,
+    0x56, 0x77, 0xb5, 0x6c, 0xc4, 0x25, 0xc5, 0xa4, 0x65, 0x8c, 0x82, 0x66, 0x17, 0xcc, 0xf1, 0x11,
+    0x5c, 0xf6, 0xf4, 0x0f, 0xbf, 0x58, 0xcb, 0x91, 0x75, 0x77, 0x65, 0x0e, 0xe8, 0x3f, 0x0e, 0x15,
+    0x06, 0x9b, 0x38, 0x44, 0x9e, 0x92, 0x72, 0x16, 0xc3, 0x05, 0xfb, 0x1a, 0x02, 0x6e, 0x9e, 0x0f,
+    0x6d, 0xb5, 0xea, 0xed, 0x26, 0x65, 0x7d, 0x4e, 0x48, 0x2f, 0xcf, 0x82, 0x6c, 0x36, 0x23, 0x07,
+    0x82, 0x95, 0xa6, 0x5c, 0xbe, 0xb4, 0xdf, 0xd6, 0x2f, 0x60, 0x94, 0x15, 0x54, 0x97, 0x2d, 0x9f,
+    0x82, 0xce, 0x4d, 0x73, 0x6a, 0x08, 0x8b, 0xd4, 0xb9, 0xb0, 0x37, 0x00, 0x00, 0x00, 0xff, 0xff,
+};
+
+static const uint8_t portalPiece18[] PROGMEM = {
+    0x6c, 0x8c, 0x3b, 0x0e, 0xc2, 0x40, 0x0c, 0x44, 0x7b, 0x4e, 0x61, 0xb9, 0x82, 0x02, 0x25, 0xe9,
+    0xb3, 0x39, 0x43, 0x6e, 0x80, 0x1c, 0x62, 0x60, 0xa5, 0xfd, 0x58, 0xde, 0x6c, 0x04, 0xb7, 0xc7,
+    0x81, 0x0e, 0xe2, 0x66, 0xe4, 0x99, 0x37, 0x83, 0xc3, 0x01, 0x7e, 0xae, 0x6f, 0x66, 0xbf, 0xee,
+    0xd8, 0xe6, 0xc2, 0x35, 0x50, 0x29, 0x0e, 0x6f, 0x59, 0xe3, 0xf9, 0xae, 0xb9, 0x0a, 0xfe, 0x83,
+    0x1f, 0x38, 0xd0, 0xc4, 0x61, 0x18, 0x99, 0x15, 0xc6, 0x07, 0x15, 0x86, 0x63, 0x0b, 0x59, 0xa1,
+    0x3b, 0xf5, 0xcd, 0x37, 0xda, 0xaf, 0xf9, 0x24, 0x75, 0x81, 0xe5, 0x25, 0xec, 0x30, 0xd5, 0x38,
+    0xb1, 0x22, 0x24, 0x8a, 0xf6, 0x89, 0x4d, 0x5d, 0x64, 0x9b, 0x42, 0x88, 0x3e, 0x39, 0x6c, 0x4d,
+    0xe9, 0xe9, 0xb0, 0x43, 0x58, 0x29, 0x54, 0x43, 0xde, 0x00, 0x00, 0x00, 0xff, 0xff,
+};
+
+static const uint8_t portalPiece19[] PROGMEM = {
+    0x6c, 0x8e, 0x3d, 0x0e, 0xc2, 0x30, 0x0c, 0x85, 0x77, 0x4e, 0xf1, 0xe4, 0x09, 0x06, 0xd4, 0x0b,
+    0xb4, 0x5d, 0x19, 0x58, 0xb8, 0x01, 0x4a, 0x89, 0x81, 0x88, 0x34, 0x89, 0xf2, 0x57, 0xe5, 0xf6,
+    0x98, 0xb2, 0x41, 0xbd, 0xf9, 0xd3, 0xf3, 0xe7, 0x47, 0xe3, 0x0e, 0x3f, 0xd3, 0x77, 0xda, 0xd4,
+    0x0d, 0x2c, 0x14, 0x37, 0xab, 0x52, 0x1a, 0xe8, 0xee, 0xe3, 0x7c, 0x7c, 0x44, 0x5f, 0x02, 0xfd,
+    0x07, 0xd7, 0xb0, 0x55, 0x13, 0xdb, 0xf1, 0xc2, 0x1c, 0x71, 0xfa, 0xe4, 0x70, 0xe6, 0x86, 0x7d,
+    0x52, 0x33, 0xc3, 0x3b, 0x70, 0xe5, 0xd8, 0x30, 0x79, 0x15, 0x35, 0x8c, 0x43, 0x7e, 0x32, 0x56,
+    0xdb, 0xa1, 0xef, 0xbe, 0x87, 0xdb, 0x52, 0xe3, 0x42, 0xc9, 0xc8, 0x2d, 0xf0, 0x40, 0x41, 0x8a,
+    0x2c, 0x3e, 0x6a, 0x82, 0x13, 0xa9, 0xec, 0xf2, 0xea, 0xfa, 0xe2, 0x46, 0xa8, 0xca, 0x16, 0x01,
+    0x6f, 0x00, 0x00, 0x00, 0xff, 0xff,
+};
+
+static const uint8_t portalPiece20[] PROGMEM = {
+    0x6c, 0x8c, 0xbd, 0x0a, 0xc2, 0x40, 0x10, 0x84, 0x7b, 0x9f, 0x62, 0xd9, 0x2a, 0x16, 0x92, 0x17,
+    0x48, 0x02, 0xf6, 0x8a, 0x20, 0x5a, 0xcb, 0xc6, 0x6c, 0xe4, 0x60, 0xef, 0x87, 0xbb, 0xbd, 0xc3,
+    0xbc, 0x7d, 0x0e, 0xed, 0x34, 0x53, 0xcd, 0x7c, 0xcc, 0x0c, 0x0e, 0x3b, 0xf8, 0x51, 0xd7, 0x4e,
+    0xa6, 0x6c, 0xe0, 0x4a, 0xe1, 0x29, 0x94, 0x52, 0x8f, 0xb3, 0x8f, 0xf6, 0xf0, 0x8a, 0x3e, 0x07,
+    0xfc, 0x2f, 0x7e, 0xca, 0x42, 0x23, 0xcb, 0x70, 0xb9, 0x1d, 0xe1, 0x4c, 0xce, 0xcc, 0x9c, 0x14,
+    0xee, 0xd7, 0x13, 0x34, 0xc2, 0x54, 0x18, 0xd8, 0x06, 0x5d, 0x40, 0x3d, 0x4c, 0x26, 0xd1, 0x28,
+    0xbc, 0xef, 0xda, 0xef, 0x60, 0xfb, 0xcc, 0xb8, 0x90, 0x15, 0x74, 0x09, 0xdc, 0xa3, 0xf2, 0x5b,
+    0x11, 0x1c, 0xd9, 0xea, 0xbd, 0xd2, 0x23, 0x47, 0x41, 0x28, 0x24, 0xb9, 0xe6, 0x15, 0x00, 0x00,
+    0xff, 0xff,
+};
+
+static const uint8_t portalPiece21[] PROGMEM = {
+    0x6c, 0x8d, 0xbd, 0x0e, 0xc2, 0x30, 0x0c, 0x84, 0x77, 0x9e, 0xc2, 0xf2, 0x04, 0x12, 0x55, 0xdb,
+    0xbd, 0xe9, 0x8e, 0xc4, 0x80, 0xc4, 0x03, 0x20, 0xa7, 0xb8, 0x28, 0x52, 0xe2, 0x44, 0xf9, 0x29,
+    0xf0, 0xf6, 0x04, 0xd8, 0xa0, 0x5e, 0x6c, 0x9f, 0xbe, 0xbb, 0xc3, 0x71, 0x03, 0x3f, 0x33, 0xb4,
+    0x57, 0xb3, 0xac, 0xc8, 0x55, 0x85, 0xc9, 0x52, 0x4a, 0x0a, 0x67, 0x1f, 0x5d, 0x73, 0x8b, 0xbe,
+    0x04, 0xfc, 0x07, 0x3f, 0xb0, 0x25, 0xcd, 0x76, 0x3c, 0xf9, 0x3b, 0x47, 0x38, 0xd3, 0xc2, 0x70,
+    0x34, 0x29, 0xb3, 0xc0, 0x41, 0x32, 0xc7, 0x85, 0x2c, 0x6c, 0x3b, 0x50, 0xe0, 0xe7, 0x79, 0x0f,
+    0x7d, 0xd3, 0x77, 0xa0, 0x99, 0x26, 0x2f, 0x69, 0x37, 0xb4, 0x5f, 0xe7, 0x7a, 0xaa, 0x91, 0x50,
+    0x32, 0xe4, 0x67, 0x60, 0x85, 0x52, 0x9c, 0xe6, 0x88, 0x20, 0xe4, 0xea, 0x17, 0xde, 0x4d, 0x17,
+    0x6b, 0x10, 0x9c, 0x11, 0x85, 0x5d, 0xdd, 0xf4, 0x50, 0xd8, 0xd7, 0xa3, 0xb6, 0x95, 0x4a, 0xbc,
+    0x00, 0x00, 0x00, 0xff, 0xff,
+};
+
+static const uint8_t portalPiece22[] PROGMEM = {
+    0x6c, 0x8c, 0x31, 0x0b, 0xc2, 0x30, 0x14, 0x84, 0x77, 0x7f, 0xc5, 0x91, 0x49, 0x41, 0xe9, 0x2e,
+    0x6d, 0x07, 0x07, 0x37, 0x07, 0xa1, 0xbb, 0xa4, 0xfa, 0xd4, 0x60, 0xd2, 0xc4, 0x97, 0x97, 0x60,
+    0xff, 0xbd, 0xa9, 0x6e, 0xda, 0x5b, 0xee, 0xf8, 0x38, 0x3e, 0xd5, 0x2e, 0xf0, 0x93, 0xba, 0xba,
+    0x98, 0x3c, 0x83, 0x0b, 0xc5, 0xd9, 0xea, 0x18, 0x1b, 0x75, 0xf5, 0xec, 0x36, 0x37, 0xf6, 0x29,
+    0xa8, 0xff, 0xe3, 0xe7, 0x6c, 0x75, 0x4f, 0xb6, 0x3d, 0x1c, 0xbb, 0x0e, 0x3b, 0xf6, 0x0f, 0x62,
+    0x2c, 0xef, 0x3e, 0x0a, 0x3c, 0x63, 0xea, 0x6d, 0xf0, 0x2c, 0x6b, 0x58, 0xd2, 0x99, 0x40, 0x2e,
+    0xc8, 0x88, 0xe2, 0xc4, 0xde, 0x30, 0xf5, 0x3a, 0xd2, 0xaa, 0xae, 0xbe, 0x82, 0x79, 0xb9, 0x19,
+    0x42, 0x12, 0xc8, 0x18, 0xa8, 0x51, 0x42, 0x2f, 0x51, 0x18, 0xb4, 0x2b, 0xdb, 0x3d, 0x45, 0x4e,
+    0x93, 0x5e, 0x21, 0x6b, 0x9b, 0x0a, 0x79, 0x03, 0x00, 0x00, 0xff, 0xff,
+};
+
+static const uint8_t portalPiece23[] PROGMEM = {
+    0x6c, 0x8c, 0x41, 0x0e, 0x40, 0x30, 0x10, 0x45, 0xf7, 0x4e, 0x31, 0x99, 0xbd, 0xb8, 0x80, 0xba,
+    0x81, 0x85, 0x84, 0xb5, 0x14, 0x43, 0x24, 0x2d, 0xd5, 0x4e, 0x1b, 0x6e, 0xaf, 0xd8, 0xe1, 0x2f,
+    0x5f, 0xde, 0xfb, 0x58, 0x24, 0xf0, 0x5a, 0x9e, 0x0d, 0x73, 0xf8, 0xc1, 0x91, 0x42, 0xaf, 0xa4,
+    0x73, 0x02, 0xc7, 0xd5, 0xea, 0x74, 0xb2, 0xab, 0x37, 0xf8, 0x15, 0x6f, 0x59, 0xc9, 0x8e, 0x54,
+    0x51, 0x56, 0x75, 0x0d, 0x8d, 0x23, 0xbb, 0x48, 0x4d, 0x79, 0xf6, 0xc0, 0xff, 0x60, 0x5e, 0x8c,
+    0x67, 0xe0, 0xc3, 0x90, 0x40, 0xa6, 0x9d, 0x11, 0xae, 0x46, 0xa0, 0xde, 0x98, 0x5b, 0x1f, 0x2f,
+    0x10, 0x82, 0x54, 0x3e, 0x92, 0x13, 0x00, 0x00, 0xff, 0xff,
+};
+
+static const uint8_t portalPiece24[] PROGMEM = {
+    0x52, 0xb2, 0xe3, 0x52, 0x40, 0x03, 0x36, 0xfa, 0x29, 0x99, 0x65, 0x58, 0x84, 0x81, 0xa2, 0x0a,
+    0xc9, 0x39, 0x89, 0xc5, 0xc5, 0xb6, 0x4a, 0x69, 0xf9, 0x45, 0xb9, 0xba, 0xe9, 0x45, 0xf9, 0xa5,
+    0x05, 0x4a, 0x98, 0x0a, 0xc1, 0x8a, 0x73, 0x12, 0x93, 0x52, 0x73, 0xec, 0x7c, 0x03, 0x43, 0x42,
+    0x14, 0x02, 0x80, 0x5a, 0xca, 0xf3, 0x8b, 0x52, 0x6c, 0xf4, 0x21, 0x82, 0xd8, 0x35, 0x64, 0xe6,
+    0x15, 0x94, 0x96, 0x28, 0x94, 0x54, 0x16, 0xa4, 0xda, 0x2a, 0x15, 0x40, 0x75, 0x28, 0x29, 0xe4,
+    0x25, 0xe6, 0x02, 0xf9, 0xb9, 0x85, 0x25, 0x25, 0xf1, 0x20, 0x41, 0x25, 0x85, 0xb2, 0xc4, 0x9c,
+    0x52, 0xa0, 0x08, 0x00, 0x00, 0x00, 0xff, 0xff,
+};
+
+static const uint8_t portalPiece25[] PROGMEM = {
+    0x6c, 0x8c, 0xbb, 0x0e, 0xc2, 0x30, 0x14, 0x43, 0x77, 0xbe, 0xc2, 0xba, 0x13, 0x48, 0xa0, 0x16,
+    0x24, 0xb6, 0xa6, 0x03, 0x03, 0x0b, 0x6c, 0x61, 0x47, 0xb7, 0x25, 0x45, 0x11, 0x79, 0x54, 0x69,
+    0x52, 0x01, 0x5f, 0x4f, 0x80, 0x0d, 0xea, 0xc5, 0xb2, 0x75, 0x6c, 0xaa, 0x67, 0xf8, 0x51, 0x55,
+    0x5c, 0xf4, 0x38, 0x51, 0xe7, 0x16, 0xad, 0xe1, 0x61, 0x10, 0xd4, 0xf9, 0x60, 0x57, 0xd7, 0xe0,
+    0x53, 0x4f, 0xff, 0xe0, 0x07, 0x36, 0xdc, 0x28, 0x53, 0xcb, 0x18, 0x14, 0x5b, 0x9c, 0x02, 0xb7,
+    0x0a, 0x52, 0x3f, 0x15, 0xe6, 0x87, 0x1d, 0xbc, 0xc3, 0x51, 0xc7, 0x68, 0xd4, 0x5e, 0x2e, 0x51,
+    0x42, 0xc0, 0x77, 0xdd, 0xa2, 0x2a, 0xbe, 0x93, 0xe9, 0x3b, 0xed, 0xfa, 0x14, 0x11, 0x1f, 0xbd,
+    0x12, 0xe4, 0x92, 0x6d, 0x54, 0x20, 0x38, 0xb6, 0x39, 0xc5, 0xf7, 0xf7, 0xf9, 0xd6, 0x10, 0xac,
+    0x76, 0x82, 0xca, 0xec, 0x7c, 0x17, 0xb4, 0x5d, 0x6f, 0x08, 0x23, 0x9b, 0x94, 0x91, 0x17, 0x00,
+    0x00, 0x00, 0xff, 0xff,
+};
+
+static const uint8_t portalPiece26[] PROGMEM = {
+    0x6c, 0x8c, 0x3f, 0x0b, 0xc2, 0x30, 0x14, 0xc4, 0x77, 0x3f, 0xc5, 0xe3, 0x4d, 0x0a, 0x4a, 0x4a,
+    0xa2, 0x4e, 0x4d, 0x27, 0x41, 0x04, 0x41, 0x27, 0x57, 0x49, 0xdb, 0x57, 0x0d, 0xe4, 0x4f, 0x49,
+    0x93, 0xa2, 0xdf, 0xde, 0xa8, 0x9b, 0xf6, 0x96, 0xe3, 0x8e, 0xdf, 0x1d, 0x56, 0x33, 0xf8, 0x51,
+    0xc9, 0x5a, 0x3d, 0x4e, 0xd4, 0xb9, 0x85, 0xc6, 0xa8, 0x61, 0x90, 0xd8, 0xf9, 0x60, 0x57, 0xb7,
+    0xe0, 0x53, 0x8f, 0xff, 0xe0, 0x07, 0x36, 0xaa, 0x26, 0x53, 0x5d, 0xe8, 0xae, 0x1b, 0x43, 0xb0,
+    0xa3, 0x48, 0x4d, 0xf4, 0x01, 0x8e, 0xca, 0xd1, 0x00, 0xf3, 0xfd, 0xf9, 0x70, 0x02, 0xc1, 0x99,
+    0x10, 0x8c, 0x6f, 0x18, 0xdf, 0x2e, 0xa1, 0x00, 0x09, 0xbe, 0xeb, 0x16, 0x25, 0xfb, 0x2e, 0xa7,
+    0x5f, 0xb5, 0xeb, 0x53, 0x84, 0xf8, 0xec, 0x49, 0xa2, 0x4b, 0xb6, 0xa6, 0x80, 0xe0, 0x94, 0xcd,
+    0xa9, 0xa5, 0x78, 0x35, 0xef, 0x73, 0x04, 0xab, 0x9d, 0xc4, 0x22, 0xbb, 0x7a, 0x48, 0x5c, 0x23,
+    0x8c, 0xca, 0xa4, 0x4c, 0xbc, 0x00, 0x00, 0x00, 0xff, 0xff,
+};
+
+static const uint8_t portalPiece27[] PROGMEM = {
+    0x6c, 0x8c, 0xc1, 0x0e, 0x82, 0x30, 0x10, 0x44, 0xef, 0x7e, 0xc5, 0x64, 0x4f, 0x9a, 0x60, 0x80,
+    0x78, 0xa5, 0x1c, 0xbc, 0x10, 0x4f, 0xf2, 0x07, 0xa6, 0x48, 0x31, 0x4d, 0xda, 0x6d, 0x53, 0x5a,
+    0xa2, 0x7f, 0x6f, 0xc5, 0x9b, 0x32, 0x97, 0x9d, 0x99, 0xbc, 0x1d, 0x6a, 0x77, 0xf8, 0x51, 0x53,
+    0x8e, 0x7a, 0xd9, 0xa8, 0x73, 0x8b, 0xbb, 0x91, 0xf3, 0x2c, 0x68, 0x72, 0xc1, 0x1e, 0x1f, 0xc1,
+    0x25, 0x4f, 0xff, 0xe0, 0x0a, 0x1b, 0x39, 0x28, 0xd3, 0xf6, 0x6a, 0x54, 0x73, 0x0c, 0x5a, 0x32,
+    0xce, 0x29, 0x46, 0xc7, 0xd8, 0x77, 0xfd, 0xe5, 0x8a, 0xfa, 0x54, 0xa0, 0x82, 0x80, 0x9b, 0xa6,
+    0x02, 0xf5, 0xc7, 0xf0, 0xa1, 0x29, 0xbf, 0x3f, 0xdb, 0x7b, 0x9a, 0x7d, 0x8a, 0x88, 0x2f, 0xaf,
+    0x04, 0x71, 0xb2, 0x83, 0x0a, 0x04, 0x96, 0x36, 0x27, 0xaf, 0xc6, 0xdb, 0xb0, 0x8e, 0x13, 0xac,
+    0x66, 0x41, 0x55, 0xbe, 0xf2, 0x29, 0xa8, 0x26, 0x2c, 0xd2, 0xa4, 0x8c, 0xbc, 0x01, 0x00, 0x00,
+    0xff, 0xff,
+};
+
+static const uint8_t portalPiece28[] PROGMEM = {
+    0x6c, 0x8d, 0x3b, 0x0e, 0xc2, 0x30, 0x0c, 0x86, 0x77, 0x4e, 0x61, 0x79, 0x02, 0xa9, 0xa8, 0xa5,
+    0x73, 0xc3, 0x09, 0x18, 0xb8, 0x01, 0x4a, 0x13, 0x83, 0x22, 0x39, 0x0f, 0xe5, 0x51, 0xd1, 0xdb,
+    0x63, 0x95, 0x0d, 0xea, 0xc5, 0xf6, 0xa7, 0xcf, 0xfe, 0xf1, 0x7a, 0x80, 0x9f, 0x9a, 0x7a, 0xeb,
+    0x96, 0x1d, 0x2c, 0x14, 0x0c, 0xeb, 0x52, 0x14, 0x3e, 0x63, 0xf6, 0xe7, 0x57, 0x8e, 0x2d, 0xe1,
+    0xbf, 0xb8, 0xc9, 0xac, 0x67, 0xe2, 0xeb, 0x2d, 0x1a, 0xcd, 0x70, 0x67, 0x1d, 0xe0, 0x38, 0x80,
+    0x92, 0xf3, 0xd8, 0x6c, 0x07, 0x17, 0x19, 0x2d, 0x85, 0xe2, 0xea, 0x0a, 0x4c, 0x0b, 0x71, 0x07,
+    0xe3, 0x86, 0x2a, 0x99, 0x1a, 0x33, 0x98, 0xd8, 0x42, 0x2d, 0xa7, 0xa9, 0xff, 0x7e, 0xd9, 0x4f,
+    0x70, 0x21, 0xb5, 0x0a, 0x75, 0x4d, 0xa4, 0x30, 0x34, 0x3f, 0x53, 0x46, 0x08, 0xda, 0xcb, 0x96,
+    0x24, 0xef, 0xe1, 0xa3, 0x25, 0x04, 0xef, 0x82, 0xc2, 0x41, 0xba, 0x7e, 0x2b, 0x1c, 0x11, 0x16,
+    0xcd, 0x4d, 0x8c, 0x0f, 0x00, 0x00, 0x00, 0xff, 0xff,
+};
+
+static const uint8_t portalPiece29[] PROGMEM = {
+    0x6c, 0x8c, 0xbb, 0x0a, 0xc2, 0x40, 0x10, 0x45, 0x7b, 0xbf, 0xe2, 0x32, 0x95, 0x82, 0x21, 0x44,
+    0x2c, 0xb3, 0x69, 0x6c, 0x05, 0x2d, 0xb4, 0x96, 0x49, 0xdc, 0x98, 0xc0, 0xbe, 0xd8, 0x47, 0x50,
+    0xbf, 0xde, 0x55, 0x3b, 0xcd, 0x54, 0xf7, 0x5e, 0xce, 0x1c, 0x6a, 0x16, 0xf8, 0xb9, 0xba, 0xbc,
+    0x8e, 0xd3, 0xcc, 0x9c, 0x57, 0x74, 0x8a, 0x43, 0x10, 0xd4, 0x5b, 0xaf, 0x8b, 0x9b, 0xb7, 0xc9,
+    0xd1, 0x3f, 0xf8, 0x81, 0x15, 0xb7, 0x52, 0x35, 0x7b, 0xdb, 0xb1, 0xc2, 0x51, 0xb1, 0xc1, 0xf9,
+    0xb4, 0xc3, 0xa1, 0xef, 0x83, 0x8c, 0x58, 0x0e, 0x36, 0xf9, 0xb0, 0x46, 0xb6, 0xc0, 0xa7, 0x30,
+    0xe0, 0xdd, 0x57, 0x75, 0xf9, 0xfd, 0x99, 0xf7, 0x8d, 0xc6, 0xa5, 0x88, 0xf8, 0x70, 0x52, 0x90,
+    0x49, 0xba, 0x95, 0x9e, 0x60, 0x58, 0xe7, 0xe6, 0xb2, 0xfd, 0x12, 0x9f, 0x04, 0x3d, 0x1a, 0x41,
+    0x45, 0xb5, 0xc9, 0x89, 0xef, 0x82, 0xaa, 0x2d, 0x61, 0x62, 0x95, 0x32, 0xf2, 0x02, 0x00, 0x00,
+    0xff, 0xff,
+};
+
+static const uint8_t portalPiece30[] PROGMEM = {
+    0x9c, 0x90, 0x31, 0x0e, 0x83, 0x30, 0x0c, 0x45, 0x77, 0x4e, 0x61, 0x79, 0xe8, 0x56, 0xe5, 0x02,
+    0x24, 0x53, 0xf7, 0x56, 0xd0, 0x0b, 0x18, 0x62, 0x4a, 0x24, 0x92, 0xa0, 0xc4, 0x20, 0x71, 0x7b,
+    0x40, 0xed, 0xd0, 0xa2, 0x0e, 0x55, 0xbd, 0xd8, 0x7a, 0xd2, 0xff, 0xfe, 0xfa, 0x68, 0x0a, 0x38,
+    0x4c, 0xa9, 0xac, 0x9b, 0xbf, 0xe0, 0x66, 0x12, 0x89, 0x01, 0x64, 0x19, 0x59, 0x63, 0x9e, 0x1a,
+    0xef, 0x04, 0xa1, 0x1d, 0x28, 0x67, 0x8d, 0x8d, 0x84, 0xf3, 0x98, 0x9c, 0xa7, 0xb4, 0xa0, 0xa9,
+    0x69, 0x66, 0x38, 0x41, 0xc5, 0x59, 0x28, 0x49, 0xa9, 0x9e, 0xc2, 0x4f, 0xc7, 0x52, 0x75, 0x31,
+    0xf9, 0x03, 0xdb, 0x11, 0x50, 0x2b, 0x2e, 0x06, 0x8d, 0x2a, 0x71, 0xe6, 0xed, 0x83, 0x67, 0xe9,
+    0xa3, 0xd5, 0x78, 0xbb, 0xd6, 0x77, 0xfc, 0x23, 0x96, 0xa5, 0xf0, 0xe0, 0x84, 0xa6, 0xda, 0xed,
+    0x40, 0x22, 0x5c, 0xb8, 0xa3, 0x69, 0x90, 0xfc, 0x5b, 0xb0, 0xb7, 0x36, 0x5e, 0xe7, 0xa6, 0x8b,
+    0x76, 0xd9, 0x77, 0x2f, 0x7e, 0x30, 0xc5, 0x0a, 0x00, 0x00, 0xff, 0xff,
+};
+
+// 7714 bytes of HTML, 4453 bytes deflated
+static const GzipSegment configPageSegments[] = {
+    {portalPiece0, sizeof(portalPiece0), 1264, 0x344ec187, PORTAL_TEAM_ID},
+    {portalPiece1, sizeof(portalPiece1), 13, 0xd3dd99ed, PORTAL_LIGHT_ID},
+    {portalPiece2, sizeof(portalPiece2), 242, 0xab556742, PORTAL_WIFI_SSID},
+    {portalPiece3, sizeof(portalPiece3), 187, 0xeead8828, PORTAL_WIFI_PASS},
+    {portalPiece4, sizeof(portalPiece4), 189, 0x93eacee4, PORTAL_WIFI_SSID2},
+    {portalPiece5, sizeof(portalPiece5), 186, 0xb2b86162, PORTAL_WIFI_PASS2},
+    {portalPiece6, sizeof(portalPiece6), 188, 0x3e915d7a, PORTAL_WIFI_SSID3},
+    {portalPiece7, sizeof(portalPiece7), 185, 0x4535c6e9, PORTAL_WIFI_PASS3},
+    {portalPiece8, sizeof(portalPiece8), 226, 0xe3d915cd, PORTAL_WIFI_ROAM},
+    {portalPiece9, sizeof(portalPiece9), 168, 0xa48e51e0, PORTAL_TEAM_ID},
+    {portalPiece10, sizeof(portalPiece10), 189, 0x3db24fde, PORTAL_LIGHT_ID},
+    {portalPiece11, sizeof(portalPiece11), 343, 0xbce2ed12, PORTAL_FB_KEY},
+    {portalPiece12, sizeof(portalPiece12), 184, 0x88ce1681, PORTAL_FB_URL},
+    {portalPiece13, sizeof(portalPiece13), 184, 0x8d956075, PORTAL_FB_EMAIL},
+    {portalPiece14, sizeof(portalPiece14), 190, 0x84665988, PORTAL_FB_PASS},
+    {portalPiece15, sizeof(portalPiece15), 372, 0xda8876dc, PORTAL_LOCAL_KEY},
+    {portalPiece16, sizeof(portalPiece16), 242, 0xdb6c0fbd, PORTAL_PREEMPT_IN},
+    {portalPiece17, sizeof(portalPiece17), 227, 0xbc7f1712, PORTAL_PEER_GROUP},
+    {portalPiece18, sizeof(portalPiece18), 204, 0x8c832263, PORTAL_PEER_PHASE},
+    {portalPiece19, sizeof(portalPiece19), 218, 0x795a610e, PORTAL_PEER_KEY},
+    {portalPiece20, sizeof(portalPiece20), 205, 0x0e0faaba, PORTAL_OTA_URL},
+    {portalPiece21, sizeof(portalPiece21), 234, 0x6d5cee82, PORTAL_POWER_LI},
+    {portalPiece22, sizeof(portalPiece22), 223, 0x459540be, PORTAL_MQTT_HOST},
+    {portalPiece23, sizeof(portalPiece23), 179, 0x3f850b1c, PORTAL_MQTT_USER},
+    {portalPiece24, sizeof(portalPiece24), 183, 0xb0be9eea, PORTAL_MQTT_PASS},
+    {portalPiece25, sizeof(portalPiece25), 228, 0x0ca5825f, PORTAL_TRACE_KB},
+    {portalPiece26, sizeof(portalPiece26), 234, 0xff819d18, PORTAL_DET_LANES},
+    {portalPiece27, sizeof(portalPiece27), 229, 0x1eae6fb6, PORTAL_PED_BUTTON},
+    {portalPiece28, sizeof(portalPiece28), 246, 0x81dacc42, PORTAL_PLAN_MODE},
+    {portalPiece29, sizeof(portalPiece29), 229, 0xb9384aa2, PORTAL_PLAN_TZ},
+    {portalPiece30, sizeof(portalPiece30), 323, 0x0638492d, GZIP_NO_FIELD},
+};
+
+#endif
@@ -0,0 +1,378 @@
+#include "flight_recorder.h"
+#include <WiFi.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include "loop_profiler.h"
+#include "LampDriver.h"
+
+// One event, 12 bytes: a 48-bit esp_timer timestamp and two arguments
+struct FlightRecord
+{
+  uint32_t atUsLow;
+  uint16_t atUsHigh;
+  uint8_t type;
+  uint8_t a;
+  uint32_t b;
+};
+
+static_assert(sizeof(FlightRecord) == 12, "flight records are 12 bytes");
+
+struct FlightLog
+{
+  uint32_t magic;
+  uint16_t head;  // next slot to write
+  uint16_t count; // records in the ring
+  uint32_t boots; // boots since the ring was last reset by a power-on
+  uint32_t check; // header check, rewritten with every record
+  FlightRecord records[FLIGHT_RECORDER_RECORDS];
+};
+
+const uint32_t FLIGHT_LOG_MAGIC = 0x464C5452; // "FLTR"
+
+// Not touched by the startup code, so it still holds the last boot's ring
+static RTC_NOINIT_ATTR FlightLog flightLog;
+static portMUX_TYPE recorderLock = portMUX_INITIALIZER_UNLOCKED;
+static bool ready = false;
+
+static esp_reset_reason_t resetReason = ESP_RST_UNKNOWN;
+static uint16_t keptRecords = 0; // from before this boot
+
+// Last recorded values, loop task only
+static uint8_t lastLamps = 0xFF;
+static int lastStatus = -1;
+static int32_t lastDisplay = -1;
+static uint8_t lastBlink = 0;
+
+static uint32_t headerCheck()
+{
+  return flightLog.magic ^ ((uint32_t)flightLog.head << 16 | flightLog.count) ^ flightLog.boots ^ 0xA5A5A5A5;
+}
+
+static bool headerValid()
+{
+  return flightLog.magic == FLIGHT_LOG_MAGIC && flightLog.head < FLIGHT_RECORDER_RECORDS &&
+         flightLog.count <= FLIGHT_RECORDER_RECORDS && flightLog.check == headerCheck();
+}
+
+static void record(RecordType type, uint8_t a, uint32_t b)
+{
+  if (!ready)
+    return;
+
+  uint64_t nowUs = esp_timer_get_time();
+
+  portENTER_CRITICAL(&recorderLock);
+  FlightRecord &slot = flightLog.records[flightLog.head];
+  slot.atUsLow = (uint32_t)nowUs;
+  slot.atUsHigh = (uint16_t)(nowUs >> 32);
+  slot.type = type;
+  slot.a = a;
+  slot.b = b;
+  flightLog.head = flightLog.head + 1 == FLIGHT_RECORDER_RECORDS ? 0 : flightLog.head + 1;
+  if (flightLog.count < FLIGHT_RECORDER_RECORDS)
+    flightLog.count++;
+  flightLog.check = headerCheck();
+  portEXIT_CRITICAL(&recorderLock);
+}
+
+// Runs in the Wi-Fi event task
+static void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info)
+{
+  uint32_t reason = event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED ? info.wifi_sta_disconnected.reason : 0;
+  record(REC_WIFI, (uint8_t)event, reason);
+}
+
+// ================= DUMP =================
+
+static const char *resetReasonName(int reason)
+{
+  switch (reason)
+  {
+  case ESP_RST_POWERON:
+    return "power-on";
+  case ESP_RST_EXT:
+    return "external";
+  case ESP_RST_SW:
+    return "software";
+  case ESP_RST_PANIC:
+    return "panic";
+  case ESP_RST_INT_WDT:
+    return "interrupt watchdog";
+  case ESP_RST_TASK_WDT:
+    return "task watchdog";
+  case ESP_RST_WDT:
+    return "watchdog";
+  case ESP_RST_DEEPSLEEP:
+    return "deep sleep";
+  case ESP_RST_BROWNOUT:
+    return "brownout";
+  case ESP_RST_SDIO:
+    return "sdio";
+  default:
+    return "unknown";
+  }
+}
+
+static const char *streamKindName(int kind)
+{
+  switch (kind)
+  {
+  case STREAM_PUT:
+    return "put";
+  case STREAM_PATCH:
+    return "patch";
+  case STREAM_KEEP_ALIVE:
+    return "keep-alive";
+  case STREAM_CANCEL:
+    return "cancel";
+  case STREAM_AUTH_REVOKED:
+    return "auth_revoked";
+  case STREAM_MQTT:
+    return "mqtt";
+  default:
+    return "other";
+  }
+}
+
+static const char *wifiEventName(int event)
+{
+  switch (event)
+  {
+  case ARDUINO_EVENT_WIFI_STA_START:
+    return "sta start";
+  case ARDUINO_EVENT_WIFI_STA_STOP:
+    return "sta stop";
+  case ARDUINO_EVENT_WIFI_STA_CONNECTED:
+    return "connected";
+  case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+    return "disconnected";
+  case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+    return "got ip";
+  case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+    return "lost ip";
+  case ARDUINO_EVENT_WIFI_SCAN_DONE:
+    return "scan done";
+  default:
+    return nullptr;
+  }
+}
+
+static const char *statusName(int status)
+{
+  return status == 0 ? "active" : status == 1 ? "broken"
+                              : status == 2   ? "fixing"
+                                              : "?";
+}
+
+// "boot 3    12.345678  lamp     --G"
+static void printRecord(Print &out, uint32_t boot, const FlightRecord &rec)
+{
+  uint64_t atUs = (uint64_t)rec.atUsHigh << 32 | rec.atUsLow;
+  char detail[40];
+
+  switch (rec.type)
+  {
+  case REC_BOOT:
+    snprintf(detail, sizeof(detail), "reset: %s", resetReasonName(rec.a));
+    break;
+  case REC_LAMP:
+    snprintf(detail, sizeof(detail), "%c%c%c", rec.a & LAMP_RED ? 'R' : '-', rec.a & LAMP_YELLOW ? 'Y' : '-',
+             rec.a & LAMP_GREEN ? 'G' : '-');
+    break;
+  case REC_STATUS:
+    snprintf(detail, sizeof(detail), "%s", statusName(rec.a));
+    break;
+  case REC_DISPLAY:
+    if (rec.a == DISPLAY_DASHES)
+      snprintf(detail, sizeof(detail), "----");
+    else if (rec.a == DISPLAY_BLANK)
+      snprintf(detail, sizeof(detail), "blank");
+    else if (rec.a == DISPLAY_CALL)
+      snprintf(detail, sizeof(detail), "CALL");
+    else
+      snprintf(detail, sizeof(detail), "%ld", (long)(int32_t)rec.b);
+    break;
+  case REC_BLINK:
+    snprintf(detail, sizeof(detail), "%s", rec.a == BLINK_OFFLINE ? "offline" : "broken/fixing");
+    break;
+  case REC_STREAM:
+    snprintf(detail, sizeof(detail), "%s, %lu bytes", streamKindName(rec.a), (unsigned long)rec.b);
+    break;
+  case REC_WIFI:
+  {
+    const char *name = wifiEventName(rec.a);
+    if (name && rec.a == ARDUINO_EVENT_WIFI_STA_DISCONNECTED)
+      snprintf(detail, sizeof(detail), "%s, reason %lu", name, (unsigned long)rec.b);
+    else if (name)
+      snprintf(detail, sizeof(detail), "%s", name);
+    else
+      snprintf(detail, sizeof(detail), "event %u", rec.a);
+    break;
+  }
+  default:
+    snprintf(detail, sizeof(detail), "type %u: %u %lu", rec.type, rec.a, (unsigned long)rec.b);
+    break;
+  }
+
+  static const char *const typeNames[] = {"?", "boot", "lamp", "status", "display", "blink", "stream", "wifi"};
+  const char *typeName = rec.type < sizeof(typeNames) / sizeof(typeNames[0]) ? typeNames[rec.type] : "?";
+
+  out.printf("boot %-4lu %6lu.%06lu  %-8s %s\n", (unsigned long)boot, (unsigned long)(atUs / 1000000),
+             (unsigned long)(atUs % 1000000), typeName, detail);
+}
+
+// ================= PUBLIC API =================
+
+void setupFlightRecorder()
+{
+  resetReason = esp_reset_reason();
+
+  // RTC memory is undefined after a power-on; otherwise keep what survived
+  if (resetReason == ESP_RST_POWERON || !headerValid())
+  {
+    flightLog.magic = FLIGHT_LOG_MAGIC;
+    flightLog.head = 0;
+    flightLog.count = 0;
+    flightLog.boots = 0;
+  }
+  keptRecords = flightLog.count;
+  flightLog.boots++;
+  flightLog.check = headerCheck();
+  ready = true;
+
+  record(REC_BOOT, (uint8_t)resetReason, flightLog.boots);
+  WiFi.onEvent(onWiFiEvent);
+
+  Serial.printf("Flight recorder: boot %lu (reset: %s), %u records from before it\n",
+                (unsigned long)flightLog.boots, resetReasonName(resetReason), keptRecords);
+}
+
+void recordLamp(uint8_t lamps, int color)
+{
+  if (lamps == lastLamps)
+    return;
+
+  lastLamps = lamps;
+  lastBlink = 0;
+  record(REC_LAMP, lamps, (uint32_t)color);
+}
+
+void recordStatus(int status)
+{
+  if (status == lastStatus)
+    return;
+
+  lastStatus = status;
+  record(REC_STATUS, (uint8_t)status, 0);
+}
+
+void recordDisplay(DisplayContent content, int number)
+{
+  int32_t shown = content == DISPLAY_NUMBER ? (int32_t)(number & 0xFFFF) : -1 - content;
+  if (shown == lastDisplay)
+    return;
+
+  lastDisplay = shown;
+  record(REC_DISPLAY, content, (uint32_t)number);
+}
+
+void recordBlink(BlinkMode mode)
+{
+  if (mode == lastBlink)
+    return;
+
+  // The blink writes lamp and display itself; whatever comes after it is new
+  lastBlink = mode;
+  lastLamps = 0xFF;
+  lastDisplay = -1;
+  record(REC_BLINK, mode, 0);
+}
+
+void recordStreamEvent(StreamEventKind kind, uint32_t payloadBytes)
+{
+  record(REC_STREAM, kind, payloadBytes);
+}
+
+StreamEventKind streamEventKind(const String &event)
+{
+  if (event == "put")
+    return STREAM_PUT;
+  if (event == "patch")
+    return STREAM_PATCH;
+  if (event == "keep-alive")
+    return STREAM_KEEP_ALIVE;
+  if (event == "cancel")
+    return STREAM_CANCEL;
+  if (event == "auth_revoked")
+    return STREAM_AUTH_REVOKED;
+  return STREAM_OTHER;
+}
+
+void flightRecorderDump(Print &out)
+{
+  portENTER_CRITICAL(&recorderLock);
+  uint16_t count = flightLog.count;
+  uint16_t first = (flightLog.head + FLIGHT_RECORDER_RECORDS - count) % FLIGHT_RECORDER_RECORDS;
+  uint32_t boots = flightLog.boots;
+  portEXIT_CRITICAL(&recorderLock);
+
+  out.printf("Flight recorder: %u of %u records, boot %lu (reset: %s)\n", count, FLIGHT_RECORDER_RECORDS,
+             (unsigned long)boots, resetReasonName(resetReason));
+
+  // Boot records in the ring tell which boot each record belongs to
+  uint32_t bootRecords = 0;
+  for (uint16_t i = 0; i < count; i++)
+  {
+    if (flightLog.records[(first + i) % FLIGHT_RECORDER_RECORDS].type == REC_BOOT)
+      bootRecords++;
+  }
+
+  uint32_t boot = boots - bootRecords;
+  for (uint16_t i = 0; i < count; i++)
+  {
+    // Copy under the lock: a Wi-Fi event may write meanwhile
+    portENTER_CRITICAL(&recorderLock);
+    FlightRecord rec = flightLog.records[(first + i) % FLIGHT_RECORDER_RECORDS];
+    portEXIT_CRITICAL(&recorderLock);
+
+    if (rec.type == REC_BOOT)
+      boot++;
+    printRecord(out, boot, rec);
+  }
+}
+
+void flightRecorderClear()
+{
+  portENTER_CRITICAL(&recorderLock);
+  flightLog.head = 0;
+  flightLog.count = 0;
+  flightLog.check = headerCheck();
+  portEXIT_CRITICAL(&recorderLock);
+  keptRecords = 0;
+}
+
+bool flightRecorderCommand(const String &line)
+{
+  if (line == "rec")
+  {
+    PROFILE_SCOPE(PROF_SERIAL);
+    flightRecorderDump(Serial);
+    return true;
+  }
+  if (line == "rec clear")
+  {
+    flightRecorderClear();
+    Serial.println("Flight recorder cleared");
+    return true;
+  }
+  return false;
+}
+
+String flightRecorderReportJson()
+{
+  return "{\"capacity\":" + String(FLIGHT_RECORDER_RECORDS) +
+         ",\"records\":" + String(flightLog.count) +
+         ",\"boot\":" + String(flightLog.boots) +
+         ",\"reset_reason\":\"" + resetReasonName(resetReason) +
+         "\",\"kept\":" + String(keptRecords) + "}";
+}
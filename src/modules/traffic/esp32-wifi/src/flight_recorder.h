@@ -0,0 +1,86 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <Arduino.h>
+
+// ================= FLIGHT RECORDER =================
+// Post-mortem log of what the board did right before a reset. Every lamp,
+// status and display transition, every stream event (or MQTT message) and
+// every Wi-Fi event goes into a fixed ring of 12-byte binary records in RTC
+// memory (RTC_NOINIT_ATTR), stamped with esp_timer microseconds. RTC memory
+// keeps its contents over a panic, watchdog or software reset, so after the
+// reboot the ring still holds the last FLIGHT_RECORDER_RECORDS events before
+// it, behind a boot record with the reset reason.
+//
+// A record is one store into the ring under a spinlock: constant time, no
+// allocation, safe from the loop task and the Wi-Fi event task. Repeated
+// lamp and display values are recorded once, and the offline/broken blink
+// is one record per blink spell rather than one per toggle, so it cannot
+// flush the ring.
+//
+// The ring starts over on power-on (RTC memory is undefined then) or when
+// its header fails the check. Dumped oldest first over serial ("rec",
+// "rec clear") and GET /api/recorder?dump=1.
+
+const uint16_t FLIGHT_RECORDER_RECORDS = 320; // 3840 bytes of RTC slow memory
+
+enum RecordType
+{
+  REC_BOOT = 1, // a = esp_reset_reason(), b = boot count
+  REC_LAMP,     // a = lamp bits (LampDriver.h), b = color
+  REC_STATUS,   // a = status
+  REC_DISPLAY,  // a = DisplayContent, b = number shown
+  REC_BLINK,    // a = BlinkMode
+  REC_STREAM,   // a = StreamEventKind, b = payload bytes
+  REC_WIFI      // a = arduino_event_id_t, b = disconnect reason
+};
+
+enum DisplayContent
+{
+  DISPLAY_NUMBER = 0,
+  DISPLAY_DASHES = 1,
+  DISPLAY_BLANK = 2,
+  DISPLAY_CALL = 3 // pedestrian call acknowledged
+};
+
+enum BlinkMode
+{
+  BLINK_OFFLINE = 1, // all lamps, "----"
+  BLINK_STATUS = 2   // red, "0000" (broken/fixing)
+};
+
+enum StreamEventKind
+{
+  STREAM_OTHER = 0,
+  STREAM_PUT,
+  STREAM_PATCH,
+  STREAM_KEEP_ALIVE,
+  STREAM_CANCEL,
+  STREAM_AUTH_REVOKED,
+  STREAM_MQTT
+};
+
+// Validate or reset the ring, record the boot and hook the Wi-Fi events.
+// Call first thing in setup().
+void setupFlightRecorder();
+
+void recordLamp(uint8_t lamps, int color);
+void recordStatus(int status);
+void recordDisplay(DisplayContent content, int number = 0);
+void recordBlink(BlinkMode mode);
+void recordStreamEvent(StreamEventKind kind, uint32_t payloadBytes);
+
+// "put", "patch", ... as the stream reports it
+StreamEventKind streamEventKind(const String &event);
+
+// Print the ring, oldest record first, one line each
+void flightRecorderDump(Print &out);
+
+void flightRecorderClear();
+
+// Serial commands "rec" and "rec clear"; returns false for any other line
+bool flightRecorderCommand(const String &line);
+
+String flightRecorderReportJson();
+
+#endif
@@ -0,0 +1,154 @@
+#include "build_features.h"
+
+#ifndef NO_CONFIG_PORTAL
+
+#include "gzip_template.h"
+
+// ================= CRC-32 =================
+
+static const uint32_t CRC32_POLY = 0xEDB88320;
+
+static uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t len)
+{
+  crc = ~crc;
+  while (len--)
+  {
+    crc ^= *data++;
+    for (int k = 0; k < 8; k++)
+      crc = (crc >> 1) ^ (CRC32_POLY & (0 - (crc & 1)));
+  }
+  return ~crc;
+}
+
+static uint32_t gf2MatrixTimes(const uint32_t *mat, uint32_t vec)
+{
+  uint32_t sum = 0;
+  for (; vec; vec >>= 1, mat++)
+  {
+    if (vec & 1)
+      sum ^= *mat;
+  }
+  return sum;
+}
+
+static void gf2MatrixSquare(uint32_t *square, const uint32_t *mat)
+{
+  for (int n = 0; n < 32; n++)
+    square[n] = gf2MatrixTimes(mat, mat[n]);
+}
+
+// CRC of A+B from crc(A), crc(B) and len(B), as zlib's crc32_combine()
+static uint32_t crc32Combine(uint32_t crc1, uint32_t crc2, size_t len2)
+{
+  if (len2 == 0)
+    return crc1;
+
+  uint32_t even[32], odd[32];
+  odd[0] = CRC32_POLY; // operator for one zero bit
+  uint32_t row = 1;
+  for (int n = 1; n < 32; n++)
+  {
+    odd[n] = row;
+    row <<= 1;
+  }
+  gf2MatrixSquare(even, odd); // two zero bits
+  gf2MatrixSquare(odd, even); // four zero bits
+
+  // Apply len2 zero bytes to crc1
+  do
+  {
+    gf2MatrixSquare(even, odd);
+    if (len2 & 1)
+      crc1 = gf2MatrixTimes(even, crc1);
+    len2 >>= 1;
+    if (len2 == 0)
+      break;
+
+    gf2MatrixSquare(odd, even);
+    if (len2 & 1)
+      crc1 = gf2MatrixTimes(odd, crc1);
+    len2 >>= 1;
+  } while (len2 != 0);
+
+  return crc1 ^ crc2;
+}
+
+// ================= STREAMING =================
+
+// Dynamic text as stored (uncompressed) deflate blocks
+static size_t sendStoredBlocks(WebServer &server, const String &value)
+{
+  size_t sent = 0;
+  size_t offset = 0;
+  while (offset < value.length())
+  {
+    uint16_t len = min((size_t)0xFFFF, value.length() - offset);
+    uint8_t header[5] = {0x00, (uint8_t)(len & 0xFF), (uint8_t)(len >> 8),
+                         (uint8_t)(~len & 0xFF), (uint8_t)((~len >> 8) & 0xFF)};
+    server.sendContent((const char *)header, sizeof(header));
+    server.sendContent(value.c_str() + offset, len);
+    offset += len;
+    sent += sizeof(header) + len;
+  }
+  return sent;
+}
+
+static void putLE32(uint8_t *p, uint32_t v)
+{
+  for (int i = 0; i < 4; i++)
+    p[i] = (v >> (8 * i)) & 0xFF;
+}
+
+GzipSendStats sendGzipTemplate(WebServer &server, const char *contentType,
+                               const GzipSegment *segments, size_t count,
+                               String (*fieldValue)(int field))
+{
+  GzipSendStats stats;
+  unsigned long startUs = micros();
+  uint32_t heapStart = ESP.getFreeHeap();
+  uint32_t heapLow = heapStart;
+
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.sendHeader("Content-Encoding", "gzip");
+  server.send(200, contentType, "");
+
+  // gzip member header: deflate, no flags, no mtime, unknown OS
+  static const uint8_t gzipHeader[10] = {0x1f, 0x8b, 0x08, 0x00, 0, 0, 0, 0, 0x00, 0xff};
+  server.sendContent((const char *)gzipHeader, sizeof(gzipHeader));
+  stats.bytesSent += sizeof(gzipHeader);
+  stats.ttfbUs = micros() - startUs;
+
+  uint32_t crc = 0;
+  for (size_t i = 0; i < count; i++)
+  {
+    const GzipSegment &segment = segments[i];
+    server.sendContent_P((const char *)segment.deflated, segment.deflatedLen);
+    stats.bytesSent += segment.deflatedLen;
+    crc = crc32Combine(crc, segment.crc, segment.rawLen);
+    stats.rawBytes += segment.rawLen;
+
+    if (segment.field != GZIP_NO_FIELD)
+    {
+      String value = fieldValue(segment.field);
+      stats.bytesSent += sendStoredBlocks(server, value);
+      crc = crc32Update(crc, (const uint8_t *)value.c_str(), value.length());
+      stats.rawBytes += value.length();
+    }
+
+    heapLow = min(heapLow, (uint32_t)ESP.getFreeHeap());
+  }
+
+  // Final empty stored block, then CRC-32 and size of the uncompressed page
+  uint8_t trailer[13] = {0x01, 0x00, 0x00, 0xFF, 0xFF};
+  putLE32(trailer + 5, crc);
+  putLE32(trailer + 9, stats.rawBytes);
+  server.sendContent((const char *)trailer, sizeof(trailer));
+  server.sendContent(""); // end of the chunked response
+  stats.bytesSent += sizeof(trailer);
+
+  stats.totalUs = micros() - startUs;
+  stats.heapUsed = heapStart - heapLow;
+  return stats;
+}
+
+#endif // NO_CONFIG_PORTAL
@@ -0,0 +1,39 @@
+#ifndef GZIP_TEMPLATE_H
+#define GZIP_TEMPLATE_H
+
+#include <Arduino.h>
+#include <WebServer.h>
+
+// ================= GZIP TEMPLATE STREAMING =================
+// Sends a page whose static pieces were deflated ahead of time
+// (tools/gen_portal.py) as one "Content-Encoding: gzip" response, chunk by
+// chunk straight from flash. Dynamic values go between the pieces as stored
+// deflate blocks, so the whole page is never held in RAM.
+
+const int GZIP_NO_FIELD = -1;
+
+// A precompressed static piece, followed by a dynamic field
+struct GzipSegment
+{
+  const uint8_t *deflated; // raw deflate data ending in a full flush
+  uint16_t deflatedLen;
+  uint16_t rawLen; // uncompressed length of the piece
+  uint32_t crc;    // CRC-32 of the uncompressed piece
+  int field;       // field sent after this piece, or GZIP_NO_FIELD
+};
+
+struct GzipSendStats
+{
+  uint32_t ttfbUs = 0;    // handler entry until headers and gzip header are out
+  uint32_t totalUs = 0;   // handler entry until the last chunk is out
+  uint32_t heapUsed = 0;  // free heap at entry minus the lowest value seen while sending
+  uint32_t bytesSent = 0; // compressed body size
+  uint32_t rawBytes = 0;  // uncompressed page size
+};
+
+// fieldValue must return the value already escaped for the page
+GzipSendStats sendGzipTemplate(WebServer &server, const char *contentType,
+                               const GzipSegment *segments, size_t count,
+                               String (*fieldValue)(int field));
+
+#endif
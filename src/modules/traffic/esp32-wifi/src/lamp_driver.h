@@ -0,0 +1,128 @@
+#ifndef LAMP_DRIVER_H
+#define LAMP_DRIVER_H
+
+#include <Arduino.h>
+#include <soc/gpio_reg.h>
+#include "LampDriver.h"
+
+// ================= LAMP DRIVER BACKENDS =================
+// Pin maps are template parameters, so the register masks are computed at
+// compile time and a wrong pin fails the build instead of a lamp.
+
+// GPIO pins of one signal head, driven straight from the GPIO registers
+template <uint8_t RedPin, uint8_t YellowPin, uint8_t GreenPin>
+struct LampPins
+{
+  static_assert(RedPin < 32 && YellowPin < 32 && GreenPin < 32,
+                "lamp pins must be GPIO 0-31 (GPIO_OUT register)");
+  static_assert(RedPin != YellowPin && RedPin != GreenPin && YellowPin != GreenPin,
+                "lamp pins must be distinct");
+
+  static constexpr uint8_t red = RedPin;
+  static constexpr uint8_t yellow = YellowPin;
+  static constexpr uint8_t green = GreenPin;
+
+  static constexpr uint32_t mask(uint8_t lamps)
+  {
+    return ((lamps & LAMP_RED) ? 1UL << RedPin : 0) |
+           ((lamps & LAMP_YELLOW) ? 1UL << YellowPin : 0) |
+           ((lamps & LAMP_GREEN) ? 1UL << GreenPin : 0);
+  }
+
+  static constexpr uint32_t all = mask(LAMP_ALL);
+};
+
+// Direct-register backend. Lamps going off are cleared in one W1TC write
+// before the lamps going on are set in one W1TS write (break before make),
+// so two lamps are never lit together, not even for a cycle.
+template <typename Pins>
+class GpioLampDriver : public LampDriver
+{
+public:
+  void begin() override
+  {
+    pinMode(Pins::red, OUTPUT);
+    pinMode(Pins::yellow, OUTPUT);
+    pinMode(Pins::green, OUTPUT);
+    REG_WRITE(GPIO_OUT_W1TC_REG, Pins::all);
+    m_lamps = 0;
+  }
+
+  void write(uint8_t lamps) override
+  {
+    REG_WRITE(GPIO_OUT_W1TC_REG, Pins::mask(~lamps & LAMP_ALL));
+    REG_WRITE(GPIO_OUT_W1TS_REG, Pins::mask(lamps));
+    m_lamps = lamps & LAMP_ALL;
+  }
+};
+
+// 74HC595 chain. Every head takes three consecutive outputs (red, yellow,
+// green) starting at Q0 of the first chip, so Chips chips drive
+// Chips * 8 / 3 heads. The whole chain is shifted out and then latched,
+// and all outputs change together on the latch edge.
+template <uint8_t DataPin, uint8_t ClockPin, uint8_t LatchPin, uint8_t Chips>
+class ShiftRegisterLampDriver : public LampDriver
+{
+public:
+  static_assert(DataPin < 32 && ClockPin < 32 && LatchPin < 32, "74HC595 pins must be GPIO 0-31");
+  static_assert(Chips > 0, "at least one 74HC595");
+
+  static constexpr size_t HEADS = Chips * 8 / LAMP_BITS;
+
+  void begin() override
+  {
+    pinMode(DataPin, OUTPUT);
+    pinMode(ClockPin, OUTPUT);
+    pinMode(LatchPin, OUTPUT);
+    REG_WRITE(GPIO_OUT_W1TC_REG, (1UL << DataPin) | (1UL << ClockPin) | (1UL << LatchPin));
+    memset(m_image, 0, sizeof(m_image));
+    latch();
+    m_lamps = 0;
+  }
+
+  // Head 0 is the board's own light
+  void write(uint8_t lamps) override
+  {
+    writeHead(0, lamps);
+  }
+
+  void writeHead(size_t head, uint8_t lamps)
+  {
+    if (head >= HEADS)
+      return;
+
+    lamps &= LAMP_ALL;
+    for (uint8_t b = 0; b < LAMP_BITS; b++)
+    {
+      size_t bit = head * LAMP_BITS + b;
+      if (lamps & (1 << b))
+        m_image[bit / 8] |= 1 << (bit % 8);
+      else
+        m_image[bit / 8] &= ~(1 << (bit % 8));
+    }
+    if (head == 0)
+      m_lamps = lamps;
+    latch();
+  }
+
+private:
+  // Last chip first, MSB first, so bit 0 ends up on Q0 of the first chip
+  void latch()
+  {
+    for (int chip = Chips - 1; chip >= 0; chip--)
+    {
+      for (int bit = 7; bit >= 0; bit--)
+      {
+        REG_WRITE((m_image[chip] >> bit) & 1 ? GPIO_OUT_W1TS_REG : GPIO_OUT_W1TC_REG, 1UL << DataPin);
+        REG_WRITE(GPIO_OUT_W1TS_REG, 1UL << ClockPin);
+        REG_WRITE(GPIO_OUT_W1TC_REG, 1UL << ClockPin);
+      }
+    }
+    REG_WRITE(GPIO_OUT_W1TS_REG, 1UL << LatchPin);
+    REG_WRITE(GPIO_OUT_W1TC_REG, 1UL << LatchPin);
+  }
+
+  uint8_t m_image[Chips];
+};
+
+#endif
@@ -0,0 +1,433 @@
+#include "local_api.h"
+#include <WiFi.h>
+#include "preemption.h"
+#include "ota_update.h"
+#include "power_mode.h"
+#include "loop_profiler.h"
+#include "transport.h"
+#include "stream_trace.h"
+#include "vehicle_detector.h"
+#include "ped_button.h"
+#include "local_plan.h"
+#include "outbound_queue.h"
+#include "flight_recorder.h"
+#include "update_order.h"
+#include "wifi_roam.h"
+#include <LittleFS.h>
+
+LatencyStats commandLatency[SOURCE_COUNT];
+
+// ================= LATENCY STATS =================
+
+void LatencyStats::add(uint32_t us)
+{
+  if (count == 0 || us < minUs)
+    minUs = us;
+  if (us > maxUs)
+    maxUs = us;
+  totalUs += us;
+  count++;
+}
+
+void LatencyStats::reset()
+{
+  count = 0;
+  minUs = 0;
+  maxUs = 0;
+  totalUs = 0;
+}
+
+String LatencyStats::toJson() const
+{
+  uint32_t avgUs = count > 0 ? (uint32_t)(totalUs / count) : 0;
+  return "{\"count\":" + String(count) +
+         ",\"min_us\":" + String(minUs) +
+         ",\"avg_us\":" + String(avgUs) +
+         ",\"max_us\":" + String(maxUs) + "}";
+}
+
+#ifndef NO_LOCAL_API
+
+static bool apiStarted = false;
+
+// ================= AUTH =================
+
+// Constant-time comparison so the key can't be guessed byte by byte
+static bool keyMatches(const String &candidate)
+{
+  if (LOCAL_KEY.length() == 0 || candidate.length() != LOCAL_KEY.length())
+    return false;
+
+  uint8_t diff = 0;
+  for (size_t i = 0; i < LOCAL_KEY.length(); ++i)
+    diff |= (uint8_t)candidate[i] ^ (uint8_t)LOCAL_KEY[i];
+  return diff == 0;
+}
+
+static bool authorize()
+{
+  // Header only: a key in the query string ends up in logs and history
+  if (keyMatches(server.header("X-Auth-Token")))
+    return true;
+
+  server.send(401, "application/json", "{\"error\":\"unauthorized\"}");
+  return false;
+}
+
+// ================= HANDLERS =================
+
+static String stateJson()
+{
+  return "{\"color\":" + String(currentColor) +
+         ",\"remaintime\":" + String(remainingTime) +
+         ",\"yellow_duration\":" + String(yellowDuration) +
+         ",\"status\":" + String(currentStatus) +
+         ",\"online\":" + String(isOnline ? "true" : "false") +
+         ",\"changed_ms\":" + String(stateChangedMs) + "}";
+}
+
+static void handleState()
+{
+  if (!authorize())
+    return;
+  server.send(200, "application/json", stateJson());
+}
+
+// POST /api/control with any of: color, remaintime, yellow_duration, status
+static void handleControl()
+{
+  unsigned long startUs = micros();
+  if (!authorize())
+    return;
+
+  static const char *fields[] = {"color", "remaintime", "yellow_duration", "status"};
+  int accepted = 0;
+  bool changed = false;
+
+  for (const char *field : fields)
+  {
+    if (!server.hasArg(field))
+      continue;
+    accepted++;
+    changed |= applyLightField(field, server.arg(field).toInt(), SOURCE_LOCAL);
+  }
+
+  if (accepted == 0)
+  {
+    server.send(400, "application/json", "{\"error\":\"no control fields\"}");
+    return;
+  }
+
+  uint32_t latencyUs = micros() - startUs;
+  if (changed)
+    commandLatency[SOURCE_LOCAL].add(latencyUs);
+
+  server.send(200, "application/json",
+              "{\"changed\":" + String(changed ? "true" : "false") +
+                  ",\"latency_us\":" + String(latencyUs) +
+                  ",\"state\":" + stateJson() + "}");
+}
+
+// POST /api/preempt with mode: 0=clear, 1=stop, 2=green hold
+static void handlePreempt()
+{
+  unsigned long startUs = micros();
+  if (!authorize())
+    return;
+
+  if (!server.hasArg("mode"))
+  {
+    server.send(400, "application/json", "{\"error\":\"missing mode\"}");
+    return;
+  }
+
+  triggerPreemption(server.arg("mode").toInt(), SOURCE_LOCAL, startUs);
+  server.send(200, "application/json",
+              "{\"active\":" + String(preemptionActive() ? "true" : "false") +
+                  ",\"state\":" + stateJson() + "}");
+}
+
+// GET /api/latency[?reset=1]
+static void handleLatency()
+{
+  if (!authorize())
+    return;
+
+  String body = "{";
+  for (int i = 0; i < SOURCE_COUNT; i++)
+  {
+    if (i > 0)
+      body += ",";
+    body += "\"" + String(sourceName((UpdateSource)i)) + "\":" + commandLatency[i].toJson();
+  }
+  body += ",\"preempt\":" + preemptLatency.toJson() + ",\"delivery\":" + updateOrderReportJson() + "}";
+
+  if (server.arg("reset") == "1")
+  {
+    for (int i = 0; i < SOURCE_COUNT; i++)
+      commandLatency[i].reset();
+    preemptLatency.reset();
+    updateOrderReset();
+  }
+
+  server.send(200, "application/json", body);
+}
+
+// GET /api/ota: last check/update report; POST /api/ota: check now
+static void handleOta()
+{
+  if (!authorize())
+    return;
+
+  if (server.method() == HTTP_POST && !otaCheckNow())
+  {
+    server.send(409, "application/json", "{\"error\":\"OTA disabled or already running\"}");
+    return;
+  }
+  server.send(200, "application/json", otaReportJson());
+}
+
+// GET /api/power: power mode settings and idle duty cycle
+static void handlePower()
+{
+  if (!authorize())
+    return;
+  server.send(200, "application/json", powerReportJson());
+}
+
+// GET /api/wifi: candidate APs, roams and time offline per outage
+static void handleWifi()
+{
+  if (!authorize())
+    return;
+  server.send(200, "application/json", wifiRoamReportJson());
+}
+
+// GET /api/scheduler[?reset=1]: per-job lateness and jitter
+static void handleScheduler()
+{
+  if (!authorize())
+    return;
+
+  String body = "{";
+  for (int i = 0; i < scheduler.size(); i++)
+  {
+    const Job &job = scheduler.job(i);
+    if (i > 0)
+      body += ",";
+    body += "\"" + String(job.name) + "\":{\"runs\":" + String(job.stats.runs) +
+            ",\"avg_late_us\":" + String(job.stats.avgLateUs()) +
+            ",\"max_late_us\":" + String(job.stats.maxLateUs) +
+            ",\"jitter_us\":" + String(job.stats.jitterUs()) + "}";
+  }
+  body += "}";
+
+  if (server.arg("reset") == "1")
+    scheduler.resetStats();
+
+  server.send(200, "application/json", body);
+}
+
+// GET /api/profile[?reset=1][&budget_us=N]: per-subsystem loop times and stalls
+static void handleProfile()
+{
+  if (!authorize())
+    return;
+
+  if (server.hasArg("budget_us"))
+    profilerSetBudget(server.arg("budget_us").toInt());
+
+  String body = profilerJson();
+  if (server.arg("reset") == "1")
+    profilerReset();
+
+  server.send(200, "application/json", body);
+}
+
+static String countersJson(const StreamCounters &counters)
+{
+  return "{\"events\":" + String(counters.events) + ",\"bytes\":" + String(counters.bytes) + "}";
+}
+
+// GET /api/stream: transport, stream path or topic, traffic received
+// (total, this hour, last hour), heap and transport stats (stream auth
+// rotations and gaps for Firebase)
+static void handleStream()
+{
+  if (!authorize())
+    return;
+
+  server.send(200, "application/json",
+              "{\"transport\":\"" + String(transport ? transport->name() : "none") +
+                  "\",\"path\":\"" + (transport ? transport->endpoint() : getStreamPath()) +
+                  "\",\"uptime_s\":" + String(millis() / 1000) +
+                  ",\"free_heap\":" + String(ESP.getFreeHeap()) +
+                  ",\"min_free_heap\":" + String(ESP.getMinFreeHeap()) +
+                  ",\"total\":" + countersJson(streamTotal) +
+                  ",\"this_hour\":" + countersJson(streamThisHour) +
+                  ",\"last_hour\":" + countersJson(streamLastHour) +
+                  ",\"outbound\":" + outboundReportJson() +
+                  ",\"transport_stats\":" + (transport ? transport->reportJson() : String("{}")) + "}");
+}
+
+// GET /api/trace: recorder status; GET /api/trace?download=1: the ring file;
+// POST /api/trace: clear it
+static void handleTrace()
+{
+  if (!authorize())
+    return;
+
+  if (!streamTraceEnabled())
+  {
+    server.send(409, "application/json", "{\"error\":\"stream trace disabled\"}");
+    return;
+  }
+
+  if (server.method() == HTTP_POST)
+  {
+    streamTraceClear();
+  }
+  else if (server.arg("download") == "1")
+  {
+    // Include what is still in RAM
+    streamTraceFlush();
+    File file = LittleFS.open(STREAM_TRACE_FILE, "r");
+    if (!file)
+    {
+      server.send(404, "application/json", "{\"error\":\"no trace file\"}");
+      return;
+    }
+    server.streamFile(file, "application/octet-stream");
+    file.close();
+    return;
+  }
+
+  server.send(200, "application/json", streamTraceReportJson());
+}
+
+// GET /api/plan: local plan mode, cycle timing and its inputs
+static void handlePlan()
+{
+  if (!authorize())
+    return;
+
+  server.send(200, "application/json", localPlanReportJson());
+}
+
+// GET /api/detectors: lanes, current and last cycle counts, upload and ISR stats
+static void handleDetectors()
+{
+  if (!authorize())
+    return;
+
+  server.send(200, "application/json", detectorReportJson());
+}
+
+// GET /api/pedestrian: button state, calls placed, merged presses and ISR stats
+static void handlePedestrian()
+{
+  if (!authorize())
+    return;
+
+  server.send(200, "application/json", pedButtonReportJson());
+}
+
+// Sends what is printed to it as the chunks of a response of unknown length
+class ChunkedResponse : public Print
+{
+public:
+  ChunkedResponse()
+  {
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "text/plain", "");
+  }
+
+  size_t write(uint8_t c) override
+  {
+    m_buf[m_len++] = (char)c;
+    if (m_len == sizeof(m_buf))
+      flush();
+    return 1;
+  }
+
+  void flush()
+  {
+    if (m_len > 0)
+      server.sendContent(m_buf, m_len);
+    m_len = 0;
+  }
+
+  void end()
+  {
+    flush();
+    server.sendContent("");
+  }
+
+private:
+  char m_buf[512];
+  size_t m_len = 0;
+};
+
+// GET /api/recorder: flight recorder status; GET /api/recorder?dump=1: the
+// ring as text, oldest first; POST /api/recorder: clear it
+static void handleRecorder()
+{
+  if (!authorize())
+    return;
+
+  if (server.method() == HTTP_POST)
+  {
+    flightRecorderClear();
+  }
+  else if (server.arg("dump") == "1")
+  {
+    ChunkedResponse out;
+    flightRecorderDump(out);
+    out.end();
+    return;
+  }
+
+  server.send(200, "application/json", flightRecorderReportJson());
+}
+
+// ================= SETUP =================
+
+bool localApiEnabled()
+{
+  return apiStarted;
+}
+
+bool startLocalApi()
+{
+  if (LOCAL_KEY.length() == 0)
+  {
+    Serial.println("Local control API disabled (no local key configured)");
+    return false;
+  }
+
+  static const char *headerKeys[] = {"X-Auth-Token"};
+  server.collectHeaders(headerKeys, 1);
+
+  server.on("/api/state", HTTP_GET, handleState);
+  server.on("/api/control", HTTP_POST, handleControl);
+  server.on("/api/preempt", HTTP_POST, handlePreempt);
+  server.on("/api/latency", HTTP_GET, handleLatency);
+  server.on("/api/ota", handleOta);
+  server.on("/api/power", HTTP_GET, handlePower);
+  server.on("/api/wifi", HTTP_GET, handleWifi);
+  server.on("/api/scheduler", HTTP_GET, handleScheduler);
+  server.on("/api/profile", HTTP_GET, handleProfile);
+  server.on("/api/stream", HTTP_GET, handleStream);
+  server.on("/api/trace", handleTrace);
+  server.on("/api/plan", HTTP_GET, handlePlan);
+  server.on("/api/detectors", HTTP_GET, handleDetectors);
+  server.on("/api/pedestrian", HTTP_GET, handlePedestrian);
+  server.on("/api/recorder", handleRecorder);
+  server.begin();
+
+  apiStarted = true;
+  Serial.println("Local control API: http://" + WiFi.localIP().toString() + "/api/state");
+  return true;
+}
+
+#endif // NO_LOCAL_API
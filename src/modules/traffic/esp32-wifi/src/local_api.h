@@ -0,0 +1,37 @@
+#ifndef LOCAL_API_H
+#define LOCAL_API_H
+
+#include <Arduino.h>
+#include "traffic_light.h"
+
+// ================= COMMAND LATENCY STATS =================
+// Time from a command reaching the firmware (HTTP handler entry or stream
+// callback) until the lamp/display reflect it, in microseconds. This is the
+// board's own share only; tools/transport_latency.py measures the whole way
+// from the sender's write to the lamp, for the local API and the cloud.
+struct LatencyStats
+{
+  uint32_t count = 0;
+  uint32_t minUs = 0;
+  uint32_t maxUs = 0;
+  uint64_t totalUs = 0;
+
+  void add(uint32_t us);
+  void reset();
+  String toJson() const;
+};
+
+extern LatencyStats commandLatency[SOURCE_COUNT];
+
+// ================= LAN CONTROL API =================
+// Starts the authenticated local control endpoints on the shared WebServer.
+// Does nothing (and returns false) when no local key has been configured.
+#ifndef NO_LOCAL_API
+bool startLocalApi();
+bool localApiEnabled();
+#else
+inline bool startLocalApi() { return false; }
+inline bool localApiEnabled() { return false; }
+#endif
+
+#endif
@@ -0,0 +1,139 @@
+#include "local_plan.h"
+#include <time.h>
+#include "TimingEngine.h"
+#include "peer_sync.h"
+#include "token_cache.h"
+#include "vehicle_detector.h"
+
+static PlanMode mode = PLAN_CLOUD;
+static int8_t utcOffsetH = 0;
+
+static CycleTiming timing = timingByDensity(0);
+static bool running = false;
+static unsigned long cycleStartMs = 0;
+static uint32_t cycles = 0;
+
+// What the current cycle was planned from
+static bool fromCounts = false;
+static int plannedVehicles = -1;
+static int plannedHour = -1;
+
+static const char *modeName(PlanMode m)
+{
+  switch (m)
+  {
+  case PLAN_DENSITY:
+    return "density";
+  case PLAN_COUNTS:
+    return "counts";
+  default:
+    return "cloud";
+  }
+}
+
+// Local hour for rush hour, -1 while the clock is not set
+static int localHour()
+{
+  if (!clockValid())
+    return -1;
+
+  time_t now = time(nullptr) + (time_t)utcOffsetH * 3600;
+  struct tm parts;
+  gmtime_r(&now, &parts);
+  return parts.tm_hour;
+}
+
+static void startCycle(unsigned long nowMs)
+{
+  fromCounts = false;
+  plannedVehicles = -1;
+  plannedHour = localHour();
+
+  if (mode == PLAN_COUNTS)
+  {
+    // Close the detector cycle first, so the counts are the cycle that just ended
+    detectorCycleBoundary();
+    fromCounts = detectorLastCycleVehicles(plannedVehicles);
+  }
+
+  timing = fromCounts ? timingByVehicleCount(plannedVehicles) : adaptiveTiming(densityLevel, -1, plannedHour);
+  cycleStartMs = nowMs;
+  running = true;
+  cycles++;
+
+  if (fromCounts)
+    LOG_VERBOSE("Local plan: %ds green, %ds red (%d vehicles)\n", timing.green, timing.red, plannedVehicles);
+  else
+    LOG_VERBOSE("Local plan: %ds green, %ds red (density %d%s)\n", timing.green, timing.red, densityLevel,
+                plannedHour >= 0 && isRushHour(plannedHour) ? ", rush hour" : "");
+}
+
+// ================= PUBLIC API =================
+
+void setupLocalPlan()
+{
+  preferences.begin("traffic-light", true);
+  uint8_t stored = preferences.getUChar("plan_mode", PLAN_CLOUD);
+  utcOffsetH = preferences.getChar("plan_tz", 0);
+  preferences.end();
+
+  mode = stored <= PLAN_COUNTS ? (PlanMode)stored : PLAN_CLOUD;
+  if (mode == PLAN_CLOUD)
+    return;
+
+  Serial.printf("Local plan: %s timing, UTC%+d\n", modeName(mode), utcOffsetH);
+}
+
+bool localPlanEnabled()
+{
+  return mode != PLAN_CLOUD;
+}
+
+bool localPlanActive()
+{
+  return mode != PLAN_CLOUD && !peerSyncFollowing();
+}
+
+void localPlanTick()
+{
+  if (!localPlanActive() || currentStatus != 0)
+  {
+    // Broken/fixing or following a leader: start a fresh cycle afterwards
+    running = false;
+    return;
+  }
+
+  unsigned long nowMs = millis();
+  if (!running || nowMs - cycleStartMs >= (unsigned long)timing.total * 1000UL)
+    startCycle(nowMs);
+
+  unsigned long elapsedS = (nowMs - cycleStartMs) / 1000;
+  applyLightField("yellow_duration", timing.yellow, SOURCE_PLAN);
+  applyLightField("remaintime", phaseRemaining(elapsedS, timing), SOURCE_PLAN);
+  applyLightField("color", recommendedColor(elapsedS, timing), SOURCE_PLAN);
+}
+
+bool localPlanDefer(const String &field, UpdateSource source)
+{
+  if (!localPlanActive() || (source != SOURCE_CLOUD && source != SOURCE_LOCAL))
+    return false;
+
+  return field == "color" || field == "remaintime" || field == "yellow_duration";
+}
+
+String localPlanReportJson()
+{
+  unsigned long elapsedS = running ? (millis() - cycleStartMs) / 1000 : 0;
+  return "{\"mode\":\"" + String(modeName(mode)) +
+         "\",\"active\":" + (localPlanActive() && running ? "true" : "false") +
+         ",\"basis\":\"" + (fromCounts ? "counts" : "density") +
+         "\",\"density\":" + String(densityLevel) +
+         ",\"vehicles\":" + String(plannedVehicles) +
+         ",\"local_hour\":" + String(plannedHour) +
+         ",\"green\":" + String(timing.green) +
+         ",\"yellow\":" + String(timing.yellow) +
+         ",\"red\":" + String(timing.red) +
+         ",\"total\":" + String(timing.total) +
+         ",\"elapsed_s\":" + String(elapsedS) +
+         ",\"cycles\":" + String(cycles) + "}";
+}
@@ -0,0 +1,52 @@
+#ifndef LOCAL_PLAN_H
+#define LOCAL_PLAN_H
+
+#include <Arduino.h>
+#include "traffic_light.h"
+
+// ================= LOCAL PLAN =================
+// The board runs its own green-yellow-red cycle, timed by the port of the
+// backend's timing service (lib/TrafficCore/TimingEngine.h), instead of
+// following per-second color/remaintime writes. Selected with the
+// preference "plan_mode":
+//   PLAN_CLOUD   - follow the cloud plan (default)
+//   PLAN_DENSITY - adaptive timing from the density level (the stream's
+//                  density_level field), with rush-hour scaling by local time
+//   PLAN_COUNTS  - vehicle count timing from the busiest detector lane of
+//                  the last cycle (vehicle_detector.h), density timing until
+//                  the first cycle has been counted
+// Each cycle is planned at its green start, so timing changes take effect at
+// the next cycle. The plan keeps running while offline. Cloud and LAN color,
+// remaintime and yellow_duration writes are ignored while it drives the
+// lamp; status, preemption and peer sync work as before (a following board
+// leaves the plan to its leader).
+
+enum PlanMode
+{
+  PLAN_CLOUD = 0,
+  PLAN_DENSITY = 1,
+  PLAN_COUNTS = 2
+};
+
+const unsigned long LOCAL_PLAN_TICK_MS = 200;
+
+// Reads the preferences ("plan_mode", and "plan_tz", the UTC offset in hours
+// for rush hour)
+void setupLocalPlan();
+
+// A local plan mode is set
+bool localPlanEnabled();
+
+// The plan drives the lamp (mode set, not following a peer leader)
+bool localPlanActive();
+
+// Advance the cycle and apply color/remaintime (scheduler job)
+void localPlanTick();
+
+// Drop a cloud or LAN plan field while the local plan drives the lamp.
+// Returns true if the field was dropped.
+bool localPlanDefer(const String &field, UpdateSource source);
+
+String localPlanReportJson();
+
+#endif
@@ -0,0 +1,243 @@
+#include "loop_profiler.h"
+#include "flight_recorder.h"
+
+static const char *sectionNames[PROF_SECTION_COUNT] = {
+    "jobs", "heartbeat", "app", "database", "mqtt", "stream", "display",
+    "serial", "local_api", "peer", "ota", "preempt"};
+
+struct StallSnapshot
+{
+  uint32_t atMs = 0;
+  uint32_t totalUs = 0;
+  uint32_t sectionUs[PROF_SECTION_COUNT] = {};
+};
+
+static uint32_t budgetUs = PROFILE_DEFAULT_BUDGET_US;
+
+// Current iteration, in cycles
+static uint32_t iterationStart = 0;
+static uint32_t iterationCycles[PROF_SECTION_COUNT];
+static bool sectionRan[PROF_SECTION_COUNT];
+
+// Open sections; time spent in children is taken off the parent
+struct OpenSection
+{
+  ProfileSection section;
+  uint32_t start;
+  uint32_t childCycles;
+};
+static OpenSection openSections[PROFILE_MAX_DEPTH];
+static int depth = 0;
+
+// Rolling stats: the window being filled and the last complete one
+static LatencyStats loopStats[2];
+static LatencyStats sectionStats[2][PROF_SECTION_COUNT];
+static int current = 0;
+static bool haveComplete = false;
+
+static StallSnapshot stalls[PROFILE_MAX_STALLS];
+static uint32_t stallCount = 0;
+
+static uint32_t cyclesToUs(uint32_t cycles)
+{
+  return cycles / getCpuFrequencyMhz();
+}
+
+// ================= SECTIONS =================
+
+ProfileScope::ProfileScope(ProfileSection section)
+{
+  if (depth < PROFILE_MAX_DEPTH)
+    openSections[depth] = {section, ESP.getCycleCount(), 0};
+  depth++;
+}
+
+ProfileScope::~ProfileScope()
+{
+  depth--;
+  if (depth >= PROFILE_MAX_DEPTH)
+    return;
+
+  const OpenSection &open = openSections[depth];
+  uint32_t elapsed = ESP.getCycleCount() - open.start;
+  iterationCycles[open.section] += elapsed - min(elapsed, open.childCycles);
+  sectionRan[open.section] = true;
+
+  if (depth > 0 && depth <= PROFILE_MAX_DEPTH)
+    openSections[depth - 1].childCycles += elapsed;
+}
+
+// ================= ITERATIONS =================
+
+void profilerBeginIteration()
+{
+  memset(iterationCycles, 0, sizeof(iterationCycles));
+  memset(sectionRan, 0, sizeof(sectionRan));
+  depth = 0;
+  iterationStart = ESP.getCycleCount();
+}
+
+static void recordStall(uint32_t totalUs)
+{
+  StallSnapshot &snapshot = stalls[stallCount % PROFILE_MAX_STALLS];
+  snapshot.atMs = millis();
+  snapshot.totalUs = totalUs;
+
+  String line = "► Loop stall: " + String(totalUs) + " us (";
+  bool first = true;
+  for (int i = 0; i < PROF_SECTION_COUNT; i++)
+  {
+    snapshot.sectionUs[i] = cyclesToUs(iterationCycles[i]);
+    if (!sectionRan[i])
+      continue;
+    line += String(first ? "" : ", ") + sectionNames[i] + " " + String(snapshot.sectionUs[i]);
+    first = false;
+  }
+  stallCount++;
+
+  Serial.println(line + ")");
+}
+
+void profilerEndIteration()
+{
+  uint32_t totalUs = cyclesToUs(ESP.getCycleCount() - iterationStart);
+
+  loopStats[current].add(totalUs);
+  for (int i = 0; i < PROF_SECTION_COUNT; i++)
+  {
+    if (sectionRan[i])
+      sectionStats[current][i].add(cyclesToUs(iterationCycles[i]));
+  }
+
+  if (loopStats[current].count >= PROFILE_WINDOW)
+  {
+    current ^= 1;
+    haveComplete = true;
+    loopStats[current].reset();
+    for (int i = 0; i < PROF_SECTION_COUNT; i++)
+      sectionStats[current][i].reset();
+  }
+
+  if (totalUs > budgetUs)
+    recordStall(totalUs);
+}
+
+// ================= REPORTING =================
+
+void setupProfiler()
+{
+  preferences.begin("traffic-light", true);
+  budgetUs = preferences.getUInt("prof_budget", PROFILE_DEFAULT_BUDGET_US);
+  preferences.end();
+}
+
+void profilerSetBudget(uint32_t newBudgetUs)
+{
+  budgetUs = newBudgetUs;
+  preferences.begin("traffic-light", false);
+  preferences.putUInt("prof_budget", budgetUs);
+  preferences.end();
+}
+
+void profilerReset()
+{
+  for (int w = 0; w < 2; w++)
+  {
+    loopStats[w].reset();
+    for (int i = 0; i < PROF_SECTION_COUNT; i++)
+      sectionStats[w][i].reset();
+  }
+  haveComplete = false;
+  stallCount = 0;
+}
+
+String profilerJson()
+{
+  // Last complete window, or the one being filled until the first completes
+  int window = haveComplete ? current ^ 1 : current;
+
+  String body = "{\"budget_us\":" + String(budgetUs) +
+                ",\"cpu_mhz\":" + String(getCpuFrequencyMhz()) +
+                ",\"loop\":" + loopStats[window].toJson() + ",\"sections\":{";
+  for (int i = 0; i < PROF_SECTION_COUNT; i++)
+  {
+    if (i > 0)
+      body += ",";
+    body += "\"" + String(sectionNames[i]) + "\":" + sectionStats[window][i].toJson();
+  }
+
+  body += "},\"stall_count\":" + String(stallCount) + ",\"stalls\":[";
+  uint32_t kept = min(stallCount, (uint32_t)PROFILE_MAX_STALLS);
+  for (uint32_t n = 0; n < kept; n++)
+  {
+    // Oldest first
+    const StallSnapshot &snapshot = stalls[(stallCount - kept + n) % PROFILE_MAX_STALLS];
+    if (n > 0)
+      body += ",";
+    body += "{\"at_ms\":" + String(snapshot.atMs) + ",\"total_us\":" + String(snapshot.totalUs);
+    for (int i = 0; i < PROF_SECTION_COUNT; i++)
+    {
+      if (snapshot.sectionUs[i] > 0)
+        body += ",\"" + String(sectionNames[i]) + "\":" + String(snapshot.sectionUs[i]);
+    }
+    body += "}";
+  }
+  return body + "]}";
+}
+
+static void printReport()
+{
+  int window = haveComplete ? current ^ 1 : current;
+  const LatencyStats &loop = loopStats[window];
+
+  Serial.printf("Loop profile (%lu iterations, budget %lu us)\n", (unsigned long)loop.count, (unsigned long)budgetUs);
+  Serial.printf("  %-10s min %6lu  avg %6lu  max %6lu us\n", "loop", (unsigned long)loop.minUs,
+                (unsigned long)(loop.count ? loop.totalUs / loop.count : 0), (unsigned long)loop.maxUs);
+
+  for (int i = 0; i < PROF_SECTION_COUNT; i++)
+  {
+    const LatencyStats &s = sectionStats[window][i];
+    if (s.count == 0)
+      continue;
+    Serial.printf("  %-10s min %6lu  avg %6lu  max %6lu us  (%lu runs)\n", sectionNames[i], (unsigned long)s.minUs,
+                  (unsigned long)(s.totalUs / s.count), (unsigned long)s.maxUs, (unsigned long)s.count);
+  }
+  Serial.printf("  %lu stalls over budget\n", (unsigned long)stallCount);
+}
+
+void profilerSerialLoop()
+{
+  static String line;
+
+  while (Serial.available())
+  {
+    char c = Serial.read();
+    if (c != '\n' && c != '\r')
+    {
+      if (line.length() < 32)
+        line += c;
+      continue;
+    }
+
+    line.trim();
+    if (line == "prof")
+    {
+      printReport();
+    }
+    else if (line == "prof reset")
+    {
+      profilerReset();
+      Serial.println("Loop profile reset");
+    }
+    else if (line.startsWith("prof budget "))
+    {
+      profilerSetBudget(line.substring(12).toInt());
+      Serial.println("Loop budget: " + String(budgetUs) + " us");
+    }
+    else
+    {
+      flightRecorderCommand(line);
+    }
+    line = "";
+  }
+}
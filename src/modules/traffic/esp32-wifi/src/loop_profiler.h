@@ -0,0 +1,68 @@
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+#include <Arduino.h>
+#include "local_api.h"
+
+// ================= LOOP PROFILER =================
+// Cycle-counter timing of each subsystem inside one loop() iteration.
+// Sections nest (processStream() runs inside Database.loop(), a display
+// write inside processStream(), ...) and each one is charged only its own
+// time, so the breakdown of an iteration adds up to its total.
+//
+// Rolling min/avg/max per section cover the last PROFILE_WINDOW iterations.
+// An iteration slower than the budget (preference "prof_budget", in us) is
+// kept as a stall snapshot with its full breakdown. Available over serial
+// ("prof", "prof reset", "prof budget <us>") and GET /api/profile.
+//
+// Loop task only. Under dynamic frequency scaling (power mode) the cycle
+// counter rate follows the CPU clock, so times are only approximate there.
+
+enum ProfileSection
+{
+  PROF_JOBS,      // scheduled jobs other than the heartbeat
+  PROF_HEARTBEAT, // /online heartbeat write
+  PROF_APP,       // app.loop() (auth, token refresh)
+  PROF_DATABASE,  // Database.loop() minus the stream callback
+  PROF_MQTT,      // MQTT client loop and reconnects, minus the message callback
+  PROF_STREAM,    // processStream() / MQTT state message, minus display and serial
+  PROF_DISPLAY,   // TM1637 writes
+  PROF_SERIAL,    // state change logging
+  PROF_LOCAL_API, // server.handleClient()
+  PROF_PEER,      // peerSyncLoop()
+  PROF_OTA,       // otaLoop()
+  PROF_PREEMPT,   // preemptionLoop()
+  PROF_SECTION_COUNT
+};
+
+const uint32_t PROFILE_WINDOW = 500;          // iterations per stats window
+const uint32_t PROFILE_DEFAULT_BUDGET_US = 20000;
+const int PROFILE_MAX_STALLS = 4;
+const int PROFILE_MAX_DEPTH = 8;
+
+// Times the enclosing block as `section`
+class ProfileScope
+{
+public:
+  explicit ProfileScope(ProfileSection section);
+  ~ProfileScope();
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(section) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(section)
+
+void setupProfiler();
+
+// Bracket the work part of loop() (not the idle wait)
+void profilerBeginIteration();
+void profilerEndIteration();
+
+// Serial commands (the flight recorder's too); call once per loop iteration
+void profilerSerialLoop();
+
+void profilerSetBudget(uint32_t budgetUs);
+void profilerReset();
+String profilerJson();
+
+#endif
@@ -5,10 +5,36 @@
 #include <WiFi.h>
 #include <WiFiClientSecure.h>
 #include <FirebaseClient.h>
-#include <WebServer.h>
 #include <Preferences.h>
 #include <LittleFS.h>
+#include <esp_timer.h>
 #include "TM1637Display.h"
+#include "build_features.h"
+#include "traffic_light.h"
+#include "local_api.h"
+#include "preemption.h"
+#include "peer_sync.h"
+#include "ota_update.h"
+#include "power_mode.h"
+#include "loop_profiler.h"
+#include "lamp_driver.h"
+#include "LightState.h"
+#include "StreamWatchdog.h"
+#include "transport.h"
+#include "mqtt_transport.h"
+#include "stream_trace.h"
+#include "token_cache.h"
+#include "vehicle_detector.h"
+#include "local_plan.h"
+#include "flight_recorder.h"
+#include "update_order.h"
+#include "wifi_roam.h"
+#include "serial_config.h"
+#include "outbound_queue.h"
+#include "ped_button.h"
+#ifndef NO_CONFIG_PORTAL
+#include "config_page.h"
+#endif
 
 // ================= PIN CONFIGURATION =================
 const uint8_t TM1637_CLK = 22;
@@ -20,14 +46,35 @@ const uint8_t RED_PIN = 0;
 const uint8_t YELLOW_PIN = 4;
 const uint8_t GREEN_PIN = 2;
 
+// Build with -D LAMP_DRIVER_74HC595 to drive the lamps through a 74HC595
+// chain (LAMP_SR_CHIPS chips, head 0 is this light) instead of three GPIOs
+#ifdef LAMP_DRIVER_74HC595
+#ifndef LAMP_SR_CHIPS
+#define LAMP_SR_CHIPS 1
+#endif
+const uint8_t SR_DATA_PIN = 23;
+const uint8_t SR_CLOCK_PIN = 18;
+const uint8_t SR_LATCH_PIN = 5;
+ShiftRegisterLampDriver<SR_DATA_PIN, SR_CLOCK_PIN, SR_LATCH_PIN, LAMP_SR_CHIPS> lampDriver;
+#else
+GpioLampDriver<LampPins<RED_PIN, YELLOW_PIN, GREEN_PIN>> lampDriver;
+#endif
+
 // ================= CONFIGURATION =================
 Preferences preferences;
+#ifdef HAS_WEB_SERVER
 WebServer server(80);
+#endif
 TM1637Display display(TM1637_CLK, TM1637_DIO);
 
 // WiFi & Firebase
 String wifiSSID = "";
 String wifiPass = "";
+String wifiSSID2 = "";
+String wifiPass2 = "";
+String wifiSSID3 = "";
+String wifiPass3 = "";
+uint8_t wifiRoam = 1; // 0 = first SSID only, with the driver's auto-reconnect
 String teamId = "10";
 String trafficLightId = "10";
 
@@ -37,20 +84,66 @@ String DATABASE_URL = "";
 String USER_EMAIL = "";
 String USER_PASSWORD = "";
 
+// Shared key for the LAN control API (empty = API disabled)
+String LOCAL_KEY = "";
+
+// Hard-wired preemption input mode (0=off, 1=stop, 2=green hold)
+int preemptInput = 0;
+
+// Peer phase sync (group 0 = off), which intersection phase this light is
+// in, and the key every board in the group signs its ticks with
+uint32_t peerGroup = 0;
+uint8_t peerPhase = 0;
+String peerKey = "";
+
+// OTA manifest URL (empty = no OTA updates)
+String otaManifestUrl = "";
+
+// Wi-Fi listen interval in beacons for the power-managed mode (0 = off)
+uint8_t powerListenInterval = 0;
+
+// MQTT broker ("host" or "host:port", empty = Firebase stream) and its login
+String mqttHost = "";
+String mqttUser = "";
+String mqttPass = "";
+
+// Stream trace ring file size in KB (0 = off)
+uint16_t streamTraceKb = 0;
+
+// Vehicle detector inputs in use (0 = off)
+uint8_t detectorLanes = 0;
+
+// Pedestrian call button (0 = off)
+uint8_t pedButton = 0;
+
+// Local plan mode (0 = cloud plan) and the UTC offset in hours for rush hour
+uint8_t planMode = 0;
+int8_t planUtcOffset = 0;
+
 // Firebase objects
 WiFiClientSecure ssl_client;
 using AsyncClient = AsyncClientClass;
 AsyncClient aClient(ssl_client);
 
+// Two stream clients so a stream with a fresh token can be opened before
+// the old one is closed (see STREAM AUTH ROTATION)
 WiFiClientSecure stream_ssl_client;
 AsyncClient streamClient(stream_ssl_client);
+WiFiClientSecure stream_ssl_client_b;
+AsyncClient streamClientB(stream_ssl_client_b);
 
 UserAuth *user_auth = nullptr;
+IDToken *id_token = nullptr; // cached token reused at boot (token_cache.h)
 FirebaseApp app;
 RealtimeDatabase Database;
 AsyncResult aResult;
 
 bool firebaseReady = false;
+
+// Stream events and payload bytes received
+StreamCounters streamTotal;
+StreamCounters streamThisHour;
+StreamCounters streamLastHour;
 bool configMode = false;
 bool isOnline = true; // Track WiFi connection status
 
@@ -59,6 +152,8 @@ int currentColor = 1; // 1=red, 2=yellow, 3=green
 int remainingTime = 0;
 int currentStatus = 0;  // 0=active, 1=broken, 2=fixing
 int yellowDuration = 0; // yellow_duration from Firebase
+int densityLevel = 0;   // density_level from Firebase (local plan input)
+uint64_t stateChangedMs = 0;
 
 // --- Helper: sanitize non-ASCII characters ---
 String sanitizeASCII(const String &input)
@@ -112,6 +207,7 @@ String sanitizeASCII(const String &input)
   return clean;
 }
 
+#ifndef NO_CONFIG_PORTAL
 String htmlEscape(const String &s)
 {
   String out;
@@ -143,97 +239,87 @@ String htmlEscape(const String &s)
   return out;
 }
 
-// ================= WEB INTERFACE (simplified for space) =================
-const char *configPage = R"rawliteral(
-<!DOCTYPE html>
-<html lang="en">
-<head>
-    <meta charset="UTF-8">
-    <meta name="viewport" content="width=device-width, initial-scale=1">
-    <title>Traffic Light Configuration</title>
-    <style>
-        * { margin: 0; padding: 0; box-sizing: border-box; }
-        body { font-family: Arial, sans-serif; background: #f5f5f5; padding: 20px; }
-        .container { max-width: 600px; margin: 0 auto; background: white; border-radius: 8px; box-shadow: 0 2px 4px rgba(0,0,0,0.1); }
-        .header { background: #2c3e50; color: white; padding: 24px; border-radius: 8px 8px 0 0; }
-        .content { padding: 24px; }
-        .form-group { margin-bottom: 20px; }
-        label { display: block; margin-bottom: 6px; font-weight: 500; font-size: 14px; }
-        input, select { width: 100%; padding: 10px; border: 1px solid #ccc; border-radius: 4px; font-size: 14px; }
-        button { width: 100%; padding: 12px; border: none; border-radius: 4px; font-weight: 600; cursor: pointer; margin-top: 10px; }
-        .btn-primary { background: #2c3e50; color: white; }
-        .btn-danger { background: #e74c3c; color: white; }
-    </style>
-</head>
-<body>
-    <div class="container">
-        <div class="header">
-            <h1>Traffic Light Config</h1>
-            <p>Team: %TEAM_ID% | Light ID: %LIGHT_ID%</p>
-        </div>
-        <div class="content">
-            <form action="/save" method="POST">
-                <div class="form-group">
-                    <label>WiFi SSID</label>
-                    <input type="text" name="ssid" value="%WIFI_SSID%" required>
-                </div>
-                <div class="form-group">
-                    <label>WiFi Password</label>
-                    <input type="password" name="pass" value="%WIFI_PASS%">
-                </div>
-                <div class="form-group">
-                    <label>Team ID</label>
-                    <input type="text" name="team" value="%TEAM_ID%" required>
-                </div>
-                <div class="form-group">
-                    <label>Traffic Light ID</label>
-                    <input type="text" name="lightid" value="%LIGHT_ID%" required>
-                </div>
-                <hr style="margin: 30px 0; border: none; border-top: 1px solid #ddd;">
-                <h3 style="margin-bottom: 20px;">Firebase Configuration</h3>
-                <div class="form-group">
-                    <label>API Key</label>
-                    <input type="text" name="fb_key" value="%FB_KEY%" required>
-                </div>
-                <div class="form-group">
-                    <label>Database URL</label>
-                    <input type="text" name="fb_url" value="%FB_URL%" required>
-                </div>
-                <div class="form-group">
-                    <label>User Email</label>
-                    <input type="text" name="fb_email" value="%FB_EMAIL%" required>
-                </div>
-                <div class="form-group">
-                    <label>User Password</label>
-                    <input type="password" name="fb_pass" value="%FB_PASS%" required>
-                </div>
-                <button type="submit" class="btn-primary">Save & Restart</button>
-            </form>
-            <form action="/reset" method="POST">
-                <button type="submit" class="btn-danger">Reset to Defaults</button>
-            </form>
-        </div>
-    </div>
-</body>
-</html>
-)rawliteral";
-
-String processTemplate(const char *html)
-{
-  String result = html;
-  result.replace("%WIFI_SSID%", htmlEscape(wifiSSID));
-  result.replace("%WIFI_PASS%", htmlEscape(wifiPass));
-  result.replace("%TEAM_ID%", htmlEscape(teamId));
-  result.replace("%LIGHT_ID%", htmlEscape(trafficLightId));
-  result.replace("%LAT%", "");
-  result.replace("%LNG%", "");
-  result.replace("%FB_KEY%", htmlEscape(API_KEY));
-  result.replace("%FB_URL%", htmlEscape(DATABASE_URL));
-  result.replace("%FB_EMAIL%", htmlEscape(USER_EMAIL));
-  result.replace("%FB_PASS%", htmlEscape(USER_PASSWORD));
-  return result;
+// ================= WEB INTERFACE =================
+// The page lives in portal/config.html and is precompressed into
+// config_page.h by tools/gen_portal.py; only the field values are built here.
+
+String portalValue(int field)
+{
+  switch (field)
+  {
+  case PORTAL_TEAM_ID:
+    return htmlEscape(teamId);
+  case PORTAL_LIGHT_ID:
+    return htmlEscape(trafficLightId);
+  case PORTAL_WIFI_SSID:
+    return htmlEscape(wifiSSID);
+  case PORTAL_WIFI_PASS:
+    return htmlEscape(wifiPass);
+  case PORTAL_WIFI_SSID2:
+    return htmlEscape(wifiSSID2);
+  case PORTAL_WIFI_PASS2:
+    return htmlEscape(wifiPass2);
+  case PORTAL_WIFI_SSID3:
+    return htmlEscape(wifiSSID3);
+  case PORTAL_WIFI_PASS3:
+    return htmlEscape(wifiPass3);
+  case PORTAL_WIFI_ROAM:
+    return String(wifiRoam);
+  case PORTAL_FB_KEY:
+    return htmlEscape(API_KEY);
+  case PORTAL_FB_URL:
+    return htmlEscape(DATABASE_URL);
+  case PORTAL_FB_EMAIL:
+    return htmlEscape(USER_EMAIL);
+  case PORTAL_FB_PASS:
+    return htmlEscape(USER_PASSWORD);
+  case PORTAL_LOCAL_KEY:
+    return htmlEscape(LOCAL_KEY);
+  case PORTAL_PREEMPT_IN:
+    return String(preemptInput);
+  case PORTAL_PEER_GROUP:
+    return String(peerGroup);
+  case PORTAL_PEER_PHASE:
+    return String(peerPhase);
+  case PORTAL_PEER_KEY:
+    return htmlEscape(peerKey);
+  case PORTAL_OTA_URL:
+    return htmlEscape(otaManifestUrl);
+  case PORTAL_POWER_LI:
+    return String(powerListenInterval);
+  case PORTAL_MQTT_HOST:
+    return htmlEscape(mqttHost);
+  case PORTAL_MQTT_USER:
+    return htmlEscape(mqttUser);
+  case PORTAL_MQTT_PASS:
+    return htmlEscape(mqttPass);
+  case PORTAL_TRACE_KB:
+    return String(streamTraceKb);
+  case PORTAL_DET_LANES:
+    return String(detectorLanes);
+  case PORTAL_PED_BUTTON:
+    return String(pedButton);
+  case PORTAL_PLAN_MODE:
+    return String(planMode);
+  case PORTAL_PLAN_TZ:
+    return String(planUtcOffset);
+  default:
+    return "";
+  }
 }
 
+void handlePortalPage()
+{
+  GzipSendStats stats = sendGzipTemplate(server, "text/html; charset=utf-8", configPageSegments,
+                                         sizeof(configPageSegments) / sizeof(configPageSegments[0]),
+                                         portalValue);
+  Serial.printf("Portal page: %lu -> %lu bytes, ttfb %lu us, total %lu us, heap used %lu bytes\n",
+                (unsigned long)stats.rawBytes, (unsigned long)stats.bytesSent,
+                (unsigned long)stats.ttfbUs, (unsigned long)stats.totalUs,
+                (unsigned long)stats.heapUsed);
+}
+#endif // NO_CONFIG_PORTAL
+
 // ================= CONFIGURATION FUNCTIONS =================
 
 void loadFirebaseConfig()
@@ -249,6 +335,7 @@ void loadFirebaseConfig()
   bool loadedFromPreferences = (API_KEY.length() > 0 && DATABASE_URL.length() > 0 &&
                                  USER_EMAIL.length() > 0 && USER_PASSWORD.length() > 0);
 
+#ifndef NO_ENV_FILE
   // Priority 2: Try to load from .env file if not in preferences
   if (!loadedFromPreferences && LittleFS.begin(true))
   {
@@ -296,21 +383,28 @@ void loadFirebaseConfig()
       loadedFromPreferences = (API_KEY.length() > 0 && DATABASE_URL.length() > 0 &&
                                USER_EMAIL.length() > 0 && USER_PASSWORD.length() > 0);
     }
-    LittleFS.end();
+    // The stream trace keeps writing to LittleFS
+    if (!streamTraceEnabled())
+      LittleFS.end();
   }
+#endif // NO_ENV_FILE
 
   // Display config source
   if (loadedFromPreferences)
   {
     Serial.println("Firebase config loaded successfully");
-    Serial.println("API_KEY: " + API_KEY.substring(0, min(10, (int)API_KEY.length())) + "...");
-    Serial.println("DATABASE_URL: " + DATABASE_URL);
-    Serial.println("USER_EMAIL: " + USER_EMAIL);
+    LOG_VERBOSE("API_KEY: %s...\n", API_KEY.substring(0, min(10, (int)API_KEY.length())).c_str());
+    LOG_VERBOSE("DATABASE_URL: %s\n", DATABASE_URL.c_str());
+    LOG_VERBOSE("USER_EMAIL: %s\n", USER_EMAIL.c_str());
   }
   else
   {
     Serial.println("WARNING: No Firebase configuration found");
+#ifndef NO_ENV_FILE
     Serial.println("Please configure in config mode or upload .env file");
+#else
+    Serial.println("Please configure in config mode");
+#endif
   }
 }
 
@@ -319,8 +413,28 @@ void loadConfiguration()
   preferences.begin("traffic-light", false);
   wifiSSID = preferences.getString("ssid", "");
   wifiPass = preferences.getString("pass", "");
+  wifiSSID2 = preferences.getString("ssid2", "");
+  wifiPass2 = preferences.getString("pass2", "");
+  wifiSSID3 = preferences.getString("ssid3", "");
+  wifiPass3 = preferences.getString("pass3", "");
+  wifiRoam = preferences.getUChar("wifi_roam", 1);
   teamId = preferences.getString("team", "10");
   trafficLightId = preferences.getString("lightid", "10");
+  LOCAL_KEY = preferences.getString("local_key", "");
+  preemptInput = preferences.getInt("preempt_in", 0);
+  peerGroup = preferences.getUInt("peer_group", 0);
+  peerPhase = preferences.getUChar("peer_phase", 0);
+  peerKey = preferences.getString("peer_key", "");
+  otaManifestUrl = preferences.getString("ota_url", "");
+  powerListenInterval = preferences.getUChar("power_li", 0);
+  mqttHost = preferences.getString("mqtt_host", "");
+  mqttUser = preferences.getString("mqtt_user", "");
+  mqttPass = preferences.getString("mqtt_pass", "");
+  streamTraceKb = preferences.getUShort("trace_kb", 0);
+  detectorLanes = preferences.getUChar("det_lanes", 0);
+  pedButton = preferences.getUChar("ped_button", 0);
+  planMode = preferences.getUChar("plan_mode", 0);
+  planUtcOffset = preferences.getChar("plan_tz", 0);
   preferences.end();
 }
 
@@ -329,8 +443,28 @@ void saveConfiguration()
   preferences.begin("traffic-light", false);
   preferences.putString("ssid", wifiSSID);
   preferences.putString("pass", wifiPass);
+  preferences.putString("ssid2", wifiSSID2);
+  preferences.putString("pass2", wifiPass2);
+  preferences.putString("ssid3", wifiSSID3);
+  preferences.putString("pass3", wifiPass3);
+  preferences.putUChar("wifi_roam", wifiRoam);
   preferences.putString("team", teamId);
   preferences.putString("lightid", trafficLightId);
+  preferences.putString("local_key", LOCAL_KEY);
+  preferences.putInt("preempt_in", preemptInput);
+  preferences.putUInt("peer_group", peerGroup);
+  preferences.putUChar("peer_phase", peerPhase);
+  preferences.putString("peer_key", peerKey);
+  preferences.putString("ota_url", otaManifestUrl);
+  preferences.putUChar("power_li", powerListenInterval);
+  preferences.putString("mqtt_host", mqttHost);
+  preferences.putString("mqtt_user", mqttUser);
+  preferences.putString("mqtt_pass", mqttPass);
+  preferences.putUShort("trace_kb", streamTraceKb);
+  preferences.putUChar("det_lanes", detectorLanes);
+  preferences.putUChar("ped_button", pedButton);
+  preferences.putUChar("plan_mode", planMode);
+  preferences.putChar("plan_tz", planUtcOffset);
   preferences.end();
 }
 
@@ -339,11 +473,17 @@ void startConfigMode()
   Serial.println("\n=== ENTERING CONFIG MODE ===");
   configMode = true;
 
+  WiFi.disconnect(true);
+  WiFi.mode(WIFI_OFF);
+  display.showNumberDec(0);
+
+  // Serial config works in every image; the lean one has nothing else
+  startSerialConfig();
+
+#ifndef NO_CONFIG_PORTAL
   // Load Firebase config so it shows in the form
   loadFirebaseConfig();
 
-  WiFi.disconnect(true);
-  WiFi.mode(WIFI_OFF);
   delay(1000);
   WiFi.mode(WIFI_AP);
 
@@ -356,17 +496,34 @@ void startConfigMode()
   Serial.println("Password: config123");
   Serial.println("URL: http://" + IP.toString());
 
-  display.showNumberDec(0);
-
-  server.on("/", HTTP_GET, []()
-            { server.send(200, "text/html; charset=utf-8", processTemplate(configPage)); });
+  server.on("/", HTTP_GET, handlePortalPage);
 
   server.on("/save", HTTP_POST, []()
             {
               wifiSSID = sanitizeASCII(server.arg("ssid"));
               wifiPass = server.arg("pass");
+              wifiSSID2 = sanitizeASCII(server.arg("ssid2"));
+              wifiPass2 = server.arg("pass2");
+              wifiSSID3 = sanitizeASCII(server.arg("ssid3"));
+              wifiPass3 = server.arg("pass3");
+              wifiRoam = server.arg("wifi_roam").toInt() ? 1 : 0;
               teamId = server.arg("team");
               trafficLightId = server.arg("lightid");
+              LOCAL_KEY = server.arg("local_key");
+              preemptInput = constrain((int)server.arg("preempt_in").toInt(), 0, 2);
+              peerGroup = constrain((long)server.arg("peer_group").toInt(), 0L, 65535L);
+              peerPhase = server.arg("peer_phase").toInt() ? 1 : 0;
+              peerKey = server.arg("peer_key");
+              otaManifestUrl = server.arg("ota_url");
+              powerListenInterval = constrain(server.arg("power_li").toInt(), 0, POWER_MAX_LISTEN_INTERVAL);
+              mqttHost = server.arg("mqtt_host");
+              mqttUser = server.arg("mqtt_user");
+              mqttPass = server.arg("mqtt_pass");
+              streamTraceKb = constrain(server.arg("trace_kb").toInt(), 0, STREAM_TRACE_MAX_KB);
+              detectorLanes = constrain(server.arg("det_lanes").toInt(), 0, DETECTOR_MAX_LANES);
+              pedButton = server.arg("ped_button").toInt() ? 1 : 0;
+              planMode = constrain(server.arg("plan_mode").toInt(), 0, PLAN_COUNTS);
+              planUtcOffset = constrain(server.arg("plan_tz").toInt(), -12, 14);
 
               // Save Firebase credentials
               API_KEY = server.arg("fb_key");
@@ -395,6 +552,7 @@ void startConfigMode()
               preferences.begin("traffic-light", false);
               preferences.clear();
               preferences.end();
+              tokenCacheClear();
 
               server.send(200, "text/html; charset=utf-8",
                           "<html><body style='text-align:center;padding:50px;background:#dc3545;color:white;'>"
@@ -404,41 +562,152 @@ void startConfigMode()
 
   server.begin();
   Serial.println("HTTP server started");
+#endif
 }
 
 // ================= TRAFFIC LIGHT CONTROL =================
 
 void setLight(int color)
 {
-  // color: 1=red, 2=yellow, 3=green
-  if (color == 3)
+  // color: 1=red, 2=yellow, 3=green, anything else turns every lamp off.
+  // The driver switches the whole head at once, never two lamps together.
+  lampDriver.write(lampsForColor(color));
+  currentColor = lampsForColor(color) ? color : 0;
+  recordLamp(lampsForColor(color), currentColor);
+}
+
+// Show the countdown; while green, the yellow phase is not part of the displayed time
+void showCountdown()
+{
+  if (pedButtonAckShowing())
+    return; // "CALL" stays up; the button job shows the countdown after it
+
+  PROFILE_SCOPE(PROF_DISPLAY);
+  int displayTime = (currentColor == 3) ? max(0, remainingTime - yellowDuration) : remainingTime;
+  display.showNumberDec(displayTime);
+  recordDisplay(DISPLAY_NUMBER, displayTime);
+}
+
+const char *sourceName(UpdateSource source)
+{
+  switch (source)
   {
-    digitalWrite(RED_PIN, LOW);
-    digitalWrite(YELLOW_PIN, LOW);
-    digitalWrite(GREEN_PIN, HIGH);
-    currentColor = 3;
+  case SOURCE_CLOUD:
+    return "cloud";
+  case SOURCE_LOCAL:
+    return "local";
+  case SOURCE_INPUT:
+    return "input";
+  case SOURCE_PEER:
+    return "peer";
+  case SOURCE_PLAN:
+    return "plan";
+  default:
+    return "unknown";
   }
-  else if (color == 2)
+}
+
+// State change log line, profiled separately from the state handling
+static void logChange(const String &line)
+{
+  PROFILE_SCOPE(PROF_SERIAL);
+  Serial.println(line);
+}
+
+// Single state path for every command source (stream, local API, ...)
+static bool applyLightFieldValue(const String &field, int value, UpdateSource source)
+{
+  // While an emergency preemption holds the lamp, plan updates are only recorded
+  if (preemptionDefer(field, value, source))
+    return false;
+
+  // Likewise for the cloud plan while following an intersection leader
+  if (peerSyncDefer(field, value, source))
+    return false;
+
+  // And for cloud and LAN timing while the board runs its own plan
+  if (localPlanDefer(field, source))
+    return false;
+
+  // Validation is shared with the host fleet simulator (TrafficCore/LightState)
+  LightField id = lightFieldFromName(field.c_str(), field.length());
+  LightState next;
+  next.color = currentColor;
+  next.remaining = remainingTime;
+  next.status = currentStatus;
+  next.yellow = yellowDuration;
+  next.density = densityLevel;
+  if (!setLightField(next, id, value))
+    return false;
+
+  String via = (source == SOURCE_CLOUD) ? "" : String(" [") + sourceName(source) + "]";
+
+  switch (id)
   {
-    digitalWrite(RED_PIN, LOW);
-    digitalWrite(YELLOW_PIN, HIGH);
-    digitalWrite(GREEN_PIN, LOW);
-    currentColor = 2;
-  }
-  else if (color == 1)
+  case FIELD_COLOR:
   {
-    digitalWrite(RED_PIN, HIGH);
-    digitalWrite(YELLOW_PIN, LOW);
-    digitalWrite(GREEN_PIN, LOW);
-    currentColor = 1;
+    setLight(value);
+    String colorName = (value == 1) ? "red" : (value == 2) ? "yellow"
+                                                           : "green";
+    logChange("► Light changed: " + colorName + via);
+    // Update display time when color changes (especially when switching to green)
+    showCountdown();
+    return true;
   }
-  else
+
+  case FIELD_REMAINTIME:
+    remainingTime = value;
+    showCountdown();
+    // Only log every 5 seconds or final countdown
+    if (value % 5 == 0 || value <= 5)
+    {
+      logChange("► Time: " + String(remainingTime) + "s" + via);
+    }
+    return true;
+
+  case FIELD_YELLOW:
+    yellowDuration = value;
+    logChange("► Yellow duration: " + String(yellowDuration) + "s" + via);
+    // Update display if currently green
+    if (currentColor == 3)
+      showCountdown();
+    return true;
+
+  case FIELD_STATUS:
   {
-    digitalWrite(RED_PIN, LOW);
-    digitalWrite(YELLOW_PIN, LOW);
-    digitalWrite(GREEN_PIN, LOW);
-    currentColor = 0;
+    currentStatus = value;
+    recordStatus(value);
+    String statusName = (value == 0) ? "active" : (value == 1) ? "broken"
+                                                               : "fixing";
+    logChange("► Status changed: " + statusName + via);
+    return true;
   }
+
+  case FIELD_DENSITY:
+    densityLevel = value;
+    logChange("► Density level: " + String(densityLevel) + via);
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+bool applyLightField(const String &field, int value, UpdateSource source)
+{
+  bool changed = applyLightFieldValue(field, value, source);
+  if (changed)
+    stateChangedMs = wallClockMs();
+
+  // A leading board passes every change on to its peers straight away
+  if (changed && source != SOURCE_PEER)
+    peerSyncStateChanged();
+
+  // Acknowledge a new color or status; the countdown goes along with it
+  if (changed && (field == "color" || field == "status"))
+    outboundReportApplied();
+
+  return changed;
 }
 
 // ================= FIREBASE FUNCTIONS =================
@@ -448,31 +717,381 @@ String getMyLightPath()
   return "/teams/" + teamId + "/traffic_lights/" + trafficLightId;
 }
 
+// The board streams the backend's device view of its light, which carries
+// only the render fields. Build with -D STREAM_FULL_LIGHT_NODE to stream the
+// whole light node instead (for comparing stream traffic).
+String getStreamPath()
+{
+#ifdef STREAM_FULL_LIGHT_NODE
+  return getMyLightPath();
+#else
+  return "/teams/" + teamId + "/device_view/" + trafficLightId;
+#endif
+}
+
 void updateMyStatus()
 {
   if (!firebaseReady || !app.ready())
     return;
 
-  String path = getMyLightPath();
+  PROFILE_SCOPE(PROF_HEARTBEAT);
+
+  // Heartbeat to show the board is online (runs every 10 seconds), merged
+  // with what the lamp shows into one update by the outbound queue
+  outboundPutBool("online", true);
+  outboundReportApplied();
 
-  static unsigned long lastUpdate = 0;
+  LOG_VERBOSE("Heartbeat queued\n");
+}
+
+const char OUTBOUND_UID_PREFIX[] = "outbound-";
 
-  // Only send heartbeat every 10 seconds to show board is online
-  // Don't send color/time as those come from web control via stream
-  if (millis() - lastUpdate < 10000)
+// Answer to an outbound queue update; the task uid carries the batch id
+static void processOutbound(AsyncResult &result)
+{
+  if (!result.isResult())
     return;
 
-  // Send online status only
-  Database.set<bool>(aClient, path + "/online", true, aResult);
+  String uid = result.uid();
+  if (!uid.startsWith(OUTBOUND_UID_PREFIX))
+    return;
+  uint32_t batch = strtoul(uid.c_str() + sizeof(OUTBOUND_UID_PREFIX) - 1, nullptr, 10);
 
-  Serial.println("Heartbeat sent");
+  if (result.isError())
+  {
+    Serial.printf("Outbound write %lu failed: %s, code: %d\n", (unsigned long)batch,
+                  result.error().message().c_str(), result.error().code());
+    outboundDone(batch, false);
+  }
+  else if (result.available())
+    outboundDone(batch, true);
+}
 
-  lastUpdate = millis();
+// Per-cycle vehicle detector batches, kept apart from the light node so they
+// never reach the device view or a full-node stream
+String getDetectorPath()
+{
+  return "/teams/" + teamId + "/detector_counts/" + trafficLightId;
+}
+
+String getLatencyPath()
+{
+  return "/teams/" + teamId + "/delivery_latency/" + trafficLightId;
 }
 
 // No longer needed - using stream only
 // void fetchLightState() - removed
 
+// Extract an integer field from a flat JSON object such as the initial full-object put
+bool readJsonInt(const String &data, const char *key, int &value)
+{
+  return readJsonInt(data.c_str(), data.length(), key, value);
+}
+
+// Stream events and payload bytes, total and for the current hour
+void countStreamEvent(uint32_t payloadBytes)
+{
+  streamTotal.events++;
+  streamTotal.bytes += payloadBytes;
+  streamThisHour.events++;
+  streamThisHour.bytes += payloadBytes;
+}
+
+// Apply decoded stream fields in order; a preemption bypasses the regular
+// field handling
+static bool applyUpdates(const FieldUpdate *updates, size_t count, UpdateSource source, unsigned long startUs)
+{
+  bool changed = false;
+  for (size_t i = 0; i < count; i++)
+  {
+    if (updates[i].field == FIELD_PREEMPT)
+      triggerPreemption(updates[i].value, source, startUs);
+    else
+      changed |= applyLightField(lightFieldName(updates[i].field), updates[i].value, source);
+  }
+  return changed;
+}
+
+// Full or partial state object ({"color":3,"remaintime":30,...}).
+// A preemption in it is handled first, then the fields in a fixed order.
+bool applyStateJson(const String &data, UpdateSource source, unsigned long startUs)
+{
+  FieldUpdate updates[MAX_FIELD_UPDATES];
+  size_t count = decodeStreamUpdate("/", 1, data.c_str(), data.length(), updates);
+  if (source == SOURCE_CLOUD)
+    count = checkUpdateOrder(data.c_str(), data.length(), false, updates, count);
+  return applyUpdates(updates, count, source, startUs);
+}
+
+void processStream(AsyncResult &aResult);
+
+// ================= STREAM AUTH ROTATION =================
+// The SSE stream carries the ID token in its URL. When that token expires,
+// the server revokes the stream with auth_revoked and the library reconnects,
+// which leaves the board without updates for a few seconds. UserAuth asks for
+// a new token after AUTH_TOKEN_LIFETIME_S, well before Google's 3600 s expiry.
+// As soon as the new token shows up, a second stream is opened with it. The
+// old stream is only closed once the new one has delivered its initial put,
+// so rotating never leaves a gap. An auth_revoked or cancel on the live
+// stream still starts a gap, which is timed until the next put.
+
+const size_t AUTH_TOKEN_LIFETIME_S = 3000;
+const unsigned long STREAM_ROTATE_TIMEOUT_MS = 30000; // new stream must deliver within this
+const unsigned long STREAM_ROTATE_RETRY_MS = 60000;   // wait after a failed rotation
+
+struct StreamSlot
+{
+  AsyncClient *client;
+  const char *uid;
+  uint32_t tokenHash; // token the stream was opened with
+  unsigned long openedMs;
+  bool live; // initial put received
+};
+
+static StreamSlot streamSlots[2] = {{&streamClient, "streamA", 0, 0, false},
+                                    {&streamClientB, "streamB", 0, 0, false}};
+static int activeSlot = 0;
+static int pendingSlot = -1;
+static unsigned long rotateFailedMs = 0;
+static unsigned long gapStartMs = 0; // 0 = no auth gap in progress
+
+struct AuthStats
+{
+  uint32_t rotations = 0;
+  uint32_t rotationFailures = 0;
+  uint32_t lastOverlapMs = 0;
+  uint32_t revokes = 0;  // auth_revoked on the live stream
+  uint32_t cancels = 0;  // cancel on the live stream
+  uint32_t gaps = 0;     // completed update gaps after a revoke or cancel
+  uint32_t lastGapMs = 0;
+  uint32_t maxGapMs = 0;
+  uint64_t totalGapMs = 0;
+} authStats;
+
+// Boot path: how the app authenticated, how long that took and when the
+// first state from the stream reached the lamp (ms after boot)
+static const char *authMode = "none";
+static unsigned long authReadyMs = 0;
+static unsigned long firstStateMs = 0;
+
+// FNV-1a, to notice a token change without keeping a copy of the token
+static uint32_t tokenHash(const String &token)
+{
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < token.length(); i++)
+    hash = (hash ^ (uint8_t)token[i]) * 16777619u;
+  return hash;
+}
+
+static int slotForUid(const String &uid)
+{
+  for (int i = 0; i < 2; i++)
+  {
+    if (uid == streamSlots[i].uid)
+      return i;
+  }
+  return -1;
+}
+
+static void openStreamSlot(int slot)
+{
+  StreamSlot &s = streamSlots[slot];
+  s.tokenHash = tokenHash(app.getToken());
+  s.openedMs = millis();
+  s.live = false;
+
+  // Set SSE filters to match official example
+  s.client->setSSEFilters("get,put,patch,keep-alive,cancel,auth_revoked");
+  Database.get(*s.client, getStreamPath(), processStream, true /* SSE mode (HTTP Streaming) */, s.uid);
+}
+
+static void endAuthGap()
+{
+  if (gapStartMs == 0)
+    return;
+
+  uint32_t gapMs = millis() - gapStartMs;
+  gapStartMs = 0;
+  authStats.gaps++;
+  authStats.lastGapMs = gapMs;
+  authStats.totalGapMs += gapMs;
+  if (gapMs > authStats.maxGapMs)
+    authStats.maxGapMs = gapMs;
+  Serial.printf("Stream auth: updates resumed after %lu ms\n", (unsigned long)gapMs);
+}
+
+// Book-keeping for one stream event; false if the event carries no state
+// for the board (auth events, or data from a stream being closed)
+static bool streamEventUsable(const String &uid, const String &event)
+{
+  int slot = slotForUid(uid);
+  if (slot < 0 || (slot != activeSlot && slot != pendingSlot))
+    return false;
+
+  if (event == "auth_revoked" || event == "cancel")
+  {
+    if (slot == pendingSlot)
+      return false; // the rotation check gives up on it after the timeout
+
+    if (event == "auth_revoked")
+      authStats.revokes++;
+    else
+      authStats.cancels++;
+    if (gapStartMs == 0)
+      gapStartMs = millis();
+    Serial.println("Stream auth: " + event + " on the live stream");
+    return false;
+  }
+
+  if (event != "put")
+    return event == "patch";
+
+  StreamSlot &s = streamSlots[slot];
+  s.live = true;
+
+  if (slot == pendingSlot)
+  {
+    // The new stream is up: hand over and close the old one
+    streamSlots[activeSlot].client->stopAsync(true);
+    streamSlots[activeSlot].live = false;
+    authStats.rotations++;
+    authStats.lastOverlapMs = millis() - s.openedMs;
+    Serial.printf("Stream auth: rotated to %s after %lu ms overlap\n", s.uid,
+                  (unsigned long)authStats.lastOverlapMs);
+    activeSlot = slot;
+    pendingSlot = -1;
+  }
+  else
+  {
+    // The library reconnected the live stream, by then with the current token
+    s.tokenHash = tokenHash(app.getToken());
+  }
+
+  endAuthGap();
+  return true;
+}
+
+// Scheduler job: open a stream with the new token once it is there, or give
+// up on a new stream that never delivered
+static void rotateStreamAuth()
+{
+  if (!firebaseReady || !app.ready())
+    return;
+
+  if (pendingSlot >= 0)
+  {
+    if (millis() - streamSlots[pendingSlot].openedMs < STREAM_ROTATE_TIMEOUT_MS)
+      return;
+    streamSlots[pendingSlot].client->stopAsync(true);
+    authStats.rotationFailures++;
+    rotateFailedMs = millis();
+    Serial.printf("Stream auth: %s delivered nothing, keeping %s\n", streamSlots[pendingSlot].uid,
+                  streamSlots[activeSlot].uid);
+    pendingSlot = -1;
+    return;
+  }
+
+  if (rotateFailedMs != 0 && millis() - rotateFailedMs < STREAM_ROTATE_RETRY_MS)
+    return;
+
+  // Nothing to hand over while the live stream is down, the library reconnects it
+  if (gapStartMs != 0 || tokenHash(app.getToken()) == streamSlots[activeSlot].tokenHash)
+    return;
+
+  pendingSlot = 1 - activeSlot;
+  LOG_VERBOSE("Stream auth: new token, opening %s before closing %s\n", streamSlots[pendingSlot].uid,
+              streamSlots[activeSlot].uid);
+  openStreamSlot(pendingSlot);
+}
+
+// ================= STREAM WATCHDOG =================
+// The library notices a closed connection, but not one that went silent:
+// after an AP drop or a reset TLS session the socket can stay half-open and
+// the lamp would keep showing a plan that no longer runs. Every event on the
+// stream (keep-alives included) proves the link; a stream error or 40 s of
+// silence puts the board into the offline blink and the stream is reopened
+// (lib/TrafficCore/StreamWatchdog.h). tools/impair_bench.cpp measures how
+// long detection and recovery take under loss, delay and disconnects.
+
+static StreamWatchdog streamWatchdog;
+
+static void noteStreamEvent(const String &uid)
+{
+  int slot = slotForUid(uid);
+  if (slot < 0 || (slot != activeSlot && slot != pendingSlot))
+    return;
+
+  if (streamWatchdog.event(millis()))
+  {
+    Serial.printf("Stream: updates back after %lu ms\n", (unsigned long)streamWatchdog.lastOutageMs);
+    // Restore normal state
+    setLight(currentColor);
+    showCountdown();
+  }
+}
+
+static void noteStreamError(const String &uid)
+{
+  if (slotForUid(uid) == activeSlot && streamWatchdog.failed(millis()))
+    Serial.println("Stream: connection lost, entering offline mode...");
+}
+
+// Scheduler job: reopen a stream that went silent, and keep retrying while
+// it stays down
+static void checkStreamLink()
+{
+  if (!firebaseReady || !isOnline)
+    return;
+
+  bool wasUp = streamWatchdog.up();
+  unsigned long now = millis();
+  if (!streamWatchdog.check(now))
+    return;
+
+  if (wasUp)
+    Serial.printf("Stream: nothing for %lu ms, entering offline mode...\n",
+                  (unsigned long)streamWatchdog.silentMs(now));
+  else
+    LOG_VERBOSE("Stream: still down after %lu ms, reopening\n", (unsigned long)streamWatchdog.downMs(now));
+
+  // A pending rotation is dropped too, the reopened stream uses the current token
+  if (pendingSlot >= 0)
+  {
+    streamSlots[pendingSlot].client->stopAsync(true);
+    pendingSlot = -1;
+  }
+  streamSlots[activeSlot].client->stopAsync(true);
+  openStreamSlot(activeSlot);
+  streamWatchdog.opened(now);
+}
+
+static String authStatsJson()
+{
+  uint32_t avgGapMs = authStats.gaps ? (uint32_t)(authStats.totalGapMs / authStats.gaps) : 0;
+  return "{\"auth\":\"" + String(authMode) +
+         "\",\"auth_ms\":" + String(authReadyMs) +
+         ",\"first_state_ms\":" + String(firstStateMs) +
+         ",\"stream\":\"" + String(streamSlots[activeSlot].uid) +
+         "\",\"token_ttl_s\":" + String(firebaseReady ? app.ttl() : 0) +
+         ",\"rotations\":" + String(authStats.rotations) +
+         ",\"rotation_failures\":" + String(authStats.rotationFailures) +
+         ",\"last_overlap_ms\":" + String(authStats.lastOverlapMs) +
+         ",\"auth_revoked\":" + String(authStats.revokes) +
+         ",\"cancel\":" + String(authStats.cancels) +
+         ",\"gaps\":" + String(authStats.gaps) +
+         ",\"gap_in_progress\":" + String(gapStartMs ? "true" : "false") +
+         ",\"last_gap_ms\":" + String(authStats.lastGapMs) +
+         ",\"avg_gap_ms\":" + String(avgGapMs) +
+         ",\"max_gap_ms\":" + String(authStats.maxGapMs) +
+         ",\"link_up\":" + String(streamWatchdog.up() ? "true" : "false") +
+         ",\"silent_ms\":" + String(streamWatchdog.silentMs(millis())) +
+         ",\"outages\":" + String(streamWatchdog.outages) +
+         ",\"silences\":" + String(streamWatchdog.silences) +
+         ",\"reopens\":" + String(streamWatchdog.reopens) +
+         ",\"last_outage_ms\":" + String(streamWatchdog.lastOutageMs) +
+         ",\"max_outage_ms\":" + String(streamWatchdog.maxOutageMs) + "}";
+}
+
 // Stream callback - fully real-time, no delays
 void processStream(AsyncResult &aResult)
 {
@@ -480,9 +1099,13 @@ void processStream(AsyncResult &aResult)
   if (!aResult.isResult())
     return;
 
+  PROFILE_SCOPE(PROF_STREAM);
+  unsigned long startUs = micros();
+
   if (aResult.isError())
   {
     Serial.printf("Stream error: %s, code: %d\n", aResult.error().message().c_str(), aResult.error().code());
+    noteStreamError(aResult.uid());
   }
 
   if (aResult.available())
@@ -495,215 +1118,79 @@ void processStream(AsyncResult &aResult)
       String event = stream.event();
       String data = stream.to<String>();
 
-      // Handle specific field updates
-      if (path.endsWith("/color"))
-      {
-        int newColor = data.toInt();
-        if ((newColor >= 1 && newColor <= 3) && newColor != currentColor)
-        {
-          setLight(newColor);
-          String colorName = (newColor == 1) ? "red" : (newColor == 2) ? "yellow"
-                                                                       : "green";
-          Serial.println("► Light changed: " + colorName);
-          // Update display time when color changes (especially when switching to green)
-          int displayTime = (newColor == 3) ? max(0, remainingTime - yellowDuration) : remainingTime;
-          display.showNumberDec(displayTime);
-        }
-      }
-      else if (path.endsWith("/remaintime"))
-      {
-        int newTime = data.toInt();
-        if (newTime >= 0 && newTime <= 9999 && newTime != remainingTime)
-        {
-          remainingTime = newTime;
-          // If color is green, subtract yellow_duration from remaintime for display
-          int displayTime = (currentColor == 3) ? max(0, remainingTime - yellowDuration) : remainingTime;
-          display.showNumberDec(displayTime);
-          // Only log every 5 seconds or final countdown
-          if (newTime % 5 == 0 || newTime <= 5)
-          {
-            Serial.println("► Time: " + String(remainingTime) + "s (display: " + String(displayTime) + "s)");
-          }
-        }
-      }
-      else if (path.endsWith("/yellow_duration"))
+      countStreamEvent(event.length() + path.length() + data.length());
+      recordStreamEvent(streamEventKind(event), data.length());
+      traceStreamEvent(event, path, data);
+      noteStreamEvent(aResult.uid());
+
+      // Auth events, rotation hand-over and leftovers from a closed stream
+      if (!streamEventUsable(aResult.uid(), event))
+        return;
+
+      // Initial full object (path is empty or "/") or a single field
+      // ("/color", "/remaintime", ...), decoded by TrafficCore/LightState
+      FieldUpdate updates[MAX_FIELD_UPDATES];
+      size_t count = decodeStreamUpdate(path.c_str(), path.length(), data.c_str(), data.length(), updates);
+      // Drop what a newer update already set, and a stale countdown
+      bool snapshot = event == "put" && (path.length() == 0 || path == "/");
+      count = checkUpdateOrder(data.c_str(), data.length(), snapshot, updates, count);
+      bool changed = applyUpdates(updates, count, SOURCE_CLOUD, startUs);
+
+      if (changed)
       {
-        int newYellowDuration = data.toInt();
-        if (newYellowDuration >= 0 && newYellowDuration != yellowDuration)
+        commandLatency[SOURCE_CLOUD].add(micros() - startUs);
+        if (firstStateMs == 0)
         {
-          yellowDuration = newYellowDuration;
-          Serial.println("► Yellow duration: " + String(yellowDuration) + "s");
-          // Update display if currently green
-          if (currentColor == 3)
-          {
-            int displayTime = max(0, remainingTime - yellowDuration);
-            display.showNumberDec(displayTime);
-          }
-        }
-      }
-      else if (path.endsWith("/status"))
-      {
-        int newStatus = data.toInt();
-        if (newStatus >= 0 && newStatus <= 2 && newStatus != currentStatus)
-        {
-          currentStatus = newStatus;
-          String statusName = (newStatus == 0) ? "active" : (newStatus == 1) ? "broken"
-                                                                             : "fixing";
-          Serial.println("► Status changed: " + statusName);
-        }
-      }
-      // Handle initial full object (path is empty or "/")
-      else if (path.length() == 0 || path == "/")
-      {
-        // Parse JSON manually for color (now integer)
-        int colorIdx = data.indexOf("\"color\"");
-        if (colorIdx >= 0)
-        {
-          int colonIdx = data.indexOf(":", colorIdx);
-          int commaIdx = data.indexOf(",", colonIdx);
-          int braceIdx = data.indexOf("}", colonIdx);
-          int endIdx = (commaIdx > 0 && commaIdx < braceIdx) ? commaIdx : braceIdx;
-
-          if (colonIdx >= 0 && endIdx > colonIdx)
-          {
-            String colorStr = data.substring(colonIdx + 1, endIdx);
-            colorStr.trim();
-            int newColor = colorStr.toInt();
-            if ((newColor >= 1 && newColor <= 3) && newColor != currentColor)
-            {
-              setLight(newColor);
-              String colorName = (newColor == 1) ? "red" : (newColor == 2) ? "yellow"
-                                                                           : "green";
-              Serial.println("► Light: " + colorName);
-            }
-          }
-        }
-
-        // Parse JSON manually for remaintime
-        int timeIdx = data.indexOf("\"remaintime\"");
-        if (timeIdx >= 0)
-        {
-          int colonIdx = data.indexOf(":", timeIdx);
-          int commaIdx = data.indexOf(",", colonIdx);
-          int braceIdx = data.indexOf("}", colonIdx);
-          int endIdx = (commaIdx > 0 && commaIdx < braceIdx) ? commaIdx : braceIdx;
-
-          if (colonIdx >= 0 && endIdx > colonIdx)
-          {
-            String timeStr = data.substring(colonIdx + 1, endIdx);
-            timeStr.trim();
-            int newTime = timeStr.toInt();
-            if (newTime >= 0 && newTime <= 9999 && newTime != remainingTime)
-            {
-              remainingTime = newTime;
-              int displayTime = (currentColor == 3) ? max(0, remainingTime - yellowDuration) : remainingTime;
-              display.showNumberDec(displayTime);
-              Serial.println("► Time: " + String(remainingTime) + "s (display: " + String(displayTime) + "s)");
-            }
-          }
-        }
-
-        // Parse JSON manually for yellow_duration
-        int yellowIdx = data.indexOf("\"yellow_duration\"");
-        if (yellowIdx >= 0)
-        {
-          int colonIdx = data.indexOf(":", yellowIdx);
-          int commaIdx = data.indexOf(",", colonIdx);
-          int braceIdx = data.indexOf("}", colonIdx);
-          int endIdx = (commaIdx > 0 && commaIdx < braceIdx) ? commaIdx : braceIdx;
-
-          if (colonIdx >= 0 && endIdx > colonIdx)
-          {
-            String yellowStr = data.substring(colonIdx + 1, endIdx);
-            yellowStr.trim();
-            int newYellowDuration = yellowStr.toInt();
-            if (newYellowDuration >= 0 && newYellowDuration != yellowDuration)
-            {
-              yellowDuration = newYellowDuration;
-              Serial.println("► Yellow duration: " + String(yellowDuration) + "s");
-            }
-          }
-        }
-
-        // Parse JSON manually for status
-        int statusIdx = data.indexOf("\"status\"");
-        if (statusIdx >= 0)
-        {
-          int colonIdx = data.indexOf(":", statusIdx);
-          int commaIdx = data.indexOf(",", colonIdx);
-          int braceIdx = data.indexOf("}", colonIdx);
-          int endIdx = (commaIdx > 0 && commaIdx < braceIdx) ? commaIdx : braceIdx;
-
-          if (colonIdx >= 0 && endIdx > colonIdx)
-          {
-            String statusStr = data.substring(colonIdx + 1, endIdx);
-            statusStr.trim();
-            int newStatus = statusStr.toInt();
-            if (newStatus >= 0 && newStatus <= 2 && newStatus != currentStatus)
-            {
-              currentStatus = newStatus;
-              String statusName = (newStatus == 0) ? "active" : (newStatus == 1) ? "broken"
-                                                                                 : "fixing";
-              Serial.println("► Status: " + statusName);
-            }
-          }
+          firstStateMs = millis();
+          Serial.printf("First stream state applied %lu ms after boot\n", firstStateMs);
         }
       }
     }
   }
 }
 
-// ================= SETUP =================
-
-void setup()
-{
-  Serial.begin(115200);
-  Serial.println("\n\n=== Traffic Light System ===");
-
-  display.setBrightness(7);
-  display.showNumberDec(8888);
-  delay(1000);
-
-  pinMode(RED_PIN, OUTPUT);
-  pinMode(YELLOW_PIN, OUTPUT);
-  pinMode(GREEN_PIN, OUTPUT);
-  pinMode(CONFIG_BUTTON, INPUT_PULLUP);
+// ================= FIREBASE TRANSPORT =================
 
-  setLight(0); // Turn off all lights
+const unsigned long AUTH_WAIT_MS = 15000;       // email/password sign-in
+const unsigned long TOKEN_REUSE_WAIT_MS = 5000; // cached token, before falling back to sign-in
 
-  loadConfiguration();
+static uint32_t cachedTokenHash = 0;
 
-  if (digitalRead(CONFIG_BUTTON) == LOW || wifiSSID.length() == 0)
+// Short polls, so a cached token is in use as soon as the library has it
+static void waitForAuth(unsigned long timeoutMs)
+{
+  unsigned long startMs = millis();
+  unsigned long lastDotMs = startMs;
+  while (!app.ready() && millis() - startMs < timeoutMs)
   {
-    startConfigMode();
-    return;
+    app.loop();
+    delay(10);
+    if (millis() - lastDotMs >= 500)
+    {
+      lastDotMs = millis();
+      Serial.print(".");
+    }
   }
+}
 
-  Serial.println("Team: " + teamId);
-  Serial.println("Traffic Light ID: " + trafficLightId);
-  Serial.println("Connecting to: " + sanitizeASCII(wifiSSID));
-
-  String cleanSSID = sanitizeASCII(wifiSSID);
-  WiFi.begin(cleanSSID.c_str(), wifiPass.c_str());
-
-  int attempts = 0;
-  while (WiFi.status() != WL_CONNECTED && attempts < 20)
-  {
-    Serial.print(".");
-    delay(500);
-    attempts++;
-  }
+// Scheduler job: store every new token so the next boot can reuse it
+static void cacheAuthToken()
+{
+  if (!firebaseReady || !app.ready())
+    return;
 
-  if (WiFi.status() != WL_CONNECTED)
-  {
-    Serial.println("\nWiFi failed - entering config mode");
-    delay(2000);
-    startConfigMode();
+  String token = app.getToken();
+  uint32_t hash = tokenHash(token);
+  if (hash == cachedTokenHash)
     return;
-  }
 
-  Serial.println("\nWiFi connected: " + WiFi.localIP().toString());
+  // Stored with the library's own lifetime, which is shorter than Google's
+  if (tokenCacheStore(API_KEY, USER_EMAIL, token, app.getRefreshToken(), app.ttl()))
+    cachedTokenHash = hash;
+}
 
+static bool startFirebase()
+{
   // Load Firebase configuration from .env file (with fallback to defaults)
   loadFirebaseConfig();
 
@@ -712,44 +1199,60 @@ void setup()
   ssl_client.setInsecure();
 
   Serial.println("Initializing Firebase...");
+  unsigned long authStartMs = millis();
 
-  // Initialize UserAuth with loaded credentials
-  user_auth = new UserAuth(API_KEY.c_str(), USER_EMAIL.c_str(), USER_PASSWORD.c_str(), 3000);
+  // A token from before the reset skips the email/password sign-in
+  String cachedIdToken, cachedRefreshToken;
+  uint32_t cachedTtlS = 0;
+  if (tokenCacheLoad(API_KEY, USER_EMAIL, cachedIdToken, cachedRefreshToken, cachedTtlS))
+  {
+    Serial.printf("Using cached token (%lu s left)\n", (unsigned long)cachedTtlS);
+    id_token = new IDToken(API_KEY.c_str(), cachedIdToken.c_str(), cachedTtlS, cachedRefreshToken.c_str());
+    initializeApp(aClient, app, getAuth(*id_token));
+    authMode = "cached";
+    waitForAuth(TOKEN_REUSE_WAIT_MS);
 
-  initializeApp(aClient, app, getAuth(*user_auth));
-  app.getApp<RealtimeDatabase>(Database);
-  Database.url(DATABASE_URL.c_str());
+    if (!app.ready())
+    {
+      Serial.println("\nCached token not accepted, signing in");
+      tokenCacheClear();
+    }
+  }
 
-  attempts = 0;
-  while (!app.ready() && attempts < 30)
+  if (!app.ready())
   {
-    app.loop();
-    delay(500);
-    attempts++;
-    Serial.print(".");
+    // Initialize UserAuth with loaded credentials
+    user_auth = new UserAuth(API_KEY.c_str(), USER_EMAIL.c_str(), USER_PASSWORD.c_str(), AUTH_TOKEN_LIFETIME_S);
+    initializeApp(aClient, app, getAuth(*user_auth));
+    authMode = "sign_in";
+    waitForAuth(AUTH_WAIT_MS);
   }
 
+  app.getApp<RealtimeDatabase>(Database);
+  Database.url(DATABASE_URL.c_str());
+  authReadyMs = millis() - authStartMs;
+  Serial.printf("\nAuth (%s) took %lu ms\n", authMode, (unsigned long)authReadyMs);
+
   if (app.ready())
   {
     Serial.println("\nFirebase connected");
     firebaseReady = true;
 
     stream_ssl_client.setInsecure();
-
-    // Set SSE filters to match official example
-    streamClient.setSSEFilters("get,put,patch,keep-alive,cancel,auth_revoked");
+    stream_ssl_client_b.setInsecure();
 
     // Start streaming - this is the PRIMARY way we get updates
-    Database.get(streamClient, getMyLightPath(), processStream, true /* SSE mode (HTTP Streaming) */, "streamTask");
+    openStreamSlot(activeSlot);
+    streamWatchdog.opened(millis());
 
-    Serial.println("Real-time streaming started for: " + getMyLightPath());
+    Serial.println("Real-time streaming started for: " + getStreamPath());
 
     // Wait a moment for stream to initialize
     delay(2000);
 
     // Fetch initial values once
     Serial.println("Fetching initial state...");
-    String myPath = getMyLightPath();
+    String myPath = getStreamPath();
 
     int initialColor = Database.get<int>(aClient, myPath + "/color");
     if (aClient.lastError().code() == 0)
@@ -757,9 +1260,8 @@ void setup()
       if (initialColor >= 1 && initialColor <= 3)
       {
         setLight(initialColor);
-        String colorName = (initialColor == 1) ? "red" : (initialColor == 2) ? "yellow"
-                                                                             : "green";
-        Serial.println("Initial color: " + colorName);
+        LOG_VERBOSE("Initial color: %s\n",
+                    (initialColor == 1) ? "red" : (initialColor == 2) ? "yellow" : "green");
       }
     }
 
@@ -767,7 +1269,7 @@ void setup()
     if (aClient.lastError().code() == 0)
     {
       yellowDuration = initialYellowDuration;
-      Serial.println("Initial yellow duration: " + String(yellowDuration) + "s");
+      LOG_VERBOSE("Initial yellow duration: %ds\n", yellowDuration);
     }
 
     int initialTime = Database.get<int>(aClient, myPath + "/remaintime");
@@ -776,16 +1278,17 @@ void setup()
       remainingTime = initialTime;
       int displayTime = (currentColor == 3) ? max(0, remainingTime - yellowDuration) : remainingTime;
       display.showNumberDec(displayTime);
-      Serial.println("Initial time: " + String(remainingTime) + "s (display: " + String(displayTime) + "s)");
+      recordDisplay(DISPLAY_NUMBER, displayTime);
+      LOG_VERBOSE("Initial time: %ds (display: %ds)\n", remainingTime, displayTime);
     }
 
     int initialStatus = Database.get<int>(aClient, myPath + "/status");
     if (aClient.lastError().code() == 0)
     {
       currentStatus = initialStatus;
-      String statusName = (initialStatus == 0) ? "active" : (initialStatus == 1) ? "broken"
-                                                                                 : "fixing";
-      Serial.println("Initial status: " + statusName);
+      recordStatus(initialStatus);
+      LOG_VERBOSE("Initial status: %s\n",
+                  (initialStatus == 0) ? "active" : (initialStatus == 1) ? "broken" : "fixing");
     }
 
     Serial.println("Ready! Listening for updates...");
@@ -798,124 +1301,156 @@ void setup()
     Serial.println("\nFirebase init failed");
   }
 
-  Serial.println("\n=== System Ready - Light ID " + trafficLightId + " ===\n");
+  return firebaseReady;
 }
 
-// ================= MAIN LOOP =================
-
-void loop()
+class FirebaseTransport : public Transport
 {
-  if (configMode)
-  {
-    server.handleClient();
-    delay(10);
-    return;
-  }
+public:
+  const char *name() const override { return "firebase"; }
+  String endpoint() const override { return getStreamPath(); }
 
-  // Check WiFi connection status
-  static unsigned long lastWiFiCheck = 0;
-  if (millis() - lastWiFiCheck > 5000) // Check every 5 seconds
-  {
-    bool wasOnline = isOnline;
-    isOnline = (WiFi.status() == WL_CONNECTED);
+  bool begin() override { return startFirebase(); }
 
-    if (wasOnline && !isOnline)
+  void loop() override
+  {
     {
-      Serial.println("WiFi disconnected! Entering offline mode...");
+      PROFILE_SCOPE(PROF_APP);
+      app.loop();
     }
-    else if (!wasOnline && isOnline)
     {
-      Serial.println("WiFi reconnected! Restoring normal operation...");
-      // Restore normal state
-      setLight(currentColor);
-      int displayTime = (currentColor == 3) ? max(0, remainingTime - yellowDuration) : remainingTime;
-      display.showNumberDec(displayTime);
+      PROFILE_SCOPE(PROF_DATABASE);
+      Database.loop();
     }
-
-    lastWiFiCheck = millis();
   }
 
-  // CRITICAL: Process authentication and streaming in real-time (only when online)
-  if (isOnline)
+  bool ready() const override { return firebaseReady && app.ready(); }
+  bool linkUp() const override { return streamWatchdog.up(); }
+  void sendHeartbeat() override { updateMyStatus(); }
+
+  bool sendLightUpdate(const String &json, uint32_t batch) override
   {
-    app.loop();
-    Database.loop();
+    if (!ready())
+      return false;
+    Database.update(aClient, getMyLightPath(), object_t(json), processOutbound,
+                    OUTBOUND_UID_PREFIX + String(batch));
+    return true;
   }
 
-  // Handle offline status with blinking behavior (HIGHEST PRIORITY)
-  static unsigned long lastBlinkTime = 0;
-  static bool blinkState = false;
+  bool sendDetectorBatches(const String &json) override
+  {
+    if (!ready())
+      return false;
+    Database.update(aClient, getDetectorPath(), object_t(json), aResult);
+    return true;
+  }
 
-  if (!isOnline) // Offline - blink all lights
+  bool sendLatencyReport(const String &json) override
   {
-    // Blink every 300ms (faster to indicate urgency)
-    if (millis() - lastBlinkTime > 300)
-    {
-      blinkState = !blinkState;
+    if (!ready())
+      return false;
+    Database.set<object_t>(aClient, getLatencyPath(), object_t(json), aResult);
+    return true;
+  }
 
-      if (blinkState)
-      {
-        // Turn on all lights and show "----"
-        digitalWrite(RED_PIN, HIGH);
-        digitalWrite(YELLOW_PIN, HIGH);
-        digitalWrite(GREEN_PIN, HIGH);
-        display.setSegments(new uint8_t[4]{0x40, 0x40, 0x40, 0x40}); // Show ----
-      }
-      else
-      {
-        // Turn off all lights and clear display
-        digitalWrite(RED_PIN, LOW);
-        digitalWrite(YELLOW_PIN, LOW);
-        digitalWrite(GREEN_PIN, LOW);
-        display.clear();
-      }
+  String reportJson() const override { return authStatsJson(); }
+};
 
-      lastBlinkTime = millis();
-    }
+Transport *transport = nullptr;
+
+// ================= SCHEDULED JOBS =================
+// Timed work for the main loop, run by the scheduler instead of polled
+// static timers (see lib/TrafficCore/Scheduler.h)
+
+Scheduler scheduler;
+static int blinkJob = NO_JOB;
+
+static uint64_t schedulerClockUs()
+{
+  return (uint64_t)esp_timer_get_time();
+}
+static bool blinkState = false;
+
+// Check WiFi connection status
+static void checkWiFi()
+{
+  bool wasOnline = isOnline;
+  isOnline = (WiFi.status() == WL_CONNECTED);
+
+  if (wasOnline && !isOnline)
+  {
+    Serial.println("WiFi disconnected! Entering offline mode...");
   }
-  else if (currentStatus == 1 || currentStatus == 2) // broken or fixing
+  else if (!wasOnline && isOnline)
   {
-    // Blink every 500ms
-    if (millis() - lastBlinkTime > 500)
-    {
-      blinkState = !blinkState;
+    Serial.println("WiFi reconnected! Restoring normal operation...");
+    // Restore normal state
+    setLight(currentColor);
+    showCountdown();
+  }
+}
 
-      if (blinkState)
-      {
-        // Turn on red light and show 0000
-        digitalWrite(RED_PIN, HIGH);
-        digitalWrite(YELLOW_PIN, LOW);
-        digitalWrite(GREEN_PIN, LOW);
-        display.showNumberDec(0, true); // true = show leading zeros
-      }
-      else
-      {
-        // Turn off all lights and clear display
-        digitalWrite(RED_PIN, LOW);
-        digitalWrite(YELLOW_PIN, LOW);
-        digitalWrite(GREEN_PIN, LOW);
-        display.clear();
-      }
+// No plan reaches the board: Wi-Fi is down, or the transport knows its
+// link is dead (a silent or failed stream)
+bool offline()
+{
+  return !isOnline || (transport && !transport->linkUp());
+}
+
+// Offline or broken/fixing blink; re-arms itself for as long as the condition lasts
+static void blinkTick()
+{
+  if (preemptionActive())
+    return; // Preemption owns the lamp, even when offline
 
-      lastBlinkTime = millis();
+  if (offline() && !localPlanActive()) // Offline - blink all lights (a local plan keeps cycling)
+  {
+    recordBlink(BLINK_OFFLINE);
+    blinkState = !blinkState;
+
+    if (blinkState)
+    {
+      // Turn on all lights and show "----"
+      static const uint8_t dashes[] = {0x40, 0x40, 0x40, 0x40};
+      lampDriver.write(LAMP_ALL);
+      display.setSegments(dashes); // Show ----
     }
+    else
+    {
+      // Turn off all lights and clear display
+      lampDriver.write(0);
+      display.clear();
+    }
+
+    // Blink every 300ms (faster to indicate urgency)
+    scheduler.after(blinkJob, 300, esp_timer_get_time());
   }
-  else if (currentStatus == 0) // active/normal
+  else if (currentStatus == 1 || currentStatus == 2) // broken or fixing
   {
-    // Normal operation - display and lights are controlled by stream updates
-    // Reset blink state if we just transitioned from broken/fixing
-    static int previousStatus = 0;
-    if (previousStatus != currentStatus)
+    recordBlink(BLINK_STATUS);
+    blinkState = !blinkState;
+
+    if (blinkState)
     {
-      // Restore normal state
-      setLight(currentColor);
-      int displayTime = (currentColor == 3) ? max(0, remainingTime - yellowDuration) : remainingTime;
-      display.showNumberDec(displayTime);
-      previousStatus = currentStatus;
+      // Turn on red light and show 0000
+      lampDriver.write(LAMP_RED);
+      display.showNumberDec(0, true); // true = show leading zeros
     }
+    else
+    {
+      // Turn off all lights and clear display
+      lampDriver.write(0);
+      display.clear();
+    }
+
+    // Blink every 500ms
+    scheduler.after(blinkJob, 500, esp_timer_get_time());
   }
+}
 
-  // Check config button (hold 3 seconds to restart)
+// Check config button (hold 3 seconds to restart)
+static void checkConfigButton()
+{
   static unsigned long buttonPressTime = 0;
   if (digitalRead(CONFIG_BUTTON) == LOW)
   {
@@ -933,15 +1468,224 @@ void loop()
   {
     buttonPressTime = 0;
   }
+}
 
+static void sendHeartbeat()
+{
+  if (transport)
+    transport->sendHeartbeat();
+}
+
+// Roll the stream counters over once an hour
+static void rollStreamHour()
+{
+  streamLastHour = streamThisHour;
+  streamThisHour = StreamCounters();
+  LOG_VERBOSE("Stream: %lu events, %lu bytes in the last hour\n",
+              (unsigned long)streamLastHour.events, (unsigned long)streamLastHour.bytes);
+  updateOrderRollHour();
+}
+
+void setupScheduler()
+{
+  uint64_t nowUs = esp_timer_get_time();
+  scheduler.every("wifi", 5000, checkWiFi, nowUs);
+  scheduler.every("wifi_roam", WIFI_ROAM_TICK_MS, wifiRoamTick, nowUs);
+  scheduler.every("button", 100, checkConfigButton, nowUs);
   // Send heartbeat every 10 seconds (just online status)
-  static unsigned long lastHeartbeat = 0;
-  if (app.ready() && millis() - lastHeartbeat > 10000)
+  scheduler.every("heartbeat", 10000, sendHeartbeat, nowUs);
+  scheduler.every("stream_hour", 3600000UL, rollStreamHour, nowUs);
+  scheduler.every("auth_rotate", 1000, rotateStreamAuth, nowUs);
+  scheduler.every("stream_watchdog", 1000, checkStreamLink, nowUs);
+  scheduler.every("outbound", OUTBOUND_TICK_MS, outboundTick, nowUs);
+  scheduler.every("token_cache", 5000, cacheAuthToken, nowUs);
+  if (detectorsEnabled())
+    scheduler.every("detectors", DETECTOR_DRAIN_MS, detectorTick, nowUs);
+  if (pedButtonEnabled())
+    scheduler.every("ped_button", PED_BUTTON_TICK_MS, pedButtonTick, nowUs);
+  if (localPlanEnabled())
+    scheduler.every("local_plan", LOCAL_PLAN_TICK_MS, localPlanTick, nowUs);
+  if (streamTraceEnabled())
+    scheduler.every("trace_flush", STREAM_TRACE_FLUSH_MS, streamTraceFlush, nowUs);
+  blinkJob = scheduler.oneShot("blink", blinkTick);
+
+  // A job left out of the table would never run; stop at boot instead
+  if (scheduler.rejected() > 0)
   {
-    updateMyStatus();
-    lastHeartbeat = millis();
+    Serial.printf("Scheduler: \"%s\" and %d more not registered (%d jobs, periods up to %lu ms)\n",
+                  scheduler.firstRejected(), scheduler.rejected() - 1, SCHEDULER_MAX_JOBS,
+                  (unsigned long)SCHEDULER_MAX_PERIOD_MS);
+    Serial.flush();
+    abort();
+  }
+}
+
+// ================= SETUP =================
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println("\n\n=== Traffic Light System ===");
+  setupFlightRecorder();
+
+  display.setBrightness(7);
+  display.showNumberDec(8888);
+  delay(1000);
+
+  lampDriver.begin();
+  pinMode(CONFIG_BUTTON, INPUT_PULLUP);
+
+  setLight(0); // Turn off all lights
+
+  // A profile received over serial in config mode is written out here
+  applyPendingProfile();
+  loadConfiguration();
+
+  if (digitalRead(CONFIG_BUTTON) == LOW || wifiSSID.length() == 0)
+  {
+    startConfigMode();
+    return;
   }
 
-  // Minimal delay - spend most time processing streams
-  delay(10);
-}
\ No newline at end of file
+  setupProfiler();
+  setupPowerMode();
+  powerWakeOnLow(CONFIG_BUTTON);
+  setupPreemption();
+  setupDetectors();
+  setupPedButton();
+  setupLocalPlan();
+  setupWiFiRoam();
+
+  Serial.println("Team: " + teamId);
+  Serial.println("Traffic Light ID: " + trafficLightId);
+
+  if (!wifiConnect(10000))
+  {
+    Serial.println("\nWiFi failed - entering config mode");
+    delay(2000);
+    startConfigMode();
+    return;
+  }
+
+  Serial.println("\nWiFi connected: " + WiFi.localIP().toString());
+
+  // Modem sleep is set at connect time, clock and light sleep only from here on
+  powerModeConnected();
+
+  // Wall-clock time for the token cache (kept by the RTC across soft resets)
+  setupClock();
+
+  // LAN control endpoint stays up in normal mode (if a local key is set)
+  startLocalApi();
+
+  // Multicast phase ticks with the other boards at this intersection (if configured)
+  setupPeerSync();
+
+  // Periodic firmware update checks against the OTA manifest (if configured)
+  setupOta();
+
+  // Record stream events to LittleFS for host replay (if configured)
+  setupStreamTrace();
+
+  // Firebase stream, or MQTT when a broker is configured
+  transport = createMqttTransport();
+  if (!transport)
+    transport = new FirebaseTransport();
+
+  transport->begin();
+  LOG_VERBOSE("Transport %s: free heap %lu bytes (min %lu)\n", transport->name(),
+              (unsigned long)ESP.getFreeHeap(), (unsigned long)ESP.getMinFreeHeap());
+
+  setupScheduler();
+
+  Serial.printf("Boot: ready %lu ms after reset (%s image)\n", millis(), BUILD_VARIANT);
+  Serial.println("\n=== System Ready - Light ID " + trafficLightId + " ===\n");
+}
+
+// ================= MAIN LOOP =================
+
+void loop()
+{
+  if (configMode)
+  {
+#ifndef NO_CONFIG_PORTAL
+    server.handleClient();
+#endif
+    serialConfigLoop();
+    delay(10);
+    return;
+  }
+
+  profilerBeginIteration();
+
+  {
+    PROFILE_SCOPE(PROF_JOBS);
+    scheduler.run(schedulerClockUs);
+  }
+
+  // CRITICAL: Process authentication and streaming in real-time (only when online)
+  if (isOnline)
+  {
+    transport->loop();
+
+#ifndef NO_LOCAL_API
+    // Local commands skip the cloud round trip entirely
+    if (localApiEnabled())
+    {
+      PROFILE_SCOPE(PROF_LOCAL_API);
+      server.handleClient();
+    }
+#endif
+
+    {
+      PROFILE_SCOPE(PROF_PEER);
+      peerSyncLoop();
+    }
+    {
+      PROFILE_SCOPE(PROF_OTA);
+      otaLoop();
+    }
+  }
+
+  // Emergency preemption sequence (yellow/red/green steps, hard-wired input)
+  {
+    PROFILE_SCOPE(PROF_PREEMPT);
+    preemptionLoop();
+  }
+
+  // Handle offline status with blinking behavior (HIGHEST PRIORITY after preemption)
+  if (preemptionActive())
+  {
+    // Preemption owns the lamp, even when offline
+  }
+  else if ((offline() && !localPlanActive()) || currentStatus == 1 || currentStatus == 2)
+  {
+    // Offline (without a local plan) or broken/fixing - start blinking right away
+    if (!scheduler.armed(blinkJob))
+      scheduler.after(blinkJob, 0, esp_timer_get_time());
+  }
+  else if (currentStatus == 0) // active/normal
+  {
+    // Normal operation - display and lights are controlled by stream updates
+    // Reset blink state if we just transitioned from broken/fixing
+    static int previousStatus = 0;
+    if (previousStatus != currentStatus)
+    {
+      // Restore normal state
+      setLight(currentColor);
+      showCountdown();
+      previousStatus = currentStatus;
+    }
+  }
+
+  profilerEndIteration();
+  profilerSerialLoop();
+
+  // Sleep until the next deadline; the network clients are polled, so
+  // powerIdle() still caps the wait to keep the stream responsive, and a
+  // peer group caps it further to stay in phase with its leader
+  unsigned long idleMs = scheduler.untilNextUs(esp_timer_get_time()) / 1000;
+  if (peerSyncEnabled() && idleMs > PEER_POLL_MS)
+    idleMs = PEER_POLL_MS;
+  powerIdle(idleMs);
+}
@@ -0,0 +1,202 @@
+#include "mqtt_transport.h"
+#include <WiFi.h>
+#include <PubSubClient.h>
+#include "traffic_light.h"
+#include "local_api.h"
+#include "loop_profiler.h"
+#include "flight_recorder.h"
+#include "update_order.h"
+#include "outbound_queue.h"
+
+static WiFiClient mqttNet;
+static PubSubClient mqtt(mqttNet);
+static String stateTopic;
+
+static void onMessage(char *topic, byte *payload, unsigned int length)
+{
+  unsigned long startUs = micros();
+  PROFILE_SCOPE(PROF_STREAM);
+
+  if (stateTopic != topic)
+    return;
+
+  String data;
+  data.reserve(length);
+  for (unsigned int i = 0; i < length; i++)
+    data += (char)payload[i];
+
+  countStreamEvent(strlen(topic) + length);
+  recordStreamEvent(STREAM_MQTT, length);
+
+  if (applyStateJson(data, SOURCE_CLOUD, startUs))
+    commandLatency[SOURCE_CLOUD].add(micros() - startUs);
+}
+
+class MqttTransport : public Transport
+{
+public:
+  MqttTransport(const String &host, uint16_t port, const String &user, const String &pass)
+      : m_host(host), m_port(port), m_user(user), m_pass(pass)
+  {
+    String base = "traffic/" + teamId + "/" + trafficLightId;
+    stateTopic = base + "/state";
+    m_onlineTopic = base + "/online";
+    m_detectorTopic = base + "/detectors";
+    m_latencyTopic = base + "/latency";
+    m_updateTopic = base + "/update";
+    m_clientId = "traffic-light-" + String((uint32_t)ESP.getEfuseMac(), HEX);
+  }
+
+  const char *name() const override { return "mqtt"; }
+  String endpoint() const override { return stateTopic; }
+
+  bool begin() override
+  {
+    // PubSubClient keeps the host pointer, m_host lives as long as the transport
+    mqtt.setServer(m_host.c_str(), m_port);
+    mqtt.setCallback(onMessage);
+    mqtt.setKeepAlive(MQTT_KEEPALIVE_S);
+    mqtt.setSocketTimeout(2);
+    mqtt.setBufferSize(MQTT_BUFFER_SIZE);
+    return startConnect();
+  }
+
+  void loop() override
+  {
+    PROFILE_SCOPE(PROF_MQTT);
+
+    // The connect task owns the client until it is done
+    if (m_connecting)
+    {
+      if (m_connectDone)
+        finishConnect();
+      return;
+    }
+
+    if (!mqtt.connected())
+    {
+      if (millis() - m_lastAttemptMs >= MQTT_RECONNECT_MS)
+        startConnect();
+      return;
+    }
+    mqtt.loop();
+  }
+
+  bool ready() const override { return !m_connecting && mqtt.connected(); }
+
+  void sendHeartbeat() override
+  {
+    if (!ready())
+      return;
+
+    PROFILE_SCOPE(PROF_HEARTBEAT);
+    mqtt.publish(m_onlineTopic.c_str(), "1", true);
+    LOG_VERBOSE("Heartbeat sent\n");
+  }
+
+  // PubSubClient only publishes at QoS 0, so there is no PUBACK to wait
+  // for: on the socket is as far as the board can tell
+  bool sendLightUpdate(const String &json, uint32_t batch) override
+  {
+    if (!ready() || !mqtt.publish(m_updateTopic.c_str(), json.c_str(), false))
+      return false;
+    outboundSentUnconfirmed(batch);
+    return true;
+  }
+
+  bool sendDetectorBatches(const String &json) override
+  {
+    return ready() && mqtt.publish(m_detectorTopic.c_str(), json.c_str(), false);
+  }
+
+  bool sendLatencyReport(const String &json) override
+  {
+    return ready() && mqtt.publish(m_latencyTopic.c_str(), json.c_str(), true);
+  }
+
+private:
+  // The TCP connect and the wait for CONNACK block for seconds while the
+  // broker is down, so they run in their own task and the loop (lamp timing,
+  // scheduler, peer ticks) carries on. Nothing else touches the client
+  // until the task is done.
+  bool startConnect()
+  {
+    m_lastAttemptMs = millis();
+    m_connectDone = false;
+    m_connecting = true;
+    if (xTaskCreate(connectTask, "mqtt-connect", 4096, this, 1, nullptr) != pdPASS)
+    {
+      m_connecting = false;
+      Serial.println("MQTT connect task could not start");
+      return false;
+    }
+    return true;
+  }
+
+  static void connectTask(void *arg)
+  {
+    MqttTransport *self = (MqttTransport *)arg;
+    // The broker marks the light offline (retained) if the board drops off
+    self->m_connectOk = mqtt.connect(self->m_clientId.c_str(),
+                                     self->m_user.length() > 0 ? self->m_user.c_str() : nullptr,
+                                     self->m_pass.length() > 0 ? self->m_pass.c_str() : nullptr,
+                                     self->m_onlineTopic.c_str(), 1, true, "0");
+    self->m_connectDone = true;
+    vTaskDelete(nullptr);
+  }
+
+  // Back in the loop once the task has ended
+  void finishConnect()
+  {
+    m_connecting = false;
+    if (!m_connectOk)
+    {
+      Serial.printf("MQTT connect to %s:%u failed (state %d)\n", m_host.c_str(), m_port, mqtt.state());
+      return;
+    }
+
+    mqtt.publish(m_onlineTopic.c_str(), "1", true);
+    // The retained state arrives right after subscribing, so no initial
+    // fetch. It is a snapshot, possibly written long ago.
+    updateOrderResync();
+    mqtt.subscribe(stateTopic.c_str(), 1);
+    Serial.println("MQTT connected, subscribed to " + stateTopic);
+  }
+
+  String m_host;
+  uint16_t m_port;
+  String m_user;
+  String m_pass;
+  String m_onlineTopic;
+  String m_detectorTopic;
+  String m_latencyTopic;
+  String m_updateTopic;
+  String m_clientId;
+  unsigned long m_lastAttemptMs = 0;
+  volatile bool m_connecting = false;  // connect task running or not yet picked up
+  volatile bool m_connectDone = false; // set by the task as it ends
+  volatile bool m_connectOk = false;
+};
+
+Transport *createMqttTransport()
+{
+  preferences.begin("traffic-light", true);
+  String broker = preferences.getString("mqtt_host", "");
+  String user = preferences.getString("mqtt_user", "");
+  String pass = preferences.getString("mqtt_pass", "");
+  preferences.end();
+
+  broker.trim();
+  if (broker.length() == 0)
+    return nullptr;
+
+  uint16_t port = MQTT_DEFAULT_PORT;
+  int colon = broker.lastIndexOf(':');
+  if (colon > 0)
+  {
+    port = broker.substring(colon + 1).toInt();
+    broker = broker.substring(0, colon);
+  }
+
+  return new MqttTransport(broker, port, user, pass);
+}
@@ -0,0 +1,25 @@
+#ifndef MQTT_TRANSPORT_H
+#define MQTT_TRANSPORT_H
+
+#include "transport.h"
+
+// ================= MQTT TRANSPORT =================
+// Alternative to the Firebase stream for a broker in the traffic operations
+// center. Selected when a broker is configured (preference "mqtt_host",
+// "host" or "host:port", default port 1883). Topics, for team T and light L:
+//   traffic/T/L/state      retained state JSON, subscribed with QoS 1
+//   traffic/T/L/online     retained "1" while connected, "0" as last will
+//   traffic/T/L/detectors  vehicle detector batches, once per signal cycle
+//   traffic/T/L/update     outbound queue updates, QoS 0 (PubSubClient
+//                          cannot publish at QoS 1), so never confirmed
+// Plain TCP, meant for the LAN or a VPN to the operations center.
+
+const uint16_t MQTT_DEFAULT_PORT = 1883;
+const uint16_t MQTT_KEEPALIVE_S = 15;
+const unsigned long MQTT_RECONNECT_MS = 5000;
+const uint16_t MQTT_BUFFER_SIZE = 1024; // fits DETECTOR_PENDING_BATCHES batches
+
+// nullptr when no broker is configured
+Transport *createMqttTransport();
+
+#endif
@@ -0,0 +1,656 @@
+#include "ota_update.h"
+#include <WiFi.h>
+#include <WiFiClientSecure.h>
+#include <HTTPClient.h>
+#include <Update.h>
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "esp32/rom/miniz.h"
+#include "traffic_light.h"
+#include "serial_config.h"
+
+struct OtaReport
+{
+  String state = "idle"; // idle, checking, up-to-date, refused, not-in-rollout, updating, failed, done
+  String version = "";   // version offered by the manifest
+  String kind = "";      // "full" or "delta"
+  String error = "";
+  uint32_t transferBytes = 0; // bytes downloaded (compressed)
+  uint32_t imageBytes = 0;    // bytes written to flash
+  uint32_t durationMs = 0;
+};
+
+// The OTA task only touches its own copy and publishes it under the lock;
+// GET /api/ota reads the published one
+static OtaReport report;
+static OtaReport published;
+static SemaphoreHandle_t reportLock = nullptr;
+
+static String otaUrl = "";
+static volatile bool otaRunning = false;
+static unsigned long nextCheckMs = 0;
+
+const unsigned long OTA_READ_TIMEOUT_MS = 10000;
+const size_t OTA_CHUNK_SIZE = 1024;
+const uint32_t OTA_PUBLISH_BYTES = 32768; // progress published every 32 KB written
+
+static void publishReport()
+{
+  xSemaphoreTake(reportLock, portMAX_DELAY);
+  published = report;
+  xSemaphoreGive(reportLock);
+}
+
+// ================= HTTP BODY =================
+
+// Response body with a known Content-Length; counts the bytes it hands out
+struct HttpBody
+{
+  Stream *stream;
+  int remaining;
+
+  // Returns bytes read, 0 at end of body, -1 on timeout
+  int read(uint8_t *buf, size_t len)
+  {
+    if (remaining <= 0)
+      return 0;
+
+    unsigned long start = millis();
+    while (stream->available() <= 0)
+    {
+      if (millis() - start > OTA_READ_TIMEOUT_MS)
+        return -1;
+      delay(1);
+    }
+
+    size_t want = min((size_t)stream->available(), min(len, (size_t)remaining));
+    int n = stream->readBytes(buf, want);
+    remaining -= n;
+    report.transferBytes += n;
+    return n;
+  }
+
+  bool readExact(uint8_t *buf, size_t len)
+  {
+    while (len > 0)
+    {
+      int n = read(buf, len);
+      if (n <= 0)
+        return false;
+      buf += n;
+      len -= n;
+    }
+    return true;
+  }
+};
+
+// ================= IMAGE SINKS =================
+
+class ImageSink
+{
+public:
+  virtual ~ImageSink() {}
+  virtual bool write(const uint8_t *data, size_t len) = 0;
+  virtual bool finish() = 0;
+};
+
+// Full image: straight into the inactive OTA partition
+class FlashSink : public ImageSink
+{
+public:
+  bool write(const uint8_t *data, size_t len) override
+  {
+    if (Update.write((uint8_t *)data, len) != len)
+      return false;
+    uint32_t before = report.imageBytes;
+    report.imageBytes += len;
+    if (before / OTA_PUBLISH_BYTES != report.imageBytes / OTA_PUBLISH_BYTES)
+      publishReport();
+    return true;
+  }
+
+  bool finish() override { return true; }
+};
+
+// Binary delta against the running partition (little endian, after gunzip):
+//   "TLD1" <u32 target size>
+//   'C' <u32 offset> <u32 length>   copy bytes from the running partition
+//   'I' <u32 length> <bytes>        insert literal bytes
+//   'E'                             end of delta
+class DeltaSink : public ImageSink
+{
+public:
+  DeltaSink(const esp_partition_t *base, ImageSink &out) : m_base(base), m_out(out) {}
+
+  bool write(const uint8_t *data, size_t len) override
+  {
+    while (len > 0)
+    {
+      if (m_done)
+        return false; // trailing garbage
+
+      if (m_insertRemaining > 0)
+      {
+        size_t n = min(len, (size_t)m_insertRemaining);
+        if (!m_out.write(data, n))
+          return false;
+        data += n;
+        len -= n;
+        m_insertRemaining -= n;
+        continue;
+      }
+
+      m_hdr[m_hdrLen++] = *data++;
+      len--;
+      if (m_hdrLen < headerSize())
+        continue;
+
+      if (!handleHeader())
+        return false;
+      m_hdrLen = 0;
+    }
+    return true;
+  }
+
+  bool finish() override { return m_done; }
+
+private:
+  size_t headerSize() const
+  {
+    if (!m_started)
+      return 8;
+    if (m_hdrLen == 0)
+      return 1;
+    switch (m_hdr[0])
+    {
+    case 'C':
+      return 9;
+    case 'I':
+      return 5;
+    default:
+      return 1;
+    }
+  }
+
+  static uint32_t u32(const uint8_t *p)
+  {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+  }
+
+  bool handleHeader()
+  {
+    if (!m_started)
+    {
+      m_started = true;
+      return memcmp(m_hdr, "TLD1", 4) == 0;
+    }
+
+    switch (m_hdr[0])
+    {
+    case 'C':
+      return copyFromBase(u32(m_hdr + 1), u32(m_hdr + 5));
+    case 'I':
+      m_insertRemaining = u32(m_hdr + 1);
+      return true;
+    case 'E':
+      m_done = true;
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  bool copyFromBase(uint32_t offset, uint32_t len)
+  {
+    if (offset + len > m_base->size)
+      return false;
+
+    uint8_t buf[256];
+    while (len > 0)
+    {
+      size_t n = min((size_t)len, sizeof(buf));
+      if (esp_partition_read(m_base, offset, buf, n) != ESP_OK || !m_out.write(buf, n))
+        return false;
+      offset += n;
+      len -= n;
+    }
+    return true;
+  }
+
+  const esp_partition_t *m_base;
+  ImageSink &m_out;
+  uint8_t m_hdr[9];
+  size_t m_hdrLen = 0;
+  uint32_t m_insertRemaining = 0;
+  bool m_started = false;
+  bool m_done = false;
+};
+
+// ================= GZIP =================
+
+static bool skipGzipHeader(HttpBody &body)
+{
+  uint8_t h[10];
+  if (!body.readExact(h, sizeof(h)) || h[0] != 0x1f || h[1] != 0x8b || h[2] != 8)
+    return false;
+
+  uint8_t flags = h[3];
+  uint8_t b[2];
+
+  if (flags & 0x04) // FEXTRA
+  {
+    if (!body.readExact(b, 2))
+      return false;
+    for (size_t n = b[0] | (b[1] << 8); n > 0; n--)
+      if (!body.readExact(b, 1))
+        return false;
+  }
+  for (uint8_t zeroTerminated : {0x08, 0x10}) // FNAME, FCOMMENT
+  {
+    if (!(flags & zeroTerminated))
+      continue;
+    do
+    {
+      if (!body.readExact(b, 1))
+        return false;
+    } while (b[0] != 0);
+  }
+  if (flags & 0x02) // FHCRC
+    return body.readExact(b, 2);
+
+  return true;
+}
+
+// Inflate the deflate stream through the 32 KB window; nothing else is buffered
+static bool inflateInto(HttpBody &body, ImageSink &sink)
+{
+  tinfl_decompressor *inflator = (tinfl_decompressor *)malloc(sizeof(tinfl_decompressor));
+  uint8_t *window = (uint8_t *)malloc(TINFL_LZ_DICT_SIZE);
+  uint8_t *inBuf = (uint8_t *)malloc(OTA_CHUNK_SIZE);
+  bool ok = inflator && window && inBuf;
+
+  if (ok)
+  {
+    tinfl_init(inflator);
+    size_t inOfs = 0, inAvail = 0, windowOfs = 0;
+    bool eof = false;
+
+    while (ok)
+    {
+      if (inAvail == 0 && !eof)
+      {
+        int n = body.read(inBuf, OTA_CHUNK_SIZE);
+        if (n < 0)
+        {
+          report.error = "read timeout";
+          ok = false;
+          break;
+        }
+        eof = (n == 0);
+        inOfs = 0;
+        inAvail = n;
+      }
+
+      size_t inBytes = inAvail;
+      size_t outBytes = TINFL_LZ_DICT_SIZE - windowOfs;
+      tinfl_status status = tinfl_decompress(inflator, inBuf + inOfs, &inBytes, window, window + windowOfs,
+                                             &outBytes, eof ? 0 : TINFL_FLAG_HAS_MORE_INPUT);
+      inOfs += inBytes;
+      inAvail -= inBytes;
+
+      if (outBytes > 0 && !sink.write(window + windowOfs, outBytes))
+      {
+        report.error = "write failed";
+        ok = false;
+        break;
+      }
+      windowOfs = (windowOfs + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+
+      if (status == TINFL_STATUS_DONE)
+        break;
+      if (status < 0 || (status == TINFL_STATUS_NEEDS_MORE_INPUT && eof))
+      {
+        report.error = "corrupt or truncated gzip stream";
+        ok = false;
+      }
+    }
+  }
+
+  free(inBuf);
+  free(window);
+  free(inflator);
+  return ok;
+}
+
+// ================= MANIFEST =================
+
+static bool readJsonString(const String &data, const char *key, String &value)
+{
+  int keyIdx = data.indexOf("\"" + String(key) + "\"");
+  if (keyIdx < 0)
+    return false;
+  int start = data.indexOf('"', data.indexOf(':', keyIdx) + 1);
+  int end = data.indexOf('"', start + 1);
+  if (start < 0 || end < 0)
+    return false;
+  value = data.substring(start + 1, end);
+  return true;
+}
+
+// "1.2.3" (optional leading 'v', up to three numbers below 65536) as one
+// comparable value; false for anything else, like "dev"
+static bool parseVersion(String text, uint64_t &value)
+{
+  if (text.startsWith("v"))
+    text.remove(0, 1);
+
+  uint32_t parts[3] = {0, 0, 0};
+  size_t part = 0;
+  bool digits = false;
+  for (size_t i = 0; i < text.length(); i++)
+  {
+    char c = text[i];
+    if (c >= '0' && c <= '9')
+    {
+      parts[part] = parts[part] * 10 + (c - '0');
+      if (parts[part] > 0xFFFF)
+        return false;
+      digits = true;
+    }
+    else if (c == '.' && digits && part < 2)
+    {
+      part++;
+      digits = false;
+    }
+    else
+    {
+      return false;
+    }
+  }
+  if (!digits)
+    return false;
+
+  value = ((uint64_t)parts[0] << 32) | ((uint64_t)parts[1] << 16) | parts[2];
+  return true;
+}
+
+static bool manifestSigned(const String &manifest, const String &signature)
+{
+#ifdef OTA_KEY
+  static const char key[] = OTA_KEY;
+  return hmacMatches(key, sizeof(key) - 1, (const uint8_t *)manifest.c_str(), manifest.length(), signature);
+#else
+  (void)manifest;
+  (void)signature;
+  return false;
+#endif
+}
+
+// Stable 0-99 bucket per board, compared against the manifest's rollout percentage
+static int rolloutBucket()
+{
+  uint64_t mac = ESP.getEfuseMac();
+  uint32_t hash = 2166136261u; // FNV-1a over the MAC bytes
+  for (int i = 0; i < 6; i++)
+  {
+    hash ^= (uint8_t)(mac >> (8 * i));
+    hash *= 16777619u;
+  }
+  return hash % 100;
+}
+
+static String resolveUrl(const String &path)
+{
+  if (path.startsWith("http://") || path.startsWith("https://"))
+    return path;
+  return otaUrl.substring(0, otaUrl.lastIndexOf('/') + 1) + path;
+}
+
+static bool httpGet(HTTPClient &http, const String &url, WiFiClient &plain, WiFiClientSecure &secure)
+{
+  bool ok;
+  if (url.startsWith("https://"))
+  {
+    secure.setInsecure();
+    ok = http.begin(secure, url);
+  }
+  else
+  {
+    ok = http.begin(plain, url);
+  }
+  return ok && http.GET() == HTTP_CODE_OK;
+}
+
+// ================= UPDATE =================
+
+static bool applyUpdate(const String &url, bool delta, uint32_t imageSize, const String &md5)
+{
+  HTTPClient http;
+  WiFiClient plain;
+  WiFiClientSecure secure;
+
+  if (!httpGet(http, url, plain, secure))
+  {
+    report.error = "download failed: " + url;
+    return false;
+  }
+
+  HttpBody body = {http.getStreamPtr(), http.getSize()};
+  if (body.remaining <= 0)
+  {
+    report.error = "missing Content-Length";
+    return false;
+  }
+
+  if (!Update.begin(imageSize, U_FLASH) || !Update.setMD5(md5.c_str()))
+  {
+    report.error = Update.errorString();
+    return false;
+  }
+
+  FlashSink flash;
+  DeltaSink deltaSink(esp_ota_get_running_partition(), flash);
+  ImageSink &sink = delta ? (ImageSink &)deltaSink : (ImageSink &)flash;
+
+  bool ok = skipGzipHeader(body) && inflateInto(body, sink) && sink.finish();
+  http.end();
+
+  if (!ok)
+  {
+    if (report.error.length() == 0)
+      report.error = delta ? "invalid delta" : "invalid image";
+    Update.abort();
+    return false;
+  }
+
+  // Checks the MD5 and the image header before switching the boot partition
+  if (!Update.end())
+  {
+    report.error = Update.errorString();
+    return false;
+  }
+  return true;
+}
+
+static void checkAndUpdate()
+{
+#ifndef OTA_KEY
+  report.state = "failed";
+  report.error = "no OTA key in this build";
+  return;
+#endif
+
+  HTTPClient http;
+  WiFiClient plain;
+  WiFiClientSecure secure;
+  if (!httpGet(http, otaUrl, plain, secure))
+  {
+    report.state = "failed";
+    report.error = "manifest unavailable";
+    return;
+  }
+  String manifest = http.getString();
+  http.end();
+
+  if (!httpGet(http, otaUrl + ".sig", plain, secure))
+  {
+    report.state = "failed";
+    report.error = "manifest signature unavailable";
+    return;
+  }
+  String signature = http.getString();
+  http.end();
+  signature.trim();
+
+  // Nothing in the manifest is used before this
+  if (!manifestSigned(manifest, signature))
+  {
+    report.state = "failed";
+    report.error = "bad manifest signature";
+    return;
+  }
+
+  String image, md5, deltaPath, deltaBaseMd5;
+  int size = 0, rollout = 100;
+  readJsonString(manifest, "version", report.version);
+  readJsonString(manifest, "image", image);
+  readJsonString(manifest, "md5", md5);
+  readJsonString(manifest, "delta", deltaPath);
+  readJsonString(manifest, "delta_base_md5", deltaBaseMd5);
+  readJsonInt(manifest, "size", size);
+  readJsonInt(manifest, "rollout", rollout);
+
+  uint64_t offered = 0, running = 0;
+  if (!parseVersion(report.version, offered))
+  {
+    report.state = "failed";
+    report.error = "bad version in manifest";
+    return;
+  }
+  parseVersion(FIRMWARE_VERSION, running); // "dev" stays 0
+  if (offered == running)
+  {
+    report.state = "up-to-date";
+    return;
+  }
+  if (offered < running)
+  {
+    report.state = "refused";
+    report.error = "older than the running version";
+    return;
+  }
+  if (rolloutBucket() >= rollout)
+  {
+    report.state = "not-in-rollout";
+    return;
+  }
+  if (image.length() == 0 || md5.length() != 32 || size <= 0)
+  {
+    report.state = "failed";
+    report.error = "incomplete manifest";
+    return;
+  }
+
+  bool delta = deltaPath.length() > 0 && deltaBaseMd5 == ESP.getSketchMD5();
+  report.kind = delta ? "delta" : "full";
+  report.state = "updating";
+  publishReport();
+  Serial.println("OTA: " + String(FIRMWARE_VERSION) + " -> " + report.version + " (" + report.kind + ")");
+
+  unsigned long startMs = millis();
+  bool ok = applyUpdate(resolveUrl(delta ? deltaPath : image), delta, size, md5);
+  report.durationMs = millis() - startMs;
+
+  Serial.printf("OTA: %s, %lu bytes transferred, %lu bytes written, %lu ms\n", ok ? "verified" : "failed",
+                (unsigned long)report.transferBytes, (unsigned long)report.imageBytes,
+                (unsigned long)report.durationMs);
+
+  if (!ok)
+  {
+    report.state = "failed";
+    Serial.println("OTA error: " + report.error);
+    return;
+  }
+
+  report.state = "done";
+  publishReport();
+  Serial.println("OTA: restarting into " + report.version);
+  delay(500);
+  ESP.restart();
+}
+
+static void runCheck()
+{
+  report = OtaReport();
+  report.state = "checking";
+  publishReport();
+
+  checkAndUpdate();
+  publishReport();
+  // A failed update has logged its error already
+  if (report.error.length() > 0 && report.kind.length() == 0)
+    Serial.println("OTA " + report.state + ": " + report.error);
+}
+
+static void otaTask(void *)
+{
+  runCheck();
+  otaRunning = false;
+  vTaskDelete(nullptr);
+}
+
+// ================= PUBLIC API =================
+
+void setupOta()
+{
+  preferences.begin("traffic-light", true);
+  otaUrl = preferences.getString("ota_url", "");
+  preferences.end();
+
+  if (!reportLock)
+    reportLock = xSemaphoreCreateMutex();
+  nextCheckMs = millis() + OTA_FIRST_CHECK_MS;
+  Serial.println("Firmware version: " + String(FIRMWARE_VERSION) + " (" + BUILD_VARIANT + " image)");
+}
+
+bool otaCheckNow()
+{
+  if (otaUrl.length() == 0 || otaRunning)
+    return false;
+
+  otaRunning = true;
+  nextCheckMs = millis() + OTA_CHECK_INTERVAL_MS;
+  // Own task so the lamp keeps following the stream while the image downloads
+  if (xTaskCreate(otaTask, "ota", 8192, nullptr, 1, nullptr) != pdPASS)
+  {
+    otaRunning = false;
+    return false;
+  }
+  return true;
+}
+
+void otaLoop()
+{
+  if (otaUrl.length() > 0 && !otaRunning && (long)(millis() - nextCheckMs) >= 0)
+    otaCheckNow();
+}
+
+String otaReportJson()
+{
+  OtaReport copy;
+  if (reportLock)
+  {
+    xSemaphoreTake(reportLock, portMAX_DELAY);
+    copy = published;
+    xSemaphoreGive(reportLock);
+  }
+
+  return "{\"running_version\":\"" + String(FIRMWARE_VERSION) +
+         "\",\"state\":\"" + copy.state +
+         "\",\"version\":\"" + copy.version +
+         "\",\"kind\":\"" + copy.kind +
+         "\",\"error\":\"" + copy.error +
+         "\",\"transfer_bytes\":" + String(copy.transferBytes) +
+         ",\"image_bytes\":" + String(copy.imageBytes) +
+         ",\"duration_ms\":" + String(copy.durationMs) + "}";
+}
@@ -0,0 +1,37 @@
+#ifndef OTA_UPDATE_H
+#define OTA_UPDATE_H
+
+#include <Arduino.h>
+
+// ================= OTA FIRMWARE UPDATES =================
+// Pulls a manifest from the configured HTTP(S) URL (preference "ota_url")
+// and, if a newer version is rolled out to this board, streams either a
+// gzip-compressed image or a gzip-compressed binary delta against the
+// running partition straight into the inactive OTA partition. The image is
+// MD5-verified before the boot partition is switched. See tools/make_ota.py.
+//
+// The manifest is signed: "<ota_url>.sig" holds the hex HMAC-SHA256 of the
+// manifest bytes under the OTA key the image was built with
+// (-D OTA_KEY=\"...\"). It is checked before anything else in the manifest
+// is used, so the image size and MD5 it names are trusted too. A build
+// without the key never installs an update. Only a version numerically
+// higher than FIRMWARE_VERSION is installed; "dev" counts as the lowest.
+
+#ifndef FIRMWARE_VERSION
+#define FIRMWARE_VERSION "dev"
+#endif
+
+const unsigned long OTA_FIRST_CHECK_MS = 60UL * 1000UL;         // after boot
+const unsigned long OTA_CHECK_INTERVAL_MS = 6UL * 3600UL * 1000UL; // then every 6 hours
+
+void setupOta();
+
+// Starts a check (and update) on the OTA task when one is due
+void otaLoop();
+
+// Request a check right away; returns false if one is already running
+bool otaCheckNow();
+
+String otaReportJson();
+
+#endif
@@ -0,0 +1,78 @@
+#include "outbound_queue.h"
+#include "WriteQueue.h"
+#include "traffic_light.h"
+#include "transport.h"
+#include "update_order.h"
+
+static WriteQueue queue;
+
+static void logOverflow(bool queued, const char *path)
+{
+  if (!queued)
+    LOG_VERBOSE("Outbound: no room for %s\n", path);
+}
+
+void outboundPutInt(const char *path, long value)
+{
+  logOverflow(queue.putInt(path, value, millis()), path);
+}
+
+void outboundPutBool(const char *path, bool value)
+{
+  logOverflow(queue.putBool(path, value, millis()), path);
+}
+
+void outboundReportApplied()
+{
+  outboundPutInt("applied/color", currentColor);
+  outboundPutInt("applied/remaintime", remainingTime);
+  outboundPutInt("applied/status", currentStatus);
+  uint32_t seq = updateOrderLastSeq();
+  if (seq != 0)
+    outboundPutInt("applied/seq", (long)seq);
+}
+
+void outboundTick()
+{
+  // Checked even while offline, so an update that never got an answer times out
+  if (!queue.due(millis()) || !isOnline || !transport || !transport->ready())
+    return;
+
+  static char batch[WRITE_BATCH_MAX];
+  unsigned long now = millis();
+  if (queue.takeBatch(batch, sizeof(batch), now) == 0)
+    return;
+
+  if (!transport->sendLightUpdate(String(batch), queue.batchId()))
+    queue.done(queue.batchId(), false, now);
+}
+
+void outboundDone(uint32_t batch, bool ok)
+{
+  queue.done(batch, ok, millis());
+}
+
+void outboundSentUnconfirmed(uint32_t batch)
+{
+  queue.doneUnconfirmed(batch, millis());
+}
+
+String outboundReportJson()
+{
+  const WriteQueueStats &s = queue.stats;
+  return "{\"pending\":" + String(queue.pending()) +
+         ",\"in_flight\":" + String(queue.inFlight() ? "true" : "false") +
+         ",\"backoff_ms\":" + String(queue.backoffMs()) +
+         ",\"writes\":" + String(s.writes) +
+         ",\"merged\":" + String(s.merged) +
+         ",\"overflows\":" + String(s.overflows) +
+         ",\"batches\":" + String(s.batches) +
+         ",\"values\":" + String(s.values) +
+         ",\"landed\":" + String(s.landed) +
+         ",\"unconfirmed\":" + String(s.unconfirmed) +
+         ",\"failures\":" + String(s.failures) +
+         ",\"timeouts\":" + String(s.timeouts) +
+         ",\"late_answers\":" + String(s.lateAnswers) +
+         ",\"last_rtt_ms\":" + String(s.lastRttMs) +
+         ",\"max_rtt_ms\":" + String(s.maxRttMs) + "}";
+}
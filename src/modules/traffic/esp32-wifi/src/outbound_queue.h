@@ -0,0 +1,41 @@
+#ifndef OUTBOUND_QUEUE_H
+#define OUTBOUND_QUEUE_H
+
+#include <Arduino.h>
+
+// ================= OUTBOUND QUEUE =================
+// Writes from the board to its own light node
+// (/teams/{team}/traffic_lights/{id}) go through one queue
+// (lib/TrafficCore/WriteQueue.h) instead of a request each: the "online"
+// heartbeat, and what the lamp actually shows ("applied/color",
+// "applied/remaintime", "applied/status" and "applied/seq", the sequence
+// number of the last device view update applied), and pedestrian calls
+// ("ped_call/n" and "ped_call/t", ped_button.h). Pending values are merged
+// into one multi-path update with only the latest value per path, and a
+// failed update is sent again with backoff. The transport reports whether
+// each update landed (Transport::sendLightUpdate()), where it can.
+
+const unsigned long OUTBOUND_TICK_MS = 100;
+
+// Queue one value under the light node; it goes out with the next update
+void outboundPutInt(const char *path, long value);
+void outboundPutBool(const char *path, bool value);
+
+// Queue the applied color, countdown, status and update sequence number
+void outboundReportApplied();
+
+// Send an update when one is due (scheduler job)
+void outboundTick();
+
+// The transport's answer for update `batch` (the id passed to
+// sendLightUpdate()); an answer for any other than the one in flight is
+// ignored
+void outboundDone(uint32_t batch, bool ok);
+
+// Update `batch` is out, but the transport gets no answer for it (MQTT
+// publishes at QoS 0); counted as unconfirmed, not landed
+void outboundSentUnconfirmed(uint32_t batch);
+
+String outboundReportJson();
+
+#endif
@@ -0,0 +1,212 @@
+#include "ped_button.h"
+#include <time.h>
+#include "traffic_light.h"
+#include "outbound_queue.h"
+#include "preemption.h"
+#include "local_plan.h"
+#include "power_mode.h"
+#include "token_cache.h"
+#include "flight_recorder.h"
+
+static bool enabled = false;
+
+// ISR state: the level it last accepted and when, and the presses so far
+static volatile bool isrPressed = false;
+static volatile uint32_t isrLastUs = 0;
+static volatile uint32_t isrPresses = 0;
+static volatile uint32_t isrBounces = 0;
+
+// Loop side
+static uint32_t seenPresses = 0;
+static bool callOpen = false;
+static unsigned long callStartMs = 0;
+static int lastColor = 0;
+static bool ackShowing = false;
+static unsigned long ackStartMs = 0;
+
+static uint32_t calls = 0; // kept in NVS, so the call number never repeats after a reboot
+static uint32_t merged = 0;
+static uint32_t served = 0;
+static uint32_t expired = 0;
+static uint32_t settled = 0;
+static uint32_t lastCallS = 0;
+
+static void IRAM_ATTR onPedButtonEdge()
+{
+  uint32_t nowUs = micros();
+  bool pressed = digitalRead(PED_BUTTON_PIN) == LOW;
+  powerRearmWakeFromISR(PED_BUTTON_PIN, pressed);
+
+  if (pressed == isrPressed)
+    return; // bounced back before the ISR ran
+  if (nowUs - isrLastUs < PED_DEBOUNCE_US)
+  {
+    isrBounces++;
+    return;
+  }
+
+  isrPressed = pressed;
+  isrLastUs = nowUs;
+  if (pressed)
+    isrPresses++;
+}
+
+// A bounce that ends inside the debounce window leaves the ISR on the wrong
+// level; once the input has been quiet for the window, catch up with the pin
+static void settleInput()
+{
+  portDISABLE_INTERRUPTS();
+  uint32_t nowUs = micros();
+  bool pressed = digitalRead(PED_BUTTON_PIN) == LOW;
+  if (pressed != isrPressed && nowUs - isrLastUs >= PED_DEBOUNCE_US)
+  {
+    isrPressed = pressed;
+    isrLastUs = nowUs;
+    if (pressed)
+      isrPresses++;
+    settled++;
+  }
+  portENABLE_INTERRUPTS();
+}
+
+// The display shows the countdown (not a blink or a preemption), so "CALL"
+// can go over it
+static bool countdownShowing()
+{
+  return !preemptionActive() && currentStatus == 0 && !(offline() && !localPlanActive());
+}
+
+static void showAck()
+{
+  static const uint8_t call[] = {
+      SEG_A | SEG_D | SEG_E | SEG_F,                 // C
+      SEG_A | SEG_B | SEG_C | SEG_E | SEG_F | SEG_G, // A
+      SEG_D | SEG_E | SEG_F,                         // L
+      SEG_D | SEG_E | SEG_F                          // L
+  };
+
+  ackStartMs = millis();
+  if (ackShowing || !countdownShowing())
+    return;
+
+  display.setSegments(call);
+  recordDisplay(DISPLAY_CALL);
+  ackShowing = true;
+}
+
+static void endAck()
+{
+  ackShowing = false;
+  if (countdownShowing())
+    showCountdown();
+}
+
+// One call per cycle: the call count and the time it was placed, both in the
+// same outbound update, so the backend sees a new call as one change
+static void placeCall()
+{
+  calls++;
+  callOpen = true;
+  callStartMs = millis();
+  lastCallS = clockValid() ? (uint32_t)time(nullptr) : 0;
+
+  // Stored before it goes out: the backend tells calls apart by this number
+  preferences.begin("traffic-light", false);
+  preferences.putUInt("ped_calls", calls);
+  preferences.end();
+
+  outboundPutInt("ped_call/n", calls);
+  outboundPutInt("ped_call/t", lastCallS);
+  Serial.printf("Pedestrian call %lu placed\n", (unsigned long)calls);
+}
+
+// ================= PUBLIC API =================
+
+void setupPedButton()
+{
+  preferences.begin("traffic-light", true);
+  enabled = preferences.getUChar("ped_button", 0) != 0;
+  calls = preferences.getUInt("ped_calls", 0);
+  preferences.end();
+
+  if (!enabled)
+    return;
+
+  pinMode(PED_BUTTON_PIN, INPUT_PULLUP);
+  isrPressed = digitalRead(PED_BUTTON_PIN) == LOW;
+  isrLastUs = micros();
+  attachInterrupt(digitalPinToInterrupt(PED_BUTTON_PIN), onPedButtonEdge, CHANGE);
+  powerWakeOnLow(PED_BUTTON_PIN);
+
+  lastColor = currentColor;
+  Serial.printf("Pedestrian button on GPIO %u\n", PED_BUTTON_PIN);
+}
+
+bool pedButtonEnabled()
+{
+  return enabled;
+}
+
+void pedButtonTick()
+{
+  if (!enabled)
+    return;
+
+  settleInput();
+  unsigned long nowMs = millis();
+
+  // The cycle a call was placed in ends when the light turns green
+  bool greenStart = currentColor == 3 && lastColor != 3;
+  lastColor = currentColor;
+  if (callOpen && greenStart)
+  {
+    callOpen = false;
+    served++;
+  }
+  else if (callOpen && nowMs - callStartMs >= PED_CALL_MAX_MS)
+  {
+    callOpen = false;
+    expired++;
+  }
+
+  uint32_t presses = isrPresses;
+  if (presses != seenPresses)
+  {
+    uint32_t fresh = presses - seenPresses;
+    seenPresses = presses;
+
+    if (!callOpen)
+    {
+      placeCall();
+      fresh--;
+    }
+    merged += fresh;
+    showAck();
+  }
+
+  if (ackShowing && nowMs - ackStartMs >= PED_ACK_MS)
+    endAck();
+}
+
+bool pedButtonAckShowing()
+{
+  return ackShowing;
+}
+
+String pedButtonReportJson()
+{
+  if (!enabled)
+    return "{\"enabled\":false}";
+
+  return "{\"enabled\":true,\"pin\":" + String(PED_BUTTON_PIN) +
+         ",\"pressed\":" + String(isrPressed ? "true" : "false") +
+         ",\"call_open\":" + String(callOpen ? "true" : "false") +
+         ",\"presses\":" + String(seenPresses) +
+         ",\"calls\":" + String(calls) +
+         ",\"merged\":" + String(merged) +
+         ",\"served\":" + String(served) +
+         ",\"expired\":" + String(expired) +
+         ",\"last_call_t\":" + String(lastCallS) +
+         ",\"bounces\":" + String(isrBounces) +
+         ",\"settled\":" + String(settled) + "}";
+}
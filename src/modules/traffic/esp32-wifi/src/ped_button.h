@@ -0,0 +1,50 @@
+#ifndef PED_BUTTON_H
+#define PED_BUTTON_H
+
+#include <Arduino.h>
+
+// ================= PEDESTRIAN CALL BUTTON =================
+// A pedestrian push button wired from PED_BUTTON_PIN to ground (internal
+// pull-up). Enabled by the preference "ped_button".
+//
+// A GPIO interrupt on every edge is debounced in the ISR, the same way as the
+// vehicle detectors, and counts presses. The button job turns them into at
+// most one call per signal cycle: the first press places the call, repeat
+// presses until the light next turns green are merged into it. Each call is
+// queued on the outbound path ("ped_call/n" and "ped_call/t" on the light
+// node), where the backend turns it into one light request. The call number
+// n is kept in NVS ("ped_calls"), so it keeps counting across reboots and
+// the backend can tell a new call from one it has already handled.
+//
+// Every press, merged or not, shows "CALL" on the display for PED_ACK_MS so
+// the pedestrian knows it was taken.
+
+// Input pin (active LOW, internal pull-up)
+const uint8_t PED_BUTTON_PIN = 13;
+
+// Edges closer than this to the last accepted edge are bounce
+const uint32_t PED_DEBOUNCE_US = 30000;
+
+const unsigned long PED_BUTTON_TICK_MS = 20;
+const unsigned long PED_ACK_MS = 1500;
+
+// A call not served by a green start within this time (the light is not
+// cycling) ends anyway, so the next press places a new one
+const unsigned long PED_CALL_MAX_MS = 300000;
+
+// Reads the preference and attaches the interrupt; call before WiFi starts
+// so the input is registered as a light sleep wake source
+void setupPedButton();
+
+bool pedButtonEnabled();
+
+// Take the presses from the ISR, place or merge the call, run the display
+// acknowledgement and end the call on a green start (scheduler job)
+void pedButtonTick();
+
+// True while "CALL" is on the display; the countdown leaves it alone
+bool pedButtonAckShowing();
+
+String pedButtonReportJson();
+
+#endif
@@ -0,0 +1,263 @@
+#include "peer_sync.h"
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <mbedtls/md.h>
+#include "PhaseSync.h"
+#include "preemption.h"
+#include "power_mode.h"
+
+static const IPAddress PEER_MULTICAST_ADDR(239, 255, 42, 99);
+
+static WiFiUDP peerUdp;
+static PeerElection *election = nullptr;
+static TickReplayGuard replayGuard;
+
+// Group key (peer_key) that signs every tick
+static String groupKey;
+static PhaseTickKey tickKey;
+static uint32_t badTicks = 0;
+
+static bool enabled = false;
+static uint16_t syncGroup = 0;
+static uint8_t syncPhase = 0;
+static uint32_t boardId = 0;
+static uint32_t bootEpoch = 0;
+
+static bool leading = false;
+static bool following = false;
+static uint32_t tickSeq = 0;
+static unsigned long lastTickMs = 0;
+static PhaseTick lastSent;
+
+// When the lamp took its current color, for the tick's elapsed field
+static int tickColor = 0;
+static unsigned long colorSinceMs = 0;
+
+// Latest cloud plan while following, applied again on fallback
+static int cloudColor = 0;
+static int cloudRemaining = 0;
+static int cloudStatus = 0;
+
+static void tickHmac(const uint8_t *key, size_t keyLen, const uint8_t *data, size_t len, uint8_t *mac)
+{
+  mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), key, keyLen, data, len, mac);
+}
+
+static PhaseTick currentTick()
+{
+  PhaseTick tick;
+  tick.flags = preemptionActive() ? PHASE_FLAG_PREEMPT : 0;
+  tick.group = syncGroup;
+  tick.phase = syncPhase;
+  tick.color = currentColor;
+  tick.status = currentStatus;
+  tick.yellow = constrain(yellowDuration, 0, 255);
+  tick.remaining = constrain(remainingTime, 0, 9999);
+
+  if (currentColor != tickColor)
+  {
+    tickColor = currentColor;
+    colorSinceMs = millis();
+  }
+  tick.elapsed = min((millis() - colorSinceMs) / 1000, 9999UL);
+  tick.boardId = boardId;
+  tick.epoch = bootEpoch;
+  return tick;
+}
+
+static bool sameState(const PhaseTick &a, const PhaseTick &b)
+{
+  return a.flags == b.flags && a.color == b.color && a.status == b.status &&
+         a.yellow == b.yellow && a.remaining == b.remaining && a.elapsed == b.elapsed;
+}
+
+static void sendTick()
+{
+  PhaseTick tick = currentTick();
+  if (tick.color < 1 || tick.color > 3)
+    return;
+
+  tick.seq = ++tickSeq;
+  uint8_t buf[PHASE_TICK_SIZE];
+  size_t len = encodePhaseTick(tick, tickKey, buf, sizeof(buf));
+  if (len == 0)
+    return;
+
+  peerUdp.beginMulticastPacket();
+  peerUdp.write(buf, len);
+  peerUdp.endPacket();
+
+  lastSent = tick;
+  lastTickMs = millis();
+}
+
+static void followTick(const PhaseTick &tick)
+{
+  if (!following)
+  {
+    following = true;
+    cloudColor = currentColor;
+    cloudRemaining = remainingTime;
+    cloudStatus = currentStatus;
+    Serial.printf("Peer sync: following leader %08lx\n", (unsigned long)tick.boardId);
+  }
+
+  int color, remaining;
+  mapPeerPhase(tick, syncPhase, color, remaining);
+  // A fault at the leader puts the whole group into the broken/fixing blink;
+  // this board's own fault still shows
+  applyLightField("status", cloudStatus != 0 ? cloudStatus : tick.status, SOURCE_PEER);
+  applyLightField("remaintime", remaining, SOURCE_PEER);
+  applyLightField("color", color, SOURCE_PEER);
+}
+
+static void receiveTicks()
+{
+  int size;
+  while ((size = peerUdp.parsePacket()) > 0)
+  {
+    uint8_t buf[PHASE_TICK_SIZE + 1];
+    int len = peerUdp.read(buf, sizeof(buf));
+
+    // Unsigned, forged and replayed ticks never reach the election
+    PhaseTick tick;
+    if (len <= 0 || !decodePhaseTick(buf, len, tickKey, tick) || tick.group != syncGroup)
+    {
+      if (++badTicks == 1 || badTicks % 100 == 0)
+        Serial.printf("Peer sync: %lu ticks dropped (not signed with this group's key)\n", (unsigned long)badTicks);
+      continue;
+    }
+    if (tick.boardId == boardId || !replayGuard.accept(tick))
+      continue;
+
+    if (election->heard(tick.boardId, millis()))
+      followTick(tick);
+  }
+}
+
+// ================= PUBLIC API =================
+
+void setupPeerSync()
+{
+  preferences.begin("traffic-light", true);
+  syncGroup = preferences.getUInt("peer_group", 0);
+  syncPhase = preferences.getUChar("peer_phase", 0) ? 1 : 0;
+  groupKey = preferences.getString("peer_key", "");
+  preferences.end();
+
+  if (syncGroup == 0)
+    return;
+
+  if (groupKey.length() == 0)
+  {
+    Serial.println("Peer sync: no peer_key set, staying off");
+    return;
+  }
+
+  // A follower in power mode sees ticks only at its radio and loop wakes,
+  // up to a second late, so the group would not stay in phase
+  if (powerModeEnabled())
+  {
+    Serial.println("Peer sync: power mode is on (power_li), staying off");
+    return;
+  }
+  tickKey.key = (const uint8_t *)groupKey.c_str();
+  tickKey.len = groupKey.length();
+  tickKey.hmac = tickHmac;
+
+  // A new epoch every boot, so peers take this board's seq from 1 again
+  // while a recorded tick from an earlier boot stays refused
+  preferences.begin("traffic-light", false);
+  bootEpoch = preferences.getUInt("peer_epoch", 0) + 1;
+  preferences.putUInt("peer_epoch", bootEpoch);
+  preferences.end();
+
+  // Last four MAC bytes; the first ones are the vendor prefix shared by every board
+  boardId = (uint32_t)(ESP.getEfuseMac() >> 16);
+
+  if (!peerUdp.beginMulticast(PEER_MULTICAST_ADDR, PEER_PORT))
+  {
+    Serial.println("Peer sync: multicast join failed");
+    return;
+  }
+
+  election = new PeerElection(boardId, PEER_LEADER_TIMEOUT_MS);
+  election->start(millis());
+  enabled = true;
+
+  Serial.printf("Peer sync: group %u, phase %u, board %08lx, epoch %lu\n", syncGroup, syncPhase,
+                (unsigned long)boardId, (unsigned long)bootEpoch);
+}
+
+void peerSyncLoop()
+{
+  if (!enabled)
+    return;
+
+  receiveTicks();
+
+  unsigned long now = millis();
+
+  if (following && !election->hasLeader(now))
+  {
+    following = false;
+    Serial.println("Peer sync: leader lost, falling back to cloud");
+    applyLightField("status", cloudStatus, SOURCE_CLOUD);
+    applyLightField("remaintime", cloudRemaining, SOURCE_CLOUD);
+    applyLightField("color", cloudColor, SOURCE_CLOUD);
+  }
+
+  bool isLeader = election->isLeader(now);
+  if (isLeader != leading)
+  {
+    leading = isLeader;
+    Serial.println(leading ? "Peer sync: leading group" : "Peer sync: stepped down");
+  }
+
+  // Leader: tick on every change (e.g. preemption steps) and at least every interval
+  if (leading && (now - lastTickMs >= PEER_TICK_INTERVAL_MS || !sameState(currentTick(), lastSent)))
+    sendTick();
+}
+
+void peerSyncStateChanged()
+{
+  if (enabled && leading)
+    sendTick();
+}
+
+bool peerSyncEnabled()
+{
+  return enabled;
+}
+
+bool peerSyncFollowing()
+{
+  return following;
+}
+
+bool peerSyncDefer(const String &field, int value, UpdateSource source)
+{
+  // Only the cloud plan is overridden, local commands still reach this board
+  if (!following || source != SOURCE_CLOUD)
+    return false;
+
+  if (field == "color")
+  {
+    if (value >= 1 && value <= 3)
+      cloudColor = value;
+    return true;
+  }
+  if (field == "remaintime")
+  {
+    if (value >= 0 && value <= 9999)
+      cloudRemaining = value;
+    return true;
+  }
+  if (field == "status")
+  {
+    if (value >= 0 && value <= 2)
+      cloudStatus = value;
+    return true;
+  }
+  return false;
+}
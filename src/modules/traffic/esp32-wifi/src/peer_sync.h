@@ -0,0 +1,34 @@
+#ifndef PEER_SYNC_H
+#define PEER_SYNC_H
+
+#include <Arduino.h>
+#include "traffic_light.h"
+
+// ================= PEER PHASE SYNC =================
+// Optional LAN mode for boards at the same intersection. The board with the
+// lowest id becomes leader and multicasts compact phase ticks (PhaseSync.h);
+// the others follow those ticks in lock-step and only fall back to their own
+// cloud stream when the leader goes quiet. Enabled by a non-zero peer group.
+
+const uint16_t PEER_PORT = 4299;
+const unsigned long PEER_TICK_INTERVAL_MS = 500;
+const unsigned long PEER_LEADER_TIMEOUT_MS = 1500;
+
+// Longest loop wait while in a group (LOOP_POLL_MS otherwise), so a follower
+// picks up a tick within a few ms (tools/peer_sync_check.cpp)
+const unsigned long PEER_POLL_MS = 2;
+
+void setupPeerSync();
+void peerSyncLoop();
+bool peerSyncEnabled();
+
+// Leader: broadcast the new state right away instead of at the next interval
+void peerSyncStateChanged();
+
+bool peerSyncFollowing();
+
+// Record a cloud plan field (color, remaintime, status) while following the leader.
+// Returns true if the field was deferred.
+bool peerSyncDefer(const String &field, int value, UpdateSource source);
+
+#endif
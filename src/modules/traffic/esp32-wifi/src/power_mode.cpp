@@ -0,0 +1,205 @@
+#include "power_mode.h"
+#include <WiFi.h>
+#include <esp_wifi.h>
+#include <esp_pm.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#include <hal/gpio_ll.h>
+#include "traffic_light.h"
+
+static bool enabled = false;
+static uint8_t listenInterval = 0;
+static bool scalingActive = false;
+static bool lightSleepActive = false;
+static TaskHandle_t loopTask = nullptr;
+
+// Active-LOW inputs that must wake the chip from light sleep
+static uint8_t wakePins[8];
+static uint8_t wakePinCount = 0;
+static volatile bool wakeArmed = false;
+
+// Idle accounting for the duty cycle in /api/power
+static uint64_t idleUs = 0;
+static unsigned long statsStartMs = 0;
+static uint32_t idleCount = 0;
+static uint32_t earlyWakes = 0;
+
+static void configureSleep()
+{
+#if CONFIG_PM_ENABLE
+  esp_pm_config_esp32_t pm = {};
+  pm.max_freq_mhz = POWER_CPU_MHZ;
+  pm.min_freq_mhz = 40; // XTAL, the APB stays usable for UART/GPIO
+  pm.light_sleep_enable = true;
+
+  // Light sleep needs a tickless-idle build, fall back to frequency scaling only
+  esp_err_t err = esp_pm_configure(&pm);
+  if (err == ESP_OK)
+  {
+    lightSleepActive = true;
+  }
+  else
+  {
+    pm.light_sleep_enable = false;
+    err = esp_pm_configure(&pm);
+  }
+  scalingActive = err == ESP_OK;
+#endif
+
+  if (!lightSleepActive)
+    return;
+
+  // Edge interrupts don't fire in light sleep, so the inputs have to wake the
+  // chip. The GPIO wake source is a level trigger in the same register as the
+  // pin's interrupt type, so each pin is armed for the level it is not at now
+  // and its ISR moves the trigger over on every change (powerRearmWakeFromISR).
+  // Armed first, so an ISR that runs in between already does that.
+  wakeArmed = true;
+  for (uint8_t i = 0; i < wakePinCount; i++)
+  {
+    bool low = digitalRead(wakePins[i]) == LOW;
+    gpio_wakeup_enable((gpio_num_t)wakePins[i], low ? GPIO_INTR_HIGH_LEVEL : GPIO_INTR_LOW_LEVEL);
+  }
+  esp_sleep_enable_gpio_wakeup();
+}
+
+// ================= PUBLIC API =================
+
+void setupPowerMode()
+{
+  preferences.begin("traffic-light", true);
+  listenInterval = preferences.getUChar("power_li", 0);
+  preferences.end();
+
+  enabled = listenInterval > 0;
+  if (!enabled)
+    return;
+
+  listenInterval = min(listenInterval, POWER_MAX_LISTEN_INTERVAL);
+  loopTask = xTaskGetCurrentTaskHandle();
+  Serial.println("Power mode: listen interval " + String(listenInterval) + " beacons");
+}
+
+void powerBeginWiFi(const String &ssid, const String &pass, int32_t channel, const uint8_t *bssid)
+{
+  if (!enabled)
+  {
+    WiFi.begin(ssid.c_str(), pass.c_str(), channel, bssid);
+    return;
+  }
+
+  WiFi.mode(WIFI_STA);
+  WiFi.setSleep(WIFI_PS_MAX_MODEM);
+
+  // WiFi.begin(ssid, pass) rebuilds the station config without a listen
+  // interval, so set it here and connect with the stored config
+  wifi_config_t conf = {};
+  strlcpy((char *)conf.sta.ssid, ssid.c_str(), sizeof(conf.sta.ssid));
+  strlcpy((char *)conf.sta.password, pass.c_str(), sizeof(conf.sta.password));
+  conf.sta.listen_interval = listenInterval;
+  conf.sta.channel = channel;
+  if (bssid)
+  {
+    conf.sta.bssid_set = true;
+    memcpy(conf.sta.bssid, bssid, sizeof(conf.sta.bssid));
+  }
+  esp_wifi_set_config(WIFI_IF_STA, &conf);
+  WiFi.begin();
+}
+
+void powerModeConnected()
+{
+  if (!enabled)
+    return;
+
+  setCpuFrequencyMhz(POWER_CPU_MHZ);
+  configureSleep();
+  statsStartMs = millis();
+
+  Serial.printf("Power mode: %lu MHz, frequency scaling %s, light sleep %s, worst case +%lu ms\n",
+                (unsigned long)getCpuFrequencyMhz(), scalingActive ? "on" : "off",
+                lightSleepActive ? "on" : "off", (unsigned long)powerWorstCaseAddedMs());
+}
+
+void powerWakeOnLow(uint8_t pin)
+{
+  if (wakePinCount < sizeof(wakePins))
+    wakePins[wakePinCount++] = pin;
+}
+
+void IRAM_ATTR powerRearmWakeFromISR(uint8_t pin, bool low)
+{
+  // Register write only, safe in the ISR; no-op while the pins keep their edge type
+  if (wakeArmed)
+    gpio_ll_set_intr_type(&GPIO, (gpio_num_t)pin, low ? GPIO_INTR_HIGH_LEVEL : GPIO_INTR_LOW_LEVEL);
+}
+
+bool powerModeEnabled()
+{
+  return enabled;
+}
+
+void powerIdle(unsigned long maxMs)
+{
+  if (!enabled)
+  {
+    // Not the whole way to the next deadline: nothing wakes this task when
+    // data arrives. The stream, MQTT, the local API and peer ticks are all
+    // polled, and a select() on their sockets would still miss TLS records
+    // mbedtls has already read into its buffer
+    delay(min(maxMs, LOOP_POLL_MS));
+    return;
+  }
+
+  unsigned long waitMs = min(maxMs, POWER_IDLE_SLICE_MS);
+  unsigned long startUs = micros();
+
+  // With light sleep enabled, the idle task sleeps the chip through this wait
+  if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs)) > 0)
+    earlyWakes++;
+
+  idleUs += micros() - startUs;
+  idleCount++;
+}
+
+void powerWake()
+{
+  if (loopTask)
+    xTaskNotifyGive(loopTask);
+}
+
+void IRAM_ATTR powerWakeFromISR()
+{
+  if (!loopTask)
+    return;
+
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(loopTask, &woken);
+  if (woken)
+    portYIELD_FROM_ISR();
+}
+
+uint32_t powerWorstCaseAddedMs()
+{
+  if (!enabled)
+    return 0;
+
+  // Frames wait at the AP for the next listen beacon, then for the loop to wake
+  return (uint32_t)(listenInterval * BEACON_INTERVAL_US / 1000UL) + POWER_IDLE_SLICE_MS;
+}
+
+String powerReportJson()
+{
+  unsigned long elapsedMs = millis() - statsStartMs;
+  uint32_t idlePermille = elapsedMs > 0 ? (uint32_t)min<uint64_t>(1000, idleUs / elapsedMs) : 0;
+
+  return "{\"enabled\":" + String(enabled ? "true" : "false") +
+         ",\"listen_interval\":" + String(listenInterval) +
+         ",\"cpu_mhz\":" + String(getCpuFrequencyMhz()) +
+         ",\"frequency_scaling\":" + String(scalingActive ? "true" : "false") +
+         ",\"light_sleep\":" + String(lightSleepActive ? "true" : "false") +
+         ",\"idle_permille\":" + String(idlePermille) +
+         ",\"idle_waits\":" + String(idleCount) +
+         ",\"early_wakes\":" + String(earlyWakes) +
+         ",\"worst_case_added_ms\":" + String(powerWorstCaseAddedMs()) + "}";
+}
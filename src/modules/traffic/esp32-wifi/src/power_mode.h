@@ -0,0 +1,59 @@
+#ifndef POWER_MODE_H
+#define POWER_MODE_H
+
+#include <Arduino.h>
+
+// ================= POWER-MANAGED MODE =================
+// For solar/battery units. Enabled by a non-zero listen interval (preference
+// "power_li", 1-10 beacons):
+//   - Wi-Fi max modem sleep: the radio only wakes every listen interval to
+//     pick up frames the AP buffered meanwhile, so the association and the
+//     stream stay up
+//   - CPU at 80 MHz, with dynamic frequency scaling and automatic light sleep
+//     between deadlines when the framework build supports it
+//   - the loop waits on a task notification instead of spinning, woken by its
+//     next deadline or by an input ISR (preemption, config button)
+// Stream data is only seen at the next radio wake, see powerWorstCaseAddedMs().
+
+const uint8_t POWER_MAX_LISTEN_INTERVAL = 10;
+const uint32_t POWER_CPU_MHZ = 80;
+const unsigned long LOOP_POLL_MS = 10;         // longest loop wait in normal mode
+const unsigned long POWER_IDLE_SLICE_MS = 100; // longest loop wait in power mode
+const unsigned long BEACON_INTERVAL_US = 102400; // 100 TU, the usual AP default
+
+// Reads the preference; call before powerBeginWiFi()
+void setupPowerMode();
+
+// WiFi.begin() that sets the listen interval and sleep mode in power mode.
+// A channel and BSSID (from a scan) pin the connection to one AP.
+void powerBeginWiFi(const String &ssid, const String &pass, int32_t channel = 0, const uint8_t *bssid = nullptr);
+
+// After the connection is up: CPU clock, frequency scaling and light sleep
+void powerModeConnected();
+
+// Register an active-LOW input that has to wake the chip from light sleep.
+// With light sleep on, the pin's interrupt becomes a level trigger armed for
+// the level the pin is not at, so it wakes the chip on press and on release.
+// An input with a CHANGE interrupt must call powerRearmWakeFromISR() first
+// thing in its ISR, before any early return, with the level it just read:
+// that moves the trigger to the other level, so the ISR still runs once per
+// change instead of for as long as the level holds.
+void powerWakeOnLow(uint8_t pin);
+void IRAM_ATTR powerRearmWakeFromISR(uint8_t pin, bool low);
+
+bool powerModeEnabled();
+
+// Loop wait until the next deadline, maxMs away. Capped to LOOP_POLL_MS in
+// normal mode and to the idle slice in power mode, where it also returns
+// early on powerWake()/powerWakeFromISR().
+void powerIdle(unsigned long maxMs);
+
+void powerWake();
+void IRAM_ATTR powerWakeFromISR();
+
+// Longest extra delay between data reaching the AP and the loop seeing it
+uint32_t powerWorstCaseAddedMs();
+
+String powerReportJson();
+
+#endif
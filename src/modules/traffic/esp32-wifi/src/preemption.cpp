@@ -0,0 +1,321 @@
+#include "preemption.h"
+#include "power_mode.h"
+#include "flight_recorder.h"
+#include "outbound_queue.h"
+
+LatencyStats preemptLatency;
+
+enum PreemptStep
+{
+  STEP_IDLE,           // no preemption, plan drives the lamp
+  STEP_YELLOW,         // leaving green/yellow on the way to red
+  STEP_CLEARANCE,      // red clearance before a green hold
+  STEP_HOLD,           // holding red or green until cleared
+  STEP_RESTORE_YELLOW, // leaving a held green before going back to the plan
+  STEP_RESTORE_RED     // red clearance before going back to a green plan
+};
+
+static PreemptMode activeMode = PREEMPT_NONE;
+static PreemptStep step = STEP_IDLE;
+static unsigned long stepStartMs = 0;
+static unsigned long stepDurationMs = 0;
+
+// Latest regular plan, restored when the preemption ends
+static int planColor = 0;
+static int planRemaining = 0;
+static int planStatus = 0;
+static UpdateSource planSource = SOURCE_INPUT; // board's own state until an update is deferred
+
+// Trigger-to-lamp measurement for the current request
+static bool latencyPending = false;
+static unsigned long pendingTriggerUs = 0;
+static UpdateSource pendingSource = SOURCE_CLOUD;
+
+// Hard-wired receiver input (debounced in the ISR, handled in preemptionLoop)
+static int inputMode = PREEMPT_NONE;
+static volatile bool inputAsserted = false; // level the ISR last accepted
+static volatile uint32_t inputLastUs = 0;
+static volatile bool inputChanged = false;
+static volatile unsigned long inputChangeUs = 0;
+
+static void IRAM_ATTR onPreemptInput()
+{
+  uint32_t nowUs = micros();
+  bool asserted = digitalRead(PREEMPT_PIN) == LOW;
+  powerRearmWakeFromISR(PREEMPT_PIN, asserted);
+
+  if (asserted == inputAsserted)
+    return; // bounced back before the ISR ran
+  if (nowUs - inputLastUs < PREEMPT_DEBOUNCE_US)
+    return;
+
+  inputAsserted = asserted;
+  inputLastUs = nowUs;
+  inputChangeUs = nowUs;
+  inputChanged = true;
+  powerWakeFromISR();
+}
+
+// A bounce that ends inside the debounce window leaves the ISR on the wrong
+// level; once the input has been quiet for the window, catch up with the pin
+static void settleInput()
+{
+  portDISABLE_INTERRUPTS();
+  uint32_t nowUs = micros();
+  bool asserted = digitalRead(PREEMPT_PIN) == LOW;
+  if (asserted != inputAsserted && nowUs - inputLastUs >= PREEMPT_DEBOUNCE_US)
+  {
+    inputAsserted = asserted;
+    inputLastUs = nowUs;
+    inputChangeUs = nowUs;
+    inputChanged = true;
+  }
+  portENABLE_INTERRUPTS();
+}
+
+static unsigned long yellowMs()
+{
+  return (unsigned long)max(yellowDuration, 3) * 1000UL;
+}
+
+static void enterStep(PreemptStep next, unsigned long durationMs)
+{
+  step = next;
+  stepStartMs = millis();
+  stepDurationMs = durationMs;
+}
+
+// Drive the lamp and, for the first change after a trigger, log the latency
+static void lampTo(int color)
+{
+  setLight(color);
+  outboundReportApplied();
+
+  if (latencyPending)
+  {
+    uint32_t latencyUs = micros() - pendingTriggerUs;
+    preemptLatency.add(latencyUs);
+    latencyPending = false;
+    Serial.printf("► Preemption trigger-to-lamp: %lu us [%s]\n", (unsigned long)latencyUs, sourceName(pendingSource));
+  }
+}
+
+static void showPreemptDisplay()
+{
+  static const uint8_t dashes[] = {SEG_G, SEG_G, SEG_G, SEG_G};
+  display.setSegments(dashes);
+  recordDisplay(DISPLAY_DASHES);
+}
+
+// Hand the lamp back through the common apply path, so the restored plan
+// reaches peers and the applied-state report like any other update
+static void finishRestore()
+{
+  step = STEP_IDLE;
+  applyLightField("status", planStatus, planSource);
+  applyLightField("remaintime", planRemaining, planSource);
+  applyLightField("color", planColor, planSource);
+  // The held color may already be the plan's; the dashes go either way
+  showCountdown();
+  Serial.println("► Preemption cleared, plan restored");
+}
+
+static void startRestore()
+{
+  activeMode = PREEMPT_NONE;
+
+  if (currentColor == 3 && planColor == 2)
+  {
+    // The plan is in its yellow, so green to yellow is the whole way back
+    lampTo(2);
+    finishRestore();
+  }
+  else if (currentColor == 3 && planColor != 3)
+  {
+    lampTo(2);
+    enterStep(STEP_RESTORE_YELLOW, yellowMs());
+  }
+  else if (currentColor == 2 && planColor != 2)
+  {
+    // Let a running yellow finish before handing back to the plan
+    enterStep(STEP_RESTORE_YELLOW, stepDurationMs - min(stepDurationMs, millis() - stepStartMs));
+  }
+  else
+  {
+    finishRestore();
+  }
+}
+
+// ================= PUBLIC API =================
+
+void setupPreemption()
+{
+  preferences.begin("traffic-light", true);
+  inputMode = preferences.getInt("preempt_in", PREEMPT_NONE);
+  preferences.end();
+
+  if (inputMode != PREEMPT_STOP && inputMode != PREEMPT_GREEN_HOLD)
+    return;
+
+  pinMode(PREEMPT_PIN, INPUT_PULLUP);
+  inputAsserted = digitalRead(PREEMPT_PIN) == LOW;
+  inputLastUs = micros();
+  inputChanged = inputAsserted; // asserted at boot: preempt right away
+  inputChangeUs = inputLastUs;
+  attachInterrupt(digitalPinToInterrupt(PREEMPT_PIN), onPreemptInput, CHANGE);
+  powerWakeOnLow(PREEMPT_PIN);
+  Serial.println("Preemption input enabled on GPIO " + String(PREEMPT_PIN));
+}
+
+bool preemptionActive()
+{
+  return step != STEP_IDLE;
+}
+
+void triggerPreemption(int mode, UpdateSource source, unsigned long triggerUs)
+{
+  if (mode == PREEMPT_NONE)
+  {
+    if (activeMode != PREEMPT_NONE)
+      startRestore();
+    return;
+  }
+
+  if ((mode != PREEMPT_STOP && mode != PREEMPT_GREEN_HOLD) || mode == activeMode)
+    return;
+
+  if (step == STEP_IDLE)
+  {
+    planColor = currentColor;
+    planRemaining = remainingTime;
+    planStatus = currentStatus;
+    planSource = SOURCE_INPUT;
+    // The preemption owns the lamp now, so no broken/fixing blink. Through
+    // the apply path while still idle, so the recorder, peers and the
+    // applied state see it like the restore in finishRestore()
+    applyLightField("status", 0, SOURCE_INPUT);
+  }
+
+  activeMode = (PreemptMode)mode;
+  latencyPending = true;
+  pendingTriggerUs = triggerUs;
+  pendingSource = source;
+
+  Serial.println(String("► Preemption: ") + (mode == PREEMPT_STOP ? "stop" : "green hold") +
+                 " [" + sourceName(source) + "]");
+
+  if (currentColor == 3 && mode == PREEMPT_STOP)
+  {
+    lampTo(2);
+    enterStep(STEP_YELLOW, yellowMs());
+  }
+  else if (currentColor == 3)
+  {
+    lampTo(3);
+    enterStep(STEP_HOLD, 0);
+  }
+  else if (currentColor == 2)
+  {
+    lampTo(2);
+    enterStep(STEP_YELLOW, yellowMs());
+  }
+  else if (mode == PREEMPT_STOP)
+  {
+    lampTo(1);
+    enterStep(STEP_HOLD, 0);
+  }
+  else
+  {
+    lampTo(1);
+    enterStep(STEP_CLEARANCE, yellowMs());
+  }
+
+  showPreemptDisplay();
+}
+
+void preemptionLoop()
+{
+  if (inputMode == PREEMPT_STOP || inputMode == PREEMPT_GREEN_HOLD)
+    settleInput();
+
+  if (inputChanged)
+  {
+    inputChanged = false;
+    triggerPreemption(inputAsserted ? inputMode : PREEMPT_NONE, SOURCE_INPUT, inputChangeUs);
+  }
+
+  if (step == STEP_IDLE || step == STEP_HOLD)
+    return;
+
+  if (millis() - stepStartMs < stepDurationMs)
+    return;
+
+  switch (step)
+  {
+  case STEP_YELLOW:
+    lampTo(1);
+    if (activeMode == PREEMPT_GREEN_HOLD)
+      enterStep(STEP_CLEARANCE, yellowMs());
+    else
+      enterStep(STEP_HOLD, 0);
+    break;
+
+  case STEP_CLEARANCE:
+    lampTo(3);
+    enterStep(STEP_HOLD, 0);
+    break;
+
+  case STEP_RESTORE_YELLOW:
+    // The plan may have moved on to yellow meanwhile; red only for a red or
+    // green plan, not yellow, red, yellow
+    if (planColor == 2)
+    {
+      finishRestore();
+      break;
+    }
+    lampTo(1);
+    if (planColor == 3)
+      enterStep(STEP_RESTORE_RED, yellowMs());
+    else
+      finishRestore();
+    break;
+
+  case STEP_RESTORE_RED:
+    finishRestore();
+    break;
+
+  default:
+    break;
+  }
+}
+
+bool preemptionDefer(const String &field, int value, UpdateSource source)
+{
+  if (!preemptionActive())
+    return false;
+
+  if (field == "color" || field == "remaintime" || field == "status")
+    planSource = source;
+
+  if (field == "color")
+  {
+    if (value >= 1 && value <= 3)
+      planColor = value;
+    return true;
+  }
+  if (field == "remaintime")
+  {
+    if (value >= 0 && value <= 9999)
+      planRemaining = value;
+    return true;
+  }
+  if (field == "status")
+  {
+    if (value >= 0 && value <= 2)
+      planStatus = value;
+    return true;
+  }
+
+  // yellow_duration still applies, it times the preemption sequence too
+  return false;
+}
@@ -0,0 +1,46 @@
+#ifndef PREEMPTION_H
+#define PREEMPTION_H
+
+#include <Arduino.h>
+#include "traffic_light.h"
+#include "local_api.h"
+
+// ================= EMERGENCY PREEMPTION =================
+// An emergency-vehicle preemption takes the lamp away from the regular plan:
+//   PREEMPT_STOP       - green -> yellow -> red, then hold red
+//   PREEMPT_GREEN_HOLD - red clearance -> green, then hold green
+// Plan updates (color/remaintime/status) that arrive meanwhile are recorded
+// instead of applied, and the latest plan is restored once the preemption
+// is cleared (going through yellow first when leaving a green lamp).
+
+enum PreemptMode
+{
+  PREEMPT_NONE = 0,
+  PREEMPT_STOP = 1,
+  PREEMPT_GREEN_HOLD = 2
+};
+
+// Input pin for a hard-wired preemption receiver (active LOW)
+const uint8_t PREEMPT_PIN = 27;
+
+// Edges closer than this to the last accepted edge of the input are bounce.
+// The first edge is taken at once, so debouncing adds no trigger latency.
+const uint32_t PREEMPT_DEBOUNCE_US = 20000;
+
+extern LatencyStats preemptLatency;
+
+void setupPreemption();
+
+// triggerUs is the micros() timestamp at which the request entered the firmware
+void triggerPreemption(int mode, UpdateSource source, unsigned long triggerUs);
+
+// Drives the yellow/red/green sequence; call on every loop iteration
+void preemptionLoop();
+
+bool preemptionActive();
+
+// Record a plan field while preempted. Returns true if the field was deferred.
+// The plan is restored through applyLightField() with the latest source.
+bool preemptionDefer(const String &field, int value, UpdateSource source);
+
+#endif
@@ -0,0 +1,591 @@
+#include "serial_config.h"
+#include <mbedtls/md.h>
+#include "traffic_light.h"
+#include "ota_update.h"
+#include "power_mode.h"
+#include "stream_trace.h"
+#include "vehicle_detector.h"
+#include "local_plan.h"
+#include "token_cache.h"
+
+enum SettingType
+{
+  SETTING_TEXT,
+  SETTING_SSID,   // text, non-ASCII replaced like the portal does
+  SETTING_SECRET, // text, masked in "show"
+  SETTING_CHAR,
+  SETTING_UCHAR,
+  SETTING_USHORT,
+  SETTING_INT,
+  SETTING_UINT
+};
+
+struct Setting
+{
+  const char *key;
+  SettingType type;
+  long minValue;
+  long maxValue;
+};
+
+// Types match the getX() calls that read them back; NVS does not convert
+static const Setting settings[] = {
+    {"ssid", SETTING_SSID, 0, 0},
+    {"pass", SETTING_SECRET, 0, 0},
+    {"ssid2", SETTING_SSID, 0, 0},
+    {"pass2", SETTING_SECRET, 0, 0},
+    {"ssid3", SETTING_SSID, 0, 0},
+    {"pass3", SETTING_SECRET, 0, 0},
+    {"wifi_roam", SETTING_UCHAR, 0, 1},
+    {"team", SETTING_TEXT, 0, 0},
+    {"lightid", SETTING_TEXT, 0, 0},
+    {"fb_key", SETTING_SECRET, 0, 0},
+    {"fb_url", SETTING_TEXT, 0, 0},
+    {"fb_email", SETTING_TEXT, 0, 0},
+    {"fb_pass", SETTING_SECRET, 0, 0},
+    {"local_key", SETTING_SECRET, 0, 0},
+    {"preempt_in", SETTING_INT, 0, 2},
+    {"peer_group", SETTING_UINT, 0, 65535},
+    {"peer_phase", SETTING_UCHAR, 0, 1},
+    {"peer_key", SETTING_SECRET, 0, 0},
+    {"ota_url", SETTING_TEXT, 0, 0},
+    {"power_li", SETTING_UCHAR, 0, POWER_MAX_LISTEN_INTERVAL},
+    {"mqtt_host", SETTING_TEXT, 0, 0},
+    {"mqtt_user", SETTING_TEXT, 0, 0},
+    {"mqtt_pass", SETTING_SECRET, 0, 0},
+    {"trace_kb", SETTING_USHORT, 0, STREAM_TRACE_MAX_KB},
+    {"det_lanes", SETTING_UCHAR, 0, DETECTOR_MAX_LANES},
+    {"ped_button", SETTING_UCHAR, 0, 1},
+    {"plan_mode", SETTING_UCHAR, 0, PLAN_COUNTS},
+    {"plan_tz", SETTING_CHAR, -12, 14},
+};
+
+const size_t SETTING_COUNT = sizeof(settings) / sizeof(settings[0]);
+const size_t SERIAL_LINE_MAX = 2048; // a whole signed profile
+
+// The pending profile lives in its own namespace, so clearing the settings
+// while it is applied leaves it in place
+static const char *PROFILE_NAMESPACE = "provision";
+static const char *PROFILE_KEY = "pending";
+
+static const Setting *findSetting(const String &key)
+{
+  for (size_t i = 0; i < SETTING_COUNT; i++)
+  {
+    if (key == settings[i].key)
+      return &settings[i];
+  }
+  return nullptr;
+}
+
+static bool isText(const Setting &setting)
+{
+  return setting.type == SETTING_TEXT || setting.type == SETTING_SSID || setting.type == SETTING_SECRET;
+}
+
+// Writes into the open "traffic-light" namespace
+static void writeSetting(const Setting &setting, const String &value, long number)
+{
+  switch (setting.type)
+  {
+  case SETTING_TEXT:
+  case SETTING_SECRET:
+    preferences.putString(setting.key, value);
+    break;
+  case SETTING_SSID:
+    preferences.putString(setting.key, sanitizeASCII(value));
+    break;
+  case SETTING_CHAR:
+    preferences.putChar(setting.key, (int8_t)number);
+    break;
+  case SETTING_UCHAR:
+    preferences.putUChar(setting.key, (uint8_t)number);
+    break;
+  case SETTING_USHORT:
+    preferences.putUShort(setting.key, (uint16_t)number);
+    break;
+  case SETTING_INT:
+    preferences.putInt(setting.key, (int32_t)number);
+    break;
+  case SETTING_UINT:
+    preferences.putUInt(setting.key, (uint32_t)number);
+    break;
+  }
+}
+
+static void storeSetting(const Setting &setting, const String &value)
+{
+  long number = constrain(value.toInt(), setting.minValue, setting.maxValue);
+
+  preferences.begin("traffic-light", false);
+  writeSetting(setting, value, number);
+  preferences.end();
+
+  if (isText(setting))
+    Serial.printf("%s set (%u chars)\n", setting.key, value.length());
+  else
+    Serial.printf("%s = %ld\n", setting.key, number);
+}
+
+static void showSettings()
+{
+  preferences.begin("traffic-light", true);
+  for (size_t i = 0; i < SETTING_COUNT; i++)
+  {
+    const Setting &setting = settings[i];
+    if (!preferences.isKey(setting.key))
+    {
+      Serial.printf("  %-10s -\n", setting.key);
+      continue;
+    }
+
+    String value;
+    switch (setting.type)
+    {
+    case SETTING_TEXT:
+    case SETTING_SSID:
+      value = preferences.getString(setting.key, "");
+      break;
+    case SETTING_SECRET:
+      value = preferences.getString(setting.key, "").length() ? "***" : "";
+      break;
+    case SETTING_CHAR:
+      value = String(preferences.getChar(setting.key, 0));
+      break;
+    case SETTING_UCHAR:
+      value = String(preferences.getUChar(setting.key, 0));
+      break;
+    case SETTING_USHORT:
+      value = String(preferences.getUShort(setting.key, 0));
+      break;
+    case SETTING_INT:
+      value = String(preferences.getInt(setting.key, 0));
+      break;
+    case SETTING_UINT:
+      value = String(preferences.getUInt(setting.key, 0));
+      break;
+    }
+    Serial.printf("  %-10s %s\n", setting.key, value.c_str());
+  }
+  preferences.end();
+}
+
+// ================= SIGNED PROFILE =================
+
+struct ProfileField
+{
+  String key;
+  String value;
+  bool isString;
+};
+
+const size_t PROFILE_MAX_FIELDS = SETTING_COUNT + 1; // + "mac"
+
+static void skipSpace(const String &json, size_t &pos)
+{
+  while (pos < json.length() && isspace((unsigned char)json[pos]))
+    pos++;
+}
+
+static void appendUtf8(String &out, uint32_t code)
+{
+  if (code < 0x80)
+  {
+    out += (char)code;
+  }
+  else if (code < 0x800)
+  {
+    out += (char)(0xC0 | (code >> 6));
+    out += (char)(0x80 | (code & 0x3F));
+  }
+  else
+  {
+    out += (char)(0xE0 | (code >> 12));
+    out += (char)(0x80 | ((code >> 6) & 0x3F));
+    out += (char)(0x80 | (code & 0x3F));
+  }
+}
+
+static bool readJsonString(const String &json, size_t &pos, String &out)
+{
+  if (pos >= json.length() || json[pos] != '"')
+    return false;
+  pos++;
+
+  out = "";
+  while (pos < json.length())
+  {
+    char c = json[pos++];
+    if (c == '"')
+      return true;
+    if (c != '\\')
+    {
+      out += c;
+      continue;
+    }
+    if (pos >= json.length())
+      return false;
+
+    char e = json[pos++];
+    switch (e)
+    {
+    case '"':
+    case '\\':
+    case '/':
+      out += e;
+      break;
+    case 'n':
+      out += '\n';
+      break;
+    case 't':
+      out += '\t';
+      break;
+    case 'r':
+      out += '\r';
+      break;
+    case 'u':
+    {
+      if (pos + 4 > json.length())
+        return false;
+      char *end;
+      String hex = json.substring(pos, pos + 4);
+      uint32_t code = strtoul(hex.c_str(), &end, 16);
+      if (*end != '\0')
+        return false;
+      appendUtf8(out, code);
+      pos += 4;
+      break;
+    }
+    default:
+      return false;
+    }
+  }
+  return false;
+}
+
+// A flat object of string and integer values, which is all a profile is
+static bool parseProfile(const String &json, ProfileField *fields, size_t &count)
+{
+  size_t pos = 0;
+  count = 0;
+
+  skipSpace(json, pos);
+  if (pos >= json.length() || json[pos++] != '{')
+    return false;
+  skipSpace(json, pos);
+  if (pos < json.length() && json[pos] == '}')
+    return ++pos == json.length();
+
+  while (count < PROFILE_MAX_FIELDS)
+  {
+    ProfileField &field = fields[count++];
+    skipSpace(json, pos);
+    if (!readJsonString(json, pos, field.key))
+      return false;
+    skipSpace(json, pos);
+    if (pos >= json.length() || json[pos++] != ':')
+      return false;
+    skipSpace(json, pos);
+
+    field.isString = pos < json.length() && json[pos] == '"';
+    if (field.isString)
+    {
+      if (!readJsonString(json, pos, field.value))
+        return false;
+    }
+    else
+    {
+      size_t start = pos;
+      if (pos < json.length() && json[pos] == '-')
+        pos++;
+      while (pos < json.length() && isdigit((unsigned char)json[pos]))
+        pos++;
+      if (pos == start || (pos == start + 1 && json[start] == '-'))
+        return false;
+      field.value = json.substring(start, pos);
+    }
+
+    skipSpace(json, pos);
+    if (pos >= json.length())
+      return false;
+    char next = json[pos++];
+    if (next == '}')
+    {
+      skipSpace(json, pos);
+      return pos == json.length();
+    }
+    if (next != ',')
+      return false;
+  }
+  return false; // more fields than there are settings
+}
+
+static String boardMac()
+{
+  uint64_t mac = ESP.getEfuseMac();
+  char text[18];
+  snprintf(text, sizeof(text), "%02x:%02x:%02x:%02x:%02x:%02x", (unsigned)(mac & 0xFF),
+           (unsigned)((mac >> 8) & 0xFF), (unsigned)((mac >> 16) & 0xFF), (unsigned)((mac >> 24) & 0xFF),
+           (unsigned)((mac >> 32) & 0xFF), (unsigned)((mac >> 40) & 0xFF));
+  return String(text);
+}
+
+static bool hasField(const ProfileField *fields, size_t count, const char *key)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    if (fields[i].key == key && fields[i].value.length() > 0)
+      return true;
+  }
+  return false;
+}
+
+// Empty when the profile can be applied, else why not
+static String checkProfile(const ProfileField *fields, size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    const ProfileField &field = fields[i];
+    for (size_t j = 0; j < i; j++)
+    {
+      if (fields[j].key == field.key)
+        return "duplicate " + field.key;
+    }
+
+    if (field.key == "mac")
+    {
+      if (!field.isString || !field.value.equalsIgnoreCase(boardMac()))
+        return "profile is for board " + field.value;
+      continue;
+    }
+
+    const Setting *setting = findSetting(field.key);
+    if (!setting)
+      return "unknown key " + field.key;
+    if (isText(*setting) != field.isString)
+      return "wrong type for " + field.key;
+    if (!isText(*setting))
+    {
+      long number = field.value.toInt();
+      if (number < setting->minValue || number > setting->maxValue)
+        return "out of range: " + field.key;
+    }
+  }
+
+  static const char *const required[] = {"ssid", "team", "lightid"};
+  for (const char *key : required)
+  {
+    if (!hasField(fields, count, key))
+      return String("missing ") + key;
+  }
+
+  bool firebase = hasField(fields, count, "fb_key") && hasField(fields, count, "fb_url") &&
+                  hasField(fields, count, "fb_email") && hasField(fields, count, "fb_pass");
+  if (!firebase && !hasField(fields, count, "mqtt_host"))
+    return "missing backend (fb_key/fb_url/fb_email/fb_pass or mqtt_host)";
+  return "";
+}
+
+bool hmacMatches(const char *key, size_t keyLen, const uint8_t *data, size_t len, const String &signature)
+{
+  uint8_t mac[32];
+  mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), (const uint8_t *)key, keyLen, data, len, mac);
+
+  if (signature.length() != sizeof(mac) * 2)
+    return false;
+
+  // Constant-time, like the local API key check
+  static const char hexDigits[] = "0123456789abcdef";
+  uint8_t diff = 0;
+  for (size_t i = 0; i < sizeof(mac); i++)
+  {
+    diff |= (uint8_t)tolower(signature[2 * i]) ^ (uint8_t)hexDigits[mac[i] >> 4];
+    diff |= (uint8_t)tolower(signature[2 * i + 1]) ^ (uint8_t)hexDigits[mac[i] & 0x0F];
+  }
+  return diff == 0;
+}
+
+static bool signatureMatches(const String &json, const String &signature)
+{
+#ifdef PROVISION_KEY
+  static const char key[] = PROVISION_KEY;
+  return hmacMatches(key, sizeof(key) - 1, (const uint8_t *)json.c_str(), json.length(), signature);
+#else
+  (void)json;
+  (void)signature;
+  return false;
+#endif
+}
+
+// "profile <json> <hmac>": check, store as one NVS entry, acknowledge and
+// restart. The settings are only written at the next boot.
+static void receiveProfile(const String &message)
+{
+#ifndef PROVISION_KEY
+  Serial.println("ERR no provisioning key in this build");
+  return;
+#endif
+
+  int split = message.lastIndexOf(' ');
+  if (split < 0)
+  {
+    Serial.println("ERR expected: profile <json> <hmac>");
+    return;
+  }
+  String json = message.substring(0, split);
+  String signature = message.substring(split + 1);
+  json.trim();
+
+  if (!signatureMatches(json, signature))
+  {
+    Serial.println("ERR bad signature");
+    return;
+  }
+
+  ProfileField fields[PROFILE_MAX_FIELDS];
+  size_t count = 0;
+  if (!parseProfile(json, fields, count))
+  {
+    Serial.println("ERR malformed profile");
+    return;
+  }
+  String problem = checkProfile(fields, count);
+  if (problem.length() > 0)
+  {
+    Serial.println("ERR " + problem);
+    return;
+  }
+
+  preferences.begin(PROFILE_NAMESPACE, false);
+  bool stored = preferences.putString(PROFILE_KEY, json) == json.length();
+  preferences.end();
+  if (!stored)
+  {
+    Serial.println("ERR could not store profile");
+    return;
+  }
+
+  Serial.println("OK " + signature.substring(0, 8) + " " + String((unsigned)count) + " settings, restarting");
+  Serial.flush();
+  delay(100);
+  ESP.restart();
+}
+
+static void printHelp()
+{
+  Serial.println("Serial config: set <key> <value> | show | reset | restart | id | profile <json> <hmac>");
+  String keys = "Keys:";
+  for (size_t i = 0; i < SETTING_COUNT; i++)
+    keys += String(" ") + settings[i].key;
+  Serial.println(keys);
+}
+
+static void runCommand(const String &line)
+{
+  if (line.startsWith("set "))
+  {
+    String rest = line.substring(4);
+    int space = rest.indexOf(' ');
+    String key = space < 0 ? rest : rest.substring(0, space);
+    String value = space < 0 ? String("") : rest.substring(space + 1);
+
+    const Setting *setting = findSetting(key);
+    if (setting)
+      storeSetting(*setting, value);
+    else
+      Serial.println("Unknown key: " + key);
+  }
+  else if (line == "show")
+  {
+    showSettings();
+  }
+  else if (line == "id")
+  {
+    Serial.println("ID " + boardMac() + " " + FIRMWARE_VERSION + " " + BUILD_VARIANT);
+  }
+  else if (line.startsWith("profile "))
+  {
+    receiveProfile(line.substring(8));
+  }
+  else if (line == "reset")
+  {
+    preferences.begin("traffic-light", false);
+    preferences.clear();
+    preferences.end();
+    tokenCacheClear();
+    Serial.println("Settings cleared");
+  }
+  else if (line == "restart")
+  {
+    Serial.println("Restarting...");
+    delay(100);
+    ESP.restart();
+  }
+  else if (line.length() > 0)
+  {
+    printHelp();
+  }
+}
+
+// ================= PUBLIC API =================
+
+void applyPendingProfile()
+{
+  preferences.begin(PROFILE_NAMESPACE, true);
+  String json = preferences.isKey(PROFILE_KEY) ? preferences.getString(PROFILE_KEY, "") : String("");
+  preferences.end();
+  if (json.length() == 0)
+    return;
+
+  // Checked before it was stored; parsed again only to write it out
+  ProfileField fields[PROFILE_MAX_FIELDS];
+  size_t count = 0;
+  if (parseProfile(json, fields, count))
+  {
+    preferences.begin("traffic-light", false);
+    preferences.clear();
+    for (size_t i = 0; i < count; i++)
+    {
+      const Setting *setting = findSetting(fields[i].key);
+      if (setting)
+        writeSetting(*setting, fields[i].value, fields[i].value.toInt());
+    }
+    preferences.end();
+    Serial.printf("Provisioning: profile applied (%u settings)\n", (unsigned)count);
+  }
+  else
+  {
+    Serial.println("Provisioning: stored profile unreadable, dropped");
+  }
+
+  // Only now: a reset before this point applies the whole profile again
+  preferences.begin(PROFILE_NAMESPACE, false);
+  preferences.remove(PROFILE_KEY);
+  preferences.end();
+}
+
+void startSerialConfig()
+{
+  printHelp();
+}
+
+void serialConfigLoop()
+{
+  static String line;
+
+  while (Serial.available())
+  {
+    char c = Serial.read();
+    if (c != '\n' && c != '\r')
+    {
+      if (line.length() < SERIAL_LINE_MAX)
+        line += c;
+      continue;
+    }
+
+    // Only surrounding whitespace is trimmed; a value keeps its inner spaces
+    line.trim();
+    runCommand(line);
+    line = "";
+  }
+}
@@ -0,0 +1,41 @@
+#ifndef SERIAL_CONFIG_H
+#define SERIAL_CONFIG_H
+
+#include <Arduino.h>
+
+// ================= SERIAL CONFIG =================
+// Config mode over the USB serial port (115200 baud), for images built
+// without the config portal and for cabinets with no phone at hand. Same
+// preference keys and limits as the portal form:
+//   set <key> <value>   store one setting ("set pass" with no value clears it)
+//   show                list the settings, secrets masked
+//   reset               clear all settings
+//   restart             leave config mode
+//   id                  "ID <mac> <firmware version> <full|lean>"
+//   profile <json> <hmac>
+// A value is stored as soon as it is set.
+//
+// A profile is the complete configuration in one line, for provisioning in
+// bulk (tools/provision.py): a flat JSON object of setting keys, plus an
+// optional "mac" that binds it to one board, signed with HMAC-SHA256 (hex)
+// under the fleet key the image was built with (-D PROVISION_KEY=\"...\").
+// ssid, team, lightid and a backend (the four fb_* keys, or mqtt_host) are
+// required. The board checks it, stores it as a single NVS entry, answers
+// "OK <first 8 hex of the hmac> ..." (or "ERR <reason>") and restarts.
+// applyPendingProfile() then replaces all settings with it and deletes it
+// last, so a reset halfway through applies it again from the start.
+
+// Replace the settings with a stored profile, if there is one; call before
+// the settings are read
+void applyPendingProfile();
+
+void startSerialConfig();
+
+// HMAC-SHA256 of data under key against a hex signature, in constant time.
+// Also checks the signed OTA manifest (ota_update.cpp).
+bool hmacMatches(const char *key, size_t keyLen, const uint8_t *data, size_t len, const String &signature);
+
+// Reads and runs commands; call from loop() in config mode
+void serialConfigLoop();
+
+#endif
@@ -0,0 +1,231 @@
+#include "stream_trace.h"
+#include <LittleFS.h>
+#include "StreamTrace.h"
+#include "traffic_light.h"
+
+static uint16_t ringBlocks = 0; // 0 = tracing off
+static uint16_t sizeKb = 0;
+
+// Two RAM blocks: one takes records while the other, once sealed, waits
+// for the flush job
+static TraceBlockWriter buffers[2];
+static bool sealed[2] = {false, false};
+static int current = 0;
+static bool dirty = false;
+static uint32_t nextSeq = 0;
+
+static uint32_t recorded = 0;
+static uint32_t dropped = 0;
+static uint32_t flushes = 0;
+static uint32_t lastFlushUs = 0;
+static uint32_t maxFlushUs = 0;
+
+static bool writeBlock(const TraceBlockWriter &block)
+{
+  File file = LittleFS.open(STREAM_TRACE_FILE, "r+");
+  if (!file)
+    return false;
+
+  bool ok = file.seek((block.seq() % ringBlocks) * TRACE_BLOCK_SIZE) &&
+            file.write(block.bytes(), TRACE_BLOCK_SIZE) == TRACE_BLOCK_SIZE;
+  file.close();
+  return ok;
+}
+
+// Fresh ring file of zeroed blocks
+static bool createRing()
+{
+  LittleFS.remove(STREAM_TRACE_FILE);
+  File file = LittleFS.open(STREAM_TRACE_FILE, "w");
+  if (!file)
+    return false;
+
+  static const uint8_t zero[256] = {};
+  bool ok = true;
+  for (size_t i = 0; ok && i < (size_t)ringBlocks * TRACE_BLOCK_SIZE; i += sizeof(zero))
+    ok = file.write(zero, sizeof(zero)) == sizeof(zero);
+  file.close();
+  return ok;
+}
+
+// Continue after the newest block of an existing ring of the same size
+static bool resumeRing(uint32_t &lastSeq)
+{
+  if (!LittleFS.exists(STREAM_TRACE_FILE))
+    return false;
+
+  File file = LittleFS.open(STREAM_TRACE_FILE, "r");
+  if (!file)
+    return false;
+  if (file.size() != (size_t)ringBlocks * TRACE_BLOCK_SIZE)
+  {
+    file.close();
+    return false;
+  }
+
+  bool found = false;
+  uint8_t header[TRACE_BLOCK_HEADER];
+  for (uint16_t i = 0; i < ringBlocks; i++)
+  {
+    uint32_t seq;
+    uint16_t flags;
+    if (!file.seek(i * TRACE_BLOCK_SIZE) || file.read(header, sizeof(header)) != sizeof(header))
+      break;
+    if (readTraceBlockHeader(header, seq, flags) && (!found || seq > lastSeq))
+    {
+      lastSeq = seq;
+      found = true;
+    }
+  }
+  file.close();
+  return true;
+}
+
+// ================= PUBLIC API =================
+
+void setupStreamTrace()
+{
+  preferences.begin("traffic-light", true);
+  sizeKb = min(preferences.getUShort("trace_kb", 0), STREAM_TRACE_MAX_KB);
+  preferences.end();
+
+  if (sizeKb == 0)
+    return;
+
+  if (!LittleFS.begin(true))
+  {
+    Serial.println("Stream trace disabled (LittleFS mount failed)");
+    return;
+  }
+
+  ringBlocks = max((uint16_t)2, (uint16_t)(sizeKb * 1024UL / TRACE_BLOCK_SIZE));
+
+  uint32_t lastSeq = 0;
+  bool resumed = resumeRing(lastSeq);
+  if (!resumed)
+  {
+    size_t freeBytes = LittleFS.totalBytes() - LittleFS.usedBytes();
+    if (freeBytes < (size_t)ringBlocks * TRACE_BLOCK_SIZE || !createRing())
+    {
+      Serial.printf("Stream trace disabled (%u KB does not fit on LittleFS)\n", sizeKb);
+      ringBlocks = 0;
+      return;
+    }
+  }
+
+  // A new boot always starts a new block, flagged so a replay resets its state
+  nextSeq = resumed ? lastSeq + 1 : 0;
+  current = 0;
+  buffers[0].begin(nextSeq++, TRACE_BLOCK_BOOT);
+  Serial.printf("Stream trace: %u KB ring in %s (%u blocks, from block %lu)\n", sizeKb,
+                STREAM_TRACE_FILE, ringBlocks, (unsigned long)buffers[0].seq());
+}
+
+bool streamTraceEnabled()
+{
+  return ringBlocks > 0;
+}
+
+void traceStreamEvent(const String &event, const String &path, const String &data)
+{
+  if (ringBlocks == 0)
+    return;
+
+  uint32_t atMs = millis();
+  if (buffers[current].append(atMs, event.c_str(), event.length(), path.c_str(), path.length(),
+                              data.c_str(), data.length()))
+  {
+    recorded++;
+    dirty = true;
+    return;
+  }
+
+  // Block full: seal it for the flush job and go on in the other one
+  int other = 1 - current;
+  if (sealed[other])
+  {
+    dropped++;
+    return;
+  }
+
+  sealed[current] = true;
+  current = other;
+  buffers[current].begin(nextSeq++);
+
+  if (buffers[current].append(atMs, event.c_str(), event.length(), path.c_str(), path.length(),
+                              data.c_str(), data.length()))
+  {
+    recorded++;
+    dirty = true;
+  }
+  else
+  {
+    dropped++;
+  }
+}
+
+void streamTraceFlush()
+{
+  if (ringBlocks == 0)
+    return;
+
+  unsigned long startUs = micros();
+  bool wrote = false;
+
+  // The sealed block is always the older one
+  int other = 1 - current;
+  if (sealed[other])
+  {
+    if (!writeBlock(buffers[other]))
+      Serial.println("Stream trace: block write failed");
+    sealed[other] = false;
+    wrote = true;
+  }
+
+  // The open block is rewritten in place until it fills up
+  if (dirty)
+  {
+    writeBlock(buffers[current]);
+    dirty = false;
+    wrote = true;
+  }
+
+  if (!wrote)
+    return;
+
+  flushes++;
+  lastFlushUs = micros() - startUs;
+  if (lastFlushUs > maxFlushUs)
+    maxFlushUs = lastFlushUs;
+}
+
+void streamTraceClear()
+{
+  if (ringBlocks == 0)
+    return;
+
+  createRing();
+  sealed[0] = sealed[1] = false;
+  dirty = false;
+  current = 0;
+  nextSeq = 0;
+  buffers[0].begin(nextSeq++);
+  recorded = 0;
+  dropped = 0;
+}
+
+String streamTraceReportJson()
+{
+  if (ringBlocks == 0)
+    return "{\"enabled\":false}";
+
+  return "{\"enabled\":true,\"file\":\"" + String(STREAM_TRACE_FILE) +
+         "\",\"size_kb\":" + String(sizeKb) +
+         ",\"blocks\":" + String(ringBlocks) +
+         ",\"block\":" + String(buffers[current].seq()) +
+         ",\"recorded\":" + String(recorded) +
+         ",\"dropped\":" + String(dropped) +
+         ",\"flushes\":" + String(flushes) +
+         ",\"last_flush_us\":" + String(lastFlushUs) +
+         ",\"max_flush_us\":" + String(maxFlushUs) + "}";
+}
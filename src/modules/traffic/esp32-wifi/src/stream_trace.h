@@ -0,0 +1,38 @@
+#ifndef STREAM_TRACE_H
+#define STREAM_TRACE_H
+
+#include <Arduino.h>
+
+// ================= STREAM TRACE =================
+// Records every stream event (put, patch, keep-alive, cancel, auth_revoked)
+// with its arrival time into a ring file on LittleFS, for replay on a host
+// with tools/trace_replay.cpp. Enabled by a non-zero size in the preference
+// "trace_kb".
+//
+// Records collect in RAM blocks (lib/TrafficCore/StreamTrace.h) and only the
+// flush job writes them to flash, so the stream callback never waits on a
+// flash write. Events that arrive while both RAM blocks wait for the flush
+// are dropped and counted.
+
+const char *const STREAM_TRACE_FILE = "/stream.trc";
+const uint16_t STREAM_TRACE_MAX_KB = 512;
+const unsigned long STREAM_TRACE_FLUSH_MS = 2000;
+
+// Reads the preference and opens (or creates) the ring file. Call before
+// the transport starts so the first full-object put is recorded too.
+void setupStreamTrace();
+
+bool streamTraceEnabled();
+
+// Record one stream event; cheap enough for the stream callback
+void traceStreamEvent(const String &event, const String &path, const String &data);
+
+// Write pending blocks to the ring file (scheduler job)
+void streamTraceFlush();
+
+// Zero the ring file and start over
+void streamTraceClear();
+
+String streamTraceReportJson();
+
+#endif
@@ -0,0 +1,213 @@
+#include "token_cache.h"
+#include <time.h>
+#include <sys/time.h>
+#include <mbedtls/md.h>
+#include "traffic_light.h"
+
+#ifdef CONFIG_NVS_ENCRYPTION
+#include <nvs_flash.h>
+#include <esp_partition.h>
+#include <esp_flash_encrypt.h>
+#endif
+
+static const char *PREF_NAMESPACE = "tok_cache";
+static const char *PREF_KEY = "entry";
+static const char *LEGACY_KEY = "tok_cache"; // v1, in "traffic-light", AES keyed from the MAC
+static const uint8_t CACHE_VERSION = 2;
+static const size_t BINDING_LEN = 32;
+static const size_t HEADER_LEN = 1 + 4 + 2 + 2 + BINDING_LEN; // version, expiresAt, idLen, refreshLen, binding
+static const size_t MAX_CACHE_LEN = 4000;
+
+// Anything before this is an unset clock (2023-11-14)
+static const time_t CLOCK_VALID_AFTER = 1700000000;
+
+static Preferences tokenPrefs;
+static bool storeTried = false;
+static bool storeReady = false;
+
+// The cache only lives in its own NVS partition, encrypted with keys from a
+// flash-encrypted nvs_keys partition. Anywhere else a flash dump hands over
+// the tokens, so without that the cache stays off.
+static bool openStore()
+{
+  if (storeTried)
+    return storeReady;
+  storeTried = true;
+
+  // Drop what the v1 cache left behind, whatever happens next
+  preferences.begin("traffic-light", false);
+  preferences.remove(LEGACY_KEY);
+  preferences.end();
+
+#ifdef CONFIG_NVS_ENCRYPTION
+  if (!esp_flash_encryption_enabled())
+  {
+    Serial.println("Token cache off: flash encryption is not enabled");
+    return false;
+  }
+
+  const esp_partition_t *keys =
+      esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_NVS_KEYS, nullptr);
+  if (!keys)
+  {
+    Serial.println("Token cache off: no nvs_keys partition");
+    return false;
+  }
+
+  // The keys are generated on the board the first time and never leave it
+  nvs_sec_cfg_t cfg;
+  esp_err_t err = nvs_flash_read_security_cfg(keys, &cfg);
+  if (err == ESP_ERR_NVS_KEYS_NOT_INITIALIZED)
+    err = nvs_flash_generate_keys(keys, &cfg);
+  if (err == ESP_OK)
+    err = nvs_flash_secure_init_partition(TOKEN_CACHE_PARTITION, &cfg);
+  memset(&cfg, 0, sizeof(cfg));
+  if (err != ESP_OK)
+  {
+    Serial.printf("Token cache off: encrypted NVS failed (%s)\n", esp_err_to_name(err));
+    return false;
+  }
+
+  storeReady = true;
+  return true;
+#else
+  Serial.println("Token cache off: built without NVS encryption");
+  return false;
+#endif
+}
+
+// The entry is only used for the same API key and account
+static void bindingHash(const String &apiKey, const String &email, uint8_t out[BINDING_LEN])
+{
+  String binding = apiKey + "\n" + email;
+  mbedtls_md(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), (const uint8_t *)binding.c_str(), binding.length(), out);
+}
+
+// ================= CLOCK =================
+
+void setupClock()
+{
+  configTime(0, 0, "pool.ntp.org", "time.google.com");
+}
+
+bool clockValid()
+{
+  return time(nullptr) > CLOCK_VALID_AFTER;
+}
+
+uint64_t wallClockMs()
+{
+  if (!clockValid())
+    return 0;
+
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+// ================= CACHE =================
+
+bool tokenCacheLoad(const String &apiKey, const String &email, String &idToken, String &refreshToken,
+                    uint32_t &remainingS)
+{
+  if (!openStore())
+    return false;
+
+  tokenPrefs.begin(PREF_NAMESPACE, true, TOKEN_CACHE_PARTITION);
+  size_t len = tokenPrefs.getBytesLength(PREF_KEY);
+  if (len <= HEADER_LEN || len > MAX_CACHE_LEN)
+  {
+    tokenPrefs.end();
+    return false;
+  }
+
+  uint8_t *blob = (uint8_t *)malloc(len + 1);
+  if (!blob)
+  {
+    tokenPrefs.end();
+    return false;
+  }
+  tokenPrefs.getBytes(PREF_KEY, blob, len);
+  tokenPrefs.end();
+
+  // A cold boot has no time until SNTP answers, give it a moment
+  unsigned long waitStart = millis();
+  while (!clockValid() && millis() - waitStart < TOKEN_CLOCK_WAIT_MS)
+    delay(20);
+
+  uint8_t binding[BINDING_LEN];
+  bindingHash(apiKey, email, binding);
+
+  uint32_t expiresAt = (uint32_t)blob[1] | ((uint32_t)blob[2] << 8) | ((uint32_t)blob[3] << 16) |
+                       ((uint32_t)blob[4] << 24);
+  size_t idLen = blob[5] | (blob[6] << 8);
+  size_t refreshLen = blob[7] | (blob[8] << 8);
+  time_t now = time(nullptr);
+
+  bool ok = blob[0] == CACHE_VERSION && clockValid() && memcmp(blob + 9, binding, BINDING_LEN) == 0 &&
+            HEADER_LEN + idLen + refreshLen == len && idLen > 0 &&
+            (time_t)expiresAt > now + (time_t)TOKEN_CACHE_MIN_TTL_S;
+  if (ok)
+  {
+    remainingS = expiresAt - now;
+
+    // Terminate each token in place to copy it into a String
+    char *id = (char *)blob + HEADER_LEN;
+    char *refresh = id + idLen;
+    char first = refresh[0];
+    refresh[0] = '\0';
+    idToken = String(id);
+    refresh[0] = first;
+    blob[len] = '\0';
+    refreshToken = String(refresh);
+  }
+
+  memset(blob, 0, len + 1);
+  free(blob);
+  return ok;
+}
+
+bool tokenCacheStore(const String &apiKey, const String &email, const String &idToken,
+                     const String &refreshToken, uint32_t ttlS)
+{
+  if (!clockValid() || idToken.length() == 0 || !openStore())
+    return false;
+
+  size_t len = HEADER_LEN + idToken.length() + refreshToken.length();
+  if (len > MAX_CACHE_LEN)
+    return false;
+
+  uint8_t *blob = (uint8_t *)malloc(len);
+  if (!blob)
+    return false;
+
+  uint32_t expiresAt = (uint32_t)time(nullptr) + ttlS;
+  blob[0] = CACHE_VERSION;
+  for (int i = 0; i < 4; i++)
+    blob[1 + i] = (expiresAt >> (8 * i)) & 0xFF;
+  blob[5] = idToken.length() & 0xFF;
+  blob[6] = idToken.length() >> 8;
+  blob[7] = refreshToken.length() & 0xFF;
+  blob[8] = refreshToken.length() >> 8;
+  bindingHash(apiKey, email, blob + 9);
+  memcpy(blob + HEADER_LEN, idToken.c_str(), idToken.length());
+  memcpy(blob + HEADER_LEN + idToken.length(), refreshToken.c_str(), refreshToken.length());
+
+  tokenPrefs.begin(PREF_NAMESPACE, false, TOKEN_CACHE_PARTITION);
+  bool ok = tokenPrefs.putBytes(PREF_KEY, blob, len) == len;
+  tokenPrefs.end();
+
+  memset(blob, 0, len);
+  free(blob);
+  return ok;
+}
+
+void tokenCacheClear()
+{
+  if (!openStore())
+    return;
+
+  tokenPrefs.begin(PREF_NAMESPACE, false, TOKEN_CACHE_PARTITION);
+  tokenPrefs.remove(PREF_KEY);
+  tokenPrefs.end();
+}
@@ -0,0 +1,55 @@
+#ifndef TOKEN_CACHE_H
+#define TOKEN_CACHE_H
+
+#include <Arduino.h>
+
+// ================= TOKEN CACHE =================
+// Keeps the Firebase ID and refresh tokens in NVS, together with the
+// wall-clock time the ID token expires. After a reset, startFirebase()
+// reuses a token that is still valid through IDToken instead of signing in
+// again with email and password. That takes a full sign-in round trip off
+// the path to the first correct lamp.
+//
+// The entry lives in its own NVS partition (TOKEN_CACHE_PARTITION),
+// encrypted by NVS with keys the board generates into a flash-encrypted
+// nvs_keys partition. A flash dump therefore shows neither the tokens nor
+// the keys. That needs flash encryption on the chip and a build with
+// CONFIG_NVS_ENCRYPTION. Without either, the cache stays off and every boot
+// signs in. A hash of the API key and account is stored with the entry, so
+// a changed account never reuses an old token.
+//
+// Expiry is checked against wall-clock time. The RTC keeps it across soft
+// resets, and SNTP sets it after a power cycle.
+
+// NVS partition for the cache (partitions_tokens.csv)
+const char TOKEN_CACHE_PARTITION[] = "tok_nvs";
+
+// Minimum lifetime a cached token needs left to be worth reusing
+const uint32_t TOKEN_CACHE_MIN_TTL_S = 120;
+
+// Longest boot wait for SNTP when the clock is not set yet
+const unsigned long TOKEN_CLOCK_WAIT_MS = 1500;
+
+// Start SNTP (non-blocking); call once WiFi is up
+void setupClock();
+
+// Wall-clock time is set (RTC kept it or SNTP answered)
+bool clockValid();
+
+// Wall-clock ms since the epoch, 0 while the clock is not set
+uint64_t wallClockMs();
+
+// Cached tokens for this API key and account. Returns false if the cache is
+// off, there is no entry, it belongs to another account or it has less than
+// TOKEN_CACHE_MIN_TTL_S left.
+bool tokenCacheLoad(const String &apiKey, const String &email, String &idToken, String &refreshToken,
+                    uint32_t &remainingS);
+
+// Store the tokens with `ttlS` seconds of validity left. Returns false (and
+// stores nothing) while the clock is not set or the cache is off.
+bool tokenCacheStore(const String &apiKey, const String &email, const String &idToken,
+                     const String &refreshToken, uint32_t ttlS);
+
+void tokenCacheClear();
+
+#endif
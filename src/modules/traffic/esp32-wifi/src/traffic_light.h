@@ -0,0 +1,82 @@
+#ifndef TRAFFIC_LIGHT_H
+#define TRAFFIC_LIGHT_H
+
+#include <Arduino.h>
+#include "build_features.h"
+#ifdef HAS_WEB_SERVER
+#include <WebServer.h>
+#endif
+#include <Preferences.h>
+#include "TM1637Display.h"
+#include "Scheduler.h"
+
+// Shared state and helpers owned by main.cpp. Subsystems in other
+// translation units (local API, ...) go through these so every command,
+// whatever its origin, ends up on the same state path as processStream().
+
+// Where a state change came from (used for logging and latency stats)
+enum UpdateSource
+{
+  SOURCE_CLOUD = 0, // Firebase SSE stream
+  SOURCE_LOCAL = 1, // LAN control API
+  SOURCE_INPUT = 2, // hard-wired input on the board
+  SOURCE_PEER = 3,  // phase tick from the intersection's leader board
+  SOURCE_PLAN = 4,  // the board's own local plan
+  SOURCE_COUNT
+};
+
+extern Preferences preferences;
+#ifdef HAS_WEB_SERVER
+extern WebServer server;
+#endif
+extern TM1637Display display;
+extern Scheduler scheduler;
+
+extern String teamId;
+extern String trafficLightId;
+extern String LOCAL_KEY;
+
+extern bool isOnline;
+
+// Stream events and payload bytes (event + path + data) received
+struct StreamCounters
+{
+  uint32_t events = 0;
+  uint32_t bytes = 0;
+};
+
+extern StreamCounters streamTotal;
+extern StreamCounters streamThisHour;
+extern StreamCounters streamLastHour;
+
+extern int currentColor;   // 1=red, 2=yellow, 3=green
+extern int remainingTime;  // seconds
+extern int currentStatus;  // 0=active, 1=broken, 2=fixing
+extern int yellowDuration; // seconds
+extern int densityLevel;   // 1-4 for the local plan, 0=unknown
+
+// Wall-clock ms of the last state change, whatever its source (0 = clock
+// not set). Host tools compare it with their send time for end-to-end latency.
+extern uint64_t stateChangedMs;
+
+String getStreamPath();
+// No plan reaches the board (Wi-Fi down or a dead transport link)
+bool offline();
+String sanitizeASCII(const String &input);
+void setLight(int color);
+bool readJsonInt(const String &data, const char *key, int &value);
+void showCountdown();
+const char *sourceName(UpdateSource source);
+
+// Count one stream event (or MQTT message) with its payload size
+void countStreamEvent(uint32_t payloadBytes);
+
+// Apply a full or partial state object such as {"color":3,"remaintime":30}.
+// Returns true when any field changed the current state.
+bool applyStateJson(const String &data, UpdateSource source, unsigned long startUs);
+
+// Apply one field ("color", "remaintime", "yellow_duration", "status" or "density_level").
+// Returns true when the value was valid and changed the current state.
+bool applyLightField(const String &field, int value, UpdateSource source);
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <Arduino.h>
+
+// ================= TRANSPORT =================
+// Where the board gets its plan from and reports that it is online. The
+// Firebase SSE stream is the default (main.cpp); MQTT to a local broker is
+// the alternative (mqtt_transport.h). Either way, incoming state goes
+// through applyStateJson()/applyLightField() as a SOURCE_CLOUD update.
+
+class Transport
+{
+public:
+  virtual ~Transport() {}
+
+  virtual const char *name() const = 0;
+
+  // Stream path or subscribed topic, for diagnostics
+  virtual String endpoint() const = 0;
+
+  // Connect and subscribe; returns false if that failed (loop() retries where possible)
+  virtual bool begin() = 0;
+
+  // Called on every loop iteration while WiFi is up
+  virtual void loop() = 0;
+
+  virtual bool ready() const = 0;
+
+  // False while the transport knows its link is dead although Wi-Fi is up
+  // (a stream gone silent); the board blinks offline meanwhile
+  virtual bool linkUp() const { return true; }
+
+  virtual void sendHeartbeat() = 0;
+
+  // Merged writes to this light's node from the outbound queue
+  // (outbound_queue.h): one JSON object of relative paths. Returns false if
+  // nothing was sent; otherwise outboundDone(batch, ...) follows once the
+  // write landed or failed, or outboundSentUnconfirmed(batch) if the
+  // transport never learns either.
+  virtual bool sendLightUpdate(const String &json, uint32_t batch) = 0;
+
+  // Vehicle detector batches as one JSON object of fields to update
+  // (vehicle_detector.h). Returns false if nothing was sent.
+  virtual bool sendDetectorBatches(const String &json) = 0;
+
+  // Last hour's delivery latency histogram (update_order.h). Returns false
+  // if nothing was sent.
+  virtual bool sendLatencyReport(const String &json) = 0;
+
+  // Transport specific diagnostics for /api/stream (JSON object)
+  virtual String reportJson() const { return "{}"; }
+};
+
+extern Transport *transport;
+
+#endif
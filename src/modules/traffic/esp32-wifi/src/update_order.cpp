@@ -0,0 +1,138 @@
+#include "update_order.h"
+#include "UpdateStamp.h"
+#include "token_cache.h"
+#include "transport.h"
+
+static UpdateGate gate;
+static uint32_t unstamped = 0;
+
+static LatencyHistogram total;
+static LatencyHistogram thisHour;
+static LatencyHistogram lastHour;
+
+// "p99_ms":500 for a percentile up to a bucket bound; past the last bound
+// the bound with "p99_over":true, so it never reads as "no samples" (-1)
+static String percentileJson(const LatencyHistogram &h, uint32_t percent)
+{
+  String key = ",\"p" + String(percent);
+  int32_t ms = h.percentileMs(percent);
+  bool over = ms == LATENCY_OVER_MS;
+  if (over)
+    ms = LATENCY_BUCKET_MS[LATENCY_BUCKETS - 2];
+  return key + "_ms\":" + String(ms) + key + "_over\":" + (over ? "true" : "false");
+}
+
+static String histogramJson(const LatencyHistogram &h)
+{
+  String buckets = "[";
+  for (size_t i = 0; i < LATENCY_BUCKETS; i++)
+  {
+    if (i > 0)
+      buckets += ",";
+    buckets += String(h.buckets[i]);
+  }
+
+  return "{\"count\":" + String(h.count) +
+         ",\"min_ms\":" + String(h.minMs) +
+         ",\"avg_ms\":" + String(h.averageMs()) +
+         ",\"max_ms\":" + String(h.maxMs) +
+         percentileJson(h, 50) +
+         percentileJson(h, 90) +
+         percentileJson(h, 99) +
+         ",\"negative\":" + String(h.negative) +
+         ",\"buckets\":" + buckets + "]}";
+}
+
+static String bucketBoundsJson()
+{
+  String bounds = "[";
+  for (size_t i = 0; i < LATENCY_BUCKETS - 1; i++)
+  {
+    if (i > 0)
+      bounds += ",";
+    bounds += String(LATENCY_BUCKET_MS[i]);
+  }
+  return bounds + "]";
+}
+
+static String countersJson()
+{
+  return "\"fresh\":" + String(gate.fresh) +
+         ",\"snapshots\":" + String(gate.snapshots) +
+         ",\"out_of_order\":" + String(gate.outOfOrder) +
+         ",\"stale\":" + String(gate.stale) +
+         ",\"gaps\":" + String(gate.gaps) +
+         ",\"dropped_fields\":" + String(gate.dropped) +
+         ",\"unstamped\":" + String(unstamped);
+}
+
+// ================= PUBLIC API =================
+
+size_t checkUpdateOrder(const char *data, size_t len, bool snapshot, FieldUpdate *updates, size_t count)
+{
+  UpdateStamp stamp;
+  if (!readUpdateStamp(data, len, stamp))
+  {
+    if (count > 0)
+      unstamped++;
+    return count;
+  }
+
+  StampResult result;
+  size_t kept = gate.filter(stamp, snapshot, wallClockMs(), updates, count, result);
+
+  if (result.measured)
+  {
+    total.add(result.latencyMs);
+    thisHour.add(result.latencyMs);
+  }
+  if (result.verdict == STAMP_STALE)
+    Serial.printf("Stream: update %lu arrived %ld ms after it was written, countdown dropped\n",
+                  (unsigned long)stamp.seq, (long)result.latencyMs);
+
+  return kept;
+}
+
+void updateOrderResync()
+{
+  gate.resync();
+}
+
+uint32_t updateOrderLastSeq()
+{
+  return gate.lastSeq();
+}
+
+void updateOrderRollHour()
+{
+  lastHour = thisHour;
+  thisHour.reset();
+
+  if (lastHour.count == 0 || !transport || !transport->ready())
+    return;
+
+  transport->sendLatencyReport("{\"t\":" + String((uint32_t)(wallClockMs() / 1000)) +
+                               ",\"bucket_ms\":" + bucketBoundsJson() +
+                               ",\"last_hour\":" + histogramJson(lastHour) +
+                               "," + countersJson() + "}");
+}
+
+void updateOrderReset()
+{
+  total.reset();
+  thisHour.reset();
+  lastHour.reset();
+}
+
+String updateOrderReportJson()
+{
+  return "{\"last_seq\":" + String(gate.lastSeq()) +
+         ",\"synced\":" + (gate.synced() ? "true" : "false") +
+         ",\"clock\":" + (clockValid() ? "true" : "false") +
+         ",\"max_age_ms\":" + String(UPDATE_MAX_AGE_MS) +
+         "," + countersJson() +
+         ",\"bucket_ms\":" + bucketBoundsJson() +
+         ",\"total\":" + histogramJson(total) +
+         ",\"this_hour\":" + histogramJson(thisHour) +
+         ",\"last_hour\":" + histogramJson(lastHour) + "}";
+}
@@ -0,0 +1,37 @@
+#ifndef UPDATE_ORDER_H
+#define UPDATE_ORDER_H
+
+#include <Arduino.h>
+#include "LightState.h"
+
+// ================= UPDATE ORDER =================
+// The backend stamps every device view write with a sequence number ("seq")
+// and the server time ("ts"). Each stamped cloud update goes through the
+// gate in lib/TrafficCore/UpdateStamp.h before it is applied:
+//   - a field that a newer update already set is dropped (out of order,
+//     or the second copy while two streams overlap during auth rotation)
+//   - an update that arrives more than UPDATE_MAX_AGE_MS after it was
+//     written is stale, and its remaintime is dropped
+// Delivery latency (arrival on the SNTP clock minus server time) of every
+// in-order update goes into a histogram. The last hour's histogram is
+// uploaded through the transport once an hour. Unstamped updates apply as
+// before.
+
+// Filter a decoded cloud update by its stamp and record its latency; returns
+// how many updates are left. `snapshot`: the event is the full state (put).
+size_t checkUpdateOrder(const char *data, size_t len, bool snapshot, FieldUpdate *updates, size_t count);
+
+// Treat the next stamped update as a snapshot (transport reconnected)
+void updateOrderResync();
+
+// Sequence number of the newest stamped update applied, 0 before the first
+uint32_t updateOrderLastSeq();
+
+// Keep this hour's histogram as the last hour's and upload it (hourly)
+void updateOrderRollHour();
+
+void updateOrderReset();
+
+String updateOrderReportJson();
+
+#endif
@@ -0,0 +1,355 @@
+#include "vehicle_detector.h"
+#include <time.h>
+#include "SpscRing.h"
+#include "traffic_light.h"
+#include "transport.h"
+#include "power_mode.h"
+#include "token_cache.h"
+
+// One accepted edge of a detector input
+struct DetectorEdge
+{
+  uint32_t atUs;
+  uint8_t lane;
+  bool present;
+};
+
+// ISR state of one input: the level it last accepted and when
+struct LaneInput
+{
+  volatile bool present;
+  volatile uint32_t lastUs;
+  volatile uint32_t bounces;
+};
+
+struct LaneCounts
+{
+  uint16_t vehicles;
+  uint32_t occupiedUs;
+};
+
+// Aggregates of one signal cycle
+struct Batch
+{
+  uint32_t seq;
+  uint32_t startS;     // wall-clock start (0 = clock not set)
+  uint32_t durationMs;
+  uint32_t greenMs;
+  uint32_t lost;       // edges dropped on a full ring during the cycle
+  LaneCounts lane[DETECTOR_MAX_LANES];
+};
+
+static uint8_t lanes = 0; // 0 = detectors off
+
+static SpscRing<DetectorEdge, 64> edges;
+static LaneInput inputs[DETECTOR_MAX_LANES];
+
+// Loop side
+static bool present[DETECTOR_MAX_LANES];
+static uint32_t presentSinceUs[DETECTOR_MAX_LANES];
+static Batch current;
+static uint32_t batchStartUs = 0;
+static uint32_t droppedAtStart = 0;
+static int lastColor = 0;
+static unsigned long lastTickMs = 0;
+
+static Batch pending[DETECTOR_PENDING_BATCHES];
+static uint8_t pendingCount = 0;
+static Batch lastBatch;
+static bool haveLastBatch = false;
+
+static uint32_t edgeCount = 0;
+static uint32_t settled = 0;
+static uint32_t batchesSent = 0;
+static uint32_t batchesDiscarded = 0;
+
+static void IRAM_ATTR onDetectorEdge(void *arg)
+{
+  uint8_t lane = (uint8_t)(uintptr_t)arg;
+  LaneInput &in = inputs[lane];
+  uint32_t nowUs = micros();
+  bool isPresent = digitalRead(DETECTOR_PINS[lane]) == LOW;
+  powerRearmWakeFromISR(DETECTOR_PINS[lane], isPresent);
+
+  if (isPresent == in.present)
+    return; // bounced back before the ISR ran
+  if (nowUs - in.lastUs < DETECTOR_DEBOUNCE_US)
+  {
+    in.bounces++;
+    return;
+  }
+
+  in.present = isPresent;
+  in.lastUs = nowUs;
+  edges.push({nowUs, lane, isPresent});
+}
+
+// A bounce that ends inside the debounce window leaves the ISR on the wrong
+// level. Once the input has been quiet for the window, catch up with the
+// pin. Interrupts are masked on this core, where the ISRs run, for the
+// check only, so the ring still has one producer at a time.
+static void settleInputs()
+{
+  for (uint8_t lane = 0; lane < lanes; lane++)
+  {
+    portDISABLE_INTERRUPTS();
+    LaneInput &in = inputs[lane];
+    uint32_t nowUs = micros();
+    bool isPresent = digitalRead(DETECTOR_PINS[lane]) == LOW;
+    if (isPresent != in.present && nowUs - in.lastUs >= DETECTOR_DEBOUNCE_US)
+    {
+      in.present = isPresent;
+      in.lastUs = nowUs;
+      edges.push({nowUs, lane, isPresent});
+      settled++;
+    }
+    portENABLE_INTERRUPTS();
+  }
+}
+
+// A vehicle counts when it arrives; its time over the detector counts in
+// the cycle it was spent in
+static void applyEdge(const DetectorEdge &edge)
+{
+  edgeCount++;
+  uint8_t lane = edge.lane;
+  if (edge.present == present[lane])
+    return;
+
+  present[lane] = edge.present;
+  if (edge.present)
+  {
+    current.lane[lane].vehicles++;
+    presentSinceUs[lane] = edge.atUs;
+  }
+  else
+  {
+    current.lane[lane].occupiedUs += edge.atUs - presentSinceUs[lane];
+  }
+}
+
+static void startBatch(uint32_t nowUs)
+{
+  static uint32_t nextSeq = 0;
+
+  current = Batch();
+  current.seq = nextSeq++;
+  current.startS = clockValid() ? (uint32_t)time(nullptr) : 0;
+  batchStartUs = nowUs;
+  droppedAtStart = edges.dropped();
+
+  // A vehicle still over the detector goes on counting from here
+  for (uint8_t lane = 0; lane < lanes; lane++)
+    presentSinceUs[lane] = nowUs;
+}
+
+// The current cycle up to nowUs, including vehicles still over a detector
+static Batch snapshot(uint32_t nowUs)
+{
+  Batch batch = current;
+  batch.durationMs = (nowUs - batchStartUs) / 1000;
+  batch.lost = edges.dropped() - droppedAtStart;
+  for (uint8_t lane = 0; lane < lanes; lane++)
+  {
+    if (present[lane])
+      batch.lane[lane].occupiedUs += nowUs - presentSinceUs[lane];
+  }
+  return batch;
+}
+
+static void closeBatch(uint32_t nowUs)
+{
+  Batch batch = snapshot(nowUs);
+
+  if (pendingCount == DETECTOR_PENDING_BATCHES)
+  {
+    // Offline for a while: keep the newest cycles
+    memmove(pending, pending + 1, sizeof(Batch) * (DETECTOR_PENDING_BATCHES - 1));
+    pendingCount--;
+    batchesDiscarded++;
+  }
+  pending[pendingCount++] = batch;
+  lastBatch = batch;
+  haveLastBatch = true;
+
+  startBatch(nowUs);
+}
+
+static uint16_t occupancyPermille(const Batch &batch, uint8_t lane)
+{
+  if (batch.durationMs == 0)
+    return 0;
+  return (uint16_t)min((uint64_t)1000, (uint64_t)batch.lane[lane].occupiedUs / batch.durationMs);
+}
+
+// {"seq":12,"t":1760000000,"ms":95000,"green_ms":40000,"n":[3,5],"occ":[120,340],"lost":0}
+static String batchJson(const Batch &batch)
+{
+  String counts = "[";
+  String occupancy = "[";
+  for (uint8_t lane = 0; lane < lanes; lane++)
+  {
+    if (lane > 0)
+    {
+      counts += ",";
+      occupancy += ",";
+    }
+    counts += String(batch.lane[lane].vehicles);
+    occupancy += String(occupancyPermille(batch, lane));
+  }
+
+  return "{\"seq\":" + String(batch.seq) +
+         ",\"t\":" + String(batch.startS) +
+         ",\"ms\":" + String(batch.durationMs) +
+         ",\"green_ms\":" + String(batch.greenMs) +
+         ",\"n\":" + counts + "]" +
+         ",\"occ\":" + occupancy + "]" +
+         ",\"lost\":" + String(batch.lost) + "}";
+}
+
+// All pending batches in one update: each in its history slot ("c0"-"c7"),
+// plus the newest sequence number and the lane count
+static void sendPending()
+{
+  if (pendingCount == 0 || !transport || !transport->ready())
+    return;
+
+  String body = "{";
+  for (uint8_t i = 0; i < pendingCount; i++)
+    body += "\"c" + String(pending[i].seq % DETECTOR_HISTORY_SLOTS) + "\":" + batchJson(pending[i]) + ",";
+  body += "\"last\":" + String(pending[pendingCount - 1].seq) + ",\"lanes\":" + String(lanes) + "}";
+
+  if (transport->sendDetectorBatches(body))
+  {
+    batchesSent += pendingCount;
+    pendingCount = 0;
+  }
+}
+
+// Apply every edge so far and account the green time up to now; returns
+// the time the drain started
+static uint32_t drainEdges()
+{
+  settleInputs();
+
+  // Read the time first: every edge stamped before it is in the ring by now
+  uint32_t nowUs = micros();
+  DetectorEdge edge;
+  while (edges.pop(edge))
+    applyEdge(edge);
+
+  unsigned long nowMs = millis();
+  if (lastColor == 3)
+    current.greenMs += nowMs - lastTickMs;
+  lastTickMs = nowMs;
+  return nowUs;
+}
+
+// ================= PUBLIC API =================
+
+void setupDetectors()
+{
+  preferences.begin("traffic-light", true);
+  lanes = min(preferences.getUChar("det_lanes", 0), DETECTOR_MAX_LANES);
+  preferences.end();
+
+  if (lanes == 0)
+    return;
+
+  uint32_t nowUs = micros();
+  for (uint8_t lane = 0; lane < lanes; lane++)
+  {
+    uint8_t pin = DETECTOR_PINS[lane];
+    pinMode(pin, INPUT_PULLUP);
+    present[lane] = digitalRead(pin) == LOW;
+    inputs[lane].present = present[lane];
+    inputs[lane].lastUs = nowUs;
+    attachInterruptArg(digitalPinToInterrupt(pin), onDetectorEdge, (void *)(uintptr_t)lane, CHANGE);
+    powerWakeOnLow(pin);
+  }
+
+  lastColor = currentColor;
+  lastTickMs = millis();
+  startBatch(nowUs);
+
+  String pins = String(DETECTOR_PINS[0]);
+  for (uint8_t lane = 1; lane < lanes; lane++)
+    pins += ", " + String(DETECTOR_PINS[lane]);
+  Serial.printf("Vehicle detectors: %u lanes on GPIO %s\n", lanes, pins.c_str());
+}
+
+bool detectorsEnabled()
+{
+  return lanes > 0;
+}
+
+void detectorTick()
+{
+  if (lanes == 0)
+    return;
+
+  uint32_t nowUs = drainEdges();
+
+  // A cycle ends when the light turns green
+  bool greenStart = currentColor == 3 && lastColor != 3;
+  lastColor = currentColor;
+  if (greenStart || nowUs - batchStartUs >= DETECTOR_MAX_BATCH_MS * 1000UL)
+    closeBatch(nowUs);
+
+  sendPending();
+}
+
+void detectorCycleBoundary()
+{
+  if (lanes == 0)
+    return;
+
+  closeBatch(drainEdges());
+  // The green start that follows is this boundary, not another one
+  lastColor = 3;
+}
+
+bool detectorLastCycleVehicles(int &vehicles)
+{
+  if (lanes == 0 || !haveLastBatch)
+    return false;
+
+  vehicles = 0;
+  for (uint8_t lane = 0; lane < lanes; lane++)
+    vehicles = max(vehicles, (int)lastBatch.lane[lane].vehicles);
+  return true;
+}
+
+String detectorReportJson()
+{
+  if (lanes == 0)
+    return "{\"enabled\":false}";
+
+  String pins = "[";
+  String occupied = "[";
+  uint32_t bounces = 0;
+  for (uint8_t lane = 0; lane < lanes; lane++)
+  {
+    if (lane > 0)
+    {
+      pins += ",";
+      occupied += ",";
+    }
+    pins += String(DETECTOR_PINS[lane]);
+    occupied += present[lane] ? "true" : "false";
+    bounces += inputs[lane].bounces;
+  }
+
+  return "{\"enabled\":true,\"lanes\":" + String(lanes) +
+         ",\"pins\":" + pins + "]" +
+         ",\"occupied\":" + occupied + "]" +
+         ",\"cycle\":" + batchJson(snapshot(micros())) +
+         ",\"last\":" + (haveLastBatch ? batchJson(lastBatch) : String("null")) +
+         ",\"pending\":" + String(pendingCount) +
+         ",\"sent\":" + String(batchesSent) +
+         ",\"discarded\":" + String(batchesDiscarded) +
+         ",\"edges\":" + String(edgeCount) +
+         ",\"dropped\":" + String(edges.dropped()) +
+         ",\"bounces\":" + String(bounces) +
+         ",\"settled\":" + String(settled) + "}";
+}
@@ -0,0 +1,58 @@
+#ifndef VEHICLE_DETECTOR_H
+#define VEHICLE_DETECTOR_H
+
+#include <Arduino.h>
+
+// ================= VEHICLE DETECTORS =================
+// Counts vehicles on inductive-loop or beam-break detectors wired to the
+// board, one input per lane (active LOW: the detector output pulls the pin
+// to ground while a vehicle is present). Enabled by a non-zero lane count
+// in the preference "det_lanes" (1-4).
+//
+// A GPIO interrupt on every edge is debounced in the ISR and pushed with its
+// timestamp into a lock-free ring (lib/TrafficCore/SpscRing.h). The drain job
+// turns the edges into per-lane vehicle counts and occupancy (share of time
+// a vehicle was over the detector) for the current signal cycle.
+//
+// A cycle ends when the light turns green, or after DETECTOR_MAX_BATCH_MS
+// when the light is not cycling. Each closed cycle becomes one compact batch,
+// and the batches go up through the transport in a single write per cycle,
+// never one per vehicle. Batches that could not be sent (offline) are kept
+// and go along with the next write, up to DETECTOR_PENDING_BATCHES.
+
+const uint8_t DETECTOR_MAX_LANES = 4;
+
+// Input pins, lane 1 first (GPIO 25/26/32/33, with internal pull-ups)
+const uint8_t DETECTOR_PINS[DETECTOR_MAX_LANES] = {32, 33, 25, 26};
+
+// Edges closer than this to the last accepted edge of the same input are bounce
+const uint32_t DETECTOR_DEBOUNCE_US = 20000;
+
+const unsigned long DETECTOR_DRAIN_MS = 100;
+const unsigned long DETECTOR_MAX_BATCH_MS = 300000;
+
+// Closed batches kept until they are sent, and slots in the cloud history
+const uint8_t DETECTOR_PENDING_BATCHES = 4;
+const uint8_t DETECTOR_HISTORY_SLOTS = 8;
+
+// Reads the preference and attaches the interrupts; call before WiFi starts
+// so the inputs are registered as light sleep wake sources
+void setupDetectors();
+
+bool detectorsEnabled();
+
+// Drain the edge ring, close the cycle on a green start and send pending
+// batches (scheduler job)
+void detectorTick();
+
+// End the cycle right now, ahead of a green start the caller is about to
+// make (the local plan), so the batch covers exactly the cycle that ended
+void detectorCycleBoundary();
+
+// Vehicles on the busiest lane in the last closed cycle; false before the
+// first cycle closed or with detectors off
+bool detectorLastCycleVehicles(int &vehicles);
+
+String detectorReportJson();
+
+#endif
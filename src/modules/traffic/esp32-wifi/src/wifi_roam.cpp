@@ -0,0 +1,548 @@
+#include "wifi_roam.h"
+#include <WiFi.h>
+#include "traffic_light.h"
+#include "power_mode.h"
+
+struct Network
+{
+  String ssid;
+  String pass;
+};
+
+// One AP of a configured network; an unpinned candidate lets the driver pick
+struct Candidate
+{
+  uint8_t network;
+  bool pinned;
+  uint8_t bssid[6];
+  int32_t channel;
+  int32_t rssi;
+};
+
+// Last AP connected to, kept in "wifi_last" for a scan-free boot
+struct LastAp
+{
+  uint8_t network;
+  uint8_t channel;
+  uint8_t bssid[6];
+};
+
+struct OutageStats
+{
+  uint32_t count = 0;
+  uint32_t lastMs = 0;
+  uint32_t maxMs = 0;
+  uint64_t totalMs = 0;
+  uint32_t recent[WIFI_OUTAGE_HISTORY] = {};
+};
+
+static bool roaming = true;
+static Network networks[WIFI_MAX_NETWORKS];
+static uint8_t networkCount = 0;
+
+static Candidate candidates[WIFI_MAX_CANDIDATES];
+static uint8_t candidateCount = 0;
+static bool haveScan = false;
+static bool scanning = false;
+static unsigned long scannedMs = 0;
+
+static Candidate current;
+static bool haveCurrent = false;
+static bool linkWasUp = false;
+static bool attempting = false;
+static unsigned long attemptStartMs = 0;
+static uint8_t nextCandidate = 0;
+static Candidate dropped; // AP that lost the link, tried last
+static bool haveDropped = false;
+
+static int32_t linkRssi = 0;
+static uint8_t weakTicks = 0;
+static uint32_t scans = 0;
+static uint32_t roams = 0;
+static uint32_t attempts = 0;
+
+// Written by the Wi-Fi event task
+static portMUX_TYPE outageLock = portMUX_INITIALIZER_UNLOCKED;
+static bool linkUp = false;
+static bool everUp = false;
+static uint32_t outageStartMs = 0;
+static bool outageEnded = false;
+static OutageStats outages;
+
+static String bssidText(const uint8_t *bssid)
+{
+  char text[18];
+  snprintf(text, sizeof(text), "%02X:%02X:%02X:%02X:%02X:%02X", bssid[0], bssid[1], bssid[2], bssid[3], bssid[4],
+           bssid[5]);
+  return String(text);
+}
+
+// SSIDs are free text
+static String jsonEscape(const String &s)
+{
+  String out;
+  for (size_t i = 0; i < s.length(); i++)
+  {
+    char c = s[i];
+    if (c == '"' || c == '\\')
+      out += '\\';
+    if ((uint8_t)c >= 0x20)
+      out += c;
+  }
+  return out;
+}
+
+static bool sameAp(const Candidate &a, const Candidate &b)
+{
+  return a.pinned && b.pinned && memcmp(a.bssid, b.bssid, sizeof(a.bssid)) == 0;
+}
+
+// A usable AP of a higher priority network first, then the stronger signal
+static bool ranksAbove(const Candidate &a, const Candidate &b)
+{
+  bool aUsable = a.rssi >= WIFI_WEAK_RSSI;
+  bool bUsable = b.rssi >= WIFI_WEAK_RSSI;
+  if (aUsable != bUsable)
+    return aUsable;
+  if (aUsable && a.network != b.network)
+    return a.network < b.network;
+  return a.rssi > b.rssi;
+}
+
+// Link lost: an outage starts. An IP again: it ends.
+static void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info)
+{
+  uint32_t nowMs = millis();
+  portENTER_CRITICAL(&outageLock);
+  if ((event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED || event == ARDUINO_EVENT_WIFI_STA_LOST_IP) && linkUp)
+  {
+    linkUp = false;
+    outageStartMs = nowMs;
+  }
+  else if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP && !linkUp)
+  {
+    linkUp = true;
+    if (everUp)
+    {
+      uint32_t ms = nowMs - outageStartMs;
+      outages.recent[outages.count % WIFI_OUTAGE_HISTORY] = ms;
+      outages.count++;
+      outages.lastMs = ms;
+      outages.maxMs = max(outages.maxMs, ms);
+      outages.totalMs += ms;
+      outageEnded = true;
+    }
+    everUp = true;
+  }
+  portEXIT_CRITICAL(&outageLock);
+}
+
+// ================= SCANNING =================
+
+static void addCandidate(const Candidate &candidate)
+{
+  uint8_t at = candidateCount;
+  if (candidateCount < WIFI_MAX_CANDIDATES)
+    candidateCount++;
+  else if (ranksAbove(candidate, candidates[WIFI_MAX_CANDIDATES - 1]))
+    at = WIFI_MAX_CANDIDATES - 1;
+  else
+    return;
+
+  // Insertion sort, best first
+  while (at > 0 && ranksAbove(candidate, candidates[at - 1]))
+  {
+    candidates[at] = candidates[at - 1];
+    at--;
+  }
+  candidates[at] = candidate;
+}
+
+static void collectScan(int16_t found)
+{
+  candidateCount = 0;
+  for (int16_t i = 0; i < found; i++)
+  {
+    String ssid = WiFi.SSID(i);
+    for (uint8_t n = 0; n < networkCount; n++)
+    {
+      if (ssid != networks[n].ssid)
+        continue;
+
+      Candidate candidate;
+      candidate.network = n;
+      candidate.pinned = true;
+      memcpy(candidate.bssid, WiFi.BSSID(i), sizeof(candidate.bssid));
+      candidate.channel = WiFi.channel(i);
+      candidate.rssi = WiFi.RSSI(i);
+      addCandidate(candidate);
+      break;
+    }
+  }
+  WiFi.scanDelete();
+
+  haveScan = true;
+  scannedMs = millis();
+  scans++;
+}
+
+static void startScan()
+{
+  if (WiFi.scanNetworks(true) == WIFI_SCAN_FAILED)
+    return;
+  scanning = true;
+}
+
+// i-th candidate in reconnect order: the AP that dropped goes last. Without
+// any scan result, each network in priority order, unpinned.
+static bool candidateAt(uint8_t i, Candidate &out)
+{
+  if (candidateCount == 0)
+  {
+    if (i >= networkCount)
+      return false;
+    out = Candidate();
+    out.network = i;
+    return true;
+  }
+
+  uint8_t seen = 0;
+  for (uint8_t c = 0; c < candidateCount; c++)
+  {
+    if (haveDropped && sameAp(candidates[c], dropped))
+      continue;
+    if (seen++ == i)
+    {
+      out = candidates[c];
+      return true;
+    }
+  }
+
+  if (haveDropped && i == seen)
+  {
+    for (uint8_t c = 0; c < candidateCount; c++)
+    {
+      if (sameAp(candidates[c], dropped))
+      {
+        out = candidates[c];
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// ================= CONNECTING =================
+
+static void connectTo(const Candidate &candidate)
+{
+  const Network &network = networks[candidate.network];
+  String via = "";
+  if (candidate.pinned)
+    via = " (" + bssidText(candidate.bssid) + ", channel " + String(candidate.channel) +
+          (candidate.rssi ? ", " + String(candidate.rssi) + " dBm)" : String(")"));
+  Serial.println("WiFi: connecting to " + network.ssid + via);
+
+  if (WiFi.status() == WL_CONNECTED)
+    WiFi.disconnect();
+  powerBeginWiFi(network.ssid, network.pass, candidate.channel, candidate.pinned ? candidate.bssid : nullptr);
+
+  current = candidate;
+  haveCurrent = true;
+  linkWasUp = false; // left on purpose, not a drop
+  attempting = true;
+  attemptStartMs = millis();
+  attempts++;
+}
+
+static bool waitConnected(unsigned long timeoutMs)
+{
+  unsigned long startMs = millis();
+  while (WiFi.status() != WL_CONNECTED && millis() - startMs < timeoutMs)
+  {
+    Serial.print(".");
+    delay(500);
+  }
+  Serial.println();
+  return WiFi.status() == WL_CONNECTED;
+}
+
+static bool loadLastAp(Candidate &out)
+{
+  LastAp last;
+  preferences.begin("traffic-light", true);
+  size_t len = preferences.getBytes("wifi_last", &last, sizeof(last));
+  preferences.end();
+
+  if (len != sizeof(last) || last.network >= networkCount)
+    return false;
+
+  out = Candidate();
+  out.network = last.network;
+  out.pinned = true;
+  out.channel = last.channel;
+  memcpy(out.bssid, last.bssid, sizeof(out.bssid));
+  return true;
+}
+
+static void saveLastAp(const Candidate &candidate)
+{
+  Candidate stored;
+  if (!candidate.pinned || (loadLastAp(stored) && sameAp(stored, candidate) && stored.network == candidate.network &&
+                            stored.channel == candidate.channel))
+    return;
+
+  LastAp last;
+  last.network = candidate.network;
+  last.channel = (uint8_t)candidate.channel;
+  memcpy(last.bssid, candidate.bssid, sizeof(last.bssid));
+
+  preferences.begin("traffic-light", false);
+  preferences.putBytes("wifi_last", &last, sizeof(last));
+  preferences.end();
+}
+
+// The link is degraded and a scan is in: move to a clearly stronger AP
+static void maybeRoam()
+{
+  if (weakTicks < WIFI_WEAK_TICKS)
+    return;
+
+  for (uint8_t c = 0; c < candidateCount; c++)
+  {
+    const Candidate &candidate = candidates[c];
+    if ((haveCurrent && sameAp(candidate, current)) || candidate.rssi < linkRssi + WIFI_ROAM_MARGIN_DB)
+      continue;
+
+    Serial.printf("WiFi: link at %ld dBm, roaming\n", (long)linkRssi);
+    roams++;
+    weakTicks = 0;
+    connectTo(candidate);
+    // Should it fail, go on with the ones after it
+    haveDropped = false;
+    nextCandidate = c + 1;
+    return;
+  }
+}
+
+static void logOutage()
+{
+  portENTER_CRITICAL(&outageLock);
+  bool ended = outageEnded;
+  uint32_t ms = outages.lastMs;
+  outageEnded = false;
+  portEXIT_CRITICAL(&outageLock);
+
+  if (ended)
+    Serial.printf("WiFi: back online after %lu ms offline (%s)\n", (unsigned long)ms, WiFi.SSID().c_str());
+}
+
+// ================= PUBLIC API =================
+
+void setupWiFiRoam()
+{
+  static const char *const ssidKeys[WIFI_MAX_NETWORKS] = {"ssid", "ssid2", "ssid3"};
+  static const char *const passKeys[WIFI_MAX_NETWORKS] = {"pass", "pass2", "pass3"};
+
+  preferences.begin("traffic-light", true);
+  roaming = preferences.getUChar("wifi_roam", 1) != 0;
+  for (uint8_t i = 0; i < WIFI_MAX_NETWORKS; i++)
+  {
+    String ssid = sanitizeASCII(preferences.getString(ssidKeys[i], ""));
+    if (ssid.length() == 0)
+      continue;
+    networks[networkCount].ssid = ssid;
+    networks[networkCount].pass = preferences.getString(passKeys[i], "");
+    networkCount++;
+  }
+  preferences.end();
+
+  WiFi.onEvent(onWiFiEvent);
+
+  if (!roaming)
+  {
+    Serial.println("WiFi: roaming off, single SSID");
+    return;
+  }
+
+  String names = networkCount > 0 ? networks[0].ssid : String("");
+  for (uint8_t i = 1; i < networkCount; i++)
+    names += ", " + networks[i].ssid;
+  Serial.println("WiFi: roaming over " + names);
+}
+
+bool wifiRoamEnabled()
+{
+  return roaming;
+}
+
+bool wifiConnect(unsigned long timeoutMs)
+{
+  if (networkCount == 0)
+    return false;
+
+  if (!roaming)
+  {
+    Serial.println("Connecting to: " + networks[0].ssid);
+    powerBeginWiFi(networks[0].ssid, networks[0].pass);
+    return waitConnected(timeoutMs);
+  }
+
+  // The roaming logic reconnects, not the driver (which would only retry the same AP)
+  WiFi.mode(WIFI_STA);
+  WiFi.setAutoReconnect(false);
+
+  Candidate last;
+  if (loadLastAp(last))
+  {
+    connectTo(last);
+    if (waitConnected(WIFI_LAST_AP_MS))
+      return true;
+    WiFi.disconnect();
+  }
+
+  collectScan(WiFi.scanNetworks());
+  LOG_VERBOSE("WiFi: %u candidate APs\n", candidateCount);
+
+  Candidate candidate;
+  for (uint8_t i = 0; candidateAt(i, candidate); i++)
+  {
+    connectTo(candidate);
+    if (waitConnected(WIFI_ATTEMPT_MS))
+      return true;
+    WiFi.disconnect();
+  }
+  return false;
+}
+
+void wifiRoamTick()
+{
+  logOutage();
+  if (!roaming)
+    return;
+
+  unsigned long nowMs = millis();
+  bool connected = WiFi.status() == WL_CONNECTED;
+
+  if (scanning)
+  {
+    int16_t found = WiFi.scanComplete();
+    if (found == WIFI_SCAN_RUNNING)
+      return;
+
+    // A failed scan leaves no candidates: the networks get tried unpinned
+    scanning = false;
+    collectScan(found);
+
+    if (connected)
+      maybeRoam();
+    else
+      nextCandidate = 0;
+    return;
+  }
+
+  if (connected)
+  {
+    if (attempting || !linkWasUp)
+    {
+      attempting = false;
+      linkWasUp = true;
+      haveDropped = false;
+      nextCandidate = 0;
+      if (haveCurrent)
+        saveLastAp(current);
+    }
+
+    linkRssi = WiFi.RSSI();
+    weakTicks = linkRssi < WIFI_WEAK_RSSI ? min(weakTicks + 1, 255) : 0;
+
+    // Keep the list fresh for a fast reconnect; scan sooner on a weak link
+    bool degraded = weakTicks >= WIFI_WEAK_TICKS;
+    unsigned long interval = degraded ? WIFI_WEAK_SCAN_MS : WIFI_SCAN_INTERVAL_MS;
+    if ((degraded || !powerModeEnabled()) && (!haveScan || nowMs - scannedMs >= interval))
+      startScan();
+    return;
+  }
+
+  if (linkWasUp)
+  {
+    // Dropped: try the others first
+    linkWasUp = false;
+    attempting = false;
+    nextCandidate = 0;
+    dropped = current;
+    haveDropped = haveCurrent && current.pinned;
+    Serial.printf("WiFi: link to %s lost\n", haveCurrent ? networks[current.network].ssid.c_str() : "?");
+  }
+
+  if (attempting && nowMs - attemptStartMs < WIFI_ATTEMPT_MS)
+    return;
+  attempting = false;
+
+  Candidate candidate;
+  if (!haveScan || nowMs - scannedMs > WIFI_SCAN_MAX_AGE_MS || !candidateAt(nextCandidate, candidate))
+  {
+    // Stale or used up: stop the attempt and look again
+    WiFi.disconnect();
+    startScan();
+    return;
+  }
+
+  nextCandidate++;
+  connectTo(candidate);
+}
+
+static String candidateJson(const Candidate &candidate)
+{
+  return "{\"ssid\":\"" + jsonEscape(networks[candidate.network].ssid) +
+         "\",\"bssid\":\"" + (candidate.pinned ? bssidText(candidate.bssid) : String("")) +
+         "\",\"channel\":" + String(candidate.channel) +
+         ",\"rssi\":" + String(candidate.rssi) + "}";
+}
+
+String wifiRoamReportJson()
+{
+  portENTER_CRITICAL(&outageLock);
+  OutageStats stats = outages;
+  bool up = linkUp;
+  bool wasUp = everUp;
+  uint32_t startMs = outageStartMs;
+  portEXIT_CRITICAL(&outageLock);
+
+  String recent = "[";
+  uint32_t kept = min(stats.count, (uint32_t)WIFI_OUTAGE_HISTORY);
+  for (uint32_t i = 0; i < kept; i++)
+  {
+    if (i > 0)
+      recent += ",";
+    recent += String(stats.recent[(stats.count - kept + i) % WIFI_OUTAGE_HISTORY]);
+  }
+
+  String list = "[";
+  for (uint8_t c = 0; c < candidateCount; c++)
+  {
+    if (c > 0)
+      list += ",";
+    list += candidateJson(candidates[c]);
+  }
+
+  uint32_t avgMs = stats.count ? (uint32_t)(stats.totalMs / stats.count) : 0;
+  return "{\"roaming\":" + String(roaming ? "true" : "false") +
+         ",\"networks\":" + String(networkCount) +
+         ",\"ssid\":\"" + jsonEscape(WiFi.SSID()) +
+         "\",\"bssid\":\"" + WiFi.BSSIDstr() +
+         "\",\"rssi\":" + String(WiFi.RSSI()) +
+         ",\"weak_ticks\":" + String(weakTicks) +
+         ",\"scans\":" + String(scans) +
+         ",\"scan_age_s\":" + (haveScan ? String((millis() - scannedMs) / 1000) : String("null")) +
+         ",\"candidates\":" + list + "]" +
+         ",\"attempts\":" + String(attempts) +
+         ",\"roams\":" + String(roams) +
+         ",\"outages\":{\"count\":" + String(stats.count) +
+         ",\"last_ms\":" + String(stats.lastMs) +
+         ",\"avg_ms\":" + String(avgMs) +
+         ",\"max_ms\":" + String(stats.maxMs) +
+         ",\"total_ms\":" + String((uint32_t)stats.totalMs) +
+         ",\"in_progress_ms\":" + String(!up && wasUp ? millis() - startMs : 0) +
+         ",\"recent_ms\":" + recent + "]}}";
+}
@@ -0,0 +1,56 @@
+#ifndef WIFI_ROAM_H
+#define WIFI_ROAM_H
+
+#include <Arduino.h>
+
+// ================= WI-FI ROAMING =================
+// Up to WIFI_MAX_NETWORKS credential sets in priority order: the portal's
+// WiFi SSID/password, then "ssid2"/"pass2" and "ssid3"/"pass3". Candidates
+// are the APs of those networks seen in a scan, each pinned by BSSID and
+// channel. A usable AP (WIFI_WEAK_RSSI or better) of a higher priority
+// network ranks first, then signal strength decides.
+//
+// - Boot: the AP of the last connection first, without a scan; then a scan
+//   and each candidate in rank order.
+// - Link up: an async scan every WIFI_SCAN_INTERVAL_MS keeps the candidate
+//   list fresh (not in power mode). When the RSSI stays below
+//   WIFI_WEAK_RSSI, a scan looks for an AP at least WIFI_ROAM_MARGIN_DB
+//   stronger and the board moves to it.
+// - Link lost: the next candidate from the list right away, with the AP
+//   that dropped tried last, instead of waiting on the driver's reconnect
+//   to the same AP. A new scan once the list is stale or used up.
+//
+// Every outage (link lost until an IP again) is timed. The preference
+// "wifi_roam" = 0 keeps the single-SSID behaviour (driver auto-reconnect),
+// with the same outage timing, for comparison.
+
+const uint8_t WIFI_MAX_NETWORKS = 3;
+const uint8_t WIFI_MAX_CANDIDATES = 8;
+
+const int32_t WIFI_WEAK_RSSI = -75;     // dBm; a weaker link is degraded
+const int32_t WIFI_ROAM_MARGIN_DB = 8;  // how much stronger a roam target must be
+const uint8_t WIFI_WEAK_TICKS = 5;      // degraded readings in a row before a scan
+const unsigned long WIFI_ROAM_TICK_MS = 1000;
+const unsigned long WIFI_SCAN_INTERVAL_MS = 300000; // background scan, link up
+const unsigned long WIFI_WEAK_SCAN_MS = 30000;      // rescan interval while degraded
+const unsigned long WIFI_SCAN_MAX_AGE_MS = 120000;  // candidates trusted after a drop
+const unsigned long WIFI_ATTEMPT_MS = 6000;         // per candidate
+const unsigned long WIFI_LAST_AP_MS = 4000;         // boot attempt on the last AP
+
+const uint8_t WIFI_OUTAGE_HISTORY = 8;
+
+// Reads the preferences and hooks the Wi-Fi events; call before wifiConnect()
+void setupWiFiRoam();
+
+bool wifiRoamEnabled();
+
+// Boot connection: returns true once connected, false after trying every
+// candidate (or timeoutMs without roaming)
+bool wifiConnect(unsigned long timeoutMs);
+
+// Link watch, scans, roaming and reconnects (scheduler job)
+void wifiRoamTick();
+
+String wifiRoamReportJson();
+
+#endif
@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+"""Build the full and lean images and report flash, static RAM and boot time.
+
+Flash and static RAM (.data + .bss) come from the summary PlatformIO prints
+after linking. With --port, each image is also uploaded and the board reset
+several times; boot time is the "Boot: ready N ms after reset" line it logs
+once the transport is up (needs pyserial and a provisioned board).
+
+Examples:
+  python3 tools/build_variants.py
+  python3 tools/build_variants.py --port /dev/ttyUSB0 --boots 5
+"""
+
+import argparse
+import re
+import statistics
+import subprocess
+import sys
+import time
+
+ENVS = [("full", "esp32doit-devkit-v1"), ("lean", "esp32doit-devkit-v1-lean")]
+
+SIZE_LINE = re.compile(r"^(RAM|Flash):.*\(used (\d+) bytes from (\d+) bytes\)", re.M)
+BOOT_LINE = re.compile(r"Boot: ready (\d+) ms after reset")
+
+
+def build(env: str) -> dict:
+    out = subprocess.run(["pio", "run", "-e", env], capture_output=True, text=True)
+    if out.returncode != 0:
+        sys.exit(f"pio run -e {env} failed:\n{out.stdout[-2000:]}{out.stderr[-2000:]}")
+    return {kind: int(used) for kind, used, _ in SIZE_LINE.findall(out.stdout)}
+
+
+def boot_times(env: str, port: str, boots: int, timeout_s: float) -> list:
+    import serial
+
+    subprocess.run(["pio", "run", "-e", env, "-t", "upload", "--upload-port", port], check=True,
+                   capture_output=True)
+    times = []
+    with serial.Serial(port, 115200, timeout=0.5) as ser:
+        for _ in range(boots):
+            # EN low through RTS, as esptool does
+            ser.dtr = False
+            ser.rts = True
+            time.sleep(0.1)
+            ser.rts = False
+            deadline = time.monotonic() + timeout_s
+            while time.monotonic() < deadline:
+                match = BOOT_LINE.search(ser.readline().decode(errors="replace"))
+                if match:
+                    times.append(int(match.group(1)))
+                    break
+            else:
+                print(f"{env}: no boot line within {timeout_s:.0f} s", file=sys.stderr)
+    return times
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--port", help="serial port of a provisioned board, to measure boot time")
+    parser.add_argument("--boots", type=int, default=3, help="resets per image (default 3)")
+    parser.add_argument("--timeout", type=float, default=60, help="seconds to wait for each boot")
+    args = parser.parse_args()
+
+    rows = []
+    for name, env in ENVS:
+        sizes = build(env)
+        boot = "-"
+        if args.port:
+            times = boot_times(env, args.port, args.boots, args.timeout)
+            if times:
+                boot = f"{statistics.median(times)} ms (n={len(times)})"
+        rows.append((name, env, sizes.get("Flash", 0), sizes.get("RAM", 0), boot))
+
+    full_flash, full_ram = rows[0][2], rows[0][3]
+    print("| Image | Environment | Flash | Static RAM | Boot to ready |")
+    print("| ----- | ----------- | ----- | ---------- | ------------- |")
+    for name, env, flash, ram, boot in rows:
+        delta = "" if name == "full" else f" ({flash - full_flash:+d})"
+        ram_delta = "" if name == "full" else f" ({ram - full_ram:+d})"
+        print(f"| {name} | `{env}` | {flash} B{delta} | {ram} B{ram_delta} | {boot} |")
+
+
+if __name__ == "__main__":
+    main()
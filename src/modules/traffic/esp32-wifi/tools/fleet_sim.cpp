@@ -0,0 +1,584 @@
+// Fleet load simulator.
+//
+// Runs many virtual boards that hold a stream and send a heartbeat every
+// 10 s, like the firmware does, against a local stand-in for the parts of
+// the Realtime Database REST API the fleet uses (tools/rtdb_standin.h).
+// Every stream event goes through the firmware's own decoding and state
+// validation (lib/TrafficCore/LightState), so a virtual board accepts and
+// rejects exactly what a real one would.
+//
+// A driver thread plays the backend's device-view mirror: it PATCHes a new
+// `remaintime` into one light at a time and the board that sees it records
+// the end-to-end latency. For each fleet size the simulator reports latency
+// percentiles, events per second and memory per virtual board.
+//
+// Linux only (epoll). Build from the esp32-wifi directory:
+//   g++ -std=c++17 -O2 -pthread -Ilib/TrafficCore -o fleet_sim
+//       tools/fleet_sim.cpp lib/TrafficCore/LightState.cpp
+//
+// Examples:
+//   ./fleet_sim --steps 100,500,1000,2000 --seconds 30 --rate 200
+//   ./fleet_sim --steps 2000 --full-node        # stream the full light node
+//   ./fleet_sim --serve 9000                    # stand-in server only
+//   ./fleet_sim --server 127.0.0.1:9000 --steps 500,1000
+
+#include "LightState.h"
+#include "rtdb_standin.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+static const uint64_t HEARTBEAT_NS = 10000000000ULL; // firmware heartbeat job
+static const int CONNECTS_PER_TICK = 50;             // ramp-up batch per 10 ms
+
+static long rssBytes()
+{
+  long pages = 0, resident = 0;
+  FILE *f = fopen("/proc/self/statm", "r");
+  if (!f)
+    return 0;
+  if (fscanf(f, "%ld %ld", &pages, &resident) != 2)
+    resident = 0;
+  fclose(f);
+  return resident * sysconf(_SC_PAGESIZE);
+}
+
+// ================= VIRTUAL BOARDS =================
+
+// The update the driver sent to a board and is waiting to see applied
+struct Pending
+{
+  std::atomic<int> value{-1};
+  std::atomic<uint64_t> sentNs{0};
+};
+
+struct Board
+{
+  int id = 0;
+  LightState state;
+  int streamFd = -1;
+  int restFd = -1;
+  bool headersDone = false;
+  std::string buf; // unparsed stream bytes
+  std::string event;
+  std::string data;
+  uint64_t heartbeatDue = 0;
+};
+
+struct FleetStats
+{
+  std::atomic<uint64_t> events{0}; // SSE events received
+  std::atomic<uint64_t> applied{0}; // events that changed a board's state
+  std::atomic<uint64_t> heartbeats{0};
+  std::atomic<uint64_t> disconnects{0};
+  std::atomic<uint64_t> connectFailures{0};
+};
+
+class Fleet
+{
+public:
+  Fleet(const sockaddr_in &server, const std::string &team, const std::string &node)
+      : m_server(server), m_team(team), m_node(node) {}
+
+  void run(const std::atomic<bool> &stop);
+
+  // Grow the fleet to `count` boards (boards are never removed)
+  std::atomic<int> target{0};
+  std::atomic<int> connected{0};
+  FleetStats stats;
+  Pending pending[65536];
+
+  // Latency samples in µs, swapped out by the main thread between steps
+  std::vector<uint32_t> takeSamples();
+
+  // Bytes held per board by the simulator itself (not the ESP32 heap),
+  // refreshed once a second
+  std::atomic<size_t> stateBytes{0};
+
+private:
+  int connectTo();
+  bool openStream(Board &board);
+  void readStream(Board &board);
+  void dispatch(Board &board);
+  void drainRest(Board &board);
+  size_t measureStateBytes() const;
+
+  sockaddr_in m_server;
+  std::string m_team;
+  std::string m_node;
+  int m_epoll = -1;
+  std::vector<Board *> m_boards;
+  std::vector<uint32_t> m_samples;
+  std::atomic_flag m_samplesLock = ATOMIC_FLAG_INIT;
+};
+
+int Fleet::connectTo()
+{
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+  if (::connect(fd, (const sockaddr *)&m_server, sizeof(m_server)) < 0)
+  {
+    close(fd);
+    return -1;
+  }
+  setNonBlocking(fd);
+  return fd;
+}
+
+bool Fleet::openStream(Board &board)
+{
+  board.streamFd = connectTo();
+  if (board.streamFd < 0)
+    return false;
+
+  board.headersDone = false;
+  board.buf.clear();
+  std::string request = "GET /teams/" + m_team + "/" + m_node + "/" + std::to_string(board.id) +
+                        ".json HTTP/1.1\r\nHost: localhost\r\nAccept: text/event-stream\r\n\r\n";
+  if (!sendAll(board.streamFd, request))
+  {
+    close(board.streamFd);
+    board.streamFd = -1;
+    return false;
+  }
+
+  epoll_event ev = {};
+  ev.events = EPOLLIN;
+  ev.data.u64 = ((uint64_t)board.id << 1);
+  epoll_ctl(m_epoll, EPOLL_CTL_ADD, board.streamFd, &ev);
+  return true;
+}
+
+void Fleet::run(const std::atomic<bool> &stop)
+{
+  m_epoll = epoll_create1(0);
+  epoll_event events[256];
+  uint64_t lastReconnect = 0;
+
+  while (!stop)
+  {
+    int n = epoll_wait(m_epoll, events, 256, 10);
+    for (int i = 0; i < n; i++)
+    {
+      Board &board = *m_boards[events[i].data.u64 >> 1];
+      if (events[i].data.u64 & 1)
+        drainRest(board);
+      else
+        readStream(board);
+    }
+
+    uint64_t now = nowNs();
+
+    // Ramp up in small batches so the listen backlog never overflows
+    for (int i = 0; i < CONNECTS_PER_TICK && (int)m_boards.size() < target; i++)
+    {
+      Board *board = new Board();
+      board->id = m_boards.size();
+      board->heartbeatDue = now + (uint64_t)(rand() % 10000) * 1000000ULL;
+      m_boards.push_back(board);
+
+      board->restFd = connectTo();
+      if (board->restFd >= 0)
+      {
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.u64 = ((uint64_t)board->id << 1) | 1;
+        epoll_ctl(m_epoll, EPOLL_CTL_ADD, board->restFd, &ev);
+      }
+
+      if (board->restFd >= 0 && openStream(*board))
+        connected++;
+      else
+        stats.connectFailures++;
+    }
+
+    // Dropped streams reconnect once a second, like the firmware's stream task
+    if (now - lastReconnect > 1000000000ULL)
+    {
+      lastReconnect = now;
+      stateBytes = measureStateBytes();
+      for (Board *board : m_boards)
+      {
+        if (board->streamFd < 0 && openStream(*board))
+          connected++;
+      }
+    }
+
+    // Heartbeat: the firmware sets /online on its light node every 10 s
+    for (Board *board : m_boards)
+    {
+      if (now < board->heartbeatDue || board->restFd < 0)
+        continue;
+      board->heartbeatDue += HEARTBEAT_NS;
+      std::string request = "PUT /teams/" + m_team + "/traffic_lights/" + std::to_string(board->id) +
+                            "/online.json HTTP/1.1\r\nHost: localhost\r\nContent-Length: 4\r\n\r\ntrue";
+      if (sendAll(board->restFd, request))
+        stats.heartbeats++;
+    }
+  }
+}
+
+void Fleet::drainRest(Board &board)
+{
+  char buf[1024];
+  while (recv(board.restFd, buf, sizeof(buf), 0) > 0)
+  {
+  }
+}
+
+void Fleet::readStream(Board &board)
+{
+  char buf[4096];
+  while (true)
+  {
+    ssize_t n = recv(board.streamFd, buf, sizeof(buf), 0);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))
+    {
+      epoll_ctl(m_epoll, EPOLL_CTL_DEL, board.streamFd, nullptr);
+      close(board.streamFd);
+      board.streamFd = -1;
+      connected--;
+      stats.disconnects++;
+      return;
+    }
+    if (n < 0)
+      break;
+    board.buf.append(buf, n);
+  }
+
+  size_t pos = 0;
+  if (!board.headersDone)
+  {
+    size_t end = board.buf.find("\r\n\r\n");
+    if (end == std::string::npos)
+      return;
+    board.headersDone = true;
+    pos = end + 4;
+  }
+
+  // SSE lines: "event: ...", "data: ...", blank line ends the event
+  while (true)
+  {
+    size_t eol = board.buf.find('\n', pos);
+    if (eol == std::string::npos)
+      break;
+
+    if (eol == pos)
+      dispatch(board);
+    else if (board.buf.compare(pos, 7, "event: ") == 0)
+      board.event.assign(board.buf, pos + 7, eol - pos - 7);
+    else if (board.buf.compare(pos, 6, "data: ") == 0)
+      board.data.assign(board.buf, pos + 6, eol - pos - 6);
+    pos = eol + 1;
+  }
+  board.buf.erase(0, pos);
+}
+
+// What the firmware's stream callback does with one event, minus the lamp
+void Fleet::dispatch(Board &board)
+{
+  stats.events++;
+  if (board.event != "put" && board.event != "patch")
+    return;
+
+  // Envelope {"path":"/...","data":...}, unpacked by FirebaseClient on a board
+  const std::string &d = board.data;
+  size_t pathAt = d.find("\"path\":\"");
+  size_t dataAt = d.find("\"data\":");
+  if (pathAt == std::string::npos || dataAt == std::string::npos || d.size() < dataAt + 8)
+    return;
+  pathAt += 8;
+  size_t pathEnd = d.find('"', pathAt);
+  dataAt += 7;
+
+  FieldUpdate updates[MAX_FIELD_UPDATES];
+  size_t count = decodeStreamUpdate(d.data() + pathAt, pathEnd - pathAt, d.data() + dataAt,
+                                    d.size() - 1 - dataAt, updates);
+
+  bool changed = false;
+  for (size_t i = 0; i < count; i++)
+    changed |= setLightField(board.state, updates[i].field, updates[i].value);
+  if (!changed)
+    return;
+  stats.applied++;
+
+  Pending &p = pending[board.id];
+  if (board.state.remaining == p.value.load(std::memory_order_acquire))
+  {
+    uint32_t us = (uint32_t)((nowNs() - p.sentNs.load()) / 1000);
+    p.value = -1;
+    while (m_samplesLock.test_and_set(std::memory_order_acquire))
+    {
+    }
+    m_samples.push_back(us);
+    m_samplesLock.clear(std::memory_order_release);
+  }
+}
+
+std::vector<uint32_t> Fleet::takeSamples()
+{
+  std::vector<uint32_t> samples;
+  while (m_samplesLock.test_and_set(std::memory_order_acquire))
+  {
+  }
+  samples.swap(m_samples);
+  m_samplesLock.clear(std::memory_order_release);
+  return samples;
+}
+
+size_t Fleet::measureStateBytes() const
+{
+  size_t total = 0;
+  for (Board *board : m_boards)
+    total += sizeof(Board) + board->buf.capacity() + board->event.capacity() + board->data.capacity();
+  return m_boards.empty() ? 0 : total / m_boards.size();
+}
+
+// ================= DRIVER =================
+// Stands in for the backend: PATCHes a new remaintime into one light at a
+// time, round robin, like the device-view mirror writes a render change.
+
+static void runDriver(const sockaddr_in &server, const std::string &team, const std::string &node,
+                      Fleet &fleet, int rate, std::atomic<uint64_t> &sent, const std::atomic<bool> &stop)
+{
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (::connect(fd, (const sockaddr *)&server, sizeof(server)) < 0)
+  {
+    perror("driver connect");
+    return;
+  }
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  std::vector<int> values(65536, 0);
+  uint64_t next = nowNs();
+  int light = 0;
+  char response[4096];
+
+  while (!stop)
+  {
+    int boards = fleet.connected.load();
+    if (rate <= 0 || boards == 0)
+    {
+      usleep(10000);
+      next = nowNs();
+      continue;
+    }
+
+    uint64_t now = nowNs();
+    if (now < next)
+    {
+      usleep((next - now) / 1000);
+      continue;
+    }
+    next += 1000000000ULL / rate;
+
+    light = (light + 1) % boards;
+    // Values outside a normal countdown so every write is a real change
+    int value = 1000 + (++values[light] % 8999);
+    std::string body = "{\"remaintime\":" + std::to_string(value) + "}";
+    std::string request = "PATCH /teams/" + team + "/" + node + "/" + std::to_string(light) +
+                          ".json HTTP/1.1\r\nHost: localhost\r\nContent-Length: " +
+                          std::to_string(body.size()) + "\r\n\r\n" + body;
+
+    fleet.pending[light].sentNs.store(nowNs());
+    fleet.pending[light].value.store(value, std::memory_order_release);
+    if (!sendAll(fd, request))
+      break;
+    sent++;
+
+    // One response per request; the body echoes the small PATCH
+    ssize_t n = recv(fd, response, sizeof(response), 0);
+    if (n <= 0)
+      break;
+  }
+  close(fd);
+}
+
+// ================= MAIN =================
+
+static void usage()
+{
+  fprintf(stderr,
+          "usage: fleet_sim [--steps N,N,...] [--seconds S] [--rate UPDATES_PER_S]\n"
+          "                 [--team ID] [--full-node] [--server HOST:PORT | --serve PORT]\n");
+}
+
+static uint32_t percentile(std::vector<uint32_t> &sorted, double p)
+{
+  if (sorted.empty())
+    return 0;
+  return sorted[std::min(sorted.size() - 1, (size_t)(p / 100.0 * (sorted.size() - 1) + 0.5))];
+}
+
+int main(int argc, char **argv)
+{
+  std::vector<int> steps = {100, 500, 1000, 2000};
+  int seconds = 20;
+  int rate = 100;
+  int port = 0;
+  std::string team = "10";
+  std::string node = "device_view";
+  std::string external;
+  bool serveOnly = false;
+
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--steps" && hasValue)
+    {
+      steps.clear();
+      for (char *tok = strtok(argv[++i], ","); tok; tok = strtok(nullptr, ","))
+        steps.push_back(atoi(tok));
+    }
+    else if (arg == "--seconds" && hasValue)
+      seconds = atoi(argv[++i]);
+    else if (arg == "--rate" && hasValue)
+      rate = atoi(argv[++i]);
+    else if (arg == "--team" && hasValue)
+      team = argv[++i];
+    else if (arg == "--full-node")
+      node = "traffic_lights";
+    else if (arg == "--server" && hasValue)
+      external = argv[++i];
+    else if (arg == "--serve" && hasValue)
+    {
+      port = atoi(argv[++i]);
+      serveOnly = true;
+    }
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+
+  if (!steps.empty() && steps.back() > 65536)
+  {
+    fprintf(stderr, "at most 65536 boards\n");
+    return 2;
+  }
+
+  // Each in-process board needs four descriptors (two per side)
+  rlimit limit;
+  getrlimit(RLIMIT_NOFILE, &limit);
+  limit.rlim_cur = limit.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &limit);
+  size_t needed = (size_t)(steps.empty() ? 0 : steps.back()) * (external.empty() ? 4 : 2) + 64;
+  if (limit.rlim_cur < needed)
+    fprintf(stderr, "warning: open file limit %lu is below the %zu the largest step needs\n",
+            (unsigned long)limit.rlim_cur, needed);
+
+  std::atomic<bool> stop{false};
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  std::thread serverThread;
+  StandInServer *server = nullptr;
+
+  if (external.empty())
+  {
+    if (port == 0)
+      port = freeLoopbackPort();
+
+    server = new StandInServer(port);
+    if (!server->start())
+      return 1;
+
+    if (serveOnly)
+    {
+      printf("RTDB stand-in listening on 127.0.0.1:%d\n", port);
+      server->run(stop);
+      return 0;
+    }
+    serverThread = std::thread([&] { server->run(stop); });
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+  }
+  else
+  {
+    size_t colon = external.rfind(':');
+    if (colon == std::string::npos || inet_pton(AF_INET, external.substr(0, colon).c_str(), &addr.sin_addr) != 1)
+    {
+      usage();
+      return 2;
+    }
+    addr.sin_port = htons(atoi(external.c_str() + colon + 1));
+  }
+
+  long baseRss = rssBytes();
+  Fleet *fleet = new Fleet(addr, team, node);
+  std::atomic<uint64_t> driverSent{0};
+  std::thread fleetThread([&] { fleet->run(stop); });
+  std::thread driverThread([&] { runDriver(addr, team, node, *fleet, rate, driverSent, stop); });
+
+  printf("stream node: %s, driver rate: %d updates/s, %d s per step%s\n", node.c_str(), rate, seconds,
+         external.empty() ? ", in-process stand-in" : "");
+  printf("%7s %8s %9s %9s %7s %8s %8s %8s %8s %6s %10s %10s %9s\n", "boards", "ramp_ms", "events/s", "writes/s",
+         "hb/s", "p50_ms", "p90_ms", "p99_ms", "max_ms", "lost", "rss/board", "sim/board", "backlog");
+
+  for (int boards : steps)
+  {
+    uint64_t rampStart = nowNs();
+    fleet->target = boards;
+    while (fleet->connected.load() + (int)fleet->stats.connectFailures.load() < boards)
+      usleep(10000);
+    uint64_t rampMs = (nowNs() - rampStart) / 1000000;
+
+    // Let the initial puts settle before measuring
+    usleep(500000);
+    fleet->takeSamples();
+    uint64_t events0 = fleet->stats.events, hb0 = fleet->stats.heartbeats;
+    uint64_t writes0 = server ? server->stats.writes.load() : 0;
+    uint64_t sent0 = driverSent;
+    if (server)
+      server->stats.maxBacklog = 0;
+
+    sleep(seconds);
+
+    std::vector<uint32_t> samples = fleet->takeSamples();
+    std::sort(samples.begin(), samples.end());
+    uint64_t sent = driverSent - sent0;
+    long lost = (long)sent - (long)samples.size();
+    double events = (double)(fleet->stats.events - events0) / seconds;
+    double writes = server ? (double)(server->stats.writes - writes0) / seconds : (double)sent / seconds;
+    double hb = (double)(fleet->stats.heartbeats - hb0) / seconds;
+    long rss = (rssBytes() - baseRss) / std::max(1, fleet->connected.load());
+
+    printf("%7d %8llu %9.0f %9.0f %7.0f %8.2f %8.2f %8.2f %8.2f %6ld %10ld %10zu %9llu\n", boards,
+           (unsigned long long)rampMs, events, writes, hb, percentile(samples, 50) / 1000.0,
+           percentile(samples, 90) / 1000.0, percentile(samples, 99) / 1000.0,
+           samples.empty() ? 0.0 : samples.back() / 1000.0, std::max(0L, lost), rss, fleet->stateBytes.load(),
+           server ? (unsigned long long)server->stats.maxBacklog.load() : 0ULL);
+    fflush(stdout);
+  }
+
+  printf("disconnects: %llu, connect failures: %llu\n", (unsigned long long)fleet->stats.disconnects.load(),
+         (unsigned long long)fleet->stats.connectFailures.load());
+
+  // Sockets and threads go away with the process
+  stop = true;
+  driverThread.join();
+  fleetThread.join();
+  if (serverThread.joinable())
+    serverThread.join();
+  return 0;
+}
@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+"""Generate src/config_page.h from portal/config.html.
+
+The page is split at its %PLACEHOLDER% markers. Every static piece is
+deflated on its own and ends with a full flush, which leaves the output byte
+aligned and with no back-references across the cut. At runtime the board
+streams these pieces straight from flash and puts each escaped value in
+between as a stored (uncompressed) deflate block, so the browser receives
+one valid gzip stream (see gzip_template.cpp).
+
+Run after editing the page:
+  python3 tools/gen_portal.py
+"""
+
+import os
+import re
+import zlib
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SOURCE = os.path.join(ROOT, "portal", "config.html")
+OUTPUT = os.path.join(ROOT, "src", "config_page.h")
+
+
+def deflate_piece(data: bytes) -> bytes:
+    compressor = zlib.compressobj(9, zlib.DEFLATED, -15, 9)
+    return compressor.compress(data) + compressor.flush(zlib.Z_FULL_FLUSH)
+
+
+def c_bytes(data: bytes) -> str:
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append("    " + ", ".join(f"0x{b:02x}" for b in data[i:i + 16]) + ",")
+    return "\n".join(lines)
+
+
+def main():
+    with open(SOURCE, "rb") as f:
+        page = f.read()
+
+    parts = re.split(rb"%([A-Z][A-Z0-9_]*)%", page)
+    statics, names = parts[0::2], [p.decode() for p in parts[1::2]]
+    fields = list(dict.fromkeys(names))
+
+    out = [
+        "// Generated by tools/gen_portal.py from portal/config.html - do not edit.",
+        "#ifndef CONFIG_PAGE_H",
+        "#define CONFIG_PAGE_H",
+        "",
+        '#include "gzip_template.h"',
+        "",
+        "enum PortalField",
+        "{",
+    ]
+    out += [f"  PORTAL_{name}," for name in fields]
+    out += ["  PORTAL_FIELD_COUNT", "};", ""]
+
+    raw_total = deflated_total = 0
+    for i, piece in enumerate(statics):
+        deflated = deflate_piece(piece)
+        raw_total += len(piece)
+        deflated_total += len(deflated)
+        out.append(f"static const uint8_t portalPiece{i}[] PROGMEM = {{")
+        out.append(c_bytes(deflated))
+        out.append("};")
+        out.append("")
+
+    out.append(f"// {raw_total} bytes of HTML, {deflated_total} bytes deflated")
+    out.append("static const GzipSegment configPageSegments[] = {")
+    for i, piece in enumerate(statics):
+        field = f"PORTAL_{names[i]}" if i < len(names) else "GZIP_NO_FIELD"
+        crc = zlib.crc32(piece) & 0xFFFFFFFF
+        out.append(f"    {{portalPiece{i}, sizeof(portalPiece{i}), {len(piece)}, 0x{crc:08x}, {field}}},")
+    out += ["};", "", "#endif", ""]
+
+    with open(OUTPUT, "w") as f:
+        f.write("\n".join(out))
+    print(f"{os.path.relpath(OUTPUT, ROOT)}: {raw_total} bytes of HTML -> {deflated_total} bytes deflated")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,20 @@
+// Host stand-in for the few Arduino pieces src/lamp_driver.h uses, so
+// tools/lamp_driver_check.cpp can build the real lamp driver backends.
+// Register writes go to hostRegWrite(), which the check implements on a
+// simulated GPIO output register.
+
+#ifndef TOOLS_HOST_ARDUINO_H
+#define TOOLS_HOST_ARDUINO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+const uint8_t OUTPUT = 0x03;
+
+void pinMode(uint8_t pin, uint8_t mode);
+void hostRegWrite(uint32_t reg, uint32_t value);
+
+#define REG_WRITE(reg, value) hostRegWrite((reg), (value))
+
+#endif
@@ -0,0 +1,9 @@
+// Host stand-in for the ESP32 GPIO output registers (see tools/host/Arduino.h)
+
+#ifndef TOOLS_HOST_SOC_GPIO_REG_H
+#define TOOLS_HOST_SOC_GPIO_REG_H
+
+#define GPIO_OUT_W1TS_REG 0x3FF44008
+#define GPIO_OUT_W1TC_REG 0x3FF4400C
+
+#endif
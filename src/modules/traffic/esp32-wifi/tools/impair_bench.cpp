@@ -0,0 +1,960 @@
+// Network impairment bench.
+//
+// Measures how long a board takes to notice that its stream stopped
+// delivering, and how long it takes to show the current plan again once the
+// network is back. One virtual board runs the firmware's stream handling:
+// events decoded by lib/TrafficCore/LightState, liveness judged by
+// lib/TrafficCore/StreamWatchdog (stream errors and silence), the Wi-Fi
+// check every 5 s and the offline-blink condition of loop(). It reaches the
+// stand-in (tools/rtdb_standin.h) through a proxy that impairs the path on
+// command: extra delay, lost segments (each one stalls the connection for a
+// retransmission timeout), a blackhole, a reset of every connection, and
+// half-open streams that stop delivering without a FIN or RST.
+//
+// A driver writes a new remaintime every second, like the backend's
+// countdown. For each scenario the bench reports
+//   detect_ms   impairment start to offline blink (- if it never blinked)
+//   recover_ms  impairment end to the board showing the current value again
+//   blink_ms    time spent blinking
+//   reopens     streams the watchdog closed and opened again
+//   p50/max_ms  delivery latency of the updates that got through
+//   missed      updates written meanwhile that the board never showed
+// All times are board time; --scale N runs every clock N times faster.
+//
+// Linux only. Build from the esp32-wifi directory:
+//   g++ -std=c++17 -O2 -pthread -Ilib/TrafficCore -o impair_bench
+//       tools/impair_bench.cpp lib/TrafficCore/LightState.cpp
+//       lib/TrafficCore/StreamWatchdog.cpp
+//
+// Examples:
+//   ./impair_bench                         # every scenario in real time
+//   ./impair_bench --scale 10              # the same, ten times faster
+//   ./impair_bench --only half_open,tls_reset --stale-ms 20000
+
+#include "LightState.h"
+#include "StreamWatchdog.h"
+#include "rtdb_standin.h"
+
+#include <deque>
+#include <mutex>
+#include <poll.h>
+#include <thread>
+
+static const uint32_t COUNTDOWN_MS = 1000;     // backend writes remaintime once a second
+static const uint32_t WIFI_CHECK_MS = 5000;    // firmware "wifi" job
+static const uint32_t WATCHDOG_TICK_MS = 1000; // firmware "stream_watchdog" job
+static const uint32_t CLIENT_RETRY_MS = 1000;  // stream client reconnect after an error
+static const uint32_t MIN_RTO_MS = 200;        // first retransmission timeout
+static const uint32_t SETTLE_MS = 3000;        // in sync this long before a scenario
+static const uint32_t RECOVER_LIMIT_MS = 180000;
+static const uint64_t HELD = UINT64_MAX;       // chunk waits for the blackhole to end
+
+static double g_scale = 1.0;
+
+// Board time: the host clock, sped up by --scale
+static uint64_t boardNowMs()
+{
+  return (uint64_t)(nowNs() * g_scale / 1000000.0);
+}
+
+// Host time for a span of board time
+static uint64_t hostNs(uint64_t boardMs)
+{
+  return (uint64_t)(boardMs * 1000000.0 / g_scale);
+}
+
+static void sleepBoardMs(uint64_t ms)
+{
+  uint64_t ns = hostNs(ms);
+  timespec ts = {(time_t)(ns / 1000000000ULL), (long)(ns % 1000000000ULL)};
+  nanosleep(&ts, nullptr);
+}
+
+static int connectTo(const sockaddr_in &addr)
+{
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+  if (::connect(fd, (const sockaddr *)&addr, sizeof(addr)) < 0)
+  {
+    close(fd);
+    return -1;
+  }
+  setNonBlocking(fd);
+  return fd;
+}
+
+// Close with an RST instead of a FIN, as a peer that lost its TLS session does
+static void resetClose(int fd)
+{
+  linger hard = {1, 0};
+  setsockopt(fd, SOL_SOCKET, SO_LINGER, &hard, sizeof(hard));
+  close(fd);
+}
+
+// ================= IMPAIRMENT PROXY =================
+// Forwards each connection to the stand-in. Every chunk read from one side
+// is queued with the time it may leave; chunks never overtake each other, so
+// a lost segment holds up everything behind it, as in TCP.
+
+class ImpairProxy
+{
+public:
+  ImpairProxy(const sockaddr_in &upstream, uint32_t handshakeMs) : m_upstream(upstream), m_handshakeMs(handshakeMs) {}
+
+  bool start(int port);
+  void run(const std::atomic<bool> &stop);
+
+  // Called from the bench thread, applied on the proxy's next pass
+  void impair(uint32_t delayMs, uint32_t lossPct, bool blackhole);
+  void resetAll();
+  void freezeStreams();
+
+private:
+  struct Chunk
+  {
+    uint64_t dueNs;
+    std::string data;
+  };
+
+  struct Pipe
+  {
+    std::deque<Chunk> chunks;
+    uint64_t lastDueNs = 0;
+    uint32_t lossRun = 0; // consecutive losses, each doubles the timeout
+  };
+
+  struct Link
+  {
+    int client = -1;
+    int upstream = -1; // -1 while parked in a blackhole
+    bool stream = false;
+    bool frozen = false; // half-open: the board's side stays open, nothing moves
+    bool closed = false;
+    Pipe toServer;
+    Pipe toBoard;
+  };
+
+  void applyCommands(uint64_t now);
+  void enqueue(Link &link, Pipe &pipe, const char *data, size_t len, uint64_t now);
+  bool readSide(Link &link, int fd, Pipe &pipe, uint64_t now);
+  bool deliver(int fd, Pipe &pipe, uint64_t now);
+  void closeLink(Link &link, bool reset);
+
+  sockaddr_in m_upstream;
+  uint32_t m_handshakeMs;
+  int m_listenFd = -1;
+  std::vector<Link *> m_links;
+
+  // Current impairment, owned by the proxy thread
+  uint32_t m_delayMs = 0;
+  uint32_t m_lossPct = 0;
+  bool m_blackhole = false;
+
+  // Commands from the bench thread
+  std::mutex m_lock;
+  uint32_t m_nextDelayMs = 0;
+  uint32_t m_nextLossPct = 0;
+  bool m_nextBlackhole = false;
+  bool m_resetPending = false;
+  bool m_freezePending = false;
+};
+
+bool ImpairProxy::start(int port)
+{
+  m_listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  int one = 1;
+  setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+  if (bind(m_listenFd, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(m_listenFd, 16) < 0)
+  {
+    perror("proxy listen");
+    return false;
+  }
+  setNonBlocking(m_listenFd);
+  return true;
+}
+
+void ImpairProxy::impair(uint32_t delayMs, uint32_t lossPct, bool blackhole)
+{
+  std::lock_guard<std::mutex> guard(m_lock);
+  m_nextDelayMs = delayMs;
+  m_nextLossPct = lossPct;
+  m_nextBlackhole = blackhole;
+}
+
+void ImpairProxy::resetAll()
+{
+  std::lock_guard<std::mutex> guard(m_lock);
+  m_resetPending = true;
+}
+
+void ImpairProxy::freezeStreams()
+{
+  std::lock_guard<std::mutex> guard(m_lock);
+  m_freezePending = true;
+}
+
+void ImpairProxy::applyCommands(uint64_t now)
+{
+  std::lock_guard<std::mutex> guard(m_lock);
+  bool released = m_blackhole && !m_nextBlackhole;
+  m_delayMs = m_nextDelayMs;
+  m_lossPct = m_nextLossPct;
+  m_blackhole = m_nextBlackhole;
+
+  if (m_resetPending)
+  {
+    for (Link *link : m_links)
+      closeLink(*link, true);
+    m_resetPending = false;
+  }
+
+  if (m_freezePending)
+  {
+    // The server's end goes away; the board's end hears nothing about it
+    for (Link *link : m_links)
+    {
+      if (!link->stream || link->closed)
+        continue;
+      link->frozen = true;
+      link->toServer.chunks.clear();
+      link->toBoard.chunks.clear();
+      if (link->upstream >= 0)
+        close(link->upstream);
+      link->upstream = -1;
+    }
+    m_freezePending = false;
+  }
+
+  if (!released)
+    return;
+
+  // What the blackhole held goes out now, in order; parked connections reach the server
+  for (Link *link : m_links)
+  {
+    if (link->closed || link->frozen)
+      continue;
+    if (link->upstream < 0)
+    {
+      // Parked since the handshake began, which only completes now
+      link->upstream = connectTo(m_upstream);
+      if (link->upstream < 0)
+      {
+        closeLink(*link, false);
+        continue;
+      }
+      link->toServer.lastDueNs = now + hostNs(m_handshakeMs);
+    }
+    for (Pipe *pipe : {&link->toServer, &link->toBoard})
+    {
+      pipe->lastDueNs = std::max(pipe->lastDueNs, now);
+      for (Chunk &chunk : pipe->chunks)
+      {
+        if (chunk.dueNs == HELD)
+          chunk.dueNs = pipe->lastDueNs;
+      }
+    }
+  }
+}
+
+void ImpairProxy::enqueue(Link &link, Pipe &pipe, const char *data, size_t len, uint64_t now)
+{
+  if (link.frozen)
+    return;
+
+  uint64_t due = HELD;
+  if (!m_blackhole)
+  {
+    due = now + hostNs(m_delayMs);
+    if (m_lossPct > 0 && (uint32_t)(rand() % 100) < m_lossPct)
+    {
+      // Retransmitted after the timeout, which doubles while losses repeat
+      due += hostNs((uint64_t)MIN_RTO_MS << std::min<uint32_t>(pipe.lossRun, 6));
+      pipe.lossRun++;
+    }
+    else
+      pipe.lossRun = 0;
+    due = std::max(due, pipe.lastDueNs);
+    pipe.lastDueNs = due;
+  }
+  pipe.chunks.push_back({due, std::string(data, len)});
+}
+
+// False once the side is gone
+bool ImpairProxy::readSide(Link &link, int fd, Pipe &pipe, uint64_t now)
+{
+  char buf[4096];
+  while (true)
+  {
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))
+      return false;
+    if (n < 0)
+      return true;
+    if (&pipe == &link.toServer && !link.stream && memmem(buf, n, "text/event-stream", 17))
+      link.stream = true;
+    enqueue(link, pipe, buf, n, now);
+  }
+}
+
+bool ImpairProxy::deliver(int fd, Pipe &pipe, uint64_t now)
+{
+  while (!pipe.chunks.empty() && pipe.chunks.front().dueNs <= now)
+  {
+    Chunk &chunk = pipe.chunks.front();
+    ssize_t n = send(fd, chunk.data.data(), chunk.data.size(), MSG_NOSIGNAL);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR))
+      return true;
+    if (n <= 0)
+      return false;
+    chunk.data.erase(0, n);
+    if (chunk.data.empty())
+      pipe.chunks.pop_front();
+  }
+  return true;
+}
+
+void ImpairProxy::closeLink(Link &link, bool reset)
+{
+  if (link.closed)
+    return;
+  for (int fd : {link.client, link.upstream})
+  {
+    if (fd < 0)
+      continue;
+    if (reset)
+      resetClose(fd);
+    else
+      close(fd);
+  }
+  link.client = link.upstream = -1;
+  link.closed = true;
+}
+
+void ImpairProxy::run(const std::atomic<bool> &stop)
+{
+  std::vector<pollfd> fds;
+  while (!stop)
+  {
+    uint64_t now = nowNs();
+    applyCommands(now);
+
+    fds.clear();
+    fds.push_back({m_listenFd, POLLIN, 0});
+    for (Link *link : m_links)
+    {
+      fds.push_back({link->client, POLLIN, 0});
+      fds.push_back({link->upstream, POLLIN, 0}); // -1 is skipped by poll()
+    }
+    poll(fds.data(), fds.size(), 1);
+    now = nowNs();
+
+    if (fds[0].revents & POLLIN)
+    {
+      int fd;
+      while ((fd = ::accept(m_listenFd, nullptr, nullptr)) >= 0)
+      {
+        setNonBlocking(fd);
+        Link *link = new Link();
+        link->client = fd;
+        // The request reaches the server once the TLS handshake would be done
+        link->toServer.lastDueNs = now + hostNs(m_handshakeMs);
+        // In a blackhole the handshake completes (the kernel does that) but
+        // nothing reaches the server
+        if (!m_blackhole)
+          link->upstream = connectTo(m_upstream);
+        m_links.push_back(link);
+      }
+    }
+
+    for (size_t i = 0; i < m_links.size() && 1 + 2 * i + 1 < fds.size(); i++)
+    {
+      Link &link = *m_links[i];
+      if (link.closed)
+        continue;
+      if ((fds[1 + 2 * i].revents & (POLLIN | POLLHUP | POLLERR)) &&
+          !readSide(link, link.client, link.toServer, now))
+      {
+        closeLink(link, false);
+        continue;
+      }
+      if (link.upstream >= 0 && fds[2 + 2 * i].fd == link.upstream &&
+          (fds[2 + 2 * i].revents & (POLLIN | POLLHUP | POLLERR)) &&
+          !readSide(link, link.upstream, link.toBoard, now))
+        closeLink(link, false);
+    }
+
+    for (Link *link : m_links)
+    {
+      if (link->closed || link->frozen)
+        continue;
+      if ((link->upstream >= 0 && !deliver(link->upstream, link->toServer, now)) ||
+          !deliver(link->client, link->toBoard, now))
+        closeLink(*link, false);
+    }
+
+    auto gone = std::remove_if(m_links.begin(), m_links.end(), [](Link *link) {
+      if (!link->closed)
+        return false;
+      delete link;
+      return true;
+    });
+    m_links.erase(gone, m_links.end());
+  }
+}
+
+// ================= DRIVER =================
+// Stands in for the backend's countdown: PATCHes a new remaintime straight
+// into the stand-in (not through the proxy) once a second.
+
+class Driver
+{
+public:
+  static const int RING = 4096;
+
+  std::atomic<int> latest{-1};
+  std::atomic<uint32_t> written{0};
+  std::atomic<bool> writeNow{false}; // next write right away, not on the second
+
+  // When a value was written (board ms), while it is among the last RING
+  uint64_t sentMs(int value) const { return m_sentMs[value % RING].load(); }
+
+  void run(const sockaddr_in &server, const std::string &path, const std::atomic<bool> &stop);
+
+private:
+  std::atomic<uint64_t> m_sentMs[RING] = {};
+};
+
+static bool request(int fd, const char *method, const std::string &path, const std::string &body)
+{
+  std::string request = std::string(method) + " " + path + ".json HTTP/1.1\r\nHost: localhost\r\nContent-Length: " +
+                        std::to_string(body.size()) + "\r\n\r\n" + body;
+  if (!sendAll(fd, request))
+    return false;
+
+  // One response per request; the body echoes the small write
+  char response[4096];
+  pollfd p = {fd, POLLIN, 0};
+  return poll(&p, 1, 1000) == 1 && recv(fd, response, sizeof(response), 0) > 0;
+}
+
+void Driver::run(const sockaddr_in &server, const std::string &path, const std::atomic<bool> &stop)
+{
+  int fd = connectTo(server);
+  if (fd < 0 || !request(fd, "PUT", path, "{\"color\":3,\"remaintime\":999,\"status\":0,\"yellow_duration\":3}"))
+  {
+    perror("driver connect");
+    return;
+  }
+
+  uint64_t next = boardNowMs();
+  uint32_t n = 0;
+  while (!stop)
+  {
+    uint64_t now = boardNowMs();
+    if (writeNow.exchange(false))
+      next = now;
+    if (now < next)
+    {
+      sleepBoardMs(std::min<uint64_t>(next - now, 10));
+      continue;
+    }
+    next += COUNTDOWN_MS;
+
+    // Values outside a normal countdown so every write is a real change
+    int value = 1000 + (int)(n++ % 8999);
+    m_sentMs[value % RING] = now;
+    latest = value;
+    written++;
+    if (!request(fd, "PATCH", path, "{\"remaintime\":" + std::to_string(value) + "}"))
+      break;
+  }
+  close(fd);
+}
+
+// ================= VIRTUAL BOARD =================
+// The firmware's Firebase transport and offline handling, minus the lamp
+
+class BenchBoard
+{
+public:
+  BenchBoard(const sockaddr_in &proxy, const std::string &path, Driver &driver, uint32_t staleMs,
+             uint32_t beaconLossMs, uint32_t assocMs)
+      : m_proxy(proxy), m_path(path), m_driver(driver), m_watchdog(staleMs), m_beaconLossMs(beaconLossMs),
+        m_assocMs(assocMs) {}
+
+  void run(const std::atomic<bool> &stop);
+
+  std::atomic<bool> apUp{true};      // set by the bench
+  std::atomic<bool> blinking{false}; // loop()'s offline condition
+  std::atomic<int> shown{-1};        // remaintime on the display
+  std::atomic<uint32_t> reopens{0};
+  std::atomic<uint64_t> downAtMs{0}; // last time the watchdog saw the link go down
+
+  struct Sample
+  {
+    int value;
+    uint32_t latencyMs;
+  };
+  std::vector<Sample> takeSamples();
+
+private:
+  bool wifiConnected(uint64_t now) const;
+  void open(uint64_t now);
+  void closeStream();
+  void readStream(uint64_t now);
+  void dispatch(uint64_t now);
+
+  sockaddr_in m_proxy;
+  std::string m_path;
+  Driver &m_driver;
+  StreamWatchdog m_watchdog;
+  uint32_t m_beaconLossMs;
+  uint32_t m_assocMs;
+
+  LightState m_state;
+  bool m_isOnline = true;
+  bool m_apWasUp = true;
+  uint64_t m_apChangedMs = 0;
+  int m_fd = -1;
+  uint64_t m_retryMs = 0;
+  bool m_headersDone = false;
+  std::string m_buf;
+  std::string m_event;
+  std::string m_data;
+
+  std::mutex m_samplesLock;
+  std::vector<Sample> m_samples;
+};
+
+// WiFi.status(): the AP's loss shows after the beacon timeout, and its return
+// after association
+bool BenchBoard::wifiConnected(uint64_t now) const
+{
+  if (m_apWasUp)
+    return m_apChangedMs == 0 || now - m_apChangedMs >= m_assocMs;
+  return now - m_apChangedMs < m_beaconLossMs;
+}
+
+void BenchBoard::open(uint64_t now)
+{
+  m_fd = connectTo(m_proxy);
+  m_headersDone = false;
+  m_buf.clear();
+  std::string request = "GET " + m_path + ".json HTTP/1.1\r\nHost: localhost\r\nAccept: text/event-stream\r\n\r\n";
+  if (m_fd >= 0 && sendAll(m_fd, request))
+    return;
+  closeStream();
+  m_retryMs = now + CLIENT_RETRY_MS;
+}
+
+void BenchBoard::closeStream()
+{
+  if (m_fd >= 0)
+    close(m_fd);
+  m_fd = -1;
+}
+
+void BenchBoard::run(const std::atomic<bool> &stop)
+{
+  uint64_t now = boardNowMs();
+  open(now);
+  m_watchdog.opened((uint32_t)now);
+  uint64_t nextWifiCheck = now + WIFI_CHECK_MS;
+  uint64_t nextWatchdog = now + WATCHDOG_TICK_MS;
+
+  while (!stop)
+  {
+    pollfd p = {m_fd, POLLIN, 0};
+    poll(&p, 1, 1);
+    now = boardNowMs();
+
+    if (apUp != m_apWasUp)
+    {
+      m_apWasUp = apUp;
+      m_apChangedMs = now;
+    }
+
+    // Scheduler jobs: "wifi" and "stream_watchdog"
+    if (now >= nextWifiCheck)
+    {
+      nextWifiCheck += WIFI_CHECK_MS;
+      m_isOnline = wifiConnected(now);
+    }
+    if (now >= nextWatchdog)
+    {
+      nextWatchdog += WATCHDOG_TICK_MS;
+      bool wasUp = m_watchdog.up();
+      if (m_isOnline && m_watchdog.check((uint32_t)now))
+      {
+        if (wasUp)
+          downAtMs = now;
+        closeStream();
+        open(now);
+        m_watchdog.opened((uint32_t)now);
+        reopens++;
+      }
+    }
+
+    // transport->loop() only runs while Wi-Fi is up
+    if (m_isOnline)
+    {
+      if (m_fd < 0 && now >= m_retryMs)
+        open(now);
+      if (m_fd >= 0 && (p.revents & (POLLIN | POLLHUP | POLLERR)))
+        readStream(now);
+    }
+
+    blinking = !m_isOnline || !m_watchdog.up();
+  }
+  closeStream();
+}
+
+void BenchBoard::readStream(uint64_t now)
+{
+  char buf[4096];
+  while (true)
+  {
+    ssize_t n = recv(m_fd, buf, sizeof(buf), 0);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))
+    {
+      // "Stream error" in processStream(); the client reconnects by itself
+      closeStream();
+      if (m_watchdog.failed((uint32_t)now))
+        downAtMs = now;
+      m_retryMs = now + CLIENT_RETRY_MS;
+      return;
+    }
+    if (n < 0)
+      break;
+    m_buf.append(buf, n);
+  }
+
+  size_t pos = 0;
+  if (!m_headersDone)
+  {
+    size_t end = m_buf.find("\r\n\r\n");
+    if (end == std::string::npos)
+      return;
+    m_headersDone = true;
+    pos = end + 4;
+  }
+
+  while (true)
+  {
+    size_t eol = m_buf.find('\n', pos);
+    if (eol == std::string::npos)
+      break;
+    if (eol == pos)
+      dispatch(now);
+    else if (m_buf.compare(pos, 7, "event: ") == 0)
+      m_event.assign(m_buf, pos + 7, eol - pos - 7);
+    else if (m_buf.compare(pos, 6, "data: ") == 0)
+      m_data.assign(m_buf, pos + 6, eol - pos - 6);
+    pos = eol + 1;
+  }
+  m_buf.erase(0, pos);
+}
+
+// processStream(): every event proves the link, put and patch carry state
+void BenchBoard::dispatch(uint64_t now)
+{
+  m_watchdog.event((uint32_t)now);
+  if (m_event != "put" && m_event != "patch")
+    return;
+
+  const std::string &d = m_data;
+  size_t pathAt = d.find("\"path\":\"");
+  size_t dataAt = d.find("\"data\":");
+  if (pathAt == std::string::npos || dataAt == std::string::npos || d.size() < dataAt + 8)
+    return;
+  pathAt += 8;
+  size_t pathEnd = d.find('"', pathAt);
+  dataAt += 7;
+
+  FieldUpdate updates[MAX_FIELD_UPDATES];
+  size_t count = decodeStreamUpdate(d.data() + pathAt, pathEnd - pathAt, d.data() + dataAt, d.size() - 1 - dataAt,
+                                    updates);
+  bool changed = false;
+  for (size_t i = 0; i < count; i++)
+    changed |= setLightField(m_state, updates[i].field, updates[i].value);
+  if (!changed || m_state.remaining == shown)
+    return;
+
+  shown = m_state.remaining;
+  if (m_state.remaining >= 1000)
+  {
+    std::lock_guard<std::mutex> guard(m_samplesLock);
+    m_samples.push_back({m_state.remaining, (uint32_t)(now - m_driver.sentMs(m_state.remaining))});
+  }
+}
+
+std::vector<BenchBoard::Sample> BenchBoard::takeSamples()
+{
+  std::lock_guard<std::mutex> guard(m_samplesLock);
+  std::vector<Sample> samples;
+  samples.swap(m_samples);
+  return samples;
+}
+
+// ================= SCENARIOS =================
+
+struct Scenario
+{
+  const char *name;
+  const char *what;
+  uint32_t durationMs; // 0 = a one-off event
+  uint32_t delayMs;    // added to every chunk, both ways
+  uint32_t lossPct;    // chunks lost; each stalls its direction for a retransmission timeout
+  bool blackhole;      // nothing gets through, new connections hang after the handshake
+  bool apDown;         // the AP is gone: Wi-Fi drops after the beacon timeout
+  bool resetAtStart;   // every connection reset (RST)
+  bool resetAtEnd;
+  bool halfOpen; // open streams stop delivering, the board's socket stays open
+};
+
+static const Scenario SCENARIOS[] = {
+    {"delay_300ms", "300 ms extra each way for 20 s", 20000, 300, 0, false, false, false, false, false},
+    {"loss_20pct", "20% segment loss for 30 s", 30000, 0, 20, false, false, false, false, false},
+    {"spike_5s", "5 s latency spike", 5000, 5000, 0, false, false, false, false, false},
+    {"tls_reset", "every connection reset once", 0, 0, 0, false, false, true, false, false},
+    {"half_open", "streams go silent, sockets stay open", 0, 0, 0, false, false, false, false, true},
+    {"ap_drop_20s", "AP gone for 20 s, sockets dead after", 20000, 0, 0, true, true, false, true, false},
+    {"blackhole_60s", "Wi-Fi up, nothing through for 60 s", 60000, 0, 0, true, false, false, false, false},
+};
+
+struct Result
+{
+  int64_t detectMs = -1;
+  int64_t recoverMs = -1;
+  uint64_t blinkMs = 0;
+  uint32_t reopens = 0;
+  uint32_t p50Ms = 0;
+  uint32_t maxMs = 0;
+  uint32_t missed = 0;
+};
+
+// Not blinking, and showing a value written at or after `sinceMs`
+static bool showsWriteSince(const BenchBoard &board, const Driver &driver, uint64_t sinceMs)
+{
+  int shown = board.shown;
+  return !board.blinking && shown >= 1000 && driver.sentMs(shown) >= sinceMs;
+}
+
+static Result runScenario(const Scenario &s, ImpairProxy &proxy, BenchBoard &board, Driver &driver)
+{
+  Result result;
+  board.takeSamples();
+  uint32_t reopens0 = board.reopens;
+  uint32_t written0 = driver.written;
+
+  uint64_t start = boardNowMs();
+  if (s.resetAtStart)
+    proxy.resetAll();
+  if (s.halfOpen)
+    proxy.freezeStreams();
+  proxy.impair(s.delayMs, s.lossPct, s.blackhole);
+  if (s.apDown)
+    board.apUp = false;
+
+  uint64_t end = start + s.durationMs;
+  uint64_t last = start;
+  bool ended = false;
+  int lastValue = -1; // on the display at recovery
+  while (true)
+  {
+    sleepBoardMs(1);
+    uint64_t now = boardNowMs();
+    // The Wi-Fi check or the watchdog, whichever noticed first
+    bool blinking = board.blinking;
+    uint64_t downAt = board.downAtMs;
+    if (blinking)
+      result.blinkMs += now - last;
+    if (result.detectMs < 0 && (blinking || downAt >= start))
+      result.detectMs = (downAt >= start ? downAt : now) - start;
+    last = now;
+
+    if (!ended && now >= end)
+    {
+      ended = true;
+      end = now;
+      proxy.impair(0, 0, false);
+      if (s.resetAtEnd)
+        proxy.resetAll();
+      board.apUp = true;
+      // Recovered once this write, or a later one, is on the display
+      driver.writeNow = true;
+    }
+    if (ended && showsWriteSince(board, driver, end))
+    {
+      result.recoverMs = now - end;
+      lastValue = board.shown;
+      break;
+    }
+    if (now - start > s.durationMs + RECOVER_LIMIT_MS)
+      break;
+  }
+
+  // Updates written up to the one shown at recovery that made it to the display
+  int first = 1000 + (int)(written0 % 8999);
+  if (lastValue < 0)
+    lastValue = driver.latest;
+  uint32_t written = (uint32_t)((lastValue - first + 8999) % 8999) + 1;
+  std::vector<uint32_t> latencies;
+  for (const BenchBoard::Sample &sample : board.takeSamples())
+  {
+    if ((uint32_t)((sample.value - first + 8999) % 8999) < written)
+      latencies.push_back(sample.latencyMs);
+  }
+  std::sort(latencies.begin(), latencies.end());
+  result.reopens = board.reopens - reopens0;
+  result.missed = written > latencies.size() ? written - latencies.size() : 0;
+  if (!latencies.empty())
+  {
+    result.p50Ms = latencies[latencies.size() / 2];
+    result.maxMs = latencies.back();
+  }
+  return result;
+}
+
+// ================= MAIN =================
+
+static void usage()
+{
+  fprintf(stderr,
+          "usage: impair_bench [--only NAME,NAME,...] [--list] [--scale N] [--stale-ms MS]\n"
+          "                    [--beacon-loss-ms MS] [--assoc-ms MS] [--handshake-ms MS] [--seed N]\n");
+}
+
+static std::string column(int64_t ms)
+{
+  return ms < 0 ? "-" : std::to_string(ms);
+}
+
+int main(int argc, char **argv)
+{
+  std::vector<std::string> only;
+  uint32_t staleMs = STREAM_STALE_MS;
+  uint32_t beaconLossMs = 6000;
+  uint32_t assocMs = 2000;
+  uint32_t handshakeMs = 1500;
+  unsigned seed = 1;
+
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--only" && hasValue)
+    {
+      for (char *tok = strtok(argv[++i], ","); tok; tok = strtok(nullptr, ","))
+        only.push_back(tok);
+    }
+    else if (arg == "--list")
+    {
+      for (const Scenario &s : SCENARIOS)
+        printf("%-14s %s\n", s.name, s.what);
+      return 0;
+    }
+    else if (arg == "--scale" && hasValue)
+      g_scale = atof(argv[++i]);
+    else if (arg == "--stale-ms" && hasValue)
+      staleMs = atoi(argv[++i]);
+    else if (arg == "--beacon-loss-ms" && hasValue)
+      beaconLossMs = atoi(argv[++i]);
+    else if (arg == "--assoc-ms" && hasValue)
+      assocMs = atoi(argv[++i]);
+    else if (arg == "--handshake-ms" && hasValue)
+      handshakeMs = atoi(argv[++i]);
+    else if (arg == "--seed" && hasValue)
+      seed = atoi(argv[++i]);
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+  if (g_scale <= 0)
+  {
+    usage();
+    return 2;
+  }
+
+  // Same losses on every run unless asked otherwise
+  srand(seed);
+
+  std::atomic<bool> stop{false};
+  int serverPort = freeLoopbackPort();
+  StandInServer server(serverPort, hostNs(STREAM_KEEPALIVE_MS));
+  if (!server.start())
+    return 1;
+  sockaddr_in serverAddr = {};
+  serverAddr.sin_family = AF_INET;
+  serverAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  serverAddr.sin_port = htons(serverPort);
+
+  int proxyPort = freeLoopbackPort();
+  ImpairProxy proxy(serverAddr, handshakeMs);
+  if (!proxy.start(proxyPort))
+    return 1;
+  sockaddr_in proxyAddr = serverAddr;
+  proxyAddr.sin_port = htons(proxyPort);
+
+  std::string path = "/teams/10/device_view/10";
+  Driver driver;
+  BenchBoard board(proxyAddr, path, driver, staleMs, beaconLossMs, assocMs);
+
+  std::thread serverThread([&] { server.run(stop); });
+  std::thread proxyThread([&] { proxy.run(stop); });
+  std::thread driverThread([&] { driver.run(serverAddr, path, stop); });
+  while (driver.latest < 0)
+    usleep(1000);
+  std::thread boardThread([&] { board.run(stop); });
+
+  printf("watchdog: stale after %u ms, keep-alive every %u ms; beacon timeout %u ms, association %u ms, "
+         "handshake %u ms; scale %.3g\n",
+         staleMs, STREAM_KEEPALIVE_MS, beaconLossMs, assocMs, handshakeMs, g_scale);
+  printf("%-14s %10s %10s %9s %8s %7s %7s %7s  %s\n", "scenario", "detect_ms", "recover_ms", "blink_ms", "reopens",
+         "p50_ms", "max_ms", "missed", "impairment");
+
+  int failed = 0;
+  for (const Scenario &s : SCENARIOS)
+  {
+    if (!only.empty() && std::find(only.begin(), only.end(), s.name) == only.end())
+      continue;
+
+    // Start each scenario from a board that has been in sync for a while
+    uint64_t syncedSince = 0;
+    uint64_t waitStart = boardNowMs();
+    while (boardNowMs() - waitStart < RECOVER_LIMIT_MS)
+    {
+      sleepBoardMs(10);
+      // The newest write may still be on its way
+      int behind = driver.latest - board.shown;
+      if (board.blinking || behind < 0 || behind > 1)
+        syncedSince = 0;
+      else if (syncedSince == 0)
+        syncedSince = boardNowMs();
+      else if (boardNowMs() - syncedSince >= SETTLE_MS)
+        break;
+    }
+
+    Result r = runScenario(s, proxy, board, driver);
+    failed += r.recoverMs < 0;
+    printf("%-14s %10s %10s %9llu %8u %7u %7u %7u  %s\n", s.name, column(r.detectMs).c_str(),
+           column(r.recoverMs).c_str(), (unsigned long long)r.blinkMs, r.reopens, r.p50Ms, r.maxMs, r.missed, s.what);
+    fflush(stdout);
+  }
+
+  // Sockets and threads go away with the process
+  stop = true;
+  boardThread.join();
+  driverThread.join();
+  proxyThread.join();
+  serverThread.join();
+  return failed ? 1 : 0;
+}
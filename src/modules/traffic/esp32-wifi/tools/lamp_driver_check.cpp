@@ -0,0 +1,288 @@
+// Lamp driver check.
+//
+// Builds the firmware's lamp driver backends (src/lamp_driver.h) on a host,
+// on a simulated GPIO output register (tools/host/), and drives the lamp
+// sequences the firmware produces through each of them and through
+// MockLampDriver (lib/TrafficCore/LampDriver.h) side by side: the normal
+// cycle, the direct switches of a preemption, the offline blink (all lamps),
+// the broken/fixing blink (red) and dark. The mock's transition log is the
+// reference.
+//
+// The outputs are sampled after every register write. The 74HC595 chain is
+// simulated down to the clock and latch edges. The check fails when
+//   - a lamp that is coming on lights while one that is going off is still
+//     lit (break before make), or a lamp outside the old and new set lights
+//   - the lamps after a write differ from the mock, or a backend's
+//     transitions (from, to, time) differ from the mock's log
+//   - a write changes a pin that is not a lamp, or the 74HC595 outputs of
+//     another head, or the chain outputs change more than once per write
+// Exits 1 on failure.
+//   ./lamp_driver_check
+//
+// Build from the esp32-wifi directory:
+//   g++ -std=c++17 -O2 -Itools/host -Isrc -Ilib/TrafficCore -o lamp_driver_check tools/lamp_driver_check.cpp lib/TrafficCore/LampDriver.cpp
+
+#include "lamp_driver.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Same pins as src/main.cpp
+const uint8_t RED_PIN = 0;
+const uint8_t YELLOW_PIN = 4;
+const uint8_t GREEN_PIN = 2;
+const uint8_t SR_DATA_PIN = 23;
+const uint8_t SR_CLOCK_PIN = 18;
+const uint8_t SR_LATCH_PIN = 5;
+const uint8_t SR_CHIPS = 2; // 5 heads, so the other heads can be checked too
+
+// Unrelated outputs that are high all along (the TM1637 lines, GPIO 21/22)
+const uint32_t OTHER_PINS = (1UL << 21) | (1UL << 22);
+
+static uint64_t simUs = 0;
+static uint64_t simClockUs()
+{
+  return simUs;
+}
+
+// ================= SIMULATED GPIO =================
+
+static uint32_t gpioOut = 0;
+
+// Sees every register write, with the output register before and after
+static void (*onRegWrite)(uint32_t before, uint32_t after) = nullptr;
+static int badWrites = 0;
+
+void pinMode(uint8_t, uint8_t) {}
+
+void hostRegWrite(uint32_t reg, uint32_t value)
+{
+  uint32_t before = gpioOut;
+  if (reg == GPIO_OUT_W1TS_REG)
+    gpioOut |= value;
+  else if (reg == GPIO_OUT_W1TC_REG)
+    gpioOut &= ~value;
+  else
+    badWrites++;
+
+  if (onRegWrite)
+    onRegWrite(before, gpioOut);
+}
+
+static bool pinHigh(uint32_t out, uint8_t pin)
+{
+  return (out >> pin) & 1;
+}
+
+// 74HC595 chain: bit chip * 8 + q is output Q<q> of chip <chip>. The shift
+// register moves on a rising clock edge, the outputs follow it on a rising
+// latch edge.
+static uint32_t srShift = 0;
+static uint32_t srOutputs = 0;
+
+static void simulateChain(uint32_t before, uint32_t after)
+{
+  if (!pinHigh(before, SR_CLOCK_PIN) && pinHigh(after, SR_CLOCK_PIN))
+    srShift = ((srShift << 1) | pinHigh(after, SR_DATA_PIN)) & ((1UL << (SR_CHIPS * 8)) - 1);
+  if (!pinHigh(before, SR_LATCH_PIN) && pinHigh(after, SR_LATCH_PIN))
+    srOutputs = srShift;
+}
+
+// ================= BACKENDS UNDER TEST =================
+
+struct Backend
+{
+  const char *name;
+  LampDriver &driver;
+  uint8_t (*lamps)();      // lamps lit on the simulated outputs
+  uint64_t (*untouched)(); // state that no lamp write may change
+  void (*observe)(uint32_t before, uint32_t after);
+};
+
+static uint8_t gpioLamps()
+{
+  return (pinHigh(gpioOut, RED_PIN) ? LAMP_RED : 0) | (pinHigh(gpioOut, YELLOW_PIN) ? LAMP_YELLOW : 0) |
+         (pinHigh(gpioOut, GREEN_PIN) ? LAMP_GREEN : 0);
+}
+
+static uint64_t gpioUntouched()
+{
+  return gpioOut & ~((1UL << RED_PIN) | (1UL << YELLOW_PIN) | (1UL << GREEN_PIN));
+}
+
+static uint8_t srHeadLamps(size_t head)
+{
+  return (srOutputs >> (head * LAMP_BITS)) & LAMP_ALL;
+}
+
+static uint8_t srLamps()
+{
+  return srHeadLamps(0);
+}
+
+// Pins outside the chain, and the outputs of heads 1 and up
+static uint64_t srUntouched()
+{
+  uint32_t pins = gpioOut & ~((1UL << SR_DATA_PIN) | (1UL << SR_CLOCK_PIN) | (1UL << SR_LATCH_PIN));
+  return ((uint64_t)pins << 32) | (srOutputs & ~(uint32_t)LAMP_ALL);
+}
+
+// ================= SEQUENCE =================
+
+struct Step
+{
+  const char *phase;
+  uint8_t lamps;
+  uint32_t holdMs;
+};
+
+// What setLight() and the blink job write, in firmware order
+static const Step SEQUENCE[] = {
+    {"cycle", LAMP_GREEN, 3000},
+    {"cycle", LAMP_GREEN, 1000}, // setLight() again with an unchanged color
+    {"cycle", LAMP_YELLOW, 2000},
+    {"cycle", LAMP_RED, 5000},
+    {"cycle", LAMP_GREEN, 3000},
+    {"preemption", LAMP_YELLOW, 2000}, // green clearing for a preemption
+    {"preemption", LAMP_RED, 1000},
+    {"preemption", LAMP_GREEN, 8000}, // the preempted direction, straight from red
+    {"preemption", LAMP_RED, 1000},   // restore: green to red without a yellow
+    {"offline", LAMP_ALL, 300},
+    {"offline", 0, 300},
+    {"offline", LAMP_ALL, 300},
+    {"status", LAMP_RED, 500}, // the status blink takes over from the offline blink
+    {"status", 0, 500},
+    {"status", LAMP_RED, 500},
+    {"status", LAMP_GREEN, 500},
+    {"status", LAMP_ALL, 300},
+    {"status", LAMP_YELLOW, 300},
+    {"dark", 0, 0},
+};
+
+static std::vector<uint8_t> samples;
+static const Backend *active = nullptr;
+
+static void sampleOutputs(uint32_t before, uint32_t after)
+{
+  if (active->observe)
+    active->observe(before, after);
+  uint8_t lamps = active->lamps();
+  if (samples.empty() || samples.back() != lamps)
+    samples.push_back(lamps);
+}
+
+static std::string lampText(uint8_t lamps)
+{
+  std::string text;
+  text += (lamps & LAMP_RED) ? 'R' : '-';
+  text += (lamps & LAMP_YELLOW) ? 'Y' : '-';
+  text += (lamps & LAMP_GREEN) ? 'G' : '-';
+  return text;
+}
+
+// Runs the sequence through the backend and the mock; returns the failures
+static int check(const Backend &backend)
+{
+  int failures = 0;
+  auto fail = [&](size_t step, const std::string &what)
+  {
+    failures++;
+    const char *phase = step < sizeof(SEQUENCE) / sizeof(SEQUENCE[0]) ? SEQUENCE[step].phase : "log";
+    printf("%s, step %zu (%s): %s\n", backend.name, step, phase, what.c_str());
+  };
+
+  MockLampDriver mock(simClockUs);
+  std::vector<LampTransition> seen;
+
+  simUs = 0;
+  gpioOut = OTHER_PINS;
+  srShift = srOutputs = 0;
+  active = &backend;
+  onRegWrite = sampleOutputs;
+
+  backend.driver.begin();
+  mock.begin();
+  if (backend.lamps() != 0)
+    fail(0, "begin() left " + lampText(backend.lamps()) + " lit");
+
+  // Other heads of the chain keep what they were set to
+  typedef ShiftRegisterLampDriver<SR_DATA_PIN, SR_CLOCK_PIN, SR_LATCH_PIN, SR_CHIPS> Chain;
+  Chain *chain = dynamic_cast<Chain *>(&backend.driver);
+  if (chain)
+  {
+    chain->writeHead(1, LAMP_GREEN);
+    chain->writeHead(4, LAMP_RED);
+    if (srHeadLamps(1) != LAMP_GREEN || srHeadLamps(4) != LAMP_RED || srLamps() != 0)
+      fail(0, "writeHead() drove the wrong outputs");
+  }
+  uint64_t untouched = backend.untouched();
+
+  for (size_t i = 0; i < sizeof(SEQUENCE) / sizeof(SEQUENCE[0]); i++)
+  {
+    uint8_t from = backend.lamps();
+    uint8_t to = SEQUENCE[i].lamps;
+    uint8_t goingOff = from & ~to;
+    uint8_t comingOn = to & ~from;
+
+    samples.assign(1, from);
+    backend.driver.write(to);
+    mock.write(to);
+
+    for (uint8_t lit : samples)
+    {
+      if (lit & ~(from | to))
+        fail(i, lampText(lit) + " lit between " + lampText(from) + " and " + lampText(to));
+      if ((lit & goingOff) && (lit & comingOn))
+        fail(i, lampText(lit) + " lit: " + lampText(comingOn) + " on before " + lampText(goingOff) + " off");
+    }
+    if (chain && samples.size() > 2)
+      fail(i, "chain outputs changed " + std::to_string(samples.size() - 1) + " times in one write");
+    if (backend.lamps() != to || backend.lamps() != mock.lamps() || backend.driver.lamps() != to)
+      fail(i, "outputs " + lampText(backend.lamps()) + ", driver " + lampText(backend.driver.lamps()) + ", mock " +
+                  lampText(mock.lamps()) + ", expected " + lampText(to));
+    if (backend.untouched() != untouched)
+      fail(i, "a write changed a pin or head that is not this head's lamps");
+
+    if (backend.lamps() != from)
+      seen.push_back({simUs, from, backend.lamps()});
+    simUs += SEQUENCE[i].holdMs * 1000ULL;
+  }
+
+  if (seen.size() != mock.count() || mock.dropped() > 0)
+    fail(SIZE_MAX, std::to_string(seen.size()) + " transitions, mock has " + std::to_string(mock.count()));
+  for (size_t i = 0; i < seen.size() && i < mock.count(); i++)
+  {
+    const LampTransition &want = mock.at(i);
+    if (seen[i].atUs != want.atUs || seen[i].from != want.from || seen[i].to != want.to)
+      fail(SIZE_MAX, "transition " + std::to_string(i) + " is " + lampText(seen[i].from) + " -> " +
+                         lampText(seen[i].to) + ", mock has " + lampText(want.from) + " -> " + lampText(want.to));
+  }
+
+  onRegWrite = nullptr;
+  printf("%-24s %11zu %8d\n", backend.name, seen.size(), failures);
+  return failures;
+}
+
+int main()
+{
+  GpioLampDriver<LampPins<RED_PIN, YELLOW_PIN, GREEN_PIN>> gpio;
+  ShiftRegisterLampDriver<SR_DATA_PIN, SR_CLOCK_PIN, SR_LATCH_PIN, SR_CHIPS> chain;
+
+  const Backend backends[] = {
+      {"GpioLampDriver", gpio, gpioLamps, gpioUntouched, nullptr},
+      {"ShiftRegisterLampDriver", chain, srLamps, srUntouched, simulateChain},
+  };
+
+  printf("%-24s %11s %8s\n", "backend", "transitions", "failures");
+  int failures = 0;
+  for (const Backend &backend : backends)
+    failures += check(backend);
+
+  if (badWrites > 0)
+  {
+    printf("%d writes to a register other than GPIO_OUT_W1TS/W1TC\n", badWrites);
+    failures++;
+  }
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+"""Build OTA artifacts for the traffic light firmware.
+
+Produces, in the output directory:
+  firmware-<version>.bin.gz          gzip-compressed full image
+  delta-<base>-<version>.tld.gz      gzip-compressed delta (with --base)
+  manifest.json                      manifest read by the board (ota_update.cpp)
+  manifest.json.sig                  hex HMAC-SHA256 of manifest.json under the
+                                     OTA key the fleet was built with
+
+Example:
+  OTA_KEY=... python3 tools/make_ota.py --version 1.1.0 \
+      --image .pio/build/esp32doit-devkit-v1/firmware.bin \
+      --base old/firmware.bin --base-version 1.0.0 --rollout 10 --out ota/
+  python3 -m http.server 8000 --directory ota/
+
+After editing manifest.json by hand (raising "rollout"), sign it again:
+  OTA_KEY=... python3 tools/make_ota.py --sign ota/manifest.json
+"""
+
+import argparse
+import gzip
+import hashlib
+import hmac
+import json
+import os
+import re
+import struct
+import sys
+
+BLOCK = 16      # bytes hashed when looking for matches in the base image
+MIN_COPY = 32   # shorter matches are cheaper as literals
+
+
+def make_delta(base: bytes, new: bytes) -> bytes:
+    """Greedy COPY/INSERT delta of `new` against `base` (format in ota_update.cpp)."""
+    index = {}
+    for off in range(0, len(base) - BLOCK + 1, 4):
+        index.setdefault(base[off:off + BLOCK], off)
+
+    out = bytearray(b"TLD1" + struct.pack("<I", len(new)))
+    literal = bytearray()
+
+    def flush_literal():
+        if literal:
+            out.extend(b"I" + struct.pack("<I", len(literal)) + literal)
+            literal.clear()
+
+    i = 0
+    while i < len(new):
+        src = index.get(new[i:i + BLOCK])
+        length = 0
+        if src is not None:
+            while (i + length < len(new) and src + length < len(base)
+                   and new[i + length] == base[src + length]):
+                length += 1
+        if length >= MIN_COPY:
+            flush_literal()
+            out.extend(b"C" + struct.pack("<II", src, length))
+            i += length
+        else:
+            literal.append(new[i])
+            i += 1
+
+    flush_literal()
+    out.extend(b"E")
+    return bytes(out)
+
+
+def sign(path: str, key: str):
+    """Write <path>.sig, checked by the board before it reads the manifest."""
+    with open(path, "rb") as f:
+        body = f.read()
+    with open(path + ".sig", "w") as f:
+        f.write(hmac.new(key.encode(), body, hashlib.sha256).hexdigest())
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--version", help="version of the new image (FIRMWARE_VERSION), like 1.1.0")
+    parser.add_argument("--image", help="new firmware.bin")
+    parser.add_argument("--base", help="firmware.bin currently running on the fleet, enables a delta")
+    parser.add_argument("--base-version", default="base", help="version label for the delta file name")
+    parser.add_argument("--rollout", type=int, default=100, help="percentage of boards offered the update")
+    parser.add_argument("--out", default="ota", help="output directory")
+    parser.add_argument("--key", default=os.environ.get("OTA_KEY"), help="OTA key (or $OTA_KEY)")
+    parser.add_argument("--sign", metavar="MANIFEST", help="only sign an existing manifest again")
+    args = parser.parse_args()
+
+    if not args.key:
+        sys.exit("no OTA key: pass --key or set OTA_KEY")
+    if args.sign:
+        sign(args.sign, args.key)
+        print(f"{args.sign}.sig written")
+        return
+    if not args.version or not args.image:
+        sys.exit("--version and --image are required")
+    if not re.fullmatch(r"v?\d{1,5}(\.\d{1,5}){0,2}", args.version):
+        sys.exit("--version must be numeric, like 1.1.0 (the board compares it with FIRMWARE_VERSION)")
+
+    os.makedirs(args.out, exist_ok=True)
+    with open(args.image, "rb") as f:
+        image = f.read()
+
+    manifest = {
+        "version": args.version,
+        "image": f"firmware-{args.version}.bin.gz",
+        "size": len(image),
+        "md5": hashlib.md5(image).hexdigest(),
+        "rollout": max(0, min(100, args.rollout)),
+    }
+    with open(os.path.join(args.out, manifest["image"]), "wb") as f:
+        f.write(gzip.compress(image, 9))
+
+    if args.base:
+        with open(args.base, "rb") as f:
+            base = f.read()
+        manifest["delta"] = f"delta-{args.base_version}-{args.version}.tld.gz"
+        manifest["delta_base_md5"] = hashlib.md5(base).hexdigest()
+        with open(os.path.join(args.out, manifest["delta"]), "wb") as f:
+            f.write(gzip.compress(make_delta(base, image), 9))
+
+    manifest_path = os.path.join(args.out, "manifest.json")
+    with open(manifest_path, "w") as f:
+        json.dump(manifest, f, indent=2)
+    sign(manifest_path, args.key)
+
+    for name in ("image", "delta"):
+        if name in manifest:
+            size = os.path.getsize(os.path.join(args.out, manifest[name]))
+            print(f"{manifest[name]}: {size} bytes ({100.0 * size / len(image):.1f}% of image)")
+    print(f"manifest.json: version {args.version}, rollout {manifest['rollout']}%, signed")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,718 @@
+// Peer phase sync check.
+//
+// Runs several simulated boards on loopback UDP with the firmware's tick
+// encoding, election and phase mapping (lib/TrafficCore/PhaseSync.h). Phases
+// alternate 0, 1, 0, 1 by board id. Each board polls its socket every
+// --loop-ms, like the firmware loop in a peer group (PEER_POLL_MS). The
+// leader runs a short plan (green 3 s, yellow 1 s, red 6 s) and ticks on
+// every change and at least every 500 ms, like src/peer_sync.cpp. Every board
+// logs its lamp changes on one shared clock.
+//
+// The run goes through three stages:
+//   1. Board 1 boots first and leads. For one second it reports a fault
+//      (status 1), which the followers take over.
+//   2. Board 1 goes silent. Board 2 has to take over within the leader
+//      timeout plus one tick interval.
+//   3. Board 2 leads, and the boards follow it.
+//
+// The three followers time out at the same moment, so they all claim
+// leadership and the higher ids step down again. The first second after the
+// takeover is therefore left out of the agreement check.
+//
+// All along, an intruder on the same LAN receives every tick and sends
+// ticks of its own every 50 ms: board id 0 (which would win the election)
+// with a cross green, signed with a wrong key or not signed at all, and
+// every tick it recorded played again 300 ms later, board 1's ticks
+// included after board 1 went silent.
+//
+// For each follower, the check pairs every change of color or status with
+// the leader tick it maps from. It fails when a change is missing, is one
+// the leader never asked for, or lags by --limit-ms or more. It also fails
+// when a board accepts one of the intruder's ticks, or did not drop both
+// kinds, and when boards of the two phases both show something other than
+// red at any moment of the run (the all red of mapPeerPhase()). Exits 1 on
+// failure.
+//   ./peer_sync_check [--boards 4] [--cycles 2] [--loop-ms 2] [--limit-ms 10]
+//
+// Build from the esp32-wifi directory:
+//   g++ -std=c++17 -O2 -pthread -Ilib/TrafficCore -o peer_sync_check tools/peer_sync_check.cpp lib/TrafficCore/PhaseSync.cpp -lcrypto
+
+#include "PhaseSync.h"
+
+#include <arpa/inet.h>
+#include <openssl/hmac.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Same as src/peer_sync.h
+static const uint32_t TICK_INTERVAL_MS = 500;
+static const uint32_t LEADER_TIMEOUT_MS = 1500;
+static const uint16_t GROUP = 7;
+static const char GROUP_KEY[] = "group 7 key";
+static const char WRONG_KEY[] = "guessed key";
+
+// The plan a leader runs, in seconds
+static const int GREEN_S = 3;
+static const int YELLOW_S = 1;
+static const int RED_S = 6; // room for the all red at both ends
+static const int CYCLE_S = GREEN_S + YELLOW_S + RED_S;
+
+static const int64_t MS = 1000000; // ns
+
+static int64_t nowNs()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static uint32_t nowMs()
+{
+  return (uint32_t)(nowNs() / MS);
+}
+
+static void sleepMs(int64_t ms)
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+static void tickHmac(const uint8_t *key, size_t keyLen, const uint8_t *data, size_t len, uint8_t *mac)
+{
+  unsigned int macLen = 32;
+  HMAC(EVP_sha256(), key, (int)keyLen, data, len, mac, &macLen);
+}
+
+static PhaseTickKey makeKey(const char *text)
+{
+  PhaseTickKey key;
+  key.key = (const uint8_t *)text;
+  key.len = strlen(text);
+  key.hmac = tickHmac;
+  return key;
+}
+
+static int openSocket(uint16_t &port)
+{
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+  if (fd < 0 || bind(fd, (sockaddr *)&addr, sizeof(addr)) != 0 || getsockname(fd, (sockaddr *)&addr, &len) != 0)
+    return -1;
+  port = ntohs(addr.sin_port);
+  return fd;
+}
+
+// Stand-in for the multicast group: a packet goes to each peer's port
+static void sendToAll(int fd, const uint8_t *buf, size_t len, const std::vector<uint16_t> &peers)
+{
+  for (uint16_t peer : peers)
+  {
+    sockaddr_in to = {};
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    to.sin_port = htons(peer);
+    sendto(fd, buf, len, 0, (sockaddr *)&to, sizeof(to));
+  }
+}
+
+struct LampChange
+{
+  int64_t atNs;
+  int color;
+  int status;
+};
+
+struct SentTick
+{
+  int64_t atNs;
+  PhaseTick tick;
+};
+
+// The firmware's peer sync on one simulated board, with its lamp reduced to
+// color and status
+class Board
+{
+public:
+  Board(uint32_t id, uint8_t phase) : id(id), phase(phase) {}
+
+  bool open()
+  {
+    m_fd = openSocket(port);
+    return m_fd >= 0;
+  }
+
+  void run(const std::vector<uint16_t> &peers, int loopMs)
+  {
+    PhaseTickKey key = makeKey(GROUP_KEY);
+    TickReplayGuard replayGuard;
+    PeerElection election(id, LEADER_TIMEOUT_MS);
+    election.start(nowMs());
+    lamp(1, 0);
+
+    bool leading = false;
+    bool sentAny = false;
+    uint32_t nextSecondMs = 0;
+    uint32_t lastTickMs = 0;
+    PhaseTick lastSent;
+    uint32_t seq = 0;
+
+    while (!stop)
+    {
+      uint8_t buf[64];
+      ssize_t n;
+      while ((n = recv(m_fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+      {
+        PhaseTick tick;
+        if (!decodePhaseTick(buf, (size_t)n, key, tick) || tick.group != GROUP)
+        {
+          dropped++;
+          continue;
+        }
+        if (tick.boardId == id || !replayGuard.accept(tick))
+          continue;
+        if (tick.boardId == 0)
+          intruderAccepted++;
+        if (election.heard(tick.boardId, nowMs()))
+        {
+          int color, remaining;
+          mapPeerPhase(tick, phase, color, remaining);
+          if (color != m_color)
+            m_elapsed = 0;
+          m_remaining = remaining;
+          lamp(color, tick.status);
+        }
+      }
+
+      uint32_t ms = nowMs();
+      bool isLeader = election.isLeader(ms);
+      if (isLeader && !leading)
+      {
+        // Carry on with the state it showed as a follower
+        nextSecondMs = ms + 1000;
+        sentAny = false;
+      }
+      leading = isLeader;
+
+      if (leading)
+      {
+        if ((int32_t)(ms - nextSecondMs) >= 0)
+        {
+          nextSecondMs += 1000;
+          stepPlan();
+        }
+        lamp(m_color, forcedStatus);
+
+        PhaseTick tick;
+        tick.group = GROUP;
+        tick.phase = phase;
+        tick.color = (uint8_t)m_color;
+        tick.status = (uint8_t)m_status;
+        tick.yellow = YELLOW_S;
+        tick.remaining = (uint16_t)m_remaining;
+        tick.elapsed = (uint16_t)m_elapsed;
+        tick.boardId = id;
+        tick.epoch = 1;
+
+        bool changed = !sentAny || tick.color != lastSent.color || tick.status != lastSent.status ||
+                       tick.remaining != lastSent.remaining || tick.elapsed != lastSent.elapsed;
+        if (changed || ms - lastTickMs >= TICK_INTERVAL_MS)
+        {
+          tick.seq = ++seq;
+          uint8_t out[PHASE_TICK_SIZE];
+          size_t len = encodePhaseTick(tick, key, out, sizeof(out));
+          sent.push_back({nowNs(), tick});
+          sendToAll(m_fd, out, len, peers);
+          lastSent = tick;
+          lastTickMs = ms;
+          sentAny = true;
+        }
+      }
+
+      sleepMs(loopMs);
+    }
+
+    refused = replayGuard.refused();
+    close(m_fd);
+  }
+
+  // State at a point in time, from the change log
+  LampChange stateAt(int64_t atNs) const
+  {
+    LampChange state = changes.front();
+    for (const LampChange &c : changes)
+    {
+      if (c.atNs > atNs)
+        break;
+      state = c;
+    }
+    return state;
+  }
+
+  const uint32_t id;
+  const uint8_t phase;
+  uint16_t port = 0;
+
+  std::atomic<bool> stop{false};
+  std::atomic<int> forcedStatus{0}; // status the board reports while leading
+  int64_t stoppedNs = 0;
+
+  // Written by the board's thread, read after it has ended
+  std::vector<LampChange> changes;
+  std::vector<SentTick> sent;
+  int dropped = 0;          // bad tag, wrong layout or group
+  uint32_t refused = 0;     // replays, from the guard
+  int intruderAccepted = 0; // id 0 ticks that got past both
+
+private:
+  void lamp(int color, int status)
+  {
+    if (!changes.empty() && color == m_color && status == m_status)
+      return;
+    m_color = color;
+    m_status = status;
+    changes.push_back({nowNs(), color, status});
+  }
+
+  void stepPlan()
+  {
+    if (m_remaining > 1)
+    {
+      m_remaining--;
+      m_elapsed++;
+      return;
+    }
+
+    m_elapsed = 0;
+    switch (m_color)
+    {
+    case 3:
+      m_color = 2;
+      m_remaining = YELLOW_S;
+      break;
+    case 2:
+      m_color = 1;
+      m_remaining = RED_S;
+      break;
+    default:
+      m_color = 3;
+      m_remaining = GREEN_S;
+      break;
+    }
+  }
+
+  int m_fd = -1;
+  int m_color = 1;
+  int m_status = 0;
+  int m_remaining = RED_S;
+  int m_elapsed = 0;
+};
+
+// A host on the LAN without the group key. It hears every tick, because the
+// boards send to it like to any peer.
+class Intruder
+{
+public:
+  bool open()
+  {
+    m_fd = openSocket(port);
+    return m_fd >= 0;
+  }
+
+  void run(const std::vector<uint16_t> &boards)
+  {
+    PhaseTickKey wrongKey = makeKey(WRONG_KEY);
+    struct Recorded
+    {
+      int64_t atNs;
+      std::vector<uint8_t> packet;
+    };
+    std::vector<Recorded> recorded;
+    size_t replayed = 0;
+    uint32_t seq = 0;
+
+    while (!stop)
+    {
+      uint8_t buf[64];
+      ssize_t n;
+      while ((n = recv(m_fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+        recorded.push_back({nowNs(), std::vector<uint8_t>(buf, buf + n)});
+
+      // Id 0 with the leader red and the cross on green, far into the future
+      PhaseTick tick;
+      tick.group = GROUP;
+      tick.phase = 0;
+      tick.color = 1;
+      tick.remaining = 30;
+      tick.yellow = YELLOW_S;
+      tick.boardId = 0;
+      tick.epoch = 1000;
+      tick.seq = ++seq;
+      uint8_t out[PHASE_TICK_SIZE];
+      size_t len = encodePhaseTick(tick, wrongKey, out, sizeof(out));
+      sendToAll(m_fd, out, len, boards);
+      memset(out + PHASE_TICK_BODY_SIZE, 0, PHASE_TICK_TAG_SIZE);
+      sendToAll(m_fd, out, len, boards);
+      forged += 2;
+
+      // Everything it heard, again, 300 ms late
+      int64_t now = nowNs();
+      while (replayed < recorded.size() && now - recorded[replayed].atNs >= 300 * MS)
+      {
+        sendToAll(m_fd, recorded[replayed].packet.data(), recorded[replayed].packet.size(), boards);
+        replayed++;
+        replays++;
+      }
+
+      sleepMs(50);
+    }
+
+    close(m_fd);
+  }
+
+  uint16_t port = 0;
+  std::atomic<bool> stop{false};
+  int forged = 0;
+  int replays = 0;
+
+private:
+  int m_fd = -1;
+};
+
+struct Agreement
+{
+  int expected = 0;
+  int matched = 0;
+  int stray = 0;
+  int64_t maxLagNs = 0;
+  int64_t totalLagNs = 0;
+  bool startsInPhase = true;
+};
+
+static PhaseTick lastTickBefore(const std::vector<SentTick> &sent, int64_t atNs, bool &found)
+{
+  found = false;
+  PhaseTick tick;
+  for (const SentTick &s : sent)
+  {
+    if (s.atNs > atNs)
+      break;
+    tick = s.tick;
+    found = true;
+  }
+  return tick;
+}
+
+// Compare a follower with the leader's ticks in [fromNs, toNs]
+static Agreement checkFollower(const Board &leader, const Board &follower, int64_t fromNs, int64_t toNs,
+                               int64_t limitNs)
+{
+  Agreement a;
+
+  // Where the follower should be at the start of the window
+  LampChange prev = follower.stateAt(fromNs);
+  bool found;
+  PhaseTick before = lastTickBefore(leader.sent, fromNs, found);
+  if (found)
+  {
+    int color, remaining;
+    mapPeerPhase(before, follower.phase, color, remaining);
+    a.startsInPhase = color == prev.color && before.status == prev.status;
+    prev = {fromNs, color, before.status};
+  }
+
+  // Every tick that changes what the follower should show
+  std::vector<LampChange> expected;
+  for (const SentTick &s : leader.sent)
+  {
+    if (s.atNs <= fromNs || s.atNs > toNs)
+      continue;
+    int color, remaining;
+    mapPeerPhase(s.tick, follower.phase, color, remaining);
+    if (color != prev.color || s.tick.status != prev.status)
+    {
+      prev = {s.atNs, color, s.tick.status};
+      expected.push_back(prev);
+    }
+  }
+
+  // The follower's own changes in the same window, each answering one tick
+  std::vector<LampChange> actual;
+  for (const LampChange &c : follower.changes)
+  {
+    if (c.atNs > fromNs && c.atNs <= toNs + limitNs)
+      actual.push_back(c);
+  }
+
+  a.expected = (int)expected.size();
+  size_t next = 0;
+  for (const LampChange &e : expected)
+  {
+    while (next < actual.size() && actual[next].atNs < e.atNs)
+    {
+      a.stray++;
+      next++;
+    }
+    if (next == actual.size() || actual[next].color != e.color || actual[next].status != e.status)
+      continue;
+
+    int64_t lagNs = actual[next].atNs - e.atNs;
+    next++;
+    if (lagNs >= limitNs)
+      continue;
+    a.matched++;
+    a.totalLagNs += lagNs;
+    if (lagNs > a.maxLagNs)
+      a.maxLagNs = lagNs;
+  }
+  a.stray += (int)(actual.size() - next);
+  return a;
+}
+
+// Anything but red lets traffic through; a fault shows the red blink
+static bool showsGo(const LampChange &state)
+{
+  return state.status == 0 && state.color != 1;
+}
+
+// Boards of the two phases must never both show something other than red.
+// Checked at every lamp change of every board, over the whole run.
+static bool checkClearance(const std::vector<std::unique_ptr<Board>> &boards)
+{
+  std::vector<int64_t> times;
+  for (const auto &b : boards)
+  {
+    for (const LampChange &c : b->changes)
+      times.push_back(c.atNs);
+  }
+  std::sort(times.begin(), times.end());
+
+  int conflicts = 0;
+  for (int64_t t : times)
+  {
+    for (size_t i = 0; i < boards.size(); i++)
+    {
+      for (size_t j = i + 1; j < boards.size(); j++)
+      {
+        const Board &a = *boards[i];
+        const Board &b = *boards[j];
+        if (a.phase == b.phase || (a.stoppedNs != 0 && t >= a.stoppedNs) || (b.stoppedNs != 0 && t >= b.stoppedNs))
+          continue;
+        LampChange sa = a.stateAt(t);
+        LampChange sb = b.stateAt(t);
+        if (!showsGo(sa) || !showsGo(sb))
+          continue;
+        if (conflicts++ == 0)
+          printf("clearance  board %u shows %d while board %u shows %d\n", a.id, sa.color, b.id, sb.color);
+      }
+    }
+  }
+
+  printf("clearance  %d moments with both phases not red  %s\n", conflicts, conflicts ? "FAIL" : "ok");
+  return conflicts == 0;
+}
+
+static bool report(const char *stage, const Board &leader, const std::vector<std::unique_ptr<Board>> &boards,
+                   int64_t fromNs, int64_t toNs, int64_t limitNs)
+{
+  bool ok = true;
+  for (const auto &b : boards)
+  {
+    if (b.get() == &leader || (b->stoppedNs != 0 && b->stoppedNs < toNs))
+      continue;
+
+    Agreement a = checkFollower(leader, *b, fromNs, toNs, limitNs);
+    bool pass = a.startsInPhase && a.stray == 0 && a.matched == a.expected && a.expected > 0;
+    ok &= pass;
+    printf("%-10s leader %u  board %u (phase %u): %d/%d changes in time, %d stray, lag max %.2f ms avg %.2f ms%s  %s\n",
+           stage, leader.id, b->id, b->phase, a.matched, a.expected, a.stray, a.maxLagNs / 1e6,
+           a.matched ? a.totalLagNs / 1e6 / a.matched : 0.0, a.startsInPhase ? "" : ", out of phase at start",
+           pass ? "ok" : "FAIL");
+  }
+  return ok;
+}
+
+int main(int argc, char **argv)
+{
+  int boardCount = 4;
+  int cycles = 2;
+  int loopMs = 2;
+  int limitMs = 10;
+
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if (i + 1 < argc && arg == "--boards")
+      boardCount = atoi(argv[++i]);
+    else if (i + 1 < argc && arg == "--cycles")
+      cycles = atoi(argv[++i]);
+    else if (i + 1 < argc && arg == "--loop-ms")
+      loopMs = atoi(argv[++i]);
+    else if (i + 1 < argc && arg == "--limit-ms")
+      limitMs = atoi(argv[++i]);
+    else
+    {
+      fprintf(stderr, "usage: %s [--boards 4] [--cycles 2] [--loop-ms 2] [--limit-ms 10]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (boardCount < 3 || cycles < 1 || loopMs < 1)
+  {
+    fprintf(stderr, "need at least 3 boards, 1 cycle and a 1 ms loop\n");
+    return 2;
+  }
+
+  std::vector<std::unique_ptr<Board>> boards;
+  for (int i = 0; i < boardCount; i++)
+  {
+    boards.emplace_back(new Board((uint32_t)(i + 1), (uint8_t)(i % 2)));
+    if (!boards.back()->open())
+    {
+      perror("socket");
+      return 2;
+    }
+  }
+
+  Intruder intruder;
+  if (!intruder.open())
+  {
+    perror("socket");
+    return 2;
+  }
+  std::vector<uint16_t> boardPorts;
+  for (auto &b : boards)
+    boardPorts.push_back(b->port);
+  std::thread intruderThread([&intruder, boardPorts]() { intruder.run(boardPorts); });
+
+  std::vector<std::thread> threads;
+  for (auto &b : boards)
+  {
+    std::vector<uint16_t> peers = {intruder.port};
+    for (auto &other : boards)
+    {
+      if (other != b)
+        peers.push_back(other->port);
+    }
+    Board *board = b.get();
+    threads.emplace_back([board, peers, loopMs]() { board->run(peers, loopMs); });
+    // The first board leads without an election fight at boot
+    if (board == boards.front().get())
+      sleepMs(300);
+  }
+
+  Board &first = *boards[0];
+  Board &second = *boards[1];
+  int64_t planMs = (int64_t)cycles * CYCLE_S * 1000;
+
+  printf("%d boards, %d cycles of %d s per leader, loop %d ms, limit %d ms\n", boardCount, cycles, CYCLE_S, loopMs,
+         limitMs);
+
+  // Stage 1: board 1 leads, with a fault for one second in the middle
+  sleepMs(LEADER_TIMEOUT_MS);
+  sleepMs(planMs / 2);
+  first.forcedStatus = 1;
+  sleepMs(1000);
+  first.forcedStatus = 0;
+  sleepMs(planMs / 2);
+
+  // Stage 2: board 1 goes silent
+  first.stop = true;
+  threads[0].join();
+  first.stoppedNs = nowNs();
+
+  // Stage 3: board 2 leads
+  sleepMs(LEADER_TIMEOUT_MS + 1000 + planMs);
+  for (size_t i = 1; i < boards.size(); i++)
+  {
+    boards[i]->stop = true;
+    threads[i].join();
+  }
+  int64_t endNs = nowNs();
+  intruder.stop = true;
+  intruderThread.join();
+
+  int64_t limitNs = (int64_t)limitMs * MS;
+  bool ok = true;
+
+  // Only board 1 may lead before it stops
+  for (size_t i = 1; i < boards.size(); i++)
+  {
+    for (const SentTick &s : boards[i]->sent)
+    {
+      if (s.atNs < first.stoppedNs)
+      {
+        printf("board %u sent ticks while board 1 led  FAIL\n", boards[i]->id);
+        ok = false;
+        break;
+      }
+    }
+  }
+
+  if (first.sent.empty() || second.sent.empty())
+  {
+    printf("no leader: board 1 sent %zu ticks, board 2 %zu  FAIL\n", first.sent.size(), second.sent.size());
+    return 1;
+  }
+
+  // Takeover within the timeout, counted from board 1's last tick
+  int64_t takeoverStartNs = 0;
+  for (const SentTick &s : second.sent)
+  {
+    if (s.atNs > first.stoppedNs)
+    {
+      takeoverStartNs = s.atNs;
+      break;
+    }
+  }
+  int64_t takeoverNs = takeoverStartNs - first.sent.back().atNs;
+  bool takeoverOk = takeoverStartNs != 0 && takeoverNs <= (int64_t)(LEADER_TIMEOUT_MS + TICK_INTERVAL_MS) * MS;
+  ok &= takeoverOk;
+  printf("takeover   board 2 leads %.0f ms after board 1's last tick  %s\n", takeoverNs / 1e6,
+         takeoverOk ? "ok" : "FAIL");
+
+  // Higher ids that claimed at the same moment step down within the settle time
+  int64_t settleNs = 1000 * MS;
+  for (size_t i = 2; i < boards.size(); i++)
+  {
+    for (const SentTick &s : boards[i]->sent)
+    {
+      if (s.atNs > takeoverStartNs + settleNs)
+      {
+        printf("board %u still leads %.0f ms after the takeover  FAIL\n", boards[i]->id,
+               (s.atNs - takeoverStartNs) / 1e6);
+        ok = false;
+        break;
+      }
+    }
+  }
+
+  // The intruder's ticks: forged ones fail the tag, replays the guard. Board 1
+  // only leads, so the only replays it hears are its own ticks.
+  for (const auto &b : boards)
+  {
+    bool pass = b->intruderAccepted == 0 && b->dropped > 0 && (b.get() == &first || b->refused > 0);
+    ok &= pass;
+    printf("intruder   board %u: %d forged or unsigned dropped, %u replays refused, %d accepted  %s\n", b->id,
+           b->dropped, b->refused, b->intruderAccepted, pass ? "ok" : "FAIL");
+  }
+
+  ok &= checkClearance(boards);
+  ok &= report("board 1", first, boards, first.sent.front().atNs - MS, first.sent.back().atNs, limitNs);
+  ok &= report("board 2", second, boards, takeoverStartNs + settleNs, endNs - limitNs, limitNs);
+
+  printf(ok ? "PASS\n" : "FAIL\n");
+  return ok ? 0 : 1;
+}
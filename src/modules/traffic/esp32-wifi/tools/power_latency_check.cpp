@@ -0,0 +1,172 @@
+// Power mode latency check.
+//
+// Measures the latency that power-managed mode adds between a stream update
+// reaching the AP and the loop reading it, on a simulated clock:
+//   - the AP holds a frame until the board's radio next listens: every
+//     beacon (102.4 ms, DTIM 1) in normal mode, every listen interval
+//     beacons in power mode. The beacons start at a random offset.
+//   - the loop runs the firmware's job table on lib/TrafficCore/Scheduler
+//     (the jobs every configuration registers, see setupScheduler() in
+//     src/main.cpp) and then waits like powerIdle(): up to the next deadline,
+//     capped to LOOP_POLL_MS in normal mode and to POWER_IDLE_SLICE_MS in
+//     power mode. The stream client is polled, so a frame that arrives
+//     during a wait is read when the wait ends.
+// Updates reach the AP at random times. For each mode the check prints the
+// AP-to-loop latency and the difference to normal mode, and fails when a
+// power mode latency exceeds the bound powerWorstCaseAddedMs() reports
+//   listen_interval x 102.4 ms + 100 ms
+// (plus one loop pass), or stays far below it (the bound is then not the
+// worst case). Exits 1 on failure.
+//   ./power_latency_check [--updates 20000] [--seed 1]
+//
+// Build from the esp32-wifi directory:
+//   g++ -std=c++17 -O2 -Ilib/TrafficCore -o power_latency_check tools/power_latency_check.cpp lib/TrafficCore/Scheduler.cpp
+//
+// Only the waits are modelled: air time, TLS and the apply path are left
+// out, and those are the same in both modes. On a board, compare
+// tools/transport_latency.py --local in both modes.
+
+#include "Scheduler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Same as src/power_mode.h
+const unsigned long LOOP_POLL_MS = 10;
+const unsigned long POWER_IDLE_SLICE_MS = 100;
+const unsigned long BEACON_INTERVAL_US = 102400;
+
+// Work the loop does per pass besides the waits
+const uint64_t LOOP_WORK_US = 300;
+
+// The bound must be reached within this share, or it is not the worst case
+const double BOUND_REACHED = 0.9;
+
+static uint64_t simUs = 0;
+static uint64_t simClockUs()
+{
+  return simUs;
+}
+
+static void noJob() {}
+
+// listenInterval 0 is normal mode. The pass that ends a wait still does its
+// own work before the next poll, which the firmware's bound leaves out.
+static uint32_t boundUs(uint8_t listenInterval)
+{
+  if (listenInterval == 0)
+    return BEACON_INTERVAL_US + LOOP_POLL_MS * 1000UL + LOOP_WORK_US;
+  return listenInterval * BEACON_INTERVAL_US + POWER_IDLE_SLICE_MS * 1000UL + LOOP_WORK_US;
+}
+
+// Times at which the loop polls the stream client, for durationUs
+static std::vector<uint64_t> loopPolls(uint8_t listenInterval, uint64_t durationUs)
+{
+  Scheduler scheduler;
+  simUs = 0;
+  scheduler.every("wifi", 5000, noJob, simUs);
+  scheduler.every("wifi_roam", 1000, noJob, simUs);
+  scheduler.every("button", 100, noJob, simUs);
+  scheduler.every("heartbeat", 10000, noJob, simUs);
+  scheduler.every("stream_hour", 3600000UL, noJob, simUs);
+  scheduler.every("auth_rotate", 1000, noJob, simUs);
+  scheduler.every("stream_watchdog", 1000, noJob, simUs);
+  scheduler.every("outbound", 100, noJob, simUs);
+  scheduler.every("token_cache", 5000, noJob, simUs);
+
+  std::vector<uint64_t> polls;
+  unsigned long capMs = listenInterval ? POWER_IDLE_SLICE_MS : LOOP_POLL_MS;
+  while (simUs < durationUs)
+  {
+    scheduler.run(simClockUs);
+    polls.push_back(simUs); // transport->loop()
+    simUs += LOOP_WORK_US;
+
+    unsigned long idleMs = scheduler.untilNextUs(simUs) / 1000;
+    simUs += (uint64_t)std::min(idleMs, capMs) * 1000ULL;
+  }
+  return polls;
+}
+
+struct Result
+{
+  uint32_t p50Us;
+  uint32_t p99Us;
+  uint32_t maxUs;
+};
+
+static Result measure(uint8_t listenInterval, int updates, std::mt19937_64 &rng)
+{
+  const uint64_t runUs = 600ULL * 1000000ULL;
+  std::vector<uint64_t> polls = loopPolls(listenInterval, runUs + 2000000ULL);
+
+  uint64_t listenUs = (listenInterval ? listenInterval : 1) * BEACON_INTERVAL_US;
+  uint64_t offsetUs = std::uniform_int_distribution<uint64_t>(0, listenUs - 1)(rng);
+  std::uniform_int_distribution<uint64_t> arrival(listenUs, runUs);
+
+  std::vector<uint32_t> latencies;
+  for (int i = 0; i < updates; i++)
+  {
+    uint64_t atApUs = arrival(rng);
+    uint64_t receivedUs = offsetUs + (atApUs - offsetUs + listenUs - 1) / listenUs * listenUs;
+    uint64_t readUs = *std::lower_bound(polls.begin(), polls.end(), receivedUs);
+    latencies.push_back((uint32_t)(readUs - atApUs));
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+  return {latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100], latencies.back()};
+}
+
+int main(int argc, char **argv)
+{
+  int updates = 20000;
+  unsigned long seed = 1;
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--updates") && i + 1 < argc)
+      updates = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+      seed = strtoul(argv[++i], nullptr, 10);
+    else
+    {
+      fprintf(stderr, "usage: %s [--updates N] [--seed N]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  std::mt19937_64 rng(seed);
+  const uint8_t modes[] = {0, 1, 3, 10};
+
+  printf("%-8s %8s %8s %8s %8s %14s %14s\n", "mode", "p50 ms", "p99 ms", "max ms", "bound ms", "added p50 ms",
+         "added max ms");
+  int failures = 0;
+  Result normal = {};
+  for (uint8_t li : modes)
+  {
+    Result r = measure(li, updates, rng);
+    if (li == 0)
+      normal = r;
+
+    char name[16];
+    snprintf(name, sizeof(name), li ? "li %u" : "normal", li);
+    printf("%-8s %8.1f %8.1f %8.1f %8.1f %14.1f %14.1f\n", name, r.p50Us / 1000.0, r.p99Us / 1000.0,
+           r.maxUs / 1000.0, boundUs(li) / 1000.0, ((double)r.p50Us - normal.p50Us) / 1000.0,
+           ((double)r.maxUs - normal.maxUs) / 1000.0);
+
+    if (r.maxUs > boundUs(li))
+    {
+      printf("%s: %.1f ms is over the bound\n", name, r.maxUs / 1000.0);
+      failures++;
+    }
+    else if (li > 0 && r.maxUs < boundUs(li) * BOUND_REACHED)
+    {
+      printf("%s: worst %.1f ms stays under %.0f%% of the bound\n", name, r.maxUs / 1000.0, BOUND_REACHED * 100);
+      failures++;
+    }
+  }
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,161 @@
+#!/usr/bin/env python3
+"""Provision many boards at once over USB serial with signed profiles.
+
+Each board must be in config mode: a freshly flashed board (no Wi-Fi
+settings) is, others need the config button held at boot. The firmware has
+to be built with the same fleet key (-D PROVISION_KEY=\\"...\\").
+
+The fleet file holds settings common to all boards and one entry per board:
+
+  {
+    "common": {"ssid": "depot", "pass": "...", "team": "10",
+               "fb_key": "...", "fb_url": "https://<db>.firebasedatabase.app",
+               "fb_email": "...", "fb_pass": "..."},
+    "boards": [
+      {"lightid": "11"},
+      {"lightid": "12", "mac": "24:6f:28:aa:bb:cc", "preempt_in": 1}
+    ]
+  }
+
+A board entry with a "mac" goes to that board only. The others are handed
+out in file order to whichever board answers next. Every profile is bound to
+the MAC of the board it was sent to, so it cannot be replayed on another.
+
+Examples:
+  PROVISION_KEY=... python3 tools/provision.py fleet.json /dev/ttyUSB*
+  python3 tools/provision.py fleet.json /dev/ttyUSB0 /dev/ttyUSB1 --key ... --reset --wait-ready
+"""
+
+import argparse
+import hashlib
+import hmac
+import json
+import os
+import sys
+import threading
+import time
+
+CHUNK = 64  # bytes per write; the UART buffer on the board holds 256
+
+
+class Fleet:
+    def __init__(self, path: str):
+        with open(path) as f:
+            data = json.load(f)
+        self.common = data.get("common", {})
+        self.pinned = {b["mac"].lower(): b for b in data["boards"] if "mac" in b}
+        self.queue = [b for b in data["boards"] if "mac" not in b]
+        self.lock = threading.Lock()
+
+    def take(self, mac: str):
+        with self.lock:
+            board = self.pinned.pop(mac, None)
+            if board is None and self.queue:
+                board = self.queue.pop(0)
+            if board is None:
+                return None
+            profile = dict(self.common)
+            profile.update(board)
+            profile["mac"] = mac
+            return profile
+
+
+def sign(key: bytes, body: str) -> str:
+    return hmac.new(key, body.encode(), hashlib.sha256).hexdigest()
+
+
+def read_until(ser, prefixes, timeout_s: float):
+    deadline = time.monotonic() + timeout_s
+    while time.monotonic() < deadline:
+        line = ser.readline().decode(errors="replace").strip()
+        for prefix in prefixes:
+            if line.startswith(prefix):
+                return line
+    return None
+
+
+def provision(port: str, fleet: Fleet, key: bytes, args, results: list):
+    import serial
+
+    started = time.monotonic()
+    mac = "?"
+    try:
+        with serial.Serial(port, 115200, timeout=0.5) as ser:
+            if args.reset:
+                # EN low through RTS, as esptool does
+                ser.dtr = False
+                ser.rts = True
+                time.sleep(0.1)
+                ser.rts = False
+
+            # The board may still be booting: ask until it answers
+            ident = None
+            deadline = time.monotonic() + args.timeout
+            while ident is None and time.monotonic() < deadline:
+                ser.write(b"id\n")
+                ident = read_until(ser, ["ID "], 1.0)
+            if ident is None:
+                raise RuntimeError("no answer to id (not in config mode?)")
+            mac = ident.split()[1].lower()
+
+            profile = fleet.take(mac)
+            if profile is None:
+                raise RuntimeError("no profile left for this board")
+
+            body = json.dumps(profile, separators=(",", ":"))
+            line = f"profile {body} {sign(key, body)}\n".encode()
+            ser.reset_input_buffer()
+            for i in range(0, len(line), CHUNK):
+                ser.write(line[i:i + CHUNK])
+                ser.flush()
+                time.sleep(0.01)
+
+            answer = read_until(ser, ["OK ", "ERR "], 5.0)
+            if answer is None:
+                raise RuntimeError("no acknowledgement")
+            if answer.startswith("ERR "):
+                raise RuntimeError(answer[4:])
+
+            status = f"ok, light {profile.get('lightid', '?')}"
+            if args.wait_ready:
+                ready = read_until(ser, ["Boot: ready"], args.ready_timeout)
+                status += ", " + (ready or "no Boot: ready line")
+            results.append((port, mac, True, status, time.monotonic() - started))
+    except Exception as e:  # one bad board must not stop the others
+        results.append((port, mac, False, str(e), time.monotonic() - started))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("fleet", help="fleet JSON file")
+    parser.add_argument("ports", nargs="+", help="serial ports, one board each")
+    parser.add_argument("--key", default=os.environ.get("PROVISION_KEY"), help="fleet key (or $PROVISION_KEY)")
+    parser.add_argument("--reset", action="store_true", help="reset each board through RTS first")
+    parser.add_argument("--timeout", type=float, default=20, help="seconds to wait for a board to answer")
+    parser.add_argument("--wait-ready", action="store_true", help="wait for the board to come up with its profile")
+    parser.add_argument("--ready-timeout", type=float, default=60)
+    args = parser.parse_args()
+
+    if not args.key:
+        sys.exit("no fleet key: pass --key or set PROVISION_KEY")
+
+    fleet = Fleet(args.fleet)
+    results = []
+    started = time.monotonic()
+    threads = [threading.Thread(target=provision, args=(port, fleet, args.key.encode(), args, results))
+               for port in args.ports]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+
+    failed = 0
+    for port, mac, ok, status, seconds in sorted(results):
+        failed += not ok
+        print(f"{port:<16} {mac:<17} {'OK ' if ok else 'ERR'} {seconds:5.1f} s  {status}")
+    print(f"{len(results) - failed}/{len(results)} boards in {time.monotonic() - started:.1f} s")
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
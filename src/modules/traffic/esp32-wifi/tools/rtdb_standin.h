@@ -0,0 +1,461 @@
+// Local stand-in for the parts of the Realtime Database REST API the boards
+// use, shared by the host tools (fleet_sim, impair_bench): GET with
+// `Accept: text/event-stream` (an initial put, then put/patch events and a
+// keep-alive every 30 s), plain GET, PUT and PATCH. Header only, so each
+// tool still builds from a single g++ line. Linux only (epoll).
+
+#ifndef TOOLS_RTDB_STANDIN_H
+#define TOOLS_RTDB_STANDIN_H
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+static const uint64_t KEEPALIVE_NS = 30000000000ULL; // RTDB stream keep-alive
+
+static uint64_t nowNs()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void setNonBlocking(int fd)
+{
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+static bool sendAll(int fd, const std::string &data)
+{
+  size_t sent = 0;
+  while (sent < data.size())
+  {
+    ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    sent += n;
+  }
+  return true;
+}
+
+// ================= STAND-IN SERVER =================
+// Flat nodes only (a light node or a device view): every leaf is stored by
+// its full path with its raw JSON value.
+
+struct ServerStats
+{
+  std::atomic<uint64_t> writes{0};
+  std::atomic<uint64_t> events{0}; // SSE events queued to streams
+  std::atomic<uint64_t> bytesOut{0};
+  std::atomic<uint64_t> streams{0};
+  std::atomic<uint64_t> maxBacklog{0}; // largest unsent stream buffer seen
+};
+
+class StandInServer
+{
+public:
+  explicit StandInServer(int port, uint64_t keepAliveNs = KEEPALIVE_NS) : m_port(port), m_keepAliveNs(keepAliveNs) {}
+
+  bool start();
+  void run(const std::atomic<bool> &stop);
+
+  ServerStats stats;
+
+private:
+  struct Conn
+  {
+    std::string in;
+    std::string out;
+    std::string streamPath; // empty unless the connection is a stream
+    bool wantWrite = false;
+  };
+
+  void accept();
+  void readFrom(int fd);
+  void flush(int fd);
+  void closeConn(int fd);
+  bool handleRequest(int fd, const std::string &method, const std::string &path,
+                     const std::string &headers, const std::string &body);
+  std::string nodeJson(const std::string &path) const;
+  void write(const std::string &path, const std::string &body, bool merge);
+  void fanOut(const std::string &path, const char *event, const std::string &data);
+  void queue(int fd, const std::string &data);
+
+  int m_port;
+  uint64_t m_keepAliveNs;
+  int m_listenFd = -1;
+  int m_epoll = -1;
+  std::map<int, Conn> m_conns;
+  std::map<std::string, std::string> m_leaves;
+  std::map<std::string, std::vector<int>> m_streams;
+};
+
+inline bool StandInServer::start()
+{
+  m_listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  int one = 1;
+  setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(m_port);
+  if (bind(m_listenFd, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(m_listenFd, SOMAXCONN) < 0)
+  {
+    perror("stand-in listen");
+    return false;
+  }
+  setNonBlocking(m_listenFd);
+
+  m_epoll = epoll_create1(0);
+  epoll_event ev = {};
+  ev.events = EPOLLIN;
+  ev.data.fd = m_listenFd;
+  epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_listenFd, &ev);
+  return true;
+}
+
+inline void StandInServer::run(const std::atomic<bool> &stop)
+{
+  epoll_event events[256];
+  uint64_t nextKeepAlive = nowNs() + m_keepAliveNs;
+
+  while (!stop)
+  {
+    int n = epoll_wait(m_epoll, events, 256, 100);
+    for (int i = 0; i < n; i++)
+    {
+      int fd = events[i].data.fd;
+      if (fd == m_listenFd)
+        accept();
+      else
+      {
+        if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+          readFrom(fd);
+        if ((events[i].events & EPOLLOUT) && m_conns.count(fd))
+          flush(fd);
+      }
+    }
+
+    if (nowNs() >= nextKeepAlive)
+    {
+      nextKeepAlive += m_keepAliveNs;
+      for (auto &entry : m_streams)
+      {
+        for (int fd : entry.second)
+        {
+          queue(fd, "event: keep-alive\ndata: null\n\n");
+          stats.events++;
+        }
+      }
+    }
+  }
+}
+
+inline void StandInServer::accept()
+{
+  while (true)
+  {
+    int fd = ::accept(m_listenFd, nullptr, nullptr);
+    if (fd < 0)
+      return;
+    setNonBlocking(fd);
+    m_conns[fd] = Conn();
+
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &ev);
+  }
+}
+
+inline void StandInServer::closeConn(int fd)
+{
+  auto it = m_conns.find(fd);
+  if (it == m_conns.end())
+    return;
+
+  if (!it->second.streamPath.empty())
+  {
+    std::vector<int> &fds = m_streams[it->second.streamPath];
+    fds.erase(std::remove(fds.begin(), fds.end(), fd), fds.end());
+    if (fds.empty())
+      m_streams.erase(it->second.streamPath);
+    stats.streams--;
+  }
+  m_conns.erase(it);
+  epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+  close(fd);
+}
+
+inline void StandInServer::readFrom(int fd)
+{
+  char buf[4096];
+  while (true)
+  {
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))
+    {
+      closeConn(fd);
+      return;
+    }
+    if (n < 0)
+      break;
+    m_conns[fd].in.append(buf, n);
+  }
+
+  // Handle every complete request (keep-alive connections pipeline them)
+  while (m_conns.count(fd))
+  {
+    std::string &in = m_conns[fd].in;
+    size_t headerEnd = in.find("\r\n\r\n");
+    if (headerEnd == std::string::npos)
+      return;
+
+    std::string headers = in.substr(0, headerEnd);
+    size_t contentLength = 0;
+    size_t cl = headers.find("Content-Length:");
+    if (cl != std::string::npos)
+      contentLength = strtoul(headers.c_str() + cl + 15, nullptr, 10);
+    if (in.size() < headerEnd + 4 + contentLength)
+      return;
+
+    std::string body = in.substr(headerEnd + 4, contentLength);
+    in.erase(0, headerEnd + 4 + contentLength);
+
+    size_t sp1 = headers.find(' ');
+    size_t sp2 = headers.find(' ', sp1 + 1);
+    std::string method = headers.substr(0, sp1);
+    std::string path = headers.substr(sp1 + 1, sp2 - sp1 - 1);
+    path = path.substr(0, path.find('?'));
+    if (path.size() > 5 && path.compare(path.size() - 5, 5, ".json") == 0)
+      path.resize(path.size() - 5);
+    if (path.size() > 1 && path.back() == '/')
+      path.pop_back();
+
+    if (!handleRequest(fd, method, path, headers, body))
+      return;
+  }
+}
+
+inline bool StandInServer::handleRequest(int fd, const std::string &method, const std::string &path,
+                                  const std::string &headers, const std::string &body)
+{
+  if (method == "GET" && headers.find("text/event-stream") != std::string::npos)
+  {
+    Conn &conn = m_conns[fd];
+    conn.streamPath = path;
+    m_streams[path].push_back(fd);
+    stats.streams++;
+    queue(fd, "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n\r\n");
+    queue(fd, "event: put\ndata: {\"path\":\"/\",\"data\":" + nodeJson(path) + "}\n\n");
+    stats.events++;
+    return true;
+  }
+
+  std::string response;
+  if (method == "GET")
+    response = nodeJson(path);
+  else if (method == "PUT" || method == "PATCH")
+  {
+    write(path, body, method == "PATCH");
+    response = body;
+  }
+  else
+  {
+    queue(fd, "HTTP/1.1 405 Method Not Allowed\r\nContent-Length: 0\r\n\r\n");
+    return true;
+  }
+
+  queue(fd, "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: " +
+                std::to_string(response.size()) + "\r\n\r\n" + response);
+  return m_conns.count(fd) > 0;
+}
+
+inline std::string StandInServer::nodeJson(const std::string &path) const
+{
+  auto leaf = m_leaves.find(path);
+  if (leaf != m_leaves.end())
+    return leaf->second;
+
+  std::string prefix = path + "/";
+  std::string json;
+  for (auto it = m_leaves.lower_bound(prefix); it != m_leaves.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it)
+  {
+    // Direct children only, nodes are flat
+    if (it->first.find('/', prefix.size()) != std::string::npos)
+      continue;
+    json += (json.empty() ? "{\"" : ",\"") + it->first.substr(prefix.size()) + "\":" + it->second;
+  }
+  return json.empty() ? "null" : json + "}";
+}
+
+// Split a flat JSON object into key/raw value pairs
+static std::vector<std::pair<std::string, std::string>> flatObject(const std::string &body)
+{
+  std::vector<std::pair<std::string, std::string>> pairs;
+  size_t pos = body.find('{');
+  while (pos != std::string::npos)
+  {
+    size_t keyStart = body.find('"', pos);
+    if (keyStart == std::string::npos)
+      break;
+    size_t keyEnd = body.find('"', keyStart + 1);
+    size_t colon = body.find(':', keyEnd);
+    if (keyEnd == std::string::npos || colon == std::string::npos)
+      break;
+    size_t valueEnd = body.find_first_of(",}", colon);
+    if (valueEnd == std::string::npos)
+      break;
+
+    std::string value = body.substr(colon + 1, valueEnd - colon - 1);
+    value.erase(0, value.find_first_not_of(" \t\r\n"));
+    value.erase(value.find_last_not_of(" \t\r\n") + 1);
+    pairs.push_back({body.substr(keyStart + 1, keyEnd - keyStart - 1), value});
+    pos = body[valueEnd] == ',' ? valueEnd : std::string::npos;
+  }
+  return pairs;
+}
+
+inline void StandInServer::write(const std::string &path, const std::string &body, bool merge)
+{
+  stats.writes++;
+  std::string trimmed = body.substr(0, body.find_last_not_of(" \t\r\n") + 1);
+  bool isObject = !trimmed.empty() && trimmed[0] == '{';
+
+  if (!merge)
+  {
+    // set() replaces the node, so drop everything under it first
+    std::string prefix = path + "/";
+    m_leaves.erase(path);
+    m_leaves.erase(m_leaves.lower_bound(prefix), m_leaves.lower_bound(path + "0"));
+  }
+
+  if (isObject)
+  {
+    for (auto &pair : flatObject(trimmed))
+    {
+      if (pair.second == "null")
+        m_leaves.erase(path + "/" + pair.first);
+      else
+        m_leaves[path + "/" + pair.first] = pair.second;
+    }
+  }
+  else if (trimmed != "null")
+    m_leaves[path] = trimmed;
+
+  fanOut(path, merge ? "patch" : "put", trimmed);
+}
+
+// Streams at or above the written path get the change relative to their
+// own path; streams below it get their whole node again.
+inline void StandInServer::fanOut(const std::string &path, const char *event, const std::string &data)
+{
+  std::string ancestor = path;
+  while (true)
+  {
+    auto it = m_streams.find(ancestor.empty() ? "/" : ancestor);
+    if (it != m_streams.end())
+    {
+      std::string relative = path.size() > ancestor.size() ? path.substr(ancestor.size()) : "/";
+      std::string message = std::string("event: ") + event + "\ndata: {\"path\":\"" + relative + "\",\"data\":" + data + "}\n\n";
+      for (int fd : it->second)
+      {
+        queue(fd, message);
+        stats.events++;
+      }
+    }
+    if (ancestor.empty() || ancestor == "/")
+      break;
+    ancestor.resize(ancestor.rfind('/'));
+  }
+
+  std::string prefix = path + "/";
+  for (auto it = m_streams.lower_bound(prefix); it != m_streams.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it)
+  {
+    std::string message = "event: put\ndata: {\"path\":\"/\",\"data\":" + nodeJson(it->first) + "}\n\n";
+    for (int fd : it->second)
+    {
+      queue(fd, message);
+      stats.events++;
+    }
+  }
+}
+
+inline void StandInServer::queue(int fd, const std::string &data)
+{
+  auto it = m_conns.find(fd);
+  if (it == m_conns.end())
+    return;
+
+  it->second.out += data;
+  flush(fd);
+}
+
+inline void StandInServer::flush(int fd)
+{
+  Conn &conn = m_conns[fd];
+  while (!conn.out.empty())
+  {
+    ssize_t n = send(fd, conn.out.data(), conn.out.size(), MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0 && errno == EAGAIN)
+      break;
+    if (n <= 0)
+    {
+      closeConn(fd);
+      return;
+    }
+    stats.bytesOut += n;
+    conn.out.erase(0, n);
+  }
+
+  if (conn.out.size() > stats.maxBacklog)
+    stats.maxBacklog = conn.out.size();
+
+  // Only wait for EPOLLOUT while there is something left to send
+  bool wantWrite = !conn.out.empty();
+  if (wantWrite != conn.wantWrite)
+  {
+    conn.wantWrite = wantWrite;
+    epoll_event ev = {};
+    ev.events = wantWrite ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    ev.data.fd = fd;
+    epoll_ctl(m_epoll, EPOLL_CTL_MOD, fd, &ev);
+  }
+}
+
+// A port on 127.0.0.1 that nothing listens on right now
+static int freeLoopbackPort()
+{
+  int probe = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in any = {};
+  any.sin_family = AF_INET;
+  any.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  bind(probe, (sockaddr *)&any, sizeof(any));
+  socklen_t len = sizeof(any);
+  getsockname(probe, (sockaddr *)&any, &len);
+  close(probe);
+  return ntohs(any.sin_port);
+}
+
+#endif
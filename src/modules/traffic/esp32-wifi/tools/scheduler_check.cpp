@@ -0,0 +1,317 @@
+// Scheduler check.
+//
+// Drives lib/TrafficCore/Scheduler on a simulated microsecond clock through
+// fixed cases and compares run times, lateness and table bookkeeping with
+// the expected values:
+//   - one-shot jobs: disarmed until after(), run once, re-armed from a job
+//   - periodic jobs: first run one period from registration, fixed rate,
+//     missed runs skipped after a stall, setPeriod(), cancel() and after()
+//   - untilNextUs(): 0 when due, UINT32_MAX with nothing armed
+//   - order: earliest deadline first, each job once per run(), a job that
+//     comes due during a pass runs in that pass
+//   - lateness and jitter per job, with the clock advancing inside jobs
+//   - a full table and a period over SCHEDULER_MAX_PERIOD_MS are refused
+//     and counted in rejected()
+// Prints one line per failed case. Exits 1 on failure.
+//   ./scheduler_check
+//
+// Build from the esp32-wifi directory:
+//   g++ -std=c++17 -O2 -Ilib/TrafficCore -o scheduler_check tools/scheduler_check.cpp lib/TrafficCore/Scheduler.cpp
+
+#include "Scheduler.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+static int failures = 0;
+static int checks = 0;
+
+static void expect(bool ok, const std::string &what)
+{
+  checks++;
+  if (ok)
+    return;
+  failures++;
+  printf("FAIL: %s\n", what.c_str());
+}
+
+static void expectEq(uint64_t got, uint64_t want, const std::string &what)
+{
+  expect(got == want, what + ": " + std::to_string(got) + ", expected " + std::to_string(want));
+}
+
+// ================= SIMULATED CLOCK =================
+
+static uint64_t simUs = 0;
+static uint64_t simClockUs()
+{
+  return simUs;
+}
+
+// Jobs log "<name>@<us>" and may take time or re-arm themselves
+struct Run
+{
+  const char *name;
+  uint64_t atUs;
+};
+static std::vector<Run> runs;
+static Scheduler *active = nullptr;
+
+static void logRun(const char *name)
+{
+  runs.push_back({name, simUs});
+}
+
+static std::string runsText()
+{
+  std::string text;
+  for (const Run &run : runs)
+  {
+    if (!text.empty())
+      text += " ";
+    text += std::string(run.name) + "@" + std::to_string(run.atUs);
+  }
+  return text.empty() ? "-" : text;
+}
+
+static int shotId = NO_JOB;
+static int slowId = NO_JOB;
+static int fastId = NO_JOB;
+static int selfId = NO_JOB;
+
+static void shotJob()
+{
+  logRun("shot");
+}
+
+static void periodicJob()
+{
+  logRun("tick");
+}
+
+// Takes 3 ms of the clock
+static void slowJob()
+{
+  logRun("slow");
+  simUs += 3000;
+}
+
+static void fastJob()
+{
+  logRun("fast");
+}
+
+// Re-arms itself with no delay, like the blink job on its first toggle
+static void selfJob()
+{
+  logRun("self");
+  active->after(selfId, 0, simUs);
+}
+
+static void noJob() {}
+
+// ================= CASES =================
+
+static void checkOneShot()
+{
+  Scheduler s;
+  simUs = 1000;
+  runs.clear();
+  shotId = s.oneShot("shot", shotJob);
+
+  expect(!s.armed(shotId), "one-shot: armed before after()");
+  expectEq(s.untilNextUs(simUs), UINT32_MAX, "one-shot: untilNextUs with nothing armed");
+  s.run(simClockUs);
+  expectEq(runs.size(), 0, "one-shot: runs before after()");
+
+  s.after(shotId, 50, simUs);
+  expectEq(s.untilNextUs(simUs), 50000, "one-shot: untilNextUs after after(50)");
+  simUs += 49999;
+  s.run(simClockUs);
+  expectEq(runs.size(), 0, "one-shot: runs 1 us early");
+  simUs += 1;
+  expectEq(s.untilNextUs(simUs), 0, "one-shot: untilNextUs when due");
+  s.run(simClockUs);
+  expect(runsText() == "shot@51000", "one-shot: ran " + runsText() + ", expected shot@51000");
+  expect(!s.armed(shotId), "one-shot: still armed after its run");
+
+  simUs += 200000;
+  s.run(simClockUs);
+  expectEq(runs.size(), 1, "one-shot: runs after the first");
+
+  // Re-armed and cancelled before it is due
+  s.after(shotId, 10, simUs);
+  s.cancel(shotId);
+  simUs += 20000;
+  s.run(simClockUs);
+  expectEq(runs.size(), 1, "one-shot: runs after cancel()");
+
+  // Late by 7 ms
+  s.after(shotId, 10, simUs);
+  simUs += 17000;
+  s.run(simClockUs);
+  const JobStats &stats = s.job(shotId).stats;
+  expectEq(stats.runs, 2, "one-shot: stats runs");
+  expectEq(stats.maxLateUs, 7000, "one-shot: max lateness");
+  expectEq(stats.minLateUs, 0, "one-shot: min lateness");
+  expectEq(stats.jitterUs(), 7000, "one-shot: jitter");
+}
+
+static void checkPeriodic()
+{
+  Scheduler s;
+  simUs = 0;
+  runs.clear();
+  int id = s.every("tick", 100, periodicJob, simUs);
+
+  expect(s.armed(id), "periodic: not armed after every()");
+  expectEq(s.untilNextUs(simUs), 100000, "periodic: first run one period out");
+
+  // Polled every 10 ms, like the normal-mode loop
+  while (simUs < 1000000)
+  {
+    simUs += 10000;
+    s.run(simClockUs);
+  }
+  expectEq(runs.size(), 10, "periodic: runs in 1 s");
+  bool onTime = true;
+  for (size_t i = 0; i < runs.size(); i++)
+    onTime = onTime && runs[i].atUs == (i + 1) * 100000;
+  expect(onTime, "periodic: not at fixed rate: " + runsText());
+
+  // Fixed rate: a late run does not push the next one back
+  runs.clear();
+  simUs = 1130000; // 30 ms late for the run at 1.1 s
+  s.run(simClockUs);
+  simUs = 1200000;
+  s.run(simClockUs);
+  expect(runsText() == "tick@1130000 tick@1200000", "periodic: late run moved the rate: " + runsText());
+
+  // After a stall of several periods: one run, then one period from there
+  runs.clear();
+  simUs = 1750000;
+  s.run(simClockUs);
+  s.run(simClockUs);
+  expectEq(runs.size(), 1, "periodic: runs after a stall");
+  expectEq(s.untilNextUs(simUs), 100000, "periodic: next run after a stall");
+
+  const JobStats &stats = s.job(id).stats;
+  expectEq(stats.runs, 13, "periodic: stats runs");
+  expectEq(stats.minLateUs, 0, "periodic: min lateness");
+  expectEq(stats.maxLateUs, 450000, "periodic: max lateness");
+  expectEq(stats.jitterUs(), 450000, "periodic: jitter");
+  s.resetStats();
+  expectEq(s.job(id).stats.runs, 0, "periodic: runs after resetStats()");
+
+  // setPeriod() takes effect from the next run; after() moves the next run
+  runs.clear();
+  s.setPeriod(id, 250);
+  simUs = 1850000;
+  s.run(simClockUs);
+  simUs = 2100000;
+  s.run(simClockUs);
+  s.after(id, 5, simUs);
+  simUs = 2105000;
+  s.run(simClockUs);
+  expect(runsText() == "tick@1850000 tick@2100000 tick@2105000", "periodic: setPeriod()/after(): " + runsText());
+  expectEq(s.untilNextUs(simUs), 250000, "periodic: period kept after after()");
+
+  s.cancel(id);
+  expectEq(s.untilNextUs(simUs), UINT32_MAX, "periodic: untilNextUs after cancel()");
+}
+
+static void checkOrderAndLateness()
+{
+  Scheduler s;
+  active = &s;
+  simUs = 0;
+  runs.clear();
+
+  // Registered in reverse deadline order
+  fastId = s.oneShot("fast", fastJob);
+  slowId = s.oneShot("slow", slowJob);
+  selfId = s.oneShot("self", selfJob);
+  s.after(fastId, 12, simUs);
+  s.after(slowId, 10, simUs);
+  s.after(selfId, 11, simUs);
+
+  // All due at 12 ms: earliest first, the clock moves 3 ms in slow, so
+  // self and fast record that as lateness. self re-arms itself with 0 delay
+  // and still runs only once in this pass.
+  simUs = 12000;
+  s.run(simClockUs);
+  expect(runsText() == "slow@12000 self@15000 fast@15000", "order: " + runsText());
+  expectEq(s.job(slowId).stats.maxLateUs, 2000, "order: slow lateness");
+  expectEq(s.job(selfId).stats.maxLateUs, 4000, "order: self lateness");
+  expectEq(s.job(fastId).stats.maxLateUs, 3000, "order: fast lateness");
+  expect(s.armed(selfId), "order: self not re-armed");
+  expectEq(s.untilNextUs(simUs), 0, "order: re-armed job not due");
+
+  // A job that comes due while slow runs is picked up in the same pass
+  runs.clear();
+  s.cancel(selfId);
+  s.after(slowId, 0, simUs);
+  s.after(fastId, 2, simUs);
+  s.run(simClockUs);
+  expect(runsText() == "slow@15000 fast@18000", "came due during a pass: " + runsText());
+  expectEq(s.job(fastId).stats.maxLateUs, 3000, "came due during a pass: fast lateness");
+  expectEq(s.job(fastId).stats.minLateUs, 1000, "came due during a pass: fast min lateness");
+  expectEq(s.job(fastId).stats.jitterUs(), 2000, "came due during a pass: fast jitter");
+  expectEq(s.job(fastId).stats.avgLateUs(), 2000, "came due during a pass: fast average lateness");
+  active = nullptr;
+}
+
+static void checkTable()
+{
+  Scheduler s;
+  simUs = 0;
+  char names[SCHEDULER_MAX_JOBS + 2][8];
+  int registered = 0;
+  for (int i = 0; i < SCHEDULER_MAX_JOBS + 2; i++)
+  {
+    snprintf(names[i], sizeof(names[i]), "job%d", i);
+    int id = i % 2 ? s.oneShot(names[i], noJob) : s.every(names[i], 100, noJob, simUs);
+    if (id != NO_JOB)
+    {
+      expectEq(id, registered, "table: id of job " + std::to_string(i));
+      registered++;
+    }
+  }
+  expectEq(s.size(), SCHEDULER_MAX_JOBS, "table: size when full");
+  expectEq(s.rejected(), 2, "table: rejected when full");
+  expect(s.firstRejected() && std::string(s.firstRejected()) == "job16",
+         std::string("table: first rejected ") + (s.firstRejected() ? s.firstRejected() : "none"));
+
+  // Unknown ids are ignored
+  s.after(NO_JOB, 0, simUs);
+  s.after(SCHEDULER_MAX_JOBS, 0, simUs);
+  s.cancel(-5);
+  expect(!s.armed(NO_JOB) && !s.armed(SCHEDULER_MAX_JOBS), "table: unknown id armed");
+
+  // Periods are 32-bit microseconds
+  Scheduler p;
+  expect(p.every("hour", 3600000UL, noJob, 0) != NO_JOB, "period: 1 h refused");
+  expect(p.every("max", SCHEDULER_MAX_PERIOD_MS, noJob, 0) != NO_JOB, "period: the maximum refused");
+  expectEq(p.job(1).periodUs, (uint64_t)SCHEDULER_MAX_PERIOD_MS * 1000, "period: the maximum");
+  expect(p.every("2h", 7200000UL, noJob, 0) == NO_JOB, "period: 2 h taken");
+  expect(p.rejected() == 1 && std::string(p.firstRejected()) == "2h", "period: 2 h not counted in rejected()");
+  p.setPeriod(0, SCHEDULER_MAX_PERIOD_MS + 1);
+  expectEq(p.job(0).periodUs, 3600000000ULL, "period: setPeriod() over the maximum");
+
+  // One-shot delays are not limited
+  int shot = p.oneShot("day", noJob);
+  p.after(shot, 86400000UL, 0);
+  expectEq(p.job(shot).deadlineUs, 86400000000ULL, "period: one-shot a day out");
+}
+
+int main()
+{
+  checkOneShot();
+  checkPeriodic();
+  checkOrderAndLateness();
+  checkTable();
+
+  printf("%d checks, %d failed\n", checks, failures);
+  return failures ? 1 : 0;
+}
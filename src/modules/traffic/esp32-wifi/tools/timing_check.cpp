@@ -0,0 +1,109 @@
+// Timing engine check.
+//
+// Runs every case in a vectors file generated from the backend's
+// timing.service.ts (tools/timing_vectors.ts) through the firmware's
+// constexpr port (lib/TrafficCore/TimingEngine.h) and reports each case where
+// the two disagree. Exits 1 on any mismatch, so a change to either side that
+// makes them drift apart fails here:
+//   ./timing_check tools/timing_vectors.txt
+//
+// Build from the esp32-wifi directory:
+//   g++ -std=c++17 -O2 -Ilib/TrafficCore -o timing_check tools/timing_check.cpp
+//
+// Refresh the vectors after changing timing.service.ts:
+//   npx tsx tools/timing_vectors.ts > tools/timing_vectors.txt
+
+#include "TimingEngine.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+
+// "-" (undefined in the TypeScript version) becomes the engine's -1
+static int inputValue(const std::string &token)
+{
+  return token == "-" ? -1 : atoi(token.c_str());
+}
+
+static std::string timingText(const CycleTiming &t)
+{
+  return std::to_string(t.green) + " " + std::to_string(t.yellow) + " " + std::to_string(t.red) + " " +
+         std::to_string(t.total);
+}
+
+int main(int argc, char **argv)
+{
+  if (argc != 2)
+  {
+    fprintf(stderr, "usage: timing_check timing_vectors.txt\n");
+    return 2;
+  }
+
+  std::ifstream in(argv[1]);
+  if (!in)
+  {
+    fprintf(stderr, "cannot read %s\n", argv[1]);
+    return 2;
+  }
+
+  std::map<std::string, int> cases;
+  std::map<std::string, int> failed;
+  std::string line;
+  int lineNo = 0;
+
+  while (std::getline(in, line))
+  {
+    lineNo++;
+    std::istringstream fields(line);
+    std::string kind;
+    if (!(fields >> kind))
+      continue;
+
+    std::string a, b, c;
+    std::string expected, actual;
+
+    if (kind == "density" && fields >> a)
+      actual = timingText(timingByDensity(inputValue(a)));
+    else if (kind == "count" && fields >> a)
+      actual = timingText(timingByVehicleCount(inputValue(a)));
+    else if (kind == "speed" && fields >> a)
+      actual = timingText(timingBySpeed(inputValue(a)));
+    else if (kind == "adaptive" && fields >> a >> b >> c)
+      actual = timingText(adaptiveTiming(inputValue(a), inputValue(b), inputValue(c)));
+    else if (kind == "coordinated" && fields >> a >> b)
+    {
+      // The intersection's highest level, Math.max() over the two lights
+      int level = inputValue(a);
+      actual = timingText(coordinatedTiming(level, timingMax(level, inputValue(b))));
+    }
+    else if (kind == "color" && fields >> a >> b)
+      actual = std::to_string(recommendedColor(strtoul(b.c_str(), nullptr, 10), timingByDensity(inputValue(a))));
+    else
+    {
+      fprintf(stderr, "line %d: cannot parse \"%s\"\n", lineNo, line.c_str());
+      return 2;
+    }
+
+    std::getline(fields >> std::ws, expected);
+    cases[kind]++;
+    if (actual != expected)
+    {
+      failed[kind]++;
+      printf("line %d: %s -> expected \"%s\", got \"%s\"\n", lineNo, line.substr(0, line.size() - expected.size()).c_str(),
+             expected.c_str(), actual.c_str());
+    }
+  }
+
+  int failures = 0;
+  printf("%-12s %6s %6s\n", "function", "cases", "failed");
+  for (const auto &entry : cases)
+  {
+    printf("%-12s %6d %6d\n", entry.first.c_str(), entry.second, failed[entry.first]);
+    failures += failed[entry.first];
+  }
+
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,84 @@
+// Reference vectors for the firmware's timing engine
+// (lib/TrafficCore/TimingEngine.h), generated from the backend's
+// timing.service.ts. One case per line: the function, its inputs, then the
+// result (green yellow red total, or a color). "-" is an input left undefined.
+//
+// From the esp32-wifi directory:
+//   npx tsx tools/timing_vectors.ts > tools/timing_vectors.txt
+// and check the engine against them with tools/timing_check.cpp.
+
+import {
+  calculateAdaptiveTiming,
+  calculateCoordinatedTiming,
+  calculateTimingByDensity,
+  calculateTimingBySpeed,
+  calculateTimingByVehicleCount,
+  getRecommendedColor,
+} from '../../services/timing.service';
+import type { TrafficLightCycleConfig } from '../../types';
+
+const levels = [-1, 0, 1, 2, 3, 4, 5];
+const speeds = [0, 10, 14, 15, 19, 20, 24, 25, 39, 40, 80];
+const adaptiveSpeeds = [undefined, 0, 19, 20, 40];
+const hours = [undefined, ...Array.from({ length: 24 }, (_, hour) => hour)];
+
+const lines: string[] = [];
+const timing = (t: TrafficLightCycleConfig) =>
+  `${t.greenDuration} ${t.yellowDuration} ${t.redDuration} ${t.totalCycle}`;
+const input = (value: number | undefined) =>
+  value === undefined ? '-' : String(value);
+
+for (const level of levels) {
+  lines.push(`density ${level} ${timing(calculateTimingByDensity(level))}`);
+}
+
+for (let vehicles = 0; vehicles <= 60; vehicles++) {
+  lines.push(
+    `count ${vehicles} ${timing(calculateTimingByVehicleCount(vehicles))}`
+  );
+}
+
+for (const speed of speeds) {
+  lines.push(`speed ${speed} ${timing(calculateTimingBySpeed(speed))}`);
+}
+
+for (const level of levels) {
+  for (const speed of adaptiveSpeeds) {
+    for (const hour of hours) {
+      // Local time, which is what getHours() reads
+      const timeOfDay =
+        hour === undefined ? undefined : new Date(2025, 0, 6, hour, 30);
+      const result = calculateAdaptiveTiming({
+        densityLevel: level,
+        speedKmh: speed,
+        timeOfDay,
+      });
+      lines.push(
+        `adaptive ${level} ${input(speed)} ${input(hour)} ${timing(result)}`
+      );
+    }
+  }
+}
+
+for (const level of levels) {
+  for (const other of levels) {
+    const result = calculateCoordinatedTiming([
+      { id: 1, densityLevel: level },
+      { id: 2, densityLevel: other },
+    ]).get(1);
+    if (result) {
+      lines.push(`coordinated ${level} ${other} ${timing(result)}`);
+    }
+  }
+}
+
+for (const level of [0, 1, 2, 3, 4]) {
+  const cycle = calculateTimingByDensity(level);
+  for (let elapsed = 0; elapsed <= cycle.totalCycle; elapsed++) {
+    lines.push(
+      `color ${level} ${elapsed} ${getRecommendedColor(elapsed, cycle)}`
+    );
+  }
+}
+
+console.log(lines.join('\n'));
@@ -0,0 +1,321 @@
+// Stream trace replayer.
+//
+// Feeds stream traces recorded by the firmware (GET /api/trace?download=1)
+// through the firmware's own decoding, validation and sequence check
+// (lib/TrafficCore/LightState, UpdateStamp) in recorded order, with no
+// real-time pacing, so every run over the same trace is identical. It times
+// the decode and apply of each event as it goes.
+//
+// Each trace gives a transcript: one line per state change, preemption,
+// cancel or auth_revoked event, timed relative to the boot it belongs to,
+// and the state the light is left in on the last line.
+// A trace `x.trc` with an `x.trc.txt` next to it is checked against that
+// transcript, which turns a directory of recorded cabinet traffic into a
+// regression suite:
+//   ./trace_replay tools/traces/*.trc       # check, exit 1 on any mismatch
+//   ./trace_replay --update traces/new.trc  # write or refresh the transcript
+//   ./trace_replay --dump traces/x.trc      # print every record
+//   ./trace_replay --budget-ns 2000 traces/*.trc  # also fail on slow p99
+//
+// Build from the esp32-wifi directory:
+//   g++ -std=c++17 -O2 -Ilib/TrafficCore -o trace_replay
+//       tools/trace_replay.cpp lib/TrafficCore/LightState.cpp lib/TrafficCore/StreamTrace.cpp
+//       lib/TrafficCore/UpdateStamp.cpp
+//
+// Times are host times. They track relative changes in the decode path,
+// not how long the same work takes on the ESP32.
+
+#include "LightState.h"
+#include "StreamTrace.h"
+#include "UpdateStamp.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct Replay
+{
+  LightState state;
+  UpdateGate gate;
+  uint32_t bootMs = 0;
+  bool bootSeen = false;
+  bool dump = false;
+  std::string transcript;
+  std::vector<uint32_t> eventNs;
+  uint32_t events = 0;
+  uint32_t truncated = 0;
+};
+
+static void line(Replay &replay, const TraceRecord &record, const std::string &text)
+{
+  char prefix[32];
+  snprintf(prefix, sizeof(prefix), "+%lu ", (unsigned long)(record.atMs - replay.bootMs));
+  replay.transcript += prefix + text + "\n";
+}
+
+static std::string stateText(const LightState &s)
+{
+  return "color=" + std::to_string(s.color) + " remaining=" + std::to_string(s.remaining) +
+         " status=" + std::to_string(s.status) + " yellow=" + std::to_string(s.yellow) +
+         (s.density ? " density=" + std::to_string(s.density) : "");
+}
+
+static void replayRecord(const TraceRecord &record, void *ctx)
+{
+  Replay &replay = *(Replay *)ctx;
+  std::string event(record.event, record.eventLen);
+  std::string path(record.path, record.pathLen);
+
+  if (!replay.bootSeen)
+  {
+    replay.bootMs = record.atMs;
+    replay.bootSeen = true;
+  }
+  replay.events++;
+  if (record.truncated)
+    replay.truncated++;
+
+  if (replay.dump)
+    printf("%10lu %-12s %-16s %.*s%s\n", (unsigned long)record.atMs, event.c_str(), path.c_str(),
+           (int)record.dataLen, record.data, record.truncated ? " [truncated]" : "");
+
+  if (event == "cancel" || event == "auth_revoked")
+  {
+    line(replay, record, event);
+    return;
+  }
+  if (event != "put" && event != "patch")
+    return;
+
+  // The timed part: what processStream() does before touching the hardware
+  auto start = std::chrono::steady_clock::now();
+  FieldUpdate updates[MAX_FIELD_UPDATES];
+  size_t count = decodeStreamUpdate(record.path, record.pathLen, record.data, record.dataLen, updates);
+
+  // Sequence order as on the board. Recorded times are not wall-clock, so
+  // staleness is not judged here.
+  UpdateStamp stamp;
+  size_t outOfOrder = 0;
+  if (readUpdateStamp(record.data, record.dataLen, stamp))
+  {
+    StampResult result;
+    bool snapshot = event == "put" && (path.empty() || path == "/");
+    size_t kept = replay.gate.filter(stamp, snapshot, 0, updates, count, result);
+    outOfOrder = count - kept;
+    count = kept;
+  }
+
+  bool changed = false;
+  int preempt = -1;
+  for (size_t i = 0; i < count; i++)
+  {
+    if (updates[i].field == FIELD_PREEMPT)
+      preempt = updates[i].value;
+    else
+      changed |= setLightField(replay.state, updates[i].field, updates[i].value);
+  }
+  auto end = std::chrono::steady_clock::now();
+  replay.eventNs.push_back((uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+
+  if (outOfOrder > 0)
+    line(replay, record, event + " " + path + " seq " + std::to_string(stamp.seq) + ": " +
+                             std::to_string(outOfOrder) + " fields out of order");
+
+  // The preemption sequence itself lives in the firmware, the transcript
+  // only records the request
+  if (preempt >= 0)
+    line(replay, record, "preempt " + std::to_string(preempt));
+  if (changed)
+    line(replay, record, event + " " + path + " -> " + stateText(replay.state));
+}
+
+struct Block
+{
+  uint32_t seq;
+  uint16_t flags;
+  const uint8_t *bytes;
+};
+
+// Blocks of a ring file in recorded order, oldest first
+static std::vector<Block> orderedBlocks(const std::vector<uint8_t> &file)
+{
+  std::vector<Block> blocks;
+  for (size_t offset = 0; offset + TRACE_BLOCK_SIZE <= file.size(); offset += TRACE_BLOCK_SIZE)
+  {
+    Block block;
+    block.bytes = file.data() + offset;
+    if (readTraceBlockHeader(block.bytes, block.seq, block.flags))
+      blocks.push_back(block);
+  }
+  std::sort(blocks.begin(), blocks.end(), [](const Block &a, const Block &b) { return a.seq < b.seq; });
+  return blocks;
+}
+
+static void replayBlocks(const std::vector<Block> &blocks, Replay &replay)
+{
+  for (size_t i = 0; i < blocks.size(); i++)
+  {
+    const Block &block = blocks[i];
+    if (block.flags & TRACE_BLOCK_BOOT)
+    {
+      // The board restarted: fresh state, times relative to the new boot
+      replay.state = LightState();
+      replay.gate = UpdateGate();
+      replay.bootSeen = false;
+      replay.transcript += "boot\n";
+    }
+    else if (i > 0 && block.seq != blocks[i - 1].seq + 1)
+    {
+      replay.transcript += "gap " + std::to_string(block.seq - blocks[i - 1].seq - 1) + " blocks\n";
+    }
+    forEachTraceRecord(block.bytes, replayRecord, &replay);
+  }
+  replay.transcript += "final " + stateText(replay.state) + "\n";
+}
+
+static bool readFile(const char *path, std::string &out)
+{
+  std::ifstream in(path, std::ios::binary);
+  if (!in)
+    return false;
+  std::stringstream buffer;
+  buffer << in.rdbuf();
+  out = buffer.str();
+  return true;
+}
+
+static uint32_t percentile(std::vector<uint32_t> &sorted, double p)
+{
+  if (sorted.empty())
+    return 0;
+  return sorted[std::min(sorted.size() - 1, (size_t)(p / 100.0 * (sorted.size() - 1) + 0.5))];
+}
+
+// First line where two transcripts differ (1-based), 0 if equal
+static size_t firstDifference(const std::string &a, const std::string &b, std::string &expected, std::string &actual)
+{
+  std::istringstream sa(a), sb(b);
+  std::string la, lb;
+  for (size_t n = 1;; n++)
+  {
+    bool ha = (bool)std::getline(sa, la);
+    bool hb = (bool)std::getline(sb, lb);
+    if (!ha && !hb)
+      return 0;
+    if (ha != hb || la != lb)
+    {
+      expected = hb ? lb : "<end>";
+      actual = ha ? la : "<end>";
+      return n;
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  bool update = false;
+  bool dump = false;
+  int repeat = 20;
+  long budgetNs = 0;
+  std::vector<const char *> traces;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--update"))
+      update = true;
+    else if (!strcmp(argv[i], "--dump"))
+      dump = true;
+    else if (!strcmp(argv[i], "--repeat") && i + 1 < argc)
+      repeat = std::max(1, atoi(argv[++i]));
+    else if (!strcmp(argv[i], "--budget-ns") && i + 1 < argc)
+      budgetNs = atol(argv[++i]);
+    else if (argv[i][0] == '-')
+    {
+      fprintf(stderr, "usage: trace_replay [--update] [--dump] [--repeat N] [--budget-ns N] trace.trc...\n");
+      return 2;
+    }
+    else
+      traces.push_back(argv[i]);
+  }
+
+  if (traces.empty())
+  {
+    fprintf(stderr, "no trace files given\n");
+    return 2;
+  }
+
+  int failures = 0;
+  printf("%-32s %7s %7s %9s %9s %9s %7s  %s\n", "trace", "blocks", "events", "p50_ns", "p99_ns", "max_ns",
+         "trunc", "result");
+
+  for (const char *path : traces)
+  {
+    std::string raw;
+    if (!readFile(path, raw))
+    {
+      printf("%-32s cannot read\n", path);
+      failures++;
+      continue;
+    }
+    std::vector<uint8_t> file(raw.begin(), raw.end());
+    std::vector<Block> blocks = orderedBlocks(file);
+
+    // The first pass gives the transcript; every pass adds timings
+    Replay first;
+    first.dump = dump;
+    replayBlocks(blocks, first);
+    std::vector<uint32_t> timings = first.eventNs;
+    for (int r = 1; r < repeat; r++)
+    {
+      Replay again;
+      replayBlocks(blocks, again);
+      timings.insert(timings.end(), again.eventNs.begin(), again.eventNs.end());
+    }
+    std::sort(timings.begin(), timings.end());
+
+    std::string goldenPath = std::string(path) + ".txt";
+    std::string golden;
+    std::string result;
+    bool failed = false;
+
+    if (update)
+    {
+      std::ofstream(goldenPath, std::ios::binary) << first.transcript;
+      result = "transcript written";
+    }
+    else if (readFile(goldenPath.c_str(), golden))
+    {
+      std::string expected, actual;
+      size_t diff = firstDifference(first.transcript, golden, expected, actual);
+      if (diff)
+      {
+        result = "MISMATCH at line " + std::to_string(diff) + ": expected \"" + expected + "\", got \"" + actual + "\"";
+        failed = true;
+      }
+      else
+        result = "ok";
+    }
+    else
+      result = "no transcript (run with --update)";
+
+    uint32_t p99 = percentile(timings, 99);
+    if (budgetNs > 0 && p99 > budgetNs)
+    {
+      result += ", p99 over the " + std::to_string(budgetNs) + " ns budget";
+      failed = true;
+    }
+
+    printf("%-32s %7zu %7u %9u %9u %9u %7u  %s\n", path, blocks.size(), first.events, percentile(timings, 50), p99,
+           timings.empty() ? 0 : timings.back(), first.truncated, result.c_str());
+    if (failed)
+      failures++;
+  }
+
+  return failures ? 1 : 0;
+}
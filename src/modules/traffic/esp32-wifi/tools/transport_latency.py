@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+"""Measure write-to-board latency over MQTT, Firebase or the local API.
+
+Each round writes a new `remaintime` for the light and polls the board's
+local API (GET /api/state) until the value shows up. The time in between
+covers the whole path, including the broker or database and the backend
+device-view mirror for Firebase. Polling adds up to --poll-ms per round.
+
+The board also reports when it applied the change on its SNTP clock
+(`changed_ms`). With the host clock on NTP as well, that time minus the
+host's send time is the end-to-end latency without the polling error, off
+only by the offset between the two clocks. Both figures are printed.
+
+Examples:
+  # MQTT to a local Mosquitto (needs paho-mqtt)
+  python3 tools/transport_latency.py --board http://10.0.0.20 --key $KEY \
+      --mqtt localhost:1883 --team 10 --light 10 --rounds 50
+
+  # Firebase via the REST API (ID token or database secret in --auth)
+  python3 tools/transport_latency.py --board http://10.0.0.20 --key $KEY \
+      --firebase https://<db>.firebasedatabase.app --auth $TOKEN \
+      --team 10 --light 10 --rounds 50
+
+  # Local API on the LAN, for comparison with the cloud paths
+  python3 tools/transport_latency.py --board http://10.0.0.20 --key $KEY \
+      --local --rounds 50
+"""
+
+import argparse
+import json
+import statistics
+import sys
+import time
+import urllib.request
+
+
+def board_state(board: str, key: str) -> dict:
+    req = urllib.request.Request(board.rstrip("/") + "/api/state", headers={"X-Auth-Token": key})
+    with urllib.request.urlopen(req, timeout=2) as resp:
+        return json.load(resp)
+
+
+class MqttWriter:
+    def __init__(self, broker: str, team: str, light: str):
+        import paho.mqtt.client as mqtt
+
+        host, _, port = broker.partition(":")
+        self.topic = f"traffic/{team}/{light}/state"
+        self.client = mqtt.Client()
+        self.client.connect(host, int(port or 1883))
+        self.client.loop_start()
+
+    def write(self, remaining: int):
+        # Retained, so a board that reconnects gets the latest state
+        self.client.publish(self.topic, json.dumps({"remaintime": remaining}), qos=1, retain=True).wait_for_publish()
+
+
+class FirebaseWriter:
+    def __init__(self, url: str, auth: str, team: str, light: str):
+        self.url = f"{url.rstrip('/')}/teams/{team}/traffic_lights/{light}.json?auth={auth}"
+
+    def write(self, remaining: int):
+        body = json.dumps({"remaintime": remaining}).encode()
+        req = urllib.request.Request(self.url, data=body, method="PATCH")
+        urllib.request.urlopen(req, timeout=5).close()
+
+
+class LocalWriter:
+    def __init__(self, board: str, key: str):
+        self.url = board.rstrip("/") + "/api/control"
+        self.key = key
+
+    def write(self, remaining: int):
+        body = f"remaintime={remaining}".encode()
+        req = urllib.request.Request(self.url, data=body, method="POST", headers={"X-Auth-Token": self.key})
+        urllib.request.urlopen(req, timeout=2).close()
+
+
+def percentile(values, p):
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(round(p / 100 * (len(ordered) - 1))))]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--board", required=True, help="board base URL, e.g. http://10.0.0.20")
+    parser.add_argument("--key", required=True, help="local API key")
+    parser.add_argument("--team", default="10")
+    parser.add_argument("--light", default="10")
+    parser.add_argument("--mqtt", help="broker host[:port]")
+    parser.add_argument("--firebase", help="Realtime Database URL")
+    parser.add_argument("--auth", help="Firebase ID token or database secret")
+    parser.add_argument("--local", action="store_true", help="write through the board's local API")
+    parser.add_argument("--rounds", type=int, default=30)
+    parser.add_argument("--poll-ms", type=float, default=5)
+    parser.add_argument("--timeout", type=float, default=5, help="seconds before a round counts as lost")
+    args = parser.parse_args()
+
+    if [bool(args.mqtt), bool(args.firebase), args.local].count(True) != 1:
+        parser.error("use exactly one of --mqtt, --firebase or --local")
+    if args.firebase and not args.auth:
+        parser.error("--firebase needs --auth")
+
+    if args.mqtt:
+        path, writer = "mqtt", MqttWriter(args.mqtt, args.team, args.light)
+    elif args.firebase:
+        path, writer = "firebase", FirebaseWriter(args.firebase, args.auth, args.team, args.light)
+    else:
+        path, writer = "local", LocalWriter(args.board, args.key)
+
+    polled = []
+    stamped = []
+    lost = 0
+    for i in range(args.rounds):
+        # Values the plan never uses, so every round is a real change
+        remaining = 5000 + (i % 2) * 1000 + i
+        sent_ms = time.time() * 1000
+        start = time.monotonic()
+        writer.write(remaining)
+
+        while time.monotonic() - start < args.timeout:
+            state = board_state(args.board, args.key)
+            if state["remaintime"] == remaining:
+                polled.append((time.monotonic() - start) * 1000)
+                if state.get("changed_ms"):
+                    stamped.append(state["changed_ms"] - sent_ms)
+                break
+            time.sleep(args.poll_ms / 1000)
+        else:
+            lost += 1
+
+        time.sleep(0.2)
+
+    if not polled:
+        print("no round reached the board", file=sys.stderr)
+        return 1
+
+    print(f"path: {path}, rounds: {args.rounds}, lost: {lost}")
+    for name, values in (("polled", polled), ("stamped", stamped)):
+        if not values:
+            print(f"{name} ms: none (board clock not set)")
+            continue
+        print(f"{name} ms: p50 {percentile(values, 50):.1f}  p90 {percentile(values, 90):.1f}  "
+              f"p99 {percentile(values, 99):.1f}  max {max(values):.1f}  mean {statistics.mean(values):.1f}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
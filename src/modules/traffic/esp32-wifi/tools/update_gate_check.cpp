@@ -0,0 +1,234 @@
+// Update gate check.
+//
+// Runs the sequence and age rules of the stream (lib/TrafficCore/UpdateStamp,
+// UpdateGate::filter) and the delivery latency histogram through fixed cases
+// and compares each result with the expected one:
+//   - the first update and every snapshot re-base the sequence, unmeasured
+//   - an in-order update on time is fresh and measured; without a clock it
+//     is fresh and unmeasured
+//   - a repeated or older seq is out of order; only the fields a newer
+//     update already set are dropped
+//   - skipped sequence numbers count as gaps, also across a counter wrap
+//   - a stale update loses its remaintime and keeps its other fields, and
+//     still outdates an older remaintime
+//   - percentiles: -1 when empty, the bucket bound, LATENCY_OVER_MS in the
+//     open last bucket, and bounds, min/max and negative samples
+// Prints one line per failed case. Exits 1 on failure.
+//   ./update_gate_check
+//
+// Build from the esp32-wifi directory:
+//   g++ -std=c++17 -O2 -Ilib/TrafficCore -o update_gate_check tools/update_gate_check.cpp lib/TrafficCore/UpdateStamp.cpp lib/TrafficCore/LightState.cpp
+
+#include "LightState.h"
+#include "UpdateStamp.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+static int failures = 0;
+static int checks = 0;
+
+static void expect(bool ok, const std::string &what)
+{
+  checks++;
+  if (ok)
+    return;
+  failures++;
+  printf("FAIL: %s\n", what.c_str());
+}
+
+// ================= GATE =================
+
+const uint64_t NOW_MS = 1760000000000ULL;
+
+struct Case
+{
+  UpdateStamp stamp;
+  bool snapshot;
+  uint64_t nowMs;
+  std::vector<FieldUpdate> updates;
+};
+
+static std::string fieldsText(const FieldUpdate *updates, size_t count)
+{
+  std::string text;
+  for (size_t i = 0; i < count; i++)
+  {
+    if (i > 0)
+      text += ",";
+    text += std::string(lightFieldName(updates[i].field)) + "=" + std::to_string(updates[i].value);
+  }
+  return text.empty() ? "-" : text;
+}
+
+// Filters one update and checks the verdict, the fields kept and the latency
+static void step(UpdateGate &gate, const char *name, const Case &in, StampVerdict verdict, const char *kept,
+                 bool measured, int32_t latencyMs = 0)
+{
+  std::vector<FieldUpdate> updates = in.updates;
+  StampResult result;
+  size_t count = gate.filter(in.stamp, in.snapshot, in.nowMs, updates.data(), updates.size(), result);
+  std::string got = fieldsText(updates.data(), count);
+
+  expect(result.verdict == verdict, std::string(name) + ": verdict " + stampVerdictName(result.verdict) +
+                                        ", expected " + stampVerdictName(verdict));
+  expect(got == kept, std::string(name) + ": kept " + got + ", expected " + kept);
+  expect(result.measured == measured && (!measured || result.latencyMs == latencyMs),
+         std::string(name) + ": latency " + (result.measured ? std::to_string(result.latencyMs) : "unmeasured") +
+             ", expected " + (measured ? std::to_string(latencyMs) : "unmeasured"));
+}
+
+static UpdateStamp stampAt(uint32_t seq, uint64_t serverMs)
+{
+  UpdateStamp stamp;
+  stamp.seq = seq;
+  stamp.serverMs = serverMs;
+  return stamp;
+}
+
+static void checkGate()
+{
+  UpdateGate gate;
+
+  // Not synced yet: the first update is taken as a snapshot whatever it says
+  step(gate, "first update", {stampAt(10, NOW_MS - 9000), false, NOW_MS, {{FIELD_COLOR, 3}, {FIELD_REMAINTIME, 20}}},
+       STAMP_SNAPSHOT, "color=3,remaintime=20", false);
+  expect(gate.synced() && gate.lastSeq() == 10, "first update: not synced on seq 10");
+
+  step(gate, "in order", {stampAt(11, NOW_MS - 120), false, NOW_MS, {{FIELD_REMAINTIME, 19}}}, STAMP_FRESH,
+       "remaintime=19", true, 120);
+  step(gate, "no clock", {stampAt(12, NOW_MS - 9000), false, 0, {{FIELD_REMAINTIME, 18}}}, STAMP_FRESH,
+       "remaintime=18", false);
+
+  // Clock skew: arrives "before" it was written, still fresh
+  step(gate, "skewed clock", {stampAt(13, NOW_MS + 40), false, NOW_MS, {{FIELD_REMAINTIME, 17}}}, STAMP_FRESH,
+       "remaintime=17", true, -40);
+
+  // A repeat (second stream during an auth rotation) and an older update
+  step(gate, "repeat", {stampAt(13, NOW_MS), false, NOW_MS, {{FIELD_REMAINTIME, 17}}}, STAMP_OUT_OF_ORDER, "-",
+       false);
+  step(gate, "older", {stampAt(11, NOW_MS), false, NOW_MS, {{FIELD_REMAINTIME, 19}}}, STAMP_OUT_OF_ORDER, "-",
+       false);
+
+  // Two skipped: 16 arrives before 15 and 14. Late fields that nothing newer
+  // has set still apply
+  step(gate, "gap", {stampAt(16, NOW_MS - 50), false, NOW_MS, {{FIELD_COLOR, 2}, {FIELD_REMAINTIME, 3}}},
+       STAMP_FRESH, "color=2,remaintime=3", true, 50);
+  expect(gate.gaps == 2, "gap: " + std::to_string(gate.gaps) + " gaps, expected 2");
+  step(gate, "late, other field", {stampAt(14, NOW_MS), false, NOW_MS, {{FIELD_YELLOW, 4}, {FIELD_COLOR, 3}}},
+       STAMP_OUT_OF_ORDER, "yellow_duration=4", false);
+  step(gate, "later than late field", {stampAt(15, NOW_MS), false, NOW_MS, {{FIELD_YELLOW, 5}}},
+       STAMP_OUT_OF_ORDER, "yellow_duration=5", false);
+  step(gate, "late field again", {stampAt(14, NOW_MS), false, NOW_MS, {{FIELD_YELLOW, 4}}}, STAMP_OUT_OF_ORDER,
+       "-", false);
+
+  // Stale: remaintime dropped, the rest applies
+  step(gate, "stale",
+       {stampAt(17, NOW_MS - UPDATE_MAX_AGE_MS - 1), false, NOW_MS, {{FIELD_COLOR, 1}, {FIELD_REMAINTIME, 30}}},
+       STAMP_STALE, "color=1", true, UPDATE_MAX_AGE_MS + 1);
+  step(gate, "at the age limit",
+       {stampAt(18, NOW_MS - UPDATE_MAX_AGE_MS), false, NOW_MS, {{FIELD_REMAINTIME, 28}}}, STAMP_FRESH,
+       "remaintime=28", true, UPDATE_MAX_AGE_MS);
+
+  // A stale remaintime is dropped but still outdates an older one that
+  // arrives after it
+  step(gate, "stale blocks older", {stampAt(20, NOW_MS - 5000), false, NOW_MS, {{FIELD_REMAINTIME, 25}}},
+       STAMP_STALE, "-", true, 5000);
+  step(gate, "older than stale", {stampAt(19, NOW_MS), false, NOW_MS, {{FIELD_REMAINTIME, 26}}},
+       STAMP_OUT_OF_ORDER, "-", false);
+
+  // A snapshot re-bases even to a lower seq (node recreated)
+  step(gate, "snapshot", {stampAt(3, NOW_MS - 60000), true, NOW_MS, {{FIELD_COLOR, 3}, {FIELD_STATUS, 0}}},
+       STAMP_SNAPSHOT, "color=3,status=0", false);
+  step(gate, "after snapshot", {stampAt(4, NOW_MS - 10), false, NOW_MS, {{FIELD_REMAINTIME, 9}}}, STAMP_FRESH,
+       "remaintime=9", true, 10);
+
+  // Reconnect: the next update is a snapshot even without the flag
+  gate.resync();
+  step(gate, "after resync", {stampAt(2, NOW_MS - 10), false, NOW_MS, {{FIELD_COLOR, 1}}}, STAMP_SNAPSHOT,
+       "color=1", false);
+
+  // The counter wraps
+  step(gate, "wrap base", {stampAt(0xFFFFFFFE, NOW_MS), true, NOW_MS, {{FIELD_COLOR, 3}}}, STAMP_SNAPSHOT,
+       "color=3", false);
+  uint32_t gapsBefore = gate.gaps;
+  step(gate, "across the wrap", {stampAt(1, NOW_MS - 5), false, NOW_MS, {{FIELD_COLOR, 2}}}, STAMP_FRESH,
+       "color=2", true, 5);
+  expect(gate.gaps - gapsBefore == 2, "across the wrap: " + std::to_string(gate.gaps - gapsBefore) +
+                                           " gaps, expected 2");
+  step(gate, "before the wrap", {stampAt(0xFFFFFFFF, NOW_MS), false, NOW_MS, {{FIELD_COLOR, 3}}},
+       STAMP_OUT_OF_ORDER, "-", false);
+
+  // Counter totals over the whole run
+  expect(gate.snapshots == 4 && gate.fresh == 7 && gate.stale == 2 && gate.outOfOrder == 7,
+         "counters: " + std::to_string(gate.snapshots) + " snapshots, " + std::to_string(gate.fresh) + " fresh, " +
+             std::to_string(gate.stale) + " stale, " + std::to_string(gate.outOfOrder) + " out of order");
+  expect(gate.dropped == 8, "counters: " + std::to_string(gate.dropped) + " dropped fields, expected 8");
+}
+
+// ================= HISTOGRAM =================
+
+static void expectPercentile(const LatencyHistogram &h, const char *name, uint32_t percent, int32_t want)
+{
+  int32_t got = h.percentileMs(percent);
+  expect(got == want, std::string(name) + ": p" + std::to_string(percent) + " " + std::to_string(got) +
+                          ", expected " + std::to_string(want));
+}
+
+static void checkHistogram()
+{
+  LatencyHistogram h;
+  expectPercentile(h, "empty", 50, -1);
+  expectPercentile(h, "empty", 99, -1);
+
+  // On a bound goes in that bucket, one past it in the next
+  h.add(50);
+  h.add(51);
+  expect(h.buckets[0] == 1 && h.buckets[1] == 1, "bounds: 50 and 51 not in buckets 0 and 1");
+  h.reset();
+
+  // 98 at 40 ms, one at 700, one at 9000
+  for (int i = 0; i < 98; i++)
+    h.add(40);
+  h.add(700);
+  h.add(9000);
+  expectPercentile(h, "tail", 50, 50);
+  expectPercentile(h, "tail", 98, 50);
+  expectPercentile(h, "tail", 99, 1000);
+  expectPercentile(h, "tail", 100, LATENCY_OVER_MS);
+  expect(h.count == 100 && h.minMs == 40 && h.maxMs == 9000 && h.averageMs() == (98 * 40 + 700 + 9000) / 100,
+         "tail: count/min/max/avg");
+  expect(h.buckets[LATENCY_BUCKETS - 1] == 1, "tail: 9000 not in the open last bucket");
+
+  // Everything over 5000: the percentile must not read as "no samples"
+  h.reset();
+  for (int i = 0; i < 10; i++)
+    h.add(6000 + i);
+  expectPercentile(h, "all over", 50, LATENCY_OVER_MS);
+  expectPercentile(h, "all over", 99, LATENCY_OVER_MS);
+  expect(LATENCY_OVER_MS != -1 && LATENCY_OVER_MS > LATENCY_BUCKET_MS[LATENCY_BUCKETS - 2],
+         "all over: LATENCY_OVER_MS is not distinct");
+
+  // Negative samples (clock skew) land in the first bucket and are counted
+  h.reset();
+  h.add(-30);
+  h.add(20);
+  expectPercentile(h, "negative", 50, 50);
+  expect(h.negative == 1 && h.minMs == -30 && h.buckets[0] == 2, "negative: not counted in bucket 0");
+
+  // A single sample: every percentile is its bucket
+  h.reset();
+  h.add(150);
+  expectPercentile(h, "single", 0, 200);
+  expectPercentile(h, "single", 100, 200);
+}
+
+int main()
+{
+  checkGate();
+  checkHistogram();
+
+  printf("%d checks, %d failed\n", checks, failures);
+  return failures ? 1 : 0;
+}
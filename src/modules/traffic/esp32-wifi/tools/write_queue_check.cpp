@@ -0,0 +1,304 @@
+// Write queue check.
+//
+// Drives the outbound write queue (lib/TrafficCore/WriteQueue) on a
+// simulated ms clock through fixed cases and compares the batches it builds
+// and its stats with the expected ones:
+//   - writes within the coalescing window go out as one batch, and a path
+//     written twice keeps only its latest value
+//   - a new path when every slot holds another one, and a path or value that
+//     is too long, are refused and counted as overflows
+//   - a batch with no answer times out as a failure; the backoff after
+//     failures doubles from WRITE_RETRY_MIN_MS up to WRITE_RETRY_MAX_MS, and
+//     a batch that lands resets it
+//   - an answer for a batch id that is no longer in flight is ignored
+//   - a value put again while its batch is in flight stays queued when the
+//     batch lands, and goes out with the next one
+//   - a batch handed off unconfirmed (MQTT QoS 0) is done, counts as
+//     unconfirmed, not landed, and records no round trip time
+//   - the 32-bit clock wrapping during a backoff
+// Prints one line per failed case. Exits 1 on failure.
+//   ./write_queue_check
+//
+// Build from the esp32-wifi directory:
+//   g++ -std=c++17 -O2 -Ilib/TrafficCore -o write_queue_check tools/write_queue_check.cpp lib/TrafficCore/WriteQueue.cpp
+
+#include "WriteQueue.h"
+
+#include <cstdio>
+#include <string>
+
+static int failures = 0;
+static int checks = 0;
+
+static void expect(bool ok, const std::string &what)
+{
+  checks++;
+  if (ok)
+    return;
+  failures++;
+  printf("FAIL: %s\n", what.c_str());
+}
+
+static void expectEq(uint64_t got, uint64_t want, const std::string &what)
+{
+  expect(got == want, what + ": " + std::to_string(got) + ", expected " + std::to_string(want));
+}
+
+// Batch text, "" when takeBatch() built none
+static std::string take(WriteQueue &q, uint32_t nowMs)
+{
+  char buf[WRITE_BATCH_MAX];
+  size_t n = q.takeBatch(buf, sizeof(buf), nowMs);
+  return n ? std::string(buf, n) : std::string();
+}
+
+static void expectBatch(WriteQueue &q, uint32_t nowMs, const std::string &want, const std::string &what)
+{
+  expect(q.due(nowMs), what + ": not due at " + std::to_string(nowMs));
+  std::string got = take(q, nowMs);
+  expect(got == want, what + ": batch " + (got.empty() ? "none" : got) + ", expected " + want);
+}
+
+// First ms at which due() turns true, searching from fromMs; UINT32_MAX if
+// not within limitMs
+static uint32_t dueAt(WriteQueue &q, uint32_t fromMs, uint32_t limitMs)
+{
+  for (uint32_t t = fromMs; t - fromMs <= limitMs; t++)
+  {
+    if (q.due(t))
+      return t;
+  }
+  return UINT32_MAX;
+}
+
+// ================= CASES =================
+
+static void checkCoalescing()
+{
+  WriteQueue q;
+  q.putBool("online", true, 1000);
+  q.putInt("applied/color", 2, 1050);
+  q.putInt("applied/color", 3, 1100); // latest value wins
+  q.putInt("applied/remaintime", 12, 1150);
+
+  expect(!q.due(1000 + WRITE_COALESCE_MS - 1), "coalescing: due inside the window");
+  expectEq(q.pending(), 3, "coalescing: pending paths");
+  expectBatch(q, 1000 + WRITE_COALESCE_MS, "{\"online\":true,\"applied/color\":3,\"applied/remaintime\":12}",
+              "coalescing");
+  expectEq(q.stats.writes, 4, "coalescing: writes");
+  expectEq(q.stats.merged, 1, "coalescing: merged");
+  expectEq(q.stats.values, 3, "coalescing: values");
+  expect(q.inFlight() && q.batchId() == 1, "coalescing: batch 1 not in flight");
+
+  // Nothing more goes out while a batch is in flight
+  q.putInt("applied/status", 0, 1300);
+  expect(!q.due(1300 + WRITE_COALESCE_MS), "coalescing: due while in flight");
+
+  q.done(1, true, 1400);
+  expectEq(q.stats.landed, 1, "coalescing: landed");
+  expectEq(q.stats.lastRttMs, 200, "coalescing: round trip");
+  expectEq(q.pending(), 1, "coalescing: pending after the answer");
+  expectBatch(q, 1500, "{\"applied/status\":0}", "coalescing: the write made in flight");
+  q.done(2, true, 1520);
+  expectEq(q.pending(), 0, "coalescing: pending at the end");
+  expect(!q.due(5000), "coalescing: due with nothing queued");
+  expectEq(take(q, 5000).size(), 0, "coalescing: batch with nothing queued");
+}
+
+static void checkOverflow()
+{
+  WriteQueue q;
+  for (size_t i = 0; i < WRITE_QUEUE_SLOTS; i++)
+    expect(q.putInt(("p" + std::to_string(i)).c_str(), (long)i, 0), "overflow: slot " + std::to_string(i));
+
+  expect(!q.putInt("extra", 1, 0), "overflow: a new path past the slots taken");
+  expect(q.putInt("p3", 33, 0), "overflow: a queued path refused when full");
+  expect(!q.put(std::string(WRITE_PATH_MAX, 'x').c_str(), "1", 0), "overflow: a long path taken");
+  expect(!q.put("p0", std::string(WRITE_VALUE_MAX, '1').c_str(), 0), "overflow: a long value taken");
+  expectEq(q.stats.overflows, 3, "overflow: overflows");
+  expectEq(q.pending(), WRITE_QUEUE_SLOTS, "overflow: pending");
+
+  // The largest batch still fits WRITE_BATCH_MAX
+  WriteQueue big;
+  std::string value = "\"" + std::string(WRITE_VALUE_MAX - 3, 'v') + "\"";
+  for (size_t i = 0; i < WRITE_QUEUE_SLOTS; i++)
+  {
+    std::string path = std::string(WRITE_PATH_MAX - 2, 'a' + (char)i);
+    expect(big.put(path.c_str(), value.c_str(), 0), "overflow: longest path and value");
+  }
+  std::string batch = take(big, WRITE_COALESCE_MS);
+  expect(!batch.empty() && batch.size() < WRITE_BATCH_MAX, "overflow: largest batch did not fit WRITE_BATCH_MAX");
+
+  // A buffer too small for the batch builds none and leaves it queued
+  WriteQueue small;
+  small.putInt("applied/color", 3, 0);
+  char buf[8];
+  expectEq(small.takeBatch(buf, sizeof(buf), WRITE_COALESCE_MS), 0, "overflow: batch in a small buffer");
+  expect(!small.inFlight() && small.pending() == 1, "overflow: small buffer took the batch");
+}
+
+static void checkTimeoutAndBackoff()
+{
+  WriteQueue q;
+  uint32_t now = 0;
+  q.putInt("applied/color", 1, now);
+  now += WRITE_COALESCE_MS;
+  expectBatch(q, now, "{\"applied/color\":1}", "timeout: first batch");
+
+  // No answer: failed at WRITE_TIMEOUT_MS, then backoff doubling to the cap
+  uint32_t expected = WRITE_RETRY_MIN_MS;
+  for (int attempt = 1; attempt <= 10; attempt++)
+  {
+    uint32_t sentMs = now;
+    expect(!q.due(sentMs + WRITE_TIMEOUT_MS - 1), "timeout: timed out early, attempt " + std::to_string(attempt));
+    expect(q.inFlight(), "timeout: not in flight, attempt " + std::to_string(attempt));
+    q.due(sentMs + WRITE_TIMEOUT_MS);
+    expect(!q.inFlight(), "timeout: still in flight, attempt " + std::to_string(attempt));
+    expectEq(q.backoffMs(), expected, "timeout: backoff after attempt " + std::to_string(attempt));
+
+    // The coalescing window restarts with the failure; the backoff is longer
+    uint32_t at = dueAt(q, sentMs + WRITE_TIMEOUT_MS, WRITE_RETRY_MAX_MS * 2);
+    expectEq(at - (sentMs + WRITE_TIMEOUT_MS), expected, "timeout: retry after attempt " + std::to_string(attempt));
+    now = at;
+    expectBatch(q, now, "{\"applied/color\":1}", "timeout: retry " + std::to_string(attempt));
+    expected = expected * 2 > WRITE_RETRY_MAX_MS ? WRITE_RETRY_MAX_MS : expected * 2;
+  }
+  expectEq(q.stats.timeouts, 10, "timeout: timeouts");
+  expectEq(q.stats.failures, 10, "timeout: failures");
+  expectEq(q.backoffMs(), WRITE_RETRY_MAX_MS, "timeout: backoff at the cap");
+
+  // Explicit failures double it the same way; a batch that lands resets it
+  WriteQueue f;
+  f.putInt("applied/status", 1, 0);
+  now = WRITE_COALESCE_MS;
+  take(f, now);
+  f.done(f.batchId(), false, now + 10);
+  expectEq(f.backoffMs(), WRITE_RETRY_MIN_MS, "backoff: after one failure");
+  now = dueAt(f, now + 10, WRITE_RETRY_MAX_MS);
+  take(f, now);
+  f.done(f.batchId(), false, now + 10);
+  expectEq(f.backoffMs(), 2 * WRITE_RETRY_MIN_MS, "backoff: after two failures");
+  now = dueAt(f, now + 10, WRITE_RETRY_MAX_MS);
+  expectBatch(f, now, "{\"applied/status\":1}", "backoff: retry");
+  f.done(f.batchId(), true, now + 30);
+  expectEq(f.backoffMs(), 0, "backoff: after landing");
+  expectEq(f.stats.lastRttMs, 30, "backoff: round trip of the batch that landed");
+  f.putInt("applied/status", 0, now + 40);
+  expectEq(dueAt(f, now + 40, WRITE_RETRY_MAX_MS) - (now + 40), WRITE_COALESCE_MS, "backoff: next write waits");
+
+  // Backoff across the 32-bit clock wrap
+  WriteQueue w;
+  uint32_t nearWrap = UINT32_MAX - 500;
+  w.putInt("applied/color", 2, nearWrap - WRITE_COALESCE_MS);
+  take(w, nearWrap);
+  w.done(w.batchId(), false, nearWrap);
+  expect(!w.due(nearWrap + WRITE_RETRY_MIN_MS - 1), "wrap: due before the backoff");
+  expect(w.due(nearWrap + WRITE_RETRY_MIN_MS), "wrap: not due after the backoff");
+}
+
+static void checkLateAnswers()
+{
+  WriteQueue q;
+  q.putInt("applied/color", 3, 0);
+  take(q, WRITE_COALESCE_MS);
+  uint32_t first = q.batchId();
+
+  // Batch 1 times out and goes out again as batch 2
+  q.due(WRITE_COALESCE_MS + WRITE_TIMEOUT_MS);
+  uint32_t now = dueAt(q, WRITE_COALESCE_MS + WRITE_TIMEOUT_MS, WRITE_RETRY_MAX_MS);
+  take(q, now);
+  uint32_t second = q.batchId();
+  expect(second != first, "late: retry has the same batch id");
+
+  // The answer to batch 1 turns up now: it says nothing about batch 2
+  q.done(first, true, now + 5);
+  expectEq(q.stats.lateAnswers, 1, "late: late answers");
+  expect(q.inFlight(), "late: the late answer finished the batch in flight");
+  expectEq(q.stats.landed, 0, "late: landed after a late answer");
+  q.doneUnconfirmed(first, now + 6);
+  expectEq(q.stats.lateAnswers, 2, "late: late unconfirmed hand-off");
+  expect(q.inFlight(), "late: a late hand-off finished the batch in flight");
+
+  q.done(second, true, now + 50);
+  expectEq(q.stats.landed, 1, "late: landed");
+  expectEq(q.stats.lastRttMs, 50, "late: round trip of the batch that landed");
+
+  // And an answer with nothing in flight
+  q.done(second, true, now + 60);
+  expectEq(q.stats.lateAnswers, 3, "late: second answer to the same batch");
+}
+
+static void checkRePutInFlight()
+{
+  WriteQueue q;
+  q.putInt("applied/color", 1, 0);
+  q.putInt("applied/remaintime", 30, 0);
+  take(q, WRITE_COALESCE_MS);
+
+  // color changes while the batch is out
+  q.putInt("applied/color", 3, 250);
+  expectEq(q.stats.merged, 0, "in flight: a new value counted as merged");
+  q.putInt("applied/color", 2, 260);
+  expectEq(q.stats.merged, 1, "in flight: a second new value not merged");
+
+  q.done(q.batchId(), true, 300);
+  expectEq(q.pending(), 1, "in flight: pending after the answer");
+  expectBatch(q, 250 + WRITE_COALESCE_MS, "{\"applied/color\":2}", "in flight: the newer value");
+  q.done(q.batchId(), true, 500);
+  expectEq(q.pending(), 0, "in flight: pending at the end");
+
+  // On failure everything in the batch goes again, with the newest values
+  WriteQueue f;
+  f.putInt("applied/color", 1, 0);
+  f.putInt("applied/remaintime", 30, 0);
+  take(f, WRITE_COALESCE_MS);
+  f.putInt("applied/remaintime", 29, 300);
+  f.done(f.batchId(), false, 400);
+  uint32_t at = dueAt(f, 400, WRITE_RETRY_MAX_MS);
+  expectBatch(f, at, "{\"applied/color\":1,\"applied/remaintime\":29}", "in flight: retry after a failure");
+}
+
+static void checkUnconfirmed()
+{
+  WriteQueue q;
+  q.putBool("online", true, 0);
+  take(q, WRITE_COALESCE_MS);
+  q.doneUnconfirmed(q.batchId(), WRITE_COALESCE_MS + 1);
+  expect(!q.inFlight() && q.pending() == 0, "unconfirmed: batch not done");
+  expectEq(q.stats.unconfirmed, 1, "unconfirmed: unconfirmed");
+  expectEq(q.stats.landed, 0, "unconfirmed: landed");
+  expectEq(q.stats.lastRttMs, 0, "unconfirmed: round trip recorded");
+  expectEq(q.backoffMs(), 0, "unconfirmed: backoff");
+
+  // It clears a backoff like a landed batch, and a value put meanwhile stays
+  q.putInt("applied/color", 3, 500);
+  take(q, 500 + WRITE_COALESCE_MS);
+  q.done(q.batchId(), false, 800);
+  expectEq(q.backoffMs(), WRITE_RETRY_MIN_MS, "unconfirmed: backoff after a failure");
+  uint32_t at = dueAt(q, 800, WRITE_RETRY_MAX_MS);
+  take(q, at);
+  q.putInt("applied/color", 1, at + 5);
+  q.doneUnconfirmed(q.batchId(), at + 10);
+  expectEq(q.backoffMs(), 0, "unconfirmed: backoff after a hand-off");
+  expectEq(q.pending(), 1, "unconfirmed: value put in flight");
+  expectBatch(q, at + 5 + WRITE_COALESCE_MS, "{\"applied/color\":1}", "unconfirmed: value put in flight");
+  q.done(q.batchId(), true, at + 5 + WRITE_COALESCE_MS + 40);
+  expectEq(q.stats.unconfirmed, 2, "unconfirmed: unconfirmed at the end");
+  expectEq(q.stats.landed, 1, "unconfirmed: landed at the end");
+  expectEq(q.stats.maxRttMs, 40, "unconfirmed: max round trip");
+  expectEq(q.stats.batches, q.stats.landed + q.stats.unconfirmed + q.stats.failures,
+           "unconfirmed: batches = landed + unconfirmed + failed");
+}
+
+int main()
+{
+  checkCoalescing();
+  checkOverflow();
+  checkTimeoutAndBackoff();
+  checkLateAnswers();
+  checkRePutInFlight();
+  checkUnconfirmed();
+
+  printf("%d checks, %d failed\n", checks, failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,196 @@
+import { ServerValue } from 'firebase-admin/database';
+import type { DataSnapshot, Reference } from 'firebase-admin/database';
+import { firebaseDatabase } from '@/config/firebase';
+
+// Fields a traffic light board actually renders, plus the density level a
+// board running its own plan times its cycle from. Everything else on the
+// light node (metadata, location, ...) stays out of the device view.
+const RENDER_FIELDS = [
+  'color',
+  'remaintime',
+  'yellow_duration',
+  'status',
+  'preempt',
+  'density_level',
+] as const;
+
+type RenderField = (typeof RENDER_FIELDS)[number];
+type DeviceView = Partial<Record<RenderField, number>>;
+
+const LOG_PREFIX = '[traffic][device-view]';
+
+const isMirrorDisabled =
+  process.env.TRAFFIC_DISABLE_DEVICE_VIEW_MIRROR === 'true' ||
+  process.env.NODE_ENV === 'test';
+
+// Teams whose lights are mirrored (comma separated, defaults to team 10)
+const mirroredTeams = (process.env.TRAFFIC_DEVICE_VIEW_TEAMS || '10')
+  .split(',')
+  .map((team) => team.trim())
+  .filter(Boolean);
+
+const lightsRef = (teamId: string) =>
+  firebaseDatabase.ref(`teams/${teamId}/traffic_lights`);
+const deviceViewRef = (teamId: string, lightId: string) =>
+  firebaseDatabase.ref(`teams/${teamId}/device_view/${lightId}`);
+
+const lastViews = new Map<string, DeviceView>();
+// Callbacks are removed one by one: the pedestrian call listener listens on
+// the same nodes
+const listeners: {
+  ref: Reference;
+  added: (snapshot: DataSnapshot) => void;
+  changed: (snapshot: DataSnapshot) => void;
+  removed: (snapshot: DataSnapshot) => void;
+}[] = [];
+let started = false;
+let writes = 0;
+let skipped = 0;
+let lastWriteAt: string | null = null;
+
+// Sequence number and server time for every write, resolved by the database
+// itself: boards drop updates that arrive out of order and measure how long
+// each one took to reach them.
+const writeStamp = () => ({
+  seq: ServerValue.increment(1),
+  ts: ServerValue.TIMESTAMP,
+});
+
+// Pick the render fields out of a full light node.
+const toDeviceView = (node: unknown): DeviceView => {
+  const view: DeviceView = {};
+  if (!node || typeof node !== 'object') return view;
+
+  for (const field of RENDER_FIELDS) {
+    const value = (node as Record<string, unknown>)[field];
+    if (typeof value === 'number' && Number.isFinite(value)) {
+      view[field] = value;
+    }
+  }
+  return view;
+};
+
+// Fields that changed since the last mirrored view (null removes a field).
+const diffDeviceView = (
+  previous: DeviceView,
+  next: DeviceView
+): Record<string, number | null> => {
+  const changes: Record<string, number | null> = {};
+  for (const field of RENDER_FIELDS) {
+    if (previous[field] !== next[field]) {
+      changes[field] = next[field] ?? null;
+    }
+  }
+  return changes;
+};
+
+// Write only what changed, so a board sees one small patch per render change
+// and nothing at all when a non-render field changes.
+const mirrorLight = async (teamId: string, snapshot: DataSnapshot) => {
+  const lightId = snapshot.key;
+  if (!lightId) return;
+
+  const key = `${teamId}/${lightId}`;
+  const view = toDeviceView(snapshot.val());
+  const previous = lastViews.get(key);
+
+  try {
+    if (!previous) {
+      // First sight since startup: replace the node to drop stale fields
+      await deviceViewRef(teamId, lightId).set({ ...view, ...writeStamp() });
+    } else {
+      const changes = diffDeviceView(previous, view);
+      if (Object.keys(changes).length === 0) {
+        skipped += 1;
+        return;
+      }
+      await deviceViewRef(teamId, lightId).update({
+        ...changes,
+        ...writeStamp(),
+      });
+    }
+
+    lastViews.set(key, view);
+    writes += 1;
+    lastWriteAt = new Date().toISOString();
+  } catch (error) {
+    console.error(`${LOG_PREFIX} Failed to mirror light ${key}:`, error);
+  }
+};
+
+const removeLight = async (teamId: string, snapshot: DataSnapshot) => {
+  const lightId = snapshot.key;
+  if (!lightId) return;
+
+  lastViews.delete(`${teamId}/${lightId}`);
+  try {
+    await deviceViewRef(teamId, lightId).remove();
+  } catch (error) {
+    console.error(
+      `${LOG_PREFIX} Failed to remove light ${teamId}/${lightId}:`,
+      error
+    );
+  }
+};
+
+// Follow every mirrored team's light nodes and keep the device views in step.
+const startDeviceViewMirror = () => {
+  if (isMirrorDisabled) {
+    console.info(`${LOG_PREFIX} Mirror disabled via env flag`);
+    return;
+  }
+  if (started) {
+    return;
+  }
+  started = true;
+
+  for (const teamId of mirroredTeams) {
+    const ref = lightsRef(teamId);
+    const added = (snapshot: DataSnapshot) =>
+      void mirrorLight(teamId, snapshot);
+    const changed = (snapshot: DataSnapshot) =>
+      void mirrorLight(teamId, snapshot);
+    const removed = (snapshot: DataSnapshot) =>
+      void removeLight(teamId, snapshot);
+    ref.on('child_added', added);
+    ref.on('child_changed', changed);
+    ref.on('child_removed', removed);
+    listeners.push({ ref, added, changed, removed });
+  }
+
+  console.info(
+    `${LOG_PREFIX} Mirror started for teams: ${mirroredTeams.join(', ')}`
+  );
+};
+
+// Allow callers/tests to detach the listeners explicitly.
+const stopDeviceViewMirror = () => {
+  for (const { ref, added, changed, removed } of listeners) {
+    ref.off('child_added', added);
+    ref.off('child_changed', changed);
+    ref.off('child_removed', removed);
+  }
+  listeners.length = 0;
+  lastViews.clear();
+  started = false;
+};
+
+// Expose the mirror status for diagnostics or future routes.
+const getDeviceViewMirrorStatus = () => ({
+  enabled: started,
+  teams: mirroredTeams,
+  lights: lastViews.size,
+  writes,
+  skipped,
+  lastWriteAt,
+});
+
+export {
+  RENDER_FIELDS,
+  mirroredTeams,
+  toDeviceView,
+  diffDeviceView,
+  startDeviceViewMirror,
+  stopDeviceViewMirror,
+  getDeviceViewMirrorStatus,
+};
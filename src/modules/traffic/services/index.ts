@@ -6,3 +6,5 @@ export * as TimingService from './timing.service';
 export * as RoadService from './roads.services';
 export * as TrafficEmergencyService from './traffic_emergencies.services';
 export * as IntersectionService from './intersection.service';
+export * as DeviceViewService from './device-view.service';
+export * as PedestrianCallService from './pedestrian-call.service';
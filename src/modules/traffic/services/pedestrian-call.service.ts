@@ -0,0 +1,198 @@
+import type { DataSnapshot, Reference } from 'firebase-admin/database';
+import { firebaseDatabase } from '@/config/firebase';
+import { mirroredTeams } from './device-view.service';
+import { createLightRequest } from './light-request.service';
+
+// A board with a pedestrian button writes `ped_call: { n, t }` to its light
+// node once per signal cycle, however often the button is pressed: `n` is
+// the call number, which the board keeps in NVS so it does not repeat after
+// a reboot, `t` is when the call was placed (epoch seconds, 0 before the
+// board's clock is set). Each call number not handled yet becomes one light
+// request. The last handled number per light is kept in the database, so a
+// restart of this server neither repeats a call nor loses one that came in
+// while it was down.
+
+const LOG_PREFIX = '[traffic][pedestrian-call]';
+
+const isListenerDisabled =
+  process.env.TRAFFIC_DISABLE_PEDESTRIAN_CALLS === 'true' ||
+  process.env.NODE_ENV === 'test';
+
+const lightsRef = (teamId: string) =>
+  firebaseDatabase.ref(`teams/${teamId}/traffic_lights`);
+// Outside the light node, so the boards' own writes never touch it
+const handledRef = (teamId: string, lightId: string) =>
+  firebaseDatabase.ref(`teams/${teamId}/ped_call_handled/${lightId}`);
+
+// A board ends a call it could not serve after 5 minutes; an older one
+// found late (the server was down) is only marked handled
+const CALL_MAX_AGE_S = 300;
+
+// Last handled call per light, loaded from the database on first sight
+const handledCalls = new Map<string, string | null>();
+// Callbacks are removed one by one: the device view mirror listens on the
+// same nodes
+const listeners: {
+  ref: Reference;
+  added: (snapshot: DataSnapshot) => void;
+  changed: (snapshot: DataSnapshot) => void;
+}[] = [];
+let started = false;
+let requests = 0;
+let expired = 0;
+let failures = 0;
+let lastRequestAt: string | null = null;
+
+// The call number on a light node as a string, null when there is none.
+const callKey = (node: unknown): string | null => {
+  if (!node || typeof node !== 'object') return null;
+  const call = (node as Record<string, unknown>).ped_call;
+  if (!call || typeof call !== 'object') return null;
+
+  const { n } = call as Record<string, unknown>;
+  if (typeof n !== 'number' || !Number.isInteger(n) || n <= 0) return null;
+  return String(n);
+};
+
+// When the call on a node (callKey() not null) was placed, 0 if unknown
+const callTime = (node: unknown): number => {
+  const { t } = (node as { ped_call: Record<string, unknown> }).ped_call;
+  return typeof t === 'number' ? t : 0;
+};
+
+// Fill handledCalls for a light the first time it is seen
+const loadHandled = async (teamId: string, lightId: string) => {
+  const key = `${teamId}/${lightId}`;
+  if (handledCalls.has(key)) return;
+
+  const value = (await handledRef(teamId, lightId).get()).val();
+  // Another check may have loaded or claimed it meanwhile
+  if (!handledCalls.has(key)) {
+    handledCalls.set(key, value === null ? null : String(value));
+  }
+};
+
+// Create the light request for a call; false if that failed
+const requestFor = async (key: string, lightId: string, node: unknown) => {
+  const placedAt = callTime(node);
+  if (placedAt > 0 && Date.now() / 1000 - placedAt > CALL_MAX_AGE_S) {
+    expired += 1;
+    console.info(`${LOG_PREFIX} Call from ${key} is over, not requested`);
+    return true;
+  }
+
+  const trafficLightId = Number(lightId);
+  if (!Number.isInteger(trafficLightId)) {
+    console.warn(`${LOG_PREFIX} Light ${key} has no numeric id, call ignored`);
+    return true;
+  }
+
+  try {
+    await createLightRequest({
+      traffic_light_id: trafficLightId,
+      requested_by: 'pedestrian_button',
+      priority: 'medium',
+      reason: 'pedestrian call',
+    });
+    requests += 1;
+    lastRequestAt = new Date().toISOString();
+    return true;
+  } catch (error) {
+    failures += 1;
+    console.error(`${LOG_PREFIX} Failed to record call from ${key}:`, error);
+    return false;
+  }
+};
+
+// The node was added (startup) or changed: create a light request if it
+// carries a call not handled yet. Other changes (heartbeat, applied state,
+// ...) are ignored.
+const checkCall = async (teamId: string, snapshot: DataSnapshot) => {
+  const lightId = snapshot.key;
+  if (!lightId) return;
+
+  const node = snapshot.val();
+  const call = callKey(node);
+  if (!call) return;
+
+  const key = `${teamId}/${lightId}`;
+  try {
+    await loadHandled(teamId, lightId);
+  } catch (error) {
+    failures += 1;
+    console.error(`${LOG_PREFIX} Cannot read handled call of ${key}:`, error);
+    return;
+  }
+
+  // Read and claimed without an await in between, so of two checks of the
+  // same call only one gets past here
+  const handled = handledCalls.get(key) ?? null;
+  if (handled === call) return;
+  handledCalls.set(key, call);
+  if (!(await requestFor(key, lightId, node))) {
+    // Tried again on the node's next change, unless a newer call came in
+    if (handledCalls.get(key) === call) handledCalls.set(key, handled);
+    return;
+  }
+
+  try {
+    await handledRef(teamId, lightId).set(Number(call));
+  } catch (error) {
+    // Still handled in memory; only a restart before the next call repeats it
+    console.error(`${LOG_PREFIX} Cannot store handled call of ${key}:`, error);
+  }
+};
+
+// Follow the light nodes of every device view team.
+const startPedestrianCallListener = () => {
+  if (isListenerDisabled) {
+    console.info(`${LOG_PREFIX} Listener disabled via env flag`);
+    return;
+  }
+  if (started) {
+    return;
+  }
+  started = true;
+
+  for (const teamId of mirroredTeams) {
+    const ref = lightsRef(teamId);
+    // Nodes present at startup are checked too: a call that came in while
+    // the server was down is handled now
+    const added = (snapshot: DataSnapshot) => void checkCall(teamId, snapshot);
+    const changed = (snapshot: DataSnapshot) =>
+      void checkCall(teamId, snapshot);
+    ref.on('child_added', added);
+    ref.on('child_changed', changed);
+    listeners.push({ ref, added, changed });
+  }
+
+  console.info(
+    `${LOG_PREFIX} Listening for calls from teams: ${mirroredTeams.join(', ')}`
+  );
+};
+
+const stopPedestrianCallListener = () => {
+  for (const { ref, added, changed } of listeners) {
+    ref.off('child_added', added);
+    ref.off('child_changed', changed);
+  }
+  listeners.length = 0;
+  handledCalls.clear();
+  started = false;
+};
+
+const getPedestrianCallStatus = () => ({
+  enabled: started,
+  teams: mirroredTeams,
+  requests,
+  expired,
+  failures,
+  lastRequestAt,
+});
+
+export {
+  callKey,
+  startPedestrianCallListener,
+  stopPedestrianCallListener,
+  getPedestrianCallStatus,
+};